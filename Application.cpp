@@ -1,8 +1,15 @@
 #include "Application.h"
 #include "ResourceManager.h"
 #include "GraphObjects.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "SessionFile.h"
+#include "ImageWriter.h"
 
 #include <glfw3webgpu.h>
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif
 #include <GLFW/glfw3.h>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -24,8 +31,14 @@
 #include <fstream>
 #include <sstream>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cctype>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <map>
+#include <thread>
 
 #include "json.hpp"
 using json = nlohmann::json;
@@ -148,6 +161,13 @@ namespace ImGui {
 ///////////////////////////////////////////////////////////////////////////////
 // Public methods
 
+bool Application::onInitHeadless(uint32_t width, uint32_t height) {
+	m_headless = true;
+	m_headlessWidth = std::max(width, 1u);
+	m_headlessHeight = std::max(height, 1u);
+	return onInit();
+}
+
 bool Application::onInit() {
 	if (!initWindowAndDevice()) return false;
 	if (!initSwapChain()) return false;
@@ -157,12 +177,22 @@ bool Application::onInit() {
 
 	if (!initRenderPipeline("boat", RESOURCE_DIR "/shader.wgsl", WGPUPrimitiveTopology_TriangleList)) return false;
 	if (!initRenderPipeline("axes", RESOURCE_DIR "/axes.wgsl", WGPUPrimitiveTopology_LineList)) return false;
-	if (!initRenderPipeline("surface", RESOURCE_DIR "/surface.wgsl", WGPUPrimitiveTopology_TriangleList)) return false;
+	if (!initRenderPipeline("surface", RESOURCE_DIR "/surface.wgsl", WGPUPrimitiveTopology_TriangleList, false, true)) return false;
+	if (!initRenderPipeline("lines", RESOURCE_DIR "/lines.wgsl", WGPUPrimitiveTopology_LineList, false, true)) return false;
+	if (!initRenderPipeline("glyph", RESOURCE_DIR "/glyph.wgsl", WGPUPrimitiveTopology_TriangleList, true)) return false;
+	if (!initRenderPipeline("surfaceOit", RESOURCE_DIR "/surface.wgsl", WGPUPrimitiveTopology_TriangleList, false, true, true)) return false;
+	if (!initRenderPipeline("heightfield", RESOURCE_DIR "/surface.wgsl", WGPUPrimitiveTopology_TriangleList, false, true, false, true)) return false;
+	if (!initRenderPipeline("heightfieldOit", RESOURCE_DIR "/surface.wgsl", WGPUPrimitiveTopology_TriangleList, false, true, true, true)) return false;
+	resolveScenePipelines();
+	if (!initOitComposite()) return false;
+	if (!initOitTargets()) return false;
 
 
 	if (!initTexture()) return false;
+	if (!initColormapTexture()) return false;
 	// std::cout << "Passed [1]" << std::endl;
 	if (!initGeometry()) return false;
+	if (!initGlyphGeometry()) return false;
 	// if (!initAxesGeometry()) return false;
 	rebuildAxesBuffer();
 	// if (!initPrincipalPlanesWireframeGeometry(1)) return false;
@@ -181,40 +211,59 @@ bool Application::onInit() {
 	// std::cout << "Passed [4]" << std::endl;
 	if (!initBindGroup()) return false;
 	if (!initGraphObjects()) return false;
-	if (!initGui()) return false;
+	if (!m_headless && !initGui()) return false;
+	if (!Profiler::shared().initGpu(m_device, m_queue)) {
+		std::cout << "Timestamp queries unsupported, profiling the CPU only" << std::endl;
+	}
 	loadPresets();
 	return true;
 }
 
-void Application::deferBufferRelease(WGPUBuffer buffer) {
-	if (buffer) {
-		m_pendingBufferReleases.push_back({buffer, BUFFER_RELEASE_DELAY});
-	}
-}
-
-void Application::processPendingReleases() {
-	for (auto it = m_pendingBufferReleases.begin(); it != m_pendingBufferReleases.end(); ) {
-		it->second--;
-		if (it->second <= 0) {
-			wgpuBufferDestroy(it->first);
-			wgpuBufferRelease(it->first);
-			it = m_pendingBufferReleases.erase(it);
-		} else {
-			++it;
-		}
-	}
+// Depth of the scene, cleared or kept; the stencil is unused
+static WGPURenderPassDepthStencilAttachment depthAttachment(WGPUTextureView view, WGPULoadOp loadOp) {
+	WGPURenderPassDepthStencilAttachment attachment = {};
+	attachment.view = view;
+	attachment.depthClearValue = 1.0f;
+	attachment.depthLoadOp = loadOp;
+	attachment.depthStoreOp = WGPUStoreOp_Store;
+	attachment.depthReadOnly = false;
+	attachment.stencilClearValue = 0;
+#ifdef WEBGPU_BACKEND_WGPU
+	attachment.stencilLoadOp = loadOp;
+	attachment.stencilStoreOp = WGPUStoreOp_Store;
+#else
+	attachment.stencilLoadOp = WGPULoadOp_Undefined;
+	attachment.stencilStoreOp = WGPUStoreOp_Undefined;
+#endif
+	attachment.stencilReadOnly = true;
+	return attachment;
 }
 
 void Application::onFrame() {
+	Profiler& profiler = Profiler::shared();
+	profiler.beginFrame();
+
 	glfwPollEvents();
+#ifndef __EMSCRIPTEN__
+	// Preloaded files never change in the browser
+	reloadChangedShaders();
+#endif
 	if (m_needsResize) {
 		m_needsResize = false;
 		onResize();
 	}
-	processPendingReleases();
 	updateDragInertia();
 	updateLightingUniforms();
-	updateGraphObjects();
+	{
+		PROFILE_SCOPE("updateGraphObjects");
+		updateGraphObjects();
+	}
+	updateSurfaceLods();
+	{
+		PROFILE_SCOPE("writeDrawCommands");
+		writeDrawCommands();
+		updateDrawBundles();
+	}
 
 	// Update uniform buffer
 	m_uniforms.time = static_cast<float>(glfwGetTime());
@@ -237,95 +286,57 @@ void Application::onFrame() {
 	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &commandEncoderDesc);
 
 
-	WGPURenderPassDescriptor renderPassDesc{};
-
-	WGPURenderPassColorAttachment renderPassColorAttachment{};
-	renderPassColorAttachment.view = nextTexture;
-	renderPassColorAttachment.resolveTarget = nullptr;
-	renderPassColorAttachment.loadOp = WGPULoadOp_Clear;
-	renderPassColorAttachment.storeOp = WGPUStoreOp_Store;
-	renderPassColorAttachment.clearValue = WGPUColor{m_bgColor[0], m_bgColor[1], m_bgColor[2], 1.0};
-	renderPassDesc.colorAttachmentCount = 1;
-	renderPassDesc.colorAttachments = &renderPassColorAttachment;
-
-	WGPURenderPassDepthStencilAttachment depthStencilAttachment = {};
-	depthStencilAttachment.view = m_depthTextureView;
-	depthStencilAttachment.depthClearValue = 1.0f;
-	depthStencilAttachment.depthLoadOp = WGPULoadOp_Clear;
-	depthStencilAttachment.depthStoreOp = WGPUStoreOp_Store;
-	depthStencilAttachment.depthReadOnly = false;
-	depthStencilAttachment.stencilClearValue = 0;
-#ifdef WEBGPU_BACKEND_WGPU
-	// depthStencilAttachment.stencilLoadOp = LoadOp::Clear;
-	// depthStencilAttachment.stencilStoreOp = StoreOp::Store;
-	depthStencilAttachment.stencilLoadOp = WGPULoadOp_Clear;
-	depthStencilAttachment.stencilStoreOp = WGPUStoreOp_Store;
-#else
-	depthStencilAttachment.stencilLoadOp = WGPULoadOp_Undefined;
-	depthStencilAttachment.stencilStoreOp = WGPUStoreOp_Undefined;
-#endif
-	depthStencilAttachment.stencilReadOnly = true;
-
-	renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
-
-	renderPassDesc.timestampWriteCount = 0;
-	renderPassDesc.timestampWrites = nullptr;
-	WGPURenderPassEncoder renderPass = wgpuCommandEncoderBeginRenderPass(encoder, &renderPassDesc);
-	
-	if(!renderPass) std::cout << "renderpass command encoder failed" << std::endl;
-
-	if (m_showBoat) {
-		m_pipeline = m_pipelines["boat"];
-		wgpuRenderPassEncoderSetPipeline(renderPass, m_pipeline);
-		wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, m_vertexBuffer, 0, m_vertexCount * sizeof(VertexAttributes));
-		wgpuRenderPassEncoderSetBindGroup(renderPass, 0, m_bindGroup, 0, nullptr);
-		wgpuRenderPassEncoderDraw(renderPass, m_vertexCount, 1, 0, 0);
-	}
-
-	if (m_showAxes && m_axesVertexCount > 0 && m_axesVertexBuffer) {
-		m_pipeline = m_pipelines["axes"];
-		wgpuRenderPassEncoderSetPipeline(renderPass, m_pipeline);
-		wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, m_axesVertexBuffer, 0, m_axesVertexCount * sizeof(VertexAttributes));
-		wgpuRenderPassEncoderSetBindGroup(renderPass, 0, m_bindGroup, 0, nullptr);
-		wgpuRenderPassEncoderDraw(renderPass, m_axesVertexCount, 1, 0, 0);
-	}
-
-	// Draw surfaces + arrows (TriangleList, "surface" pipeline)
-	if (m_surfaceVertexCount > 0 && m_surfaceVertexBuffer) {
-		wgpuRenderPassEncoderSetPipeline(renderPass, m_pipelines["surface"]);
-		wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, m_surfaceVertexBuffer, 0, m_surfaceVertexCount * sizeof(VertexAttributes));
-		wgpuRenderPassEncoderSetBindGroup(renderPass, 0, m_bindGroup, 0, nullptr);
-		wgpuRenderPassEncoderDraw(renderPass, m_surfaceVertexCount, 1, 0, 0);
+	// Advect the particles ahead of the pass that draws them
+	const float frameDt = m_previousTime > 0.0f ? m_uniforms.time - m_previousTime : 0.0f;
+	m_previousTime = m_uniforms.time;
+	for (auto& fd : m_functions) {
+		if (fd.show && fd.gpuFlow) fd.gpuFlow->encodeParticles(m_queue, encoder, m_uniforms.time, frameDt, fd.particleSpeed);
 	}
 
-	// Wireframe overlay lines (LineList, "axes" pipeline)
-	if (m_curveVertexCount > 0 && m_curveVertexBuffer) {
-		wgpuRenderPassEncoderSetPipeline(renderPass, m_pipelines["axes"]);
-		wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, m_curveVertexBuffer, 0, m_curveVertexCount * sizeof(VertexAttributes));
-		wgpuRenderPassEncoderSetBindGroup(renderPass, 0, m_bindGroup, 0, nullptr);
-		wgpuRenderPassEncoderDraw(renderPass, m_curveVertexCount, 1, 0, 0);
+	encodeScene(encoder, nextTexture);
+
+	// The GUI gets a pass of its own, on top of the scene, so the two are timed separately
+	WGPURenderPassColorAttachment guiAttachment = {};
+	guiAttachment.view = nextTexture;
+	guiAttachment.resolveTarget = nullptr;
+	guiAttachment.loadOp = WGPULoadOp_Load;
+	guiAttachment.storeOp = WGPUStoreOp_Store;
+	WGPURenderPassDepthStencilAttachment guiDepth = depthAttachment(m_depthTextureView, WGPULoadOp_Load);
+	WGPURenderPassDescriptor guiPassDesc = {};
+	guiPassDesc.colorAttachmentCount = 1;
+	guiPassDesc.colorAttachments = &guiAttachment;
+	guiPassDesc.depthStencilAttachment = &guiDepth;
+	WGPURenderPassTimestampWrite guiTimestamps[2];
+	guiPassDesc.timestampWriteCount = profiler.renderPassTimestamps("GUI pass", guiTimestamps);
+	guiPassDesc.timestampWrites = guiTimestamps;
+	WGPURenderPassEncoder guiPass = wgpuCommandEncoderBeginRenderPass(encoder, &guiPassDesc);
+	{
+		PROFILE_SCOPE("updateGui");
+		updateGui(guiPass);
 	}
+	wgpuRenderPassEncoderEnd(guiPass);
+	wgpuRenderPassEncoderRelease(guiPass);
 
-	// We add the GUI drawing commands to the render pass
-	updateGui(renderPass);
-
-	wgpuRenderPassEncoderEnd(renderPass);
-	wgpuRenderPassEncoderRelease(renderPass);
-	
 
 	wgpuTextureViewRelease(nextTexture);
 
 
 	WGPUCommandBufferDescriptor cmdBufferDescriptor{};
 	cmdBufferDescriptor.label = "Command buffer";
+	profiler.resolveGpu(encoder);
 	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDescriptor);
 	wgpuCommandEncoderRelease(encoder);
 	wgpuQueueSubmit(m_queue, 1, &command);
+	m_geometryPool.onSubmit();
+	profiler.onSubmit();
 	
 	
 	wgpuCommandBufferRelease(command);
 
+#ifndef __EMSCRIPTEN__
+	// The browser presents the canvas itself when the frame callback returns
 	wgpuSwapChainPresent(m_swapChain);
+#endif
 	
 	
 
@@ -336,18 +347,108 @@ void Application::onFrame() {
 #endif
 }
 
+// Opaque draws into target, then the translucent ones composited over them
+void Application::encodeScene(WGPUCommandEncoder encoder, WGPUTextureView target) {
+	Profiler& profiler = Profiler::shared();
+
+	WGPURenderPassDescriptor renderPassDesc{};
+
+	WGPURenderPassColorAttachment renderPassColorAttachment{};
+	renderPassColorAttachment.view = target;
+	renderPassColorAttachment.resolveTarget = nullptr;
+	renderPassColorAttachment.loadOp = WGPULoadOp_Clear;
+	renderPassColorAttachment.storeOp = WGPUStoreOp_Store;
+	renderPassColorAttachment.clearValue = WGPUColor{m_bgColor[0], m_bgColor[1], m_bgColor[2], 1.0};
+	renderPassDesc.colorAttachmentCount = 1;
+	renderPassDesc.colorAttachments = &renderPassColorAttachment;
+
+	WGPURenderPassDepthStencilAttachment depthStencilAttachment = depthAttachment(m_depthTextureView, WGPULoadOp_Clear);
+	renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
+
+	WGPURenderPassTimestampWrite sceneTimestamps[2];
+	renderPassDesc.timestampWriteCount = profiler.renderPassTimestamps("Scene pass", sceneTimestamps);
+	renderPassDesc.timestampWrites = sceneTimestamps;
+	WGPURenderPassEncoder renderPass = wgpuCommandEncoderBeginRenderPass(encoder, &renderPassDesc);
+	
+	if(!renderPass) std::cout << "renderpass command encoder failed" << std::endl;
+
+	// Boat, axes and every function, recorded by updateDrawBundles
+	if (!m_sceneBundles.empty()) {
+		wgpuRenderPassEncoderExecuteBundles(renderPass, m_sceneBundles.size(), m_sceneBundles.data());
+	}
+
+	wgpuRenderPassEncoderEnd(renderPass);
+	wgpuRenderPassEncoderRelease(renderPass);
+
+	if (!m_transparentSceneBundles.empty()) {
+		PROFILE_SCOPE("encodeTransparency");
+		// Translucent surfaces, tested against the opaque depth without writing it
+		WGPURenderPassColorAttachment oitAttachments[2] = {};
+		oitAttachments[0].view = m_oitAccumView;
+		oitAttachments[0].loadOp = WGPULoadOp_Clear;
+		oitAttachments[0].storeOp = WGPUStoreOp_Store;
+		oitAttachments[0].clearValue = WGPUColor{ 0.0, 0.0, 0.0, 0.0 };
+		oitAttachments[1].view = m_oitRevealageView;
+		oitAttachments[1].loadOp = WGPULoadOp_Clear;
+		oitAttachments[1].storeOp = WGPUStoreOp_Store;
+		oitAttachments[1].clearValue = WGPUColor{ 1.0, 0.0, 0.0, 0.0 };
+
+		WGPURenderPassDepthStencilAttachment oitDepth = {};
+		oitDepth.view = m_depthTextureView;
+		oitDepth.depthLoadOp = WGPULoadOp_Undefined;
+		oitDepth.depthStoreOp = WGPUStoreOp_Undefined;
+		oitDepth.depthReadOnly = true;
+		oitDepth.stencilLoadOp = WGPULoadOp_Undefined;
+		oitDepth.stencilStoreOp = WGPUStoreOp_Undefined;
+		oitDepth.stencilReadOnly = true;
+
+		WGPURenderPassDescriptor oitPassDesc = {};
+		oitPassDesc.colorAttachmentCount = 2;
+		oitPassDesc.colorAttachments = oitAttachments;
+		oitPassDesc.depthStencilAttachment = &oitDepth;
+		WGPURenderPassTimestampWrite oitTimestamps[2];
+		oitPassDesc.timestampWriteCount = profiler.renderPassTimestamps("Transparency pass", oitTimestamps);
+		oitPassDesc.timestampWrites = oitTimestamps;
+		WGPURenderPassEncoder oitPass = wgpuCommandEncoderBeginRenderPass(encoder, &oitPassDesc);
+		wgpuRenderPassEncoderExecuteBundles(oitPass, m_transparentSceneBundles.size(), m_transparentSceneBundles.data());
+		wgpuRenderPassEncoderEnd(oitPass);
+		wgpuRenderPassEncoderRelease(oitPass);
+
+		// Average colour over the scene, weighted by how much of it the surfaces cover
+		WGPURenderPassColorAttachment compositeAttachment = renderPassColorAttachment;
+		compositeAttachment.loadOp = WGPULoadOp_Load;
+		WGPURenderPassDescriptor compositePassDesc = {};
+		compositePassDesc.colorAttachmentCount = 1;
+		compositePassDesc.colorAttachments = &compositeAttachment;
+		compositePassDesc.depthStencilAttachment = nullptr;
+		compositePassDesc.timestampWriteCount = 0;
+		WGPURenderPassEncoder compositePass = wgpuCommandEncoderBeginRenderPass(encoder, &compositePassDesc);
+		wgpuRenderPassEncoderSetPipeline(compositePass, m_oitCompositePipeline);
+		wgpuRenderPassEncoderSetBindGroup(compositePass, 0, m_oitBindGroup, 0, nullptr);
+		wgpuRenderPassEncoderDraw(compositePass, 3, 1, 0, 0);
+		wgpuRenderPassEncoderEnd(compositePass);
+		wgpuRenderPassEncoderRelease(compositePass);
+	}
+}
+
 void Application::onFinish() {
-	terminateGui();
+	if (!m_headless) terminateGui();
+	terminateDrawBundles();
 	terminateGraphObjects();
 	terminateBindGroup();
 	terminateLightingUniforms();
 	terminateUniforms();
+	terminateGlyphGeometry();
 	terminateGeometry();
+	terminateColormapTexture();
 	terminateTexture();
+	terminateOitTargets();
+	terminateOitComposite();
 	terminateRenderPipelines();
 	terminateBindGroupLayout();
 	terminateDepthBuffer();
 	terminateSwapChain();
+	Profiler::shared().terminateGpu();
 	terminateWindowAndDevice();
 }
 
@@ -357,12 +458,14 @@ bool Application::isRunning() {
 
 void Application::onResize() {
 	// Terminate in reverse order
+	terminateOitTargets();
 	terminateDepthBuffer();
 	terminateSwapChain();
 
 	// Re-init
 	initSwapChain();
 	initDepthBuffer();
+	initOitTargets();
 
 	updateProjectionMatrix();
 }
@@ -456,21 +559,24 @@ bool Application::initWindowAndDevice() {
 		return false;
 	}
 
-	if (!glfwInit()) {
-		std::cerr << "Could not initialize GLFW!" << std::endl;
-		return false;
-	}
+	// Headless, any adapter will do: there is no surface to present to
+	if (!m_headless) {
+		if (!glfwInit()) {
+			std::cerr << "Could not initialize GLFW!" << std::endl;
+			return false;
+		}
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
-	m_window = glfwCreateWindow(640, 480, "WEBGPU", NULL, NULL);
-	if (!m_window) {
-		std::cerr << "Could not open window!" << std::endl;
-		return false;
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+		m_window = glfwCreateWindow(640, 480, "WEBGPU", NULL, NULL);
+		if (!m_window) {
+			std::cerr << "Could not open window!" << std::endl;
+			return false;
+		}
+		m_surface = glfwGetWGPUSurface(m_instance, m_window);
 	}
 
 	std::cout << "Requesting adapter..." << std::endl;
-	m_surface = glfwGetWGPUSurface(m_instance, m_window);
 	WGPURequestAdapterOptions adapterOpts{};
 	adapterOpts.compatibleSurface = m_surface;
 	// Adapter adapter = m_instance.requestAdapter(adapterOpts);
@@ -490,11 +596,11 @@ bool Application::initWindowAndDevice() {
 	std::cout << "Requesting device..." << std::endl;
 	WGPURequiredLimits requiredLimits = {};
 
-	int maxbufsize = 90000000;
-
-	requiredLimits.limits.maxVertexAttributes = 4;
-	requiredLimits.limits.maxVertexBuffers = 1;
-	requiredLimits.limits.maxBufferSize = maxbufsize * sizeof(VertexAttributes);
+	// Glyphs read a VertexAttributes buffer plus a GlyphInstance buffer: 4 + 5 attributes
+	requiredLimits.limits.maxVertexAttributes = 9;
+	requiredLimits.limits.maxVertexBuffers = 2;
+	// Meshes are indexed, so the adapter's own buffer limit is the only ceiling on resolution
+	requiredLimits.limits.maxBufferSize = supportedLimits.limits.maxBufferSize;
 	requiredLimits.limits.maxVertexBufferArrayStride = sizeof(VertexAttributes);
 	requiredLimits.limits.minStorageBufferOffsetAlignment = supportedLimits.limits.minStorageBufferOffsetAlignment;
 	// requiredLimits.limits.minStorageBufferOffsetAlignment = 256;
@@ -504,11 +610,25 @@ bool Application::initWindowAndDevice() {
 
 	requiredLimits.limits.maxInterStageShaderComponents = 11;
 	//                                                    ^ This was 8
-	requiredLimits.limits.maxBindGroups = 2;
-	requiredLimits.limits.maxUniformBuffersPerShaderStage = 2;
+	// Heightfield surfaces bind their height texture at group 2
+	requiredLimits.limits.maxBindGroups = 3;
+	requiredLimits.limits.maxUniformBuffersPerShaderStage = 3;
+	// FunctionUniforms are picked per draw by dynamic offset
+	requiredLimits.limits.maxDynamicUniformBuffersPerPipelineLayout = 1;
 	requiredLimits.limits.maxUniformBufferBindingSize = 16 * 4 * sizeof(float);
+	// Compute-evaluated surfaces write their whole mesh through storage buffers; the flow shader
+	// adds its particles, and runs 64 invocations along x
+	requiredLimits.limits.maxStorageBuffersPerShaderStage = std::min(4u, supportedLimits.limits.maxStorageBuffersPerShaderStage);
+	requiredLimits.limits.maxStorageBufferBindingSize = supportedLimits.limits.maxStorageBufferBindingSize;
+	requiredLimits.limits.maxComputeWorkgroupSizeX = std::min(64u, supportedLimits.limits.maxComputeWorkgroupSizeX);
+	requiredLimits.limits.maxComputeWorkgroupSizeY = 8;
+	requiredLimits.limits.maxComputeWorkgroupSizeZ = 1;
+	requiredLimits.limits.maxComputeInvocationsPerWorkgroup = 64;
+	requiredLimits.limits.maxComputeWorkgroupsPerDimension = supportedLimits.limits.maxComputeWorkgroupsPerDimension;
 	requiredLimits.limits.maxTextureArrayLayers = 1;
-	requiredLimits.limits.maxSampledTexturesPerShaderStage = 1;
+	// The OIT composite samples the accumulation and revealage targets, which the transparent pass writes together
+	requiredLimits.limits.maxSampledTexturesPerShaderStage = 2;
+	requiredLimits.limits.maxColorAttachments = 2;
 	requiredLimits.limits.maxSamplersPerShaderStage = 1;
 
 	// Always use adapter's texture resulution limits.
@@ -517,9 +637,16 @@ bool Application::initWindowAndDevice() {
 	// requiredLimits.limits.maxTextureDimension3D = supportedLimits.limits.maxTextureDimension3D;
 	requiredLimits.limits.maxTextureDimension3D = 2048;
 
+	// GPU pass timings for the profiler, where the adapter has them
+	std::vector<WGPUFeatureName> requiredFeatures;
+	if (wgpuAdapterHasFeature(adapter, WGPUFeatureName_TimestampQuery)) {
+		requiredFeatures.push_back(WGPUFeatureName_TimestampQuery);
+	}
+
 	WGPUDeviceDescriptor deviceDesc = {};
 	deviceDesc.label = "My Device";
-	deviceDesc.requiredFeaturesCount = 0;
+	deviceDesc.requiredFeaturesCount = requiredFeatures.size();
+	deviceDesc.requiredFeatures = requiredFeatures.data();
 	deviceDesc.requiredLimits = &requiredLimits;
 	deviceDesc.defaultQueue.label = "The default queue";
 
@@ -564,11 +691,18 @@ bool Application::initWindowAndDevice() {
 
 #ifdef WEBGPU_BACKEND_WGPU
 	// m_swapChainFormat = m_surface.getPreferredFormat(adapter);
-	m_swapChainFormat = wgpuSurfaceGetPreferredFormat(m_surface, adapter);
+	if (m_surface) m_swapChainFormat = wgpuSurfaceGetPreferredFormat(m_surface, adapter);
 #else
 	// m_swapChainFormat = TextureFormat::BGRA8Unorm;
 	m_swapChainFormat = WGPUTextureFormat_BGRA8Unorm;
 #endif
+	// Offscreen images are read back in the byte order of the files they become
+	if (m_headless) m_swapChainFormat = WGPUTextureFormat_RGBA8Unorm;
+
+	if (m_headless) {
+		wgpuAdapterRelease(adapter);
+		return m_device != nullptr;
+	}
 
 	// Add window callbacks
 	// Set the user pointer to be "this"
@@ -599,7 +733,7 @@ void Application::terminateWindowAndDevice() {
 
 	wgpuQueueRelease(m_queue);
 	wgpuDeviceRelease(m_device);
-	wgpuSurfaceRelease(m_surface);
+	if (m_surface) wgpuSurfaceRelease(m_surface);
 	wgpuInstanceRelease(m_instance);
 
 	// m_queue.release();
@@ -607,15 +741,42 @@ void Application::terminateWindowAndDevice() {
 	// m_surface.release();
 	// m_instance.release();
 
+	if (m_headless) return;
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 }
 
+void Application::framebufferSize(int& width, int& height) const {
+	if (m_headless) {
+		width = static_cast<int>(m_headlessWidth);
+		height = static_cast<int>(m_headlessHeight);
+		return;
+	}
+	glfwGetFramebufferSize(m_window, &width, &height);
+}
+
 
 bool Application::initSwapChain() {
 	// Get the current size of the window's framebuffer:
 	int width, height;
-	glfwGetFramebufferSize(m_window, &width, &height);
+	framebufferSize(width, height);
+
+	if (m_headless) {
+		// Read back after every image, so it is a copy source as well
+		WGPUTextureDescriptor textureDesc = {};
+		textureDesc.label = "Offscreen target";
+		textureDesc.dimension = WGPUTextureDimension_2D;
+		textureDesc.format = m_swapChainFormat;
+		textureDesc.mipLevelCount = 1;
+		textureDesc.sampleCount = 1;
+		textureDesc.size = { static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1 };
+		textureDesc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc;
+		textureDesc.viewFormatCount = 0;
+		textureDesc.viewFormats = nullptr;
+		m_offscreenTexture = wgpuDeviceCreateTexture(m_device, &textureDesc);
+		m_offscreenView = m_offscreenTexture ? wgpuTextureCreateView(m_offscreenTexture, nullptr) : nullptr;
+		return m_offscreenView != nullptr;
+	}
 
 	std::cout << "Creating swapchain..." << std::endl;
 	WGPUSwapChainDescriptor swapChainDesc = {};
@@ -635,6 +796,16 @@ bool Application::initSwapChain() {
 }
 
 void Application::terminateSwapChain() {
+	if (m_headless) {
+		if (m_offscreenView) wgpuTextureViewRelease(m_offscreenView);
+		if (m_offscreenTexture) {
+			wgpuTextureDestroy(m_offscreenTexture);
+			wgpuTextureRelease(m_offscreenTexture);
+		}
+		m_offscreenView = nullptr;
+		m_offscreenTexture = nullptr;
+		return;
+	}
 	// m_swapChain.release();
 	wgpuSwapChainRelease(m_swapChain);
 }
@@ -643,7 +814,7 @@ void Application::terminateSwapChain() {
 bool Application::initDepthBuffer() {
 	// Get the current size of the window's framebuffer:
 	int width, height;
-	glfwGetFramebufferSize(m_window, &width, &height);
+	framebufferSize(width, height);
 
 	// Create the depth texture
 	WGPUTextureDescriptor depthTextureDesc = {};
@@ -685,6 +856,138 @@ void Application::terminateDepthBuffer() {
 	wgpuTextureRelease(m_depthTexture);
 }
 
+bool Application::initOitTargets() {
+	int width, height;
+	framebufferSize(width, height);
+
+	auto createTarget = [this, width, height](WGPUTextureFormat format, const char* label, WGPUTexture& texture, WGPUTextureView& view) {
+		WGPUTextureDescriptor textureDesc = {};
+		textureDesc.label = label;
+		textureDesc.dimension = WGPUTextureDimension_2D;
+		textureDesc.format = format;
+		textureDesc.mipLevelCount = 1;
+		textureDesc.sampleCount = 1;
+		textureDesc.size = { static_cast<uint32_t>(std::max(width, 1)), static_cast<uint32_t>(std::max(height, 1)), 1 };
+		textureDesc.usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding;
+		textureDesc.viewFormatCount = 0;
+		textureDesc.viewFormats = nullptr;
+		texture = wgpuDeviceCreateTexture(m_device, &textureDesc);
+
+		WGPUTextureViewDescriptor viewDesc = {};
+		viewDesc.aspect = WGPUTextureAspect_All;
+		viewDesc.baseArrayLayer = 0;
+		viewDesc.arrayLayerCount = 1;
+		viewDesc.baseMipLevel = 0;
+		viewDesc.mipLevelCount = 1;
+		viewDesc.dimension = WGPUTextureViewDimension_2D;
+		viewDesc.format = format;
+		view = texture ? wgpuTextureCreateView(texture, &viewDesc) : nullptr;
+	};
+	createTarget(OIT_ACCUM_FORMAT, "OIT accumulation", m_oitAccumTexture, m_oitAccumView);
+	createTarget(OIT_REVEALAGE_FORMAT, "OIT revealage", m_oitRevealageTexture, m_oitRevealageView);
+	if (!m_oitAccumView || !m_oitRevealageView) {
+		std::cerr << "Could not create the transparency targets" << std::endl;
+		return false;
+	}
+
+	WGPUBindGroupEntry entries[2] = {};
+	entries[0].binding = 0;
+	entries[0].textureView = m_oitAccumView;
+	entries[1].binding = 1;
+	entries[1].textureView = m_oitRevealageView;
+	WGPUBindGroupDescriptor bindGroupDesc = {};
+	bindGroupDesc.label = "OIT composite";
+	bindGroupDesc.layout = m_oitBindGroupLayout;
+	bindGroupDesc.entryCount = 2;
+	bindGroupDesc.entries = entries;
+	m_oitBindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+	return m_oitBindGroup != nullptr;
+}
+
+void Application::terminateOitTargets() {
+	if (m_oitBindGroup) wgpuBindGroupRelease(m_oitBindGroup);
+	m_oitBindGroup = nullptr;
+	for (WGPUTextureView* view : { &m_oitAccumView, &m_oitRevealageView }) {
+		if (*view) wgpuTextureViewRelease(*view);
+		*view = nullptr;
+	}
+	for (WGPUTexture* texture : { &m_oitAccumTexture, &m_oitRevealageTexture }) {
+		if (!*texture) continue;
+		wgpuTextureDestroy(*texture);
+		wgpuTextureRelease(*texture);
+		*texture = nullptr;
+	}
+}
+
+bool Application::initOitComposite() {
+	m_oitCompositeModule = ResourceManager::loadShaderModule(RESOURCE_DIR "/composite.wgsl", m_device);
+	if (!m_oitCompositeModule) {
+		std::cerr << "Could not load the transparency composite shader" << std::endl;
+		return false;
+	}
+
+	// Read with textureLoad, one texel per pixel, so no sampler
+	WGPUBindGroupLayoutEntry entries[2] = {};
+	for (uint32_t i = 0; i < 2; ++i) {
+		entries[i].binding = i;
+		entries[i].visibility = WGPUShaderStage_Fragment;
+		entries[i].texture.sampleType = WGPUTextureSampleType_UnfilterableFloat;
+		entries[i].texture.viewDimension = WGPUTextureViewDimension_2D;
+		entries[i].texture.multisampled = false;
+	}
+	WGPUBindGroupLayoutDescriptor layoutDesc = {};
+	layoutDesc.entryCount = 2;
+	layoutDesc.entries = entries;
+	m_oitBindGroupLayout = wgpuDeviceCreateBindGroupLayout(m_device, &layoutDesc);
+
+	WGPUPipelineLayoutDescriptor pipelineLayoutDesc = {};
+	pipelineLayoutDesc.bindGroupLayoutCount = 1;
+	pipelineLayoutDesc.bindGroupLayouts = &m_oitBindGroupLayout;
+	WGPUPipelineLayout pipelineLayout = wgpuDeviceCreatePipelineLayout(m_device, &pipelineLayoutDesc);
+
+	WGPUBlendState blendState = {};
+	blendState.color = { WGPUBlendOperation_Add, WGPUBlendFactor_SrcAlpha, WGPUBlendFactor_OneMinusSrcAlpha };
+	blendState.alpha = { WGPUBlendOperation_Add, WGPUBlendFactor_Zero, WGPUBlendFactor_One };
+	WGPUColorTargetState colorTarget = {};
+	colorTarget.format = m_swapChainFormat;
+	colorTarget.blend = &blendState;
+	colorTarget.writeMask = WGPUColorWriteMask_All;
+
+	WGPUFragmentState fragmentState = {};
+	fragmentState.module = m_oitCompositeModule;
+	fragmentState.entryPoint = "fs_main";
+	fragmentState.targetCount = 1;
+	fragmentState.targets = &colorTarget;
+
+	WGPURenderPipelineDescriptor pipelineDesc = {};
+	pipelineDesc.label = "OIT composite";
+	pipelineDesc.layout = pipelineLayout;
+	pipelineDesc.vertex.module = m_oitCompositeModule;
+	pipelineDesc.vertex.entryPoint = "vs_main";
+	pipelineDesc.vertex.bufferCount = 0;
+	pipelineDesc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
+	pipelineDesc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
+	pipelineDesc.primitive.frontFace = WGPUFrontFace_CCW;
+	pipelineDesc.primitive.cullMode = WGPUCullMode_None;
+	pipelineDesc.fragment = &fragmentState;
+	pipelineDesc.depthStencil = nullptr;
+	pipelineDesc.multisample.count = 1;
+	pipelineDesc.multisample.mask = ~0u;
+	pipelineDesc.multisample.alphaToCoverageEnabled = false;
+	m_oitCompositePipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipelineDesc);
+	wgpuPipelineLayoutRelease(pipelineLayout);
+	return m_oitCompositePipeline != nullptr;
+}
+
+void Application::terminateOitComposite() {
+	if (m_oitCompositePipeline) wgpuRenderPipelineRelease(m_oitCompositePipeline);
+	if (m_oitBindGroupLayout) wgpuBindGroupLayoutRelease(m_oitBindGroupLayout);
+	if (m_oitCompositeModule) wgpuShaderModuleRelease(m_oitCompositeModule);
+	m_oitCompositePipeline = nullptr;
+	m_oitBindGroupLayout = nullptr;
+	m_oitCompositeModule = nullptr;
+}
+
 
 // bool Application::initRenderPipeline() {
 // 	std::cout << "Creating shader module..." << std::endl;
@@ -796,15 +1099,38 @@ void Application::terminateDepthBuffer() {
 // 	return m_pipeline != nullptr;
 // }
 
-bool Application::initRenderPipeline(const std::string& pipelineName, const std::string& shaderFileName, WGPUPrimitiveTopology topology) {
-	std::cout << "Creating shader module..." << std::endl;
-	// m_shaderModule = ResourceManager::loadShaderModule(RESOURCE_DIR "/shader.wgsl", m_device);
-	m_shaderModule = ResourceManager::loadShaderModule(shaderFileName, m_device);
-	std::cout << "Shader module: " << m_shaderModule << std::endl;
-
-	m_shaderModuleMap[pipelineName] = m_shaderModule;
+bool Application::initRenderPipeline(const std::string& pipelineName, const std::string& shaderFileName, WGPUPrimitiveTopology topology, bool instanced, bool packed, bool transparent, bool heightfield) {
+	const PipelineRecipe recipe = { shaderFileName, topology, instanced, packed, transparent, heightfield };
+	m_pipelineRecipes[pipelineName] = recipe;
+	std::error_code error;
+	m_shaderFileTimes.emplace(shaderFileName, std::filesystem::last_write_time(shaderFileName, error));
+
+	// Pipelines drawn from the same file share its module
+	auto moduleIt = m_shaderModuleMap.find(shaderFileName);
+	if (moduleIt != m_shaderModuleMap.end()) {
+		m_shaderModule = moduleIt->second;
+	} else {
+		std::cout << "Creating shader module..." << std::endl;
+		// m_shaderModule = ResourceManager::loadShaderModule(RESOURCE_DIR "/shader.wgsl", m_device);
+		m_shaderModule = ResourceManager::loadShaderModule(shaderFileName, m_device);
+		std::cout << "Shader module: " << m_shaderModule << std::endl;
+		if (!m_shaderModule) return false;
+		m_shaderModuleMap[shaderFileName] = m_shaderModule;
+	}
 
 	std::cout << "Creating render pipeline..." << std::endl;
+	m_pipeline = createRenderPipeline(recipe, m_shaderModule);
+	std::cout << "Render pipeline: " << m_pipeline << std::endl;
+
+	m_pipelines[pipelineName] = m_pipeline;
+	return m_pipeline != nullptr;
+}
+
+WGPURenderPipeline Application::createRenderPipeline(const PipelineRecipe& recipe, WGPUShaderModule module) {
+	const bool instanced = recipe.instanced;
+	const bool packed = recipe.packed;
+	const bool transparent = recipe.transparent;
+	const bool heightfield = recipe.heightfield;
 	WGPURenderPipelineDescriptor pipelineDesc = {};
 
 	// Vertex fetch
@@ -830,30 +1156,76 @@ bool Application::initRenderPipeline(const std::string& pipelineName, const std:
 	vertexAttribs[3].format = WGPUVertexFormat_Float32x2;
 	vertexAttribs[3].offset = offsetof(VertexAttributes, uv);
 
+	// Packed layout: float position, octahedral snorm16 normal, and a colour word the shader
+	// decodes as RGBA8 or as a float colormap scalar
+	std::vector<WGPUVertexAttribute> packedAttribs(3);
+
+	packedAttribs[0].shaderLocation = 0;
+	packedAttribs[0].format = WGPUVertexFormat_Float32x3;
+	packedAttribs[0].offset = offsetof(PackedVertex, position);
+
+	packedAttribs[1].shaderLocation = 1;
+	packedAttribs[1].format = WGPUVertexFormat_Snorm16x2;
+	packedAttribs[1].offset = offsetof(PackedVertex, normal);
+
+	packedAttribs[2].shaderLocation = 2;
+	packedAttribs[2].format = WGPUVertexFormat_Uint32;
+	packedAttribs[2].offset = offsetof(PackedVertex, color);
+
 	WGPUVertexBufferLayout vertexBufferLayout = {};
-	vertexBufferLayout.attributeCount = (uint32_t)vertexAttribs.size();
-	vertexBufferLayout.attributes = vertexAttribs.data();
-	vertexBufferLayout.arrayStride = sizeof(VertexAttributes);
+	vertexBufferLayout.attributeCount = (uint32_t)(packed ? packedAttribs.size() : vertexAttribs.size());
+	vertexBufferLayout.attributes = packed ? packedAttribs.data() : vertexAttribs.data();
+	vertexBufferLayout.arrayStride = packed ? sizeof(PackedVertex) : sizeof(VertexAttributes);
 	vertexBufferLayout.stepMode = WGPUVertexStepMode_Vertex;
 
-	pipelineDesc.vertex.bufferCount = 1;
-	pipelineDesc.vertex.buffers = &vertexBufferLayout;
+	// Instance fetch: position + length, direction + radius, packed color
+	std::vector<WGPUVertexAttribute> instanceAttribs(5);
 
-	pipelineDesc.vertex.module = m_shaderModule;
-	pipelineDesc.vertex.entryPoint = "vs_main";
+	instanceAttribs[0].shaderLocation = 4;
+	instanceAttribs[0].format = WGPUVertexFormat_Float32x3;
+	instanceAttribs[0].offset = offsetof(GlyphInstance, position);
+
+	instanceAttribs[1].shaderLocation = 5;
+	instanceAttribs[1].format = WGPUVertexFormat_Float32;
+	instanceAttribs[1].offset = offsetof(GlyphInstance, length);
+
+	instanceAttribs[2].shaderLocation = 6;
+	instanceAttribs[2].format = WGPUVertexFormat_Float32x3;
+	instanceAttribs[2].offset = offsetof(GlyphInstance, direction);
+
+	instanceAttribs[3].shaderLocation = 7;
+	instanceAttribs[3].format = WGPUVertexFormat_Float32;
+	instanceAttribs[3].offset = offsetof(GlyphInstance, radius);
+
+	instanceAttribs[4].shaderLocation = 8;
+	instanceAttribs[4].format = WGPUVertexFormat_Unorm8x4;
+	instanceAttribs[4].offset = offsetof(GlyphInstance, color);
+
+	WGPUVertexBufferLayout bufferLayouts[2] = { vertexBufferLayout, {} };
+	bufferLayouts[1].attributeCount = (uint32_t)instanceAttribs.size();
+	bufferLayouts[1].attributes = instanceAttribs.data();
+	bufferLayouts[1].arrayStride = sizeof(GlyphInstance);
+	bufferLayouts[1].stepMode = WGPUVertexStepMode_Instance;
+
+	// Heightfields compute every vertex from vertex_index
+	pipelineDesc.vertex.bufferCount = heightfield ? 0 : instanced ? 2 : 1;
+	pipelineDesc.vertex.buffers = heightfield ? nullptr : bufferLayouts;
+
+	pipelineDesc.vertex.module = module;
+	pipelineDesc.vertex.entryPoint = heightfield ? "vs_heightfield" : "vs_main";
 	pipelineDesc.vertex.constantCount = 0;
 	pipelineDesc.vertex.constants = nullptr;
 
 	// pipelineDesc.primitive.topology = WGPUPrimitiveTopology_TriangleList;
-	pipelineDesc.primitive.topology = topology;
+	pipelineDesc.primitive.topology = recipe.topology;
 	pipelineDesc.primitive.stripIndexFormat = WGPUIndexFormat_Undefined;
 	pipelineDesc.primitive.frontFace = WGPUFrontFace_CCW;
 	pipelineDesc.primitive.cullMode = WGPUCullMode_None;
 
 	WGPUFragmentState fragmentState = {};
 	pipelineDesc.fragment = &fragmentState;
-	fragmentState.module = m_shaderModule;
-	fragmentState.entryPoint = "fs_main";
+	fragmentState.module = module;
+	fragmentState.entryPoint = transparent ? "fs_oit" : "fs_main";
 	fragmentState.constantCount = 0;
 	fragmentState.constants = nullptr;
 
@@ -870,8 +1242,24 @@ bool Application::initRenderPipeline(const std::string& pipelineName, const std:
 	colorTarget.blend = &blendState;
 	colorTarget.writeMask = WGPUColorWriteMask_All;
 
-	fragmentState.targetCount = 1;
-	fragmentState.targets = &colorTarget;
+	// OIT: weighted colours add up, revealage is multiplied by (1 - alpha) per fragment
+	WGPUBlendState accumBlend = {};
+	accumBlend.color = { WGPUBlendOperation_Add, WGPUBlendFactor_One, WGPUBlendFactor_One };
+	accumBlend.alpha = accumBlend.color;
+	WGPUBlendState revealageBlend = {};
+	revealageBlend.color = { WGPUBlendOperation_Add, WGPUBlendFactor_Zero, WGPUBlendFactor_OneMinusSrc };
+	revealageBlend.alpha = revealageBlend.color;
+
+	WGPUColorTargetState oitTargets[2] = {};
+	oitTargets[0].format = OIT_ACCUM_FORMAT;
+	oitTargets[0].blend = &accumBlend;
+	oitTargets[0].writeMask = WGPUColorWriteMask_All;
+	oitTargets[1].format = OIT_REVEALAGE_FORMAT;
+	oitTargets[1].blend = &revealageBlend;
+	oitTargets[1].writeMask = WGPUColorWriteMask_Red;
+
+	fragmentState.targetCount = transparent ? 2 : 1;
+	fragmentState.targets = transparent ? oitTargets : &colorTarget;
 
 
 	WGPUStencilFaceState noOpStencilFaceState = {};
@@ -882,7 +1270,7 @@ bool Application::initRenderPipeline(const std::string& pipelineName, const std:
 
 	WGPUDepthStencilState depthStencilState = {};
 	depthStencilState.depthCompare = WGPUCompareFunction_Less;
-	depthStencilState.depthWriteEnabled = true;
+	depthStencilState.depthWriteEnabled = !transparent;
 	depthStencilState.format = m_depthTextureFormat;
 	depthStencilState.stencilReadMask = 0;
 	depthStencilState.stencilWriteMask = 0;
@@ -897,26 +1285,24 @@ bool Application::initRenderPipeline(const std::string& pipelineName, const std:
 	pipelineDesc.multisample.alphaToCoverageEnabled = false;
 
 	// Create the pipeline layout
+	WGPUBindGroupLayout bindGroupLayouts[3] = { m_bindGroupLayout, m_functionBindGroupLayout, m_heightfieldBindGroupLayout };
 	WGPUPipelineLayoutDescriptor layoutDesc{};
-	layoutDesc.bindGroupLayoutCount = 1;
-	layoutDesc.bindGroupLayouts = (WGPUBindGroupLayout*)&m_bindGroupLayout;
+	layoutDesc.bindGroupLayoutCount = heightfield ? 3 : packed ? 2 : 1;
+	layoutDesc.bindGroupLayouts = bindGroupLayouts;
 	WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(m_device, &layoutDesc);
 	pipelineDesc.layout = layout;
 
-	m_pipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipelineDesc);
-	std::cout << "Render pipeline: " << m_pipeline << std::endl;
-
-	m_pipelines[pipelineName] = m_pipeline;
+	WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipelineDesc);
 
 	wgpuPipelineLayoutRelease(layout);
-	return m_pipeline != nullptr;
+	return pipeline;
 }
 
 void Application::terminateRenderPipeline(const std::string& pipelineName) {
 	// m_pipeline.release();
 	// m_shaderModule.release();
+	// The shader module may be shared with other pipelines: terminateRenderPipelines releases it
 	wgpuRenderPipelineRelease(m_pipelines[pipelineName]);
-	wgpuShaderModuleRelease(m_shaderModuleMap[pipelineName]);
 	// auto pipelineIt = m_pipelines.find(pipelineName);
     // if (pipelineIt != m_pipelines.end()) {
     //     wgpuRenderPipelineRelease(pipelineIt->second);
@@ -936,7 +1322,98 @@ void Application::terminateRenderPipelines() {
         terminateRenderPipeline(pair.first);
     }
     m_pipelines.clear();
+    for (const auto& pair : m_shaderModuleMap) {
+        wgpuShaderModuleRelease(pair.second);
+    }
     m_shaderModuleMap.clear();
+    m_pipelineRecipes.clear();
+    m_shaderFileTimes.clear();
+    m_scenePipelines = {};
+}
+
+void Application::resolveScenePipelines() {
+	m_scenePipelines.boat = m_pipelines["boat"];
+	m_scenePipelines.axes = m_pipelines["axes"];
+	m_scenePipelines.surface = m_pipelines["surface"];
+	m_scenePipelines.lines = m_pipelines["lines"];
+	m_scenePipelines.glyph = m_pipelines["glyph"];
+	m_scenePipelines.surfaceOit = m_pipelines["surfaceOit"];
+	m_scenePipelines.heightfield = m_pipelines["heightfield"];
+	m_scenePipelines.heightfieldOit = m_pipelines["heightfieldOit"];
+}
+
+// ─── Shader Hot Reload ──────────────────────────────────────────────────────
+
+void Application::reloadChangedShaders() {
+	// One stat per WGSL file, a few times a second
+	const double now = glfwGetTime();
+	if (now - m_lastShaderPoll < SHADER_POLL_INTERVAL) return;
+	m_lastShaderPoll = now;
+
+	for (auto& [shaderFileName, time] : m_shaderFileTimes) {
+		std::error_code error;
+		const std::filesystem::file_time_type modified = std::filesystem::last_write_time(shaderFileName, error);
+		// Missing while an editor saves it: looked at again at the next poll
+		if (error || modified == time) continue;
+		time = modified;
+		reloadShader(shaderFileName);
+	}
+}
+
+bool Application::reloadShader(const std::string& shaderFileName) {
+	std::vector<std::string> names;
+	for (const auto& [name, recipe] : m_pipelineRecipes) {
+		if (recipe.shaderFileName == shaderFileName) names.push_back(name);
+	}
+
+	// Compile and pipeline errors go to this scope rather than the uncaptured error callback.
+	// The file is compiled once, for all of its pipelines, so an error is reported once.
+	wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_Validation);
+	WGPUShaderModule module = ResourceManager::loadShaderModule(shaderFileName, m_device);
+	std::vector<WGPURenderPipeline> pipelines;
+	if (module) {
+		for (const std::string& name : names) pipelines.push_back(createRenderPipeline(m_pipelineRecipes[name], module));
+	}
+	struct ScopeResult {
+		bool done = false;
+		WGPUErrorType type = WGPUErrorType_NoError;
+		std::string message;
+	} result;
+	wgpuDevicePopErrorScope(m_device, [](WGPUErrorType type, char const* message, void* userdata) {
+		ScopeResult& result = *reinterpret_cast<ScopeResult*>(userdata);
+		result.type = type;
+		if (message) result.message = message;
+		result.done = true;
+	}, &result);
+	while (!result.done) {
+		pollDevice();
+		std::this_thread::yield();
+	}
+
+	bool success = result.type == WGPUErrorType_NoError && module;
+	for (WGPURenderPipeline pipeline : pipelines) success = success && pipeline;
+	const std::string fileName = std::filesystem::path(shaderFileName).filename().string();
+	if (!success) {
+		// The previous pipelines keep drawing until the file compiles again
+		for (WGPURenderPipeline pipeline : pipelines) if (pipeline) wgpuRenderPipelineRelease(pipeline);
+		if (module) wgpuShaderModuleRelease(module);
+		m_shaderStatus = fileName + ": " + (result.message.empty() ? "could not be read" : result.message);
+		std::cerr << "Could not reload " << m_shaderStatus << std::endl;
+		return false;
+	}
+
+	// Bundles recorded with the old pipelines see new handles in their commands and are recorded again
+	for (size_t i = 0; i < names.size(); ++i) {
+		terminateRenderPipeline(names[i]);
+		m_pipelines[names[i]] = pipelines[i];
+	}
+	wgpuShaderModuleRelease(m_shaderModuleMap[shaderFileName]);
+	m_shaderModuleMap[shaderFileName] = module;
+	resolveScenePipelines();
+	m_sceneGeneration = ++m_bundleGeneration;
+	m_shaderStatus = "Reloaded " + fileName + " (" + std::to_string(names.size()) + " pipelines)";
+	std::cout << m_shaderStatus << std::endl;
+	return true;
 }
 
 
@@ -979,6 +1456,54 @@ void Application::terminateTexture() {
 	wgpuSamplerRelease(m_sampler);
 }
 
+bool Application::initColormapTexture() {
+	// One row per map; the shader samples texel centres, so the repeating sampler never wraps
+	WGPUTextureDescriptor textureDesc = {};
+	textureDesc.label = "Colormaps";
+	textureDesc.dimension = WGPUTextureDimension_2D;
+	textureDesc.format = WGPUTextureFormat_RGBA8Unorm;
+	textureDesc.size = { GraphObjects::COLORMAP_SIZE, GraphObjects::COLORMAP_COUNT, 1 };
+	textureDesc.mipLevelCount = 1;
+	textureDesc.sampleCount = 1;
+	textureDesc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst;
+	textureDesc.viewFormatCount = 0;
+	textureDesc.viewFormats = nullptr;
+	m_colormapTexture = wgpuDeviceCreateTexture(m_device, &textureDesc);
+	if (!m_colormapTexture) {
+		std::cerr << "Could not create the colormap texture!" << std::endl;
+		return false;
+	}
+
+	std::vector<uint32_t> texels = GraphObjects::colormapTexels();
+	WGPUImageCopyTexture destination = {};
+	destination.texture = m_colormapTexture;
+	destination.mipLevel = 0;
+	destination.origin = { 0, 0, 0 };
+	destination.aspect = WGPUTextureAspect_All;
+	WGPUTextureDataLayout source = {};
+	source.offset = 0;
+	source.bytesPerRow = GraphObjects::COLORMAP_SIZE * sizeof(uint32_t);
+	source.rowsPerImage = GraphObjects::COLORMAP_COUNT;
+	wgpuQueueWriteTexture(m_queue, &destination, texels.data(), texels.size() * sizeof(uint32_t), &source, &textureDesc.size);
+
+	WGPUTextureViewDescriptor textureViewDesc = {};
+	textureViewDesc.aspect = WGPUTextureAspect_All;
+	textureViewDesc.baseArrayLayer = 0;
+	textureViewDesc.arrayLayerCount = 1;
+	textureViewDesc.baseMipLevel = 0;
+	textureViewDesc.mipLevelCount = 1;
+	textureViewDesc.dimension = WGPUTextureViewDimension_2D;
+	textureViewDesc.format = textureDesc.format;
+	m_colormapTextureView = wgpuTextureCreateView(m_colormapTexture, &textureViewDesc);
+	return m_colormapTextureView != nullptr;
+}
+
+void Application::terminateColormapTexture() {
+	wgpuTextureViewRelease(m_colormapTextureView);
+	wgpuTextureDestroy(m_colormapTexture);
+	wgpuTextureRelease(m_colormapTexture);
+}
+
 
 bool Application::initGeometry() {
 	// Load mesh data from OBJ file
@@ -1228,46 +1753,27 @@ bool Application::initWireframeGeometry(float spacing, float len) {
 }
 
 
-bool Application::initArrowGeometry(float length, float headLength, float headAngle) {
-    std::vector<VertexAttributes> arrowVertexData;
-
-    // Define the shaft (line)
-    arrowVertexData.insert(arrowVertexData.end(), {
-        {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}},
-        {{0.0f, 0.0f, length}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}}
-    });
-
-    // Define the arrowhead (4 lines forming a cross)
-    glm::vec3 tip(0.0f, 0.0f, length);
-    glm::vec3 leftWing = tip + glm::vec3(headLength * cos(headAngle), headLength * sin(headAngle), -headLength);
-    glm::vec3 rightWing = tip + glm::vec3(-headLength * cos(headAngle), headLength * sin(headAngle), -headLength);
-    glm::vec3 topWing = tip + glm::vec3(headLength * sin(headAngle), headLength * cos(headAngle), -headLength);
-    glm::vec3 bottomWing = tip + glm::vec3(-headLength * sin(headAngle), headLength * cos(headAngle), -headLength);
-
-    arrowVertexData.insert(arrowVertexData.end(), {
-        {tip, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {leftWing, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        
-        {tip, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {rightWing, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        
-        {tip, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {topWing, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        
-        {tip, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {bottomWing, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}}
-    });
-
-    // Create the buffer and upload the data
-    WGPUBufferDescriptor bufferDesc = {};
-    bufferDesc.size = arrowVertexData.size() * sizeof(VertexAttributes);
-    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
-    bufferDesc.mappedAtCreation = false;
-    m_arrowVertexBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
-    wgpuQueueWriteBuffer(m_queue, m_arrowVertexBuffer, 0, arrowVertexData.data(), bufferDesc.size);
-    m_arrowVertexCount = static_cast<int>(arrowVertexData.size());
-
-    return m_arrowVertexBuffer != nullptr;
+bool Application::initGlyphGeometry() {
+	std::vector<VertexAttributes> arrow = GraphObjects::unitArrowMesh();
+	m_arrowVertexBuffer = createBuffer(arrow.data(), arrow.size() * sizeof(VertexAttributes), WGPUBufferUsage_Vertex);
+	m_arrowVertexCount = static_cast<int>(arrow.size());
+
+	std::vector<VertexAttributes> cube = GraphObjects::unitCubeMesh();
+	m_cubeVertexBuffer = createBuffer(cube.data(), cube.size() * sizeof(VertexAttributes), WGPUBufferUsage_Vertex);
+	m_cubeVertexCount = static_cast<int>(cube.size());
+
+	return m_arrowVertexBuffer != nullptr && m_cubeVertexBuffer != nullptr;
+}
+
+void Application::terminateGlyphGeometry() {
+	for (WGPUBuffer* buffer : { &m_arrowVertexBuffer, &m_cubeVertexBuffer }) {
+		if (!*buffer) continue;
+		wgpuBufferDestroy(*buffer);
+		wgpuBufferRelease(*buffer);
+		*buffer = nullptr;
+	}
+	m_arrowVertexCount = 0;
+	m_cubeVertexCount = 0;
 }
 
 void Application::terminateGeometry() {
@@ -1407,10 +1913,27 @@ bool Application::initBindGroupLayout() {
 	m_bindGroupLayout = wgpuDeviceCreateBindGroupLayout(m_device, &bindGroupLayoutDesc);
 	// m_bindGroupLayout = m_device.createBindGroupLayout(bindGroupLayoutDesc);
 
-	return m_bindGroupLayout != nullptr;
+	// Group 1 of the packed pipelines: one FunctionUniforms block, picked per draw by dynamic offset
+	WGPUBindGroupLayoutEntry functionLayout = {};
+	functionLayout.binding = 0;
+	functionLayout.visibility = WGPUShaderStage_Vertex | WGPUShaderStage_Fragment;
+	functionLayout.buffer.type = WGPUBufferBindingType_Uniform;
+	functionLayout.buffer.hasDynamicOffset = true;
+	functionLayout.buffer.minBindingSize = sizeof(FunctionUniforms);
+
+	WGPUBindGroupLayoutDescriptor functionLayoutDesc{};
+	functionLayoutDesc.entryCount = 1;
+	functionLayoutDesc.entries = &functionLayout;
+	m_functionBindGroupLayout = wgpuDeviceCreateBindGroupLayout(m_device, &functionLayoutDesc);
+
+	m_heightfieldBindGroupLayout = Heightfield::createBindGroupLayout(m_device);
+
+	return m_bindGroupLayout != nullptr && m_functionBindGroupLayout != nullptr && m_heightfieldBindGroupLayout != nullptr;
 }
 
 void Application::terminateBindGroupLayout() {
+	wgpuBindGroupLayoutRelease(m_heightfieldBindGroupLayout);
+	wgpuBindGroupLayoutRelease(m_functionBindGroupLayout);
 	wgpuBindGroupLayoutRelease(m_bindGroupLayout);
 }
 
@@ -1441,17 +1964,22 @@ bool Application::initBindGroup() {
 	bindGroupDesc.entries = bindings.data();
 	m_bindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
 
+	// Same uniforms and sampler, with the colormaps where the boat texture was
+	bindings[1].textureView = m_colormapTextureView;
+	m_colormapBindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+
 	return m_bindGroup != nullptr;
 }
 
 void Application::terminateBindGroup() {
+	wgpuBindGroupRelease(m_colormapBindGroup);
 	wgpuBindGroupRelease(m_bindGroup);
 }
 
 void Application::updateProjectionMatrix() {
 	// Update projection matrix
 	int width, height;
-	glfwGetFramebufferSize(m_window, &width, &height);
+	framebufferSize(width, height);
 	float ratio = width / (float)height;
 	m_aspectRatio = ratio;
 	m_uniforms.projectionMatrix = glm::perspective(m_fovy, m_aspectRatio, m_nearPlane, m_farPlane);
@@ -1462,6 +1990,7 @@ void Application::updateProjectionMatrix() {
 		&m_uniforms.projectionMatrix,
 		sizeof(MyUniforms::projectionMatrix)
 	);
+	updateFrustum();
 }
 
 void Application::updateViewMatrix() {
@@ -1489,7 +2018,7 @@ void Application::updateViewMatrix() {
 		&m_uniforms.cameraWorldPosition,
 		sizeof(MyUniforms::cameraWorldPosition)
 	);
-
+	updateFrustum();
 }
 
 void Application::updateDragInertia() {
@@ -1512,9 +2041,10 @@ void Application::updateDragInertia() {
 // ─── Axes Rebuild ───────────────────────────────────────────────────────────
 
 void Application::rebuildAxesBuffer() {
-	// Defer old buffer destruction
+	m_sceneGeneration = ++m_bundleGeneration;
+	// Destroyed once the frames drawing it have finished
 	if (m_axesVertexBuffer) {
-		deferBufferRelease(m_axesVertexBuffer);
+		m_geometryPool.retire(m_axesVertexBuffer);
 		m_axesVertexBuffer = nullptr;
 		m_axesVertexCount = 0;
 	}
@@ -1569,7 +2099,8 @@ void Application::rebuildAxesBuffer() {
 
 // ─── Expression Compilation ─────────────────────────────────────────────────
 
-void Application::compileFunctionDef(FunctionDefinition& fd) {
+// Compile fd.parsers from its expressions, setting isValid / errorMsg
+static void compileParsers(FunctionDefinition& fd) {
 	// Build variable name list based on inputDim
 	std::vector<std::string> varNames;
 	for (int i = 0; i < fd.inputDim; ++i) {
@@ -1588,12 +2119,34 @@ void Application::compileFunctionDef(FunctionDefinition& fd) {
 		if (!fd.parsers[i].compile(fd.exprStrings[i], varNames, err)) {
 			fd.isValid = false;
 			fd.errorMsg = "f" + std::to_string(i + 1) + ": " + err;
+			fd.fused.clear();
 			return;
 		}
 	}
+	fd.fused.build(fd.parsers, fd.outputDim);
+}
+
+// Conventional function and variable names for fd's dimensions
+static void resetNames(FunctionDefinition& fd) {
+	int n = fd.inputDim, m = fd.outputDim;
+	// Function name
+	if      (n == 1 && m >= 2)              fd.name = "r";
+	else if (n == 2 && m == 3)              fd.name = "s";
+	else if (n == 3 && m >= 2)              fd.name = "F";
+	else                                    fd.name = "f";
+	// Variable names
+	if      (n == 1 && m >= 2)              { fd.paramNames[0] = "t";  fd.paramNames[1] = "";  fd.paramNames[2] = ""; }
+	else if (n == 1)                        { fd.paramNames[0] = "x";  fd.paramNames[1] = "";  fd.paramNames[2] = ""; }
+	else if (n == 2 && m == 3)              { fd.paramNames[0] = "u";  fd.paramNames[1] = "v"; fd.paramNames[2] = ""; }
+	else if (n == 2)                        { fd.paramNames[0] = "x";  fd.paramNames[1] = "y"; fd.paramNames[2] = ""; }
+	else                                    { fd.paramNames[0] = "x";  fd.paramNames[1] = "y"; fd.paramNames[2] = "z"; }
+}
+
+void Application::compileFunctionDef(FunctionDefinition& fd) {
+	compileParsers(fd);
 
 	// Auto-enable vector field overlay for R³→R³ functions
-	if (fd.inputDim == 3 && fd.outputDim == 3) {
+	if (fd.isValid && fd.inputDim == 3 && fd.outputDim == 3) {
 		fd.showVectorField = true;
 	}
 }
@@ -1601,6 +2154,11 @@ void Application::compileFunctionDef(FunctionDefinition& fd) {
 // ─── Graph Objects ──────────────────────────────────────────────────────────
 
 bool Application::initGraphObjects() {
+	WGPUBufferUsageFlags poolUsage = WGPUBufferUsage_Vertex | WGPUBufferUsage_Index;
+	if (!m_geometryPool.init(m_device, m_queue, poolUsage, GEOMETRY_POOL_PAGE_SIZE, m_supported_limits.limits.maxBufferSize)) {
+		return false;
+	}
+
 	// Create a default helix function
 	FunctionDefinition helix;
 	helix.name = "r";
@@ -1623,24 +2181,173 @@ bool Application::initGraphObjects() {
 }
 
 void Application::terminateGraphObjects() {
-	if (m_surfaceVertexBuffer) {
-		wgpuBufferDestroy(m_surfaceVertexBuffer);
-		wgpuBufferRelease(m_surfaceVertexBuffer);
-		m_surfaceVertexBuffer = nullptr;
-		m_surfaceVertexCount = 0;
+	for (auto& fd : m_functions) {
+		cancelGeometryBuild(fd, true);
+		releaseFunctionGeometry(fd);
+		fd.gpuSurface.reset();
+		fd.gpuFlow.reset();
+		fd.heightfield.reset();
+	}
+	if (m_drawArgsBuffer) {
+		wgpuBufferDestroy(m_drawArgsBuffer);
+		wgpuBufferRelease(m_drawArgsBuffer);
+		m_drawArgsBuffer = nullptr;
+		m_drawArgsCapacity = 0;
+	}
+	if (m_functionUniformBuffer) {
+		wgpuBindGroupRelease(m_functionBindGroup);
+		wgpuBufferDestroy(m_functionUniformBuffer);
+		wgpuBufferRelease(m_functionUniformBuffer);
+		m_functionBindGroup = nullptr;
+		m_functionUniformBuffer = nullptr;
+		m_functionUniforms.clear();
+	}
+	m_geometryPool.terminate();
+}
+
+namespace {
+// 64-bit FNV-1a, fed little-endian words so the same settings hash the same on every platform
+// and compiler: stage keys are saved in session files
+struct StageHash {
+	uint64_t h = 0xcbf29ce484222325ull;
+
+	void byte(uint8_t b) { h = (h ^ b) * 0x100000001b3ull; }
+	void word(uint32_t v) { for (int i = 0; i < 4; ++i) byte((uint8_t)(v >> (8 * i))); }
+	void i32(int v) { word((uint32_t)v); }
+	void f32(float f) {
+		uint32_t bits;
+		std::memcpy(&bits, &f, sizeof(bits));
+		word(bits);
+	}
+	// Length first, so consecutive strings cannot run into each other
+	void str(const std::string& s) {
+		word((uint32_t)s.size());
+		for (char c : s) byte((uint8_t)c);
 	}
-	if (m_curveVertexBuffer) {
-		wgpuBufferDestroy(m_curveVertexBuffer);
-		wgpuBufferRelease(m_curveVertexBuffer);
-		m_curveVertexBuffer = nullptr;
-		m_curveVertexCount = 0;
+};
+}
+
+// Hash per GeometryStage of every FunctionDefinition field that stage is generated from; 0 for
+// overlays that are switched off. Settings read only at draw time (opacity, colour of tinted
+// surfaces, colormaps) are in none of them.
+static void functionStageKeys(const FunctionDefinition& fd, StageKeys& keys) {
+	// What every stage samples
+	StageHash common;
+	common.i32(fd.inputDim);
+	common.i32(fd.outputDim);
+	for (int i = 0; i < 3; ++i) {
+		common.str(fd.paramNames[i]);
+		common.str(fd.exprStrings[i]);
+		common.f32(fd.rangeMin[i]);
+		common.f32(fd.rangeMax[i]);
+	}
+	common.i32(fd.curvePlane);
+
+	for (int s = 0; s < STAGE_COUNT; ++s) {
+		StageHash h = common;
+		auto mixFloat = [&h](float f) { h.f32(f); };
+		auto mixInt = [&h](int i) { h.i32(i); };
+		mixInt(s);
+		bool enabled = true;
+		switch (s) {
+		case STAGE_BASE: {
+			mixInt(fd.resolution[0]);
+			mixInt(fd.resolution[1]);
+			mixFloat(fd.tubeRadius);
+			mixInt(fd.vfResolution);
+			mixFloat(fd.adaptiveTolerance);
+			int flags = (fd.wireframe << 0) | (fd.showStreamlines << 1) | (fd.gpuEvaluate << 2) | (fd.adaptive << 3)
+				| (fd.gpuStreamlines << 4) | (fd.showParticles << 5) | (fd.renderImplicit << 6);
+			mixInt(flags);
+			mixInt(fd.flowStreamlineCount);
+			mixInt(fd.particleCount);
+			mixFloat(fd.isovalue);
+			mixInt(fd.isoLevelCount);
+			mixFloat(fd.isoLevelSpacing);
+			mixInt(fd.isoResolution);
+			// The field cubes and the streamlines are sized by the overlay settings
+			if (fd.inputDim == 3) {
+				mixInt(fd.overlayVectorCount);
+				mixFloat(fd.overlayVectorScale);
+			}
+			// Isolines are lines, which have no tint
+			if (fd.renderImplicit && fd.inputDim == 2 && fd.outputDim == 1) {
+				for (int i = 0; i < 3; ++i) mixFloat(fd.color[i]);
+			}
+			break;
+		}
+		case STAGE_TANGENTS:
+			enabled = fd.showTangentVectors;
+			mixInt(fd.surfaceTangentMode);
+			break;
+		case STAGE_NORMALS:
+			enabled = fd.showNormalVectors;
+			mixInt(fd.flipNormalVectors);
+			break;
+		case STAGE_FRENET:
+			enabled = fd.showFrenetFrame;
+			mixFloat(fd.frenetT);
+			break;
+		case STAGE_GRADIENT:
+			enabled = fd.showGradientField && !fd.renderImplicit;
+			break;
+		case STAGE_VECTOR_FIELD:
+			enabled = fd.showVectorField;
+			mixFloat(fd.arrowScale);
+			break;
+		}
+		if (s != STAGE_BASE) {
+			mixInt(fd.overlayVectorCount);
+			mixFloat(fd.overlayVectorScale);
+		}
+		// Never 0 when enabled, so a built stage always differs from an empty one
+		keys[s] = enabled ? (h.h | 1) : 0;
 	}
-	// Flush all pending buffer releases
-	for (auto& p : m_pendingBufferReleases) {
-		wgpuBufferDestroy(p.first);
-		wgpuBufferRelease(p.first);
+}
+
+// Copy the fields functionStageKeys covers (keep the two in sync) and compile private parsers
+static void snapshotFunction(const FunctionDefinition& fd, FunctionDefinition& out) {
+	out.name = fd.name;
+	out.inputDim = fd.inputDim;
+	out.outputDim = fd.outputDim;
+	for (int i = 0; i < 3; ++i) {
+		out.paramNames[i] = fd.paramNames[i];
+		out.exprStrings[i] = fd.exprStrings[i];
+		out.rangeMin[i] = fd.rangeMin[i];
+		out.rangeMax[i] = fd.rangeMax[i];
+		out.color[i] = fd.color[i];
 	}
-	m_pendingBufferReleases.clear();
+	out.resolution[0] = fd.resolution[0];
+	out.resolution[1] = fd.resolution[1];
+	out.tubeRadius = fd.tubeRadius;
+	out.arrowScale = fd.arrowScale;
+	out.vfResolution = fd.vfResolution;
+	out.curvePlane = fd.curvePlane;
+	out.adaptive = fd.adaptive;
+	out.adaptiveTolerance = fd.adaptiveTolerance;
+	out.wireframe = fd.wireframe;
+	out.showTangentVectors = fd.showTangentVectors;
+	out.surfaceTangentMode = fd.surfaceTangentMode;
+	out.showNormalVectors = fd.showNormalVectors;
+	out.flipNormalVectors = fd.flipNormalVectors;
+	out.showFrenetFrame = fd.showFrenetFrame;
+	out.frenetT = fd.frenetT;
+	out.showGradientField = fd.showGradientField;
+	out.showVectorField = fd.showVectorField;
+	out.showStreamlines = fd.showStreamlines;
+	out.overlayVectorCount = fd.overlayVectorCount;
+	out.overlayVectorScale = fd.overlayVectorScale;
+	out.gpuEvaluate = fd.gpuEvaluate;
+	out.gpuStreamlines = fd.gpuStreamlines;
+	out.flowStreamlineCount = fd.flowStreamlineCount;
+	out.showParticles = fd.showParticles;
+	out.particleCount = fd.particleCount;
+	out.renderImplicit = fd.renderImplicit;
+	out.isovalue = fd.isovalue;
+	out.isoLevelCount = fd.isoLevelCount;
+	out.isoLevelSpacing = fd.isoLevelSpacing;
+	out.isoResolution = fd.isoResolution;
+	compileParsers(out);
 }
 
 void Application::updateGraphObjects() {
@@ -1648,6 +2355,9 @@ void Application::updateGraphObjects() {
 		rebuildAxesBuffer();
 	}
 
+	// Swap in background builds that finished since the last frame
+	collectGeometryBuilds();
+
 	if (!m_graphObjectsDirty) return;
 
 	// Throttle updates to prevent buffer churn (wait at least 2 frames)
@@ -1657,240 +2367,1348 @@ void Application::updateGraphObjects() {
 
 	m_graphObjectsDirty = false;
 
-	// Defer old buffer destruction (GPU may still be using them)
-	if (m_surfaceVertexBuffer) {
-		deferBufferRelease(m_surfaceVertexBuffer);
-		m_surfaceVertexBuffer = nullptr;
-		m_surfaceVertexCount = 0;
-	}
-	if (m_curveVertexBuffer) {
-		deferBufferRelease(m_curveVertexBuffer);
-		m_curveVertexBuffer = nullptr;
-		m_curveVertexCount = 0;
+	for (auto& fd : m_functions) {
+		if (!fd.dirty) continue;
+		// Hidden functions keep their dirty flag and are built when shown again
+		if (!fd.show) continue;
+		scheduleFunctionGeometry(fd);
 	}
+}
 
-	// TriangleList geometry (lit, "surface" pipeline)
-	std::vector<VertexAttributes> surfaceVerts;
-	// LineList geometry (unlit, "axes" pipeline) — for wireframe overlays
-	std::vector<VertexAttributes> lineVerts;
+void Application::scheduleFunctionGeometry(FunctionDefinition& fd) {
+	fd.dirty = false;
 
-	for (auto& fd : m_functions) {
-		if (!fd.show || !fd.isValid) continue;
+	if (!fd.isValid) {
+		cancelGeometryBuild(fd);
+		releaseFunctionGeometry(fd);
+		fd.gpuSurface.reset();
+		fd.gpuFlow.reset();
+		fd.heightfield.reset();
+		return;
+	}
 
-		vec3 col(fd.color[0], fd.color[1], fd.color[2]);
-		int n = fd.inputDim;
-		int m = fd.outputDim;
+	StageKeys keys;
+	functionStageKeys(fd, keys);
+	if (fd.pendingBuild) {
+		if (fd.pendingBuild->keys == keys) return;  // already building these settings
+		cancelGeometryBuild(fd);                    // stale, superseded below
+	}
+	// Only the stages whose inputs changed since their upload
+	uint32_t stages = 0;
+	for (int s = 0; s < STAGE_COUNT; ++s) {
+		if (keys[s] != fd.stageKeys[s]) stages |= 1u << s;
+	}
+	if (!stages) return;
 
-		if (n == 1) {
-			// Curve: build lambda t -> vec3
-			auto curveFunc = [&fd, m](float t) -> glm::vec3 {
-				double vals[1] = { (double)t };
-				if (m == 1) {
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					return glm::vec3(t, fx, 0.0f);
-				} else if (m == 2) {
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					float fy = (float)fd.parsers[1].evaluate(vals);
-					// Map to selected plane: 0=xy, 1=xz, 2=yz
-					if (fd.curvePlane == 0) return glm::vec3(fx, fy, 0.0f);      // xy plane
-					else if (fd.curvePlane == 1) return glm::vec3(fx, 0.0f, fy); // xz plane
-					else return glm::vec3(0.0f, fx, fy);                          // yz plane
-				} else { // m == 3
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					float fy = (float)fd.parsers[1].evaluate(vals);
-					float fz = (float)fd.parsers[2].evaluate(vals);
-					return glm::vec3(fx, fy, fz);
-				}
-			};
+	// Filled surface evaluated by a compute shader; it is cheap and updates right away
+	if (stages & (1u << STAGE_BASE)) {
+		updateGpuSurface(fd);
+		updateGpuFlow(fd);
+	}
 
-			// Use thinner tube for 2D curves, and support wireframe mode
-			float tubeRad = (m == 2) ? 0.01f : fd.tubeRadius;
-			if (!fd.wireframe) {
-				auto verts = GraphObjects::generateParametricCurveTube(
-					curveFunc, fd.rangeMin[0], fd.rangeMax[0],
-					fd.resolution[0], tubeRad, 8, col);
-				surfaceVerts.insert(surfaceVerts.end(), verts.begin(), verts.end());
-			} else {
-				// Wireframe: use line rendering with purple color
-				vec3 wireframeColor(0.7f, 0.4f, 0.8f);
-				auto curveLineVerts = GraphObjects::generateParametricCurve(
-					curveFunc, fd.rangeMin[0], fd.rangeMax[0],
-					fd.resolution[0], wireframeColor);
-				lineVerts.insert(lineVerts.end(), curveLineVerts.begin(), curveLineVerts.end());
-			}
+	submitGeometryBuild(fd, keys, stages);
+}
 
-			// Tangent vectors overlay
-			if (fd.showTangentVectors) {
-				auto tangentVerts = GraphObjects::generateTangentVectors(
-					curveFunc, fd.rangeMin[0], fd.rangeMax[0],
-					fd.overlayVectorCount, fd.overlayVectorScale, vec3(1, 0, 0));
-				surfaceVerts.insert(surfaceVerts.end(), tangentVerts.begin(), tangentVerts.end());
-			}
+void Application::submitGeometryBuild(FunctionDefinition& fd, const StageKeys& keys, uint32_t stages) {
+	auto task = std::make_shared<GeometryTask>();
+	snapshotFunction(fd, task->snapshot);
+	task->keys = keys;
+	task->stages = stages;
+	task->filledSurfaceOnGpu = (fd.gpuSurface != nullptr);
+	task->streamlinesOnGpu = (fd.gpuFlow && fd.gpuFlow->streamlineIndexCount() > 0);
+	fd.pendingBuild = task;
+
+	// The job holds the only other reference, so removing the function mid-build is safe
+	JobSystem::shared().submit([task] {
+		if (!task->cancelled.load()) {
+			PROFILE_SCOPE("Geometry build");
+			buildFunctionGeometry(task->snapshot, task->filledSurfaceOnGpu, task->streamlinesOnGpu,
+				task->stages, &task->cancelled, task->result);
+			finishFunctionGeometry(task->result);
+		}
+		task->finished.store(true, std::memory_order_release);
+	});
+}
 
-			// Normal vectors overlay for curves
-			if (fd.showNormalVectors) {
-				auto normalVerts = GraphObjects::generateCurveNormals(
-					curveFunc, fd.rangeMin[0], fd.rangeMax[0],
-					fd.overlayVectorCount, fd.overlayVectorScale, vec3(0, 1, 0), fd.flipNormalVectors);
-				surfaceVerts.insert(surfaceVerts.end(), normalVerts.begin(), normalVerts.end());
-			}
+void Application::collectGeometryBuilds() {
+	for (auto& fd : m_functions) {
+		if (!fd.pendingBuild || !fd.pendingBuild->finished.load(std::memory_order_acquire)) continue;
+		std::shared_ptr<GeometryTask> task = std::move(fd.pendingBuild);
+		fd.pendingBuild.reset();
+		if (task->cancelled.load()) continue;
+
+		// Swap: the old buffers of the rebuilt stages go through the deferred release, the new ones
+		// draw from this frame on
+		releaseFunctionGeometry(fd, task->stages);
+		uploadFunctionGeometry(fd, task->stages, task->result);
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (task->stages & (1u << s)) fd.stageKeys[s] = task->keys[s];
+		}
+	}
+}
+
+void Application::cancelGeometryBuild(FunctionDefinition& fd, bool wait) {
+	if (!fd.pendingBuild) return;
+	fd.pendingBuild->cancelled.store(true);
+	while (wait && !fd.pendingBuild->finished.load(std::memory_order_acquire)) {
+		std::this_thread::yield();
+	}
+	fd.pendingBuild.reset();
+}
+
+void Application::uploadFunctionGeometry(FunctionDefinition& fd, uint32_t stages, FunctionGeometry& g) {
+	PROFILE_FUNCTION();
+	fd.bundleGeneration = ++m_bundleGeneration;
+	if (stages & ARROW_STAGES) {
+		// Rebuilt overlays replace their own arrows; the buffer holds every stage's
+		size_t count = 0;
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (stages & (1u << s)) fd.stageArrows[s] = std::move(g.arrows[s]);
+			count += fd.stageArrows[s].size();
+		}
+		std::vector<GlyphInstance> arrows;
+		arrows.reserve(count);
+		for (const auto& stageArrows : fd.stageArrows) arrows.insert(arrows.end(), stageArrows.begin(), stageArrows.end());
+		if (!arrows.empty()) {
+			fd.arrowInstanceBuffer = m_geometryPool.upload(arrows.data(), arrows.size() * sizeof(GlyphInstance));
+			fd.arrowInstanceCount = static_cast<int>(arrows.size());
+		}
+		static const vec2 arrowExtent = GraphObjects::glyphMeshExtent(GraphObjects::unitArrowMesh());
+		fd.arrowBounds = GraphObjects::glyphBounds(arrows, arrowExtent);
+	}
+	if (!(stages & (1u << STAGE_BASE))) return;
+
+	// The texture of the last heightfield is rewritten when the new one has its size
+	if (!g.heightfield.empty()) {
+		if (!fd.heightfield) fd.heightfield = std::make_unique<Heightfield>();
+		std::string errorMsg;
+		if (fd.heightfield->upload(m_device, m_queue, m_heightfieldBindGroupLayout, g.heightfield.data(),
+			g.heightfieldSize[0], g.heightfieldSize[1], g.heightfieldRange, errorMsg)) {
+			fd.surfaceLodLevels = g.surfaceLodLevels;
+			std::copy(std::begin(g.surfaceLodFirst), std::end(g.surfaceLodFirst), fd.surfaceLodFirst);
+			std::copy(std::begin(g.surfaceLodCount), std::end(g.surfaceLodCount), fd.surfaceLodCount);
+			fd.surfaceVertexCount = g.heightfieldSize[0] * g.heightfieldSize[1];
+			fd.surfaceLod = 0;
+			fd.surfaceEdgeLength = g.surfaceEdgeLength;
+			fd.surfaceColormapped = g.surfaceColormapped;
+			fd.surfaceScalarRange[0] = g.surfaceScalarRange[0];
+			fd.surfaceScalarRange[1] = g.surfaceScalarRange[1];
+			fd.surfaceTinted = g.surfaceTinted;
+		} else {
+			std::cerr << "Could not upload the heightfield of " << fd.name << ": " << errorMsg << std::endl;
+			fd.heightfield.reset();
+		}
+	} else {
+		fd.heightfield.reset();
+	}
+
+	if (!g.surfaceMesh.empty()) {
+		std::vector<MeshPart> parts = uploadMeshParts(g.surfaceVertices, g.surfaceMesh.vertices, g.surfaceColormapped,
+			g.surfaceMesh.indices, g.surfaceLodCount[0], 3);
+		fd.surfaceLodLevels = g.surfaceLodLevels;
+		std::copy(std::begin(g.surfaceLodFirst), std::end(g.surfaceLodFirst), fd.surfaceLodFirst);
+		std::copy(std::begin(g.surfaceLodCount), std::end(g.surfaceLodCount), fd.surfaceLodCount);
+		if (parts.size() > 1) {
+			fd.surfaceLodLevels = 1;
+			fd.surfaceLodCount[0] = parts[0].indexCount;
+		}
+		if (!parts.empty()) {
+			fd.surfaceBuffer = parts[0].vertices;
+			fd.surfaceIndexBuffer = parts[0].indices;
+			fd.surfaceParts.assign(parts.begin() + 1, parts.end());
+		}
+		fd.surfaceVertexCount = static_cast<int>(g.surfaceVertices.empty() ? g.surfaceMesh.vertices.size() : g.surfaceVertices.size());
+		fd.surfaceIndexCount = static_cast<int>(g.surfaceLodCount[0]);
+		fd.surfaceLod = 0;
+		fd.surfaceEdgeLength = g.surfaceEdgeLength;
+		fd.surfaceColormapped = g.surfaceColormapped;
+		fd.surfaceScalarRange[0] = g.surfaceScalarRange[0];
+		fd.surfaceScalarRange[1] = g.surfaceScalarRange[1];
+		fd.surfaceTinted = g.surfaceTinted;
+	}
+	if (!g.lineMesh.empty()) {
+		std::vector<MeshPart> parts = uploadMeshParts(g.lineVertices, g.lineMesh.vertices, false,
+			g.lineMesh.indices, g.lineMesh.indices.size(), 2);
+		if (!parts.empty()) {
+			fd.lineBuffer = parts[0].vertices;
+			fd.lineIndexBuffer = parts[0].indices;
+			fd.lineParts.assign(parts.begin() + 1, parts.end());
+		}
+		fd.lineVertexCount = static_cast<int>(g.lineVertices.empty() ? g.lineMesh.vertices.size() : g.lineVertices.size());
+		fd.lineIndexCount = parts.empty() ? 0 : static_cast<int>(parts[0].indexCount);
+	}
+	if (!g.cubes.empty()) {
+		fd.cubeInstanceBuffer = m_geometryPool.upload(g.cubes.data(), g.cubes.size() * sizeof(GlyphInstance));
+		fd.cubeInstanceCount = static_cast<int>(g.cubes.size());
+	}
+	fd.surfaceBounds = g.surfaceBounds;
+	fd.lineBounds = g.lineBounds;
+	fd.cubeBounds = g.cubeBounds;
+}
+
+std::vector<MeshPart> Application::uploadMeshParts(const std::vector<PackedVertex>& packed,
+	const std::vector<VertexAttributes>& raw, bool heightScalar,
+	const std::vector<uint32_t>& indices, size_t splitCount, int primitiveSize) {
+	const size_t vertexCount = packed.empty() ? raw.size() : packed.size();
+	const uint64_t maxBytes = m_geometryPool.maxSliceSize();
+
+	// Vertices [first, first + count) into one slice, copied or packed a staging chunk at a time
+	auto uploadVertices = [&](size_t first, size_t count) {
+		if (!packed.empty() && count * sizeof(PackedVertex) <= STREAMED_UPLOAD_SIZE) {
+			return m_geometryPool.upload(packed.data() + first, count * sizeof(PackedVertex));
+		}
+		return m_geometryPool.upload(count, sizeof(PackedVertex), [&, first](void* dst, uint64_t at, uint64_t n) {
+			PackedVertex* out = static_cast<PackedVertex*>(dst);
+			if (!packed.empty()) std::memcpy(out, packed.data() + first + at, n * sizeof(PackedVertex));
+			else GraphObjects::packVertices(raw.data() + first + at, n, out, heightScalar);
+		});
+	};
+
+	std::vector<MeshPart> parts;
+	if (vertexCount * sizeof(PackedVertex) <= maxBytes && indices.size() * sizeof(uint32_t) <= maxBytes) {
+		MeshPart part;
+		part.vertices = uploadVertices(0, vertexCount);
+		part.indices = m_geometryPool.upload(indices.data(), indices.size() * sizeof(uint32_t));
+		part.indexCount = static_cast<uint32_t>(splitCount);
+		if (part.vertices && part.indices) parts.push_back(part);
+		else {
+			m_geometryPool.release(part.vertices);
+			m_geometryPool.release(part.indices);
+		}
+		return parts;
+	}
+
+	// Too big for one buffer: runs of whole primitives whose vertex span and indices each fit a slice.
+	// Generators emit neighbouring primitives from neighbouring vertices, so the spans stay short.
+	size_t dropped = 0;
+	auto emit = [&](size_t firstIndex, size_t count, uint32_t lo, uint32_t hi) {
+		MeshPart part;
+		part.vertices = uploadVertices(lo, (size_t)hi - lo + 1);
+		part.indices = m_geometryPool.upload(count, sizeof(uint32_t), [&, firstIndex, lo](void* dst, uint64_t at, uint64_t n) {
+			uint32_t* out = static_cast<uint32_t*>(dst);
+			for (uint64_t k = 0; k < n; ++k) out[k] = indices[firstIndex + at + k] - lo;
+		});
+		part.indexCount = static_cast<uint32_t>(count);
+		if (part.vertices && part.indices) parts.push_back(part);
+		else {
+			m_geometryPool.release(part.vertices);
+			m_geometryPool.release(part.indices);
+			dropped += count / primitiveSize;
+		}
+	};
+	const uint64_t maxSpan = maxBytes / sizeof(PackedVertex);
+	const uint64_t maxIndices = maxBytes / sizeof(uint32_t);
+	size_t start = 0;
+	uint32_t lo = UINT32_MAX, hi = 0;
+	for (size_t i = 0; i + primitiveSize <= splitCount; i += primitiveSize) {
+		uint32_t pLo = UINT32_MAX, pHi = 0;
+		for (int k = 0; k < primitiveSize; ++k) {
+			pLo = std::min(pLo, indices[i + k]);
+			pHi = std::max(pHi, indices[i + k]);
+		}
+		if ((uint64_t)pHi - pLo + 1 > maxSpan) {
+			// Close the run before it, so the primitive is left out of every part
+			if (lo <= hi) emit(start, i - start, lo, hi);
+			++dropped;
+			start = i + primitiveSize;
+			lo = UINT32_MAX;
+			hi = 0;
+			continue;
+		}
+		const uint32_t nextLo = std::min(lo, pLo), nextHi = std::max(hi, pHi);
+		if (lo <= hi && ((uint64_t)nextHi - nextLo + 1 > maxSpan || i + primitiveSize - start > maxIndices)) {
+			emit(start, i - start, lo, hi);
+			start = i;
+			lo = pLo;
+			hi = pHi;
+		} else {
+			lo = nextLo;
+			hi = nextHi;
+		}
+	}
+	if (lo <= hi) emit(start, splitCount / primitiveSize * primitiveSize - start, lo, hi);
+	if (dropped > 0) {
+		std::cerr << "Warning: " << dropped << " primitives of a split mesh could not be uploaded" << std::endl;
+	}
+	return parts;
+}
+
+void Application::finishFunctionGeometry(FunctionGeometry& g) {
+	PROFILE_FUNCTION();
+	IndexedMesh& mesh = g.surfaceMesh;
+	auto streamed = [](const IndexedMesh& m) { return m.vertices.size() * sizeof(PackedVertex) > STREAMED_UPLOAD_SIZE; };
+	const bool streamSurface = streamed(mesh), streamLines = streamed(g.lineMesh);
+	if (!streamSurface) g.surfaceVertices = GraphObjects::packVertices(mesh.vertices, g.surfaceColormapped);
+	if (g.surfaceColormapped) {
+		float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+		for (const auto& v : mesh.vertices) {
+			if (!std::isfinite(v.position.z)) continue;
+			lo = std::min(lo, v.position.z);
+			hi = std::max(hi, v.position.z);
+		}
+		if (lo <= hi) {
+			g.surfaceScalarRange[0] = lo;
+			g.surfaceScalarRange[1] = hi;
+		}
+	}
+	if (!streamLines) g.lineVertices = GraphObjects::packVertices(g.lineMesh.vertices);
+	g.surfaceBounds = mesh.bounds();
+	g.lineBounds = g.lineMesh.bounds();
+	static const vec2 cubeExtent = GraphObjects::glyphMeshExtent(GraphObjects::unitCubeMesh());
+	g.cubeBounds = GraphObjects::glyphBounds(g.cubes, cubeExtent);
+
+	if (mesh.indices.size() >= 3) {
+		double edgeSum = 0.0;
+		for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+			const vec3& a = mesh.vertices[mesh.indices[t]].position;
+			const vec3& b = mesh.vertices[mesh.indices[t + 1]].position;
+			const vec3& c = mesh.vertices[mesh.indices[t + 2]].position;
+			edgeSum += std::max({ glm::length(b - a), glm::length(c - b), glm::length(a - c) });
+		}
+		g.surfaceEdgeLength = static_cast<float>(edgeSum / (mesh.indices.size() / 3));
+	}
+
+	// Every level goes into one index list, full detail first, so it uploads as it is
+	g.surfaceLodLevels = mesh.empty() ? 0 : 1;
+	g.surfaceLodFirst[0] = 0;
+	g.surfaceLodCount[0] = static_cast<uint32_t>(mesh.indices.size());
+	size_t total = mesh.indices.size();
+	for (const auto& lod : mesh.lods) total += lod.size();
+	mesh.indices.reserve(total);
+	for (const auto& lod : mesh.lods) {
+		if (g.surfaceLodLevels == GraphObjects::LOD_LEVELS) break;
+		g.surfaceLodFirst[g.surfaceLodLevels] = static_cast<uint32_t>(mesh.indices.size());
+		g.surfaceLodCount[g.surfaceLodLevels] = static_cast<uint32_t>(lod.size());
+		mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		++g.surfaceLodLevels;
+	}
+
+	// Only the packed copies are uploaded; drop the full-precision vertices now rather than with the task
+	mesh.lods = {};
+	if (!streamSurface) mesh.vertices = {};
+	if (!streamLines) g.lineMesh.vertices = {};
+
+	// Heightfields: the same figures for the grid vs_heightfield draws, whose LOD levels are vertex ranges
+	if (!g.heightfield.empty()) {
+		const int uCount = g.heightfieldSize[0], vCount = g.heightfieldSize[1];
+		const float* range = g.heightfieldRange;
+		auto point = [&](int i, int j) {
+			return vec3(range[0] + (range[1] - range[0]) * i / (uCount - 1), range[2] + (range[3] - range[2]) * j / (vCount - 1),
+				g.heightfield[(size_t)j * uCount + i]);
+		};
+		float lo = std::numeric_limits<float>::max(), hi = std::numeric_limits<float>::lowest();
+		for (float h : g.heightfield) {
+			if (!std::isfinite(h)) continue;
+			lo = std::min(lo, h);
+			hi = std::max(hi, h);
+		}
+		if (lo <= hi) {
+			g.surfaceScalarRange[0] = lo;
+			g.surfaceScalarRange[1] = hi;
+			g.surfaceBounds.add(vec3(range[0], range[2], lo));
+			g.surfaceBounds.add(vec3(range[1], range[3], hi));
+		}
 
-			// Frenet frame overlay
-			if (fd.showFrenetFrame) {
-				auto frenetVerts = GraphObjects::generateFrenetFrame(
-					curveFunc, fd.rangeMin[0], fd.rangeMax[0],
-					fd.frenetT, fd.overlayVectorScale);
-				surfaceVerts.insert(surfaceVerts.end(), frenetVerts.begin(), frenetVerts.end());
+		// Cells with a non-finite corner are not drawn, so they are left out of the mean
+		double edgeSum = 0.0;
+		size_t triangles = 0;
+		for (int j = 0; j + 1 < vCount; ++j) {
+			for (int i = 0; i + 1 < uCount; ++i) {
+				const vec3 p00 = point(i, j), p10 = point(i + 1, j), p01 = point(i, j + 1), p11 = point(i + 1, j + 1);
+				if (!std::isfinite(p00.z) || !std::isfinite(p10.z) || !std::isfinite(p01.z) || !std::isfinite(p11.z)) continue;
+				const float diagonal = glm::length(p11 - p00);
+				edgeSum += std::max({ glm::length(p10 - p00), glm::length(p11 - p10), diagonal });
+				edgeSum += std::max({ glm::length(p01 - p11), glm::length(p00 - p01), diagonal });
+				triangles += 2;
 			}
+		}
+		if (triangles > 0) g.surfaceEdgeLength = static_cast<float>(edgeSum / triangles);
+
+		const int uSegments = uCount - 1, vSegments = vCount - 1;
+		g.surfaceLodLevels = Heightfield::levelCount(uSegments, vSegments);
+		uint32_t first = 0;
+		for (int l = 0; l < g.surfaceLodLevels; ++l) {
+			g.surfaceLodFirst[l] = first;
+			g.surfaceLodCount[l] = Heightfield::levelVertexCount(uSegments, vSegments, l);
+			first += g.surfaceLodCount[l];
+		}
+	}
+}
+
+void Application::releaseFunctionGeometry(FunctionDefinition& fd, uint32_t stages) {
+	fd.bundleGeneration = ++m_bundleGeneration;
+	if (stages & ARROW_STAGES) {
+		m_geometryPool.release(fd.arrowInstanceBuffer);
+		fd.arrowInstanceCount = 0;
+	}
+	for (int s = 0; s < STAGE_COUNT; ++s) {
+		if (!(stages & (1u << s))) continue;
+		fd.stageKeys[s] = 0;
+		fd.stageArrows[s].clear();
+	}
+	if (!(stages & (1u << STAGE_BASE))) return;
+
+	for (GpuBufferPool::Slice* slice : { &fd.surfaceBuffer, &fd.surfaceIndexBuffer, &fd.lineBuffer, &fd.lineIndexBuffer,
+		&fd.cubeInstanceBuffer }) {
+		m_geometryPool.release(*slice);
+	}
+	for (std::vector<MeshPart>* parts : { &fd.surfaceParts, &fd.lineParts }) {
+		for (MeshPart& part : *parts) {
+			m_geometryPool.release(part.vertices);
+			m_geometryPool.release(part.indices);
+		}
+		parts->clear();
+	}
+	fd.surfaceVertexCount = 0;
+	fd.surfaceIndexCount = 0;
+	fd.surfaceLodLevels = 0;
+	fd.surfaceLodCount[0] = 0;
+	fd.surfaceLod = 0;
+	fd.surfaceColormapped = false;
+	fd.surfaceTinted = false;
+	fd.lineVertexCount = 0;
+	fd.lineIndexCount = 0;
+	fd.cubeInstanceCount = 0;
+}
+
+// ─── Culling ────────────────────────────────────────────────────────────────
+
+void Application::updateFrustum() {
+	// Gribb-Hartmann: each plane is the last row of the clip matrix plus or minus another row.
+	// The near plane uses -w <= z, which holds under both depth conventions.
+	glm::mat4 clip = glm::transpose(m_uniforms.projectionMatrix * m_uniforms.viewMatrix * m_uniforms.modelMatrix);
+	m_frustumPlanes = {
+		clip[3] + clip[0], clip[3] - clip[0],
+		clip[3] + clip[1], clip[3] - clip[1],
+		clip[3] + clip[2], clip[3] - clip[2],
+	};
+}
+
+bool Application::isVisible(const Aabb& box) const {
+	if (!m_cullingEnabled || box.empty()) return true;
+	for (const glm::vec4& plane : m_frustumPlanes) {
+		// The corner furthest along the plane normal
+		vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+			plane.y >= 0.0f ? box.max.y : box.min.y,
+			plane.z >= 0.0f ? box.max.z : box.min.z);
+		if (glm::dot(vec3(plane), corner) + plane.w < 0.0f) return false;
+	}
+	return true;
+}
 
-		} else if (n == 2) {
-			// Surface: build lambda (u,v) -> vec3
-			auto surfFunc = [&fd, m](float u, float v) -> glm::vec3 {
-				double vals[2] = { (double)u, (double)v };
+void Application::writeDrawCommands() {
+	const size_t count = m_functions.size();
+	if (count > m_drawArgsCapacity || !m_drawArgsBuffer) {
+		// In flight frames may still read the old arguments
+		if (m_drawArgsBuffer) m_geometryPool.retire(m_drawArgsBuffer);
+		m_drawArgsCapacity = std::max<size_t>({ count, m_drawArgsCapacity * 2, 8 });
+		WGPUBufferDescriptor bufferDesc = {};
+		bufferDesc.label = "Draw arguments";
+		bufferDesc.size = m_drawArgsCapacity * DRAW_SLOTS_PER_FUNCTION * DRAW_SLOT_SIZE;
+		bufferDesc.usage = WGPUBufferUsage_Indirect | WGPUBufferUsage_CopyDst;
+		bufferDesc.mappedAtCreation = false;
+		m_drawArgsBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+
+		// The function uniforms grow alongside, and are all written again below
+		if (m_functionUniformBuffer) m_geometryPool.retire(m_functionUniformBuffer);
+		if (m_functionBindGroup) wgpuBindGroupRelease(m_functionBindGroup);
+		bufferDesc.label = "Function uniforms";
+		bufferDesc.size = m_drawArgsCapacity * FUNCTION_UNIFORM_STRIDE;
+		bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+		m_functionUniformBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+		m_functionUniforms.clear();
+
+		WGPUBindGroupEntry binding = {};
+		binding.binding = 0;
+		binding.buffer = m_functionUniformBuffer;
+		binding.offset = 0;
+		binding.size = sizeof(FunctionUniforms);
+		WGPUBindGroupDescriptor bindGroupDesc = {};
+		bindGroupDesc.layout = m_functionBindGroupLayout;
+		bindGroupDesc.entryCount = 1;
+		bindGroupDesc.entries = &binding;
+		m_functionBindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+		m_sceneGeneration = ++m_bundleGeneration;
+	}
+	writeFunctionUniforms();
+
+	m_drawArgs.assign(count * DRAW_SLOTS_PER_FUNCTION * 5, 0);
+	m_culledDraws = 0;
+	auto visible = [this](const Aabb& box) {
+		if (isVisible(box)) return true;
+		++m_culledDraws;
+		return false;
+	};
+	for (size_t f = 0; f < count; ++f) {
+		const FunctionDefinition& fd = m_functions[f];
+		if (!fd.show) continue;
+		uint32_t* surface = &m_drawArgs[(f * DRAW_SLOTS_PER_FUNCTION + 0) * 5];
+		uint32_t* lines = &m_drawArgs[(f * DRAW_SLOTS_PER_FUNCTION + 1) * 5];
+		uint32_t* arrows = &m_drawArgs[(f * DRAW_SLOTS_PER_FUNCTION + 2) * 5];
+		uint32_t* cubes = &m_drawArgs[(f * DRAW_SLOTS_PER_FUNCTION + 3) * 5];
+
+		// Indexed: indexCount, instanceCount, firstIndex, baseVertex, firstInstance.
+		// Heightfields draw non-indexed, whose vertexCount and firstVertex take the same words.
+		const bool surfaceMesh = fd.surfaceIndexCount > 0 && fd.surfaceBuffer && fd.surfaceIndexBuffer;
+		const bool heightfield = fd.heightfield && fd.surfaceLodLevels > 0;
+		if ((surfaceMesh || heightfield) && visible(fd.surfaceBounds)) {
+			surface[0] = fd.surfaceLodCount[fd.surfaceLod];
+			surface[1] = 1;
+			surface[2] = fd.surfaceLodFirst[fd.surfaceLod];
+		}
+		if (fd.lineIndexCount > 0 && fd.lineBuffer && fd.lineIndexBuffer && visible(fd.lineBounds)) {
+			lines[0] = static_cast<uint32_t>(fd.lineIndexCount);
+			lines[1] = 1;
+		}
+		// Non-indexed: vertexCount, instanceCount, firstVertex, firstInstance
+		if (fd.arrowInstanceCount > 0 && fd.arrowInstanceBuffer && visible(fd.arrowBounds)) {
+			arrows[0] = static_cast<uint32_t>(m_arrowVertexCount);
+			arrows[1] = static_cast<uint32_t>(fd.arrowInstanceCount);
+		}
+		if (fd.cubeInstanceCount > 0 && fd.cubeInstanceBuffer && visible(fd.cubeBounds)) {
+			cubes[0] = static_cast<uint32_t>(m_cubeVertexCount);
+			cubes[1] = static_cast<uint32_t>(fd.cubeInstanceCount);
+		}
+	}
+	if (count > 0) {
+		wgpuQueueWriteBuffer(m_queue, m_drawArgsBuffer, 0, m_drawArgs.data(), m_drawArgs.size() * sizeof(uint32_t));
+	}
+}
+
+void Application::writeFunctionUniforms() {
+	// Compute-evaluated surfaces carry their heights like the CPU ones, with the range read back from the GPU.
+	// Set every frame, as an upload of the rest of the base stage clears these.
+	for (FunctionDefinition& fd : m_functions) {
+		if (!fd.gpuSurface || fd.gpuSurface->indexCount() == 0) continue;
+		fd.gpuSurface->readHeightRange(m_device, m_queue);
+		fd.surfaceColormapped = true;
+		fd.gpuSurface->heightRange(fd.surfaceScalarRange);
+	}
+
+	const size_t count = m_functions.size();
+	const size_t written = std::min(m_functionUniforms.size(), count);
+	m_functionUniforms.resize(count);
+	for (size_t f = 0; f < count; ++f) {
+		const FunctionDefinition& fd = m_functions[f];
+		FunctionUniforms u;
+		if (fd.surfaceColormapped) {
+			const float* range = fd.colormapAutoRange ? fd.surfaceScalarRange : fd.colormapRange;
+			u.scalarMin = range[0];
+			u.scalarMax = range[1];
+			u.colormapRow = (glm::clamp(fd.colormap, 0, GraphObjects::COLORMAP_COUNT - 1) + 0.5f) / GraphObjects::COLORMAP_COUNT;
+			u.colormapped = 1;
+		}
+		if (fd.surfaceTinted) u.tint = vec4(fd.color[0], fd.color[1], fd.color[2], 1.0f);
+		u.tint.w = glm::clamp(fd.opacity, 0.0f, 1.0f);
+		// A recolour or a new range is one small write; unchanged functions cost nothing
+		FunctionUniforms& last = m_functionUniforms[f];
+		if (f < written && std::memcmp(&u, &last, sizeof(u)) == 0) continue;
+		last = u;
+		wgpuQueueWriteBuffer(m_queue, m_functionUniformBuffer, f * FUNCTION_UNIFORM_STRIDE, &u, sizeof(u));
+	}
+}
+
+// ─── Render Bundles ─────────────────────────────────────────────────────────
+
+namespace {
+enum DrawOp : uint64_t {
+	DRAW_OP_PIPELINE,               // pipeline
+	DRAW_OP_BIND_GROUP,             // index, group, has offset, dynamic offset
+	DRAW_OP_VERTEX_BUFFER,          // slot, buffer, offset, size
+	DRAW_OP_INDEX_BUFFER,           // buffer, offset, size (Uint32 indices)
+	DRAW_OP_DRAW,                   // vertex count, instance count
+	DRAW_OP_DRAW_INDEXED,           // index count
+	DRAW_OP_DRAW_INDIRECT,          // buffer, offset
+	DRAW_OP_DRAW_INDEXED_INDIRECT,  // buffer, offset
+};
+constexpr size_t DRAW_OP_ARGS[] = { 1, 4, 4, 3, 2, 1, 2, 2 };
+// Lists start with the pass they run in: two colour formats (the second may be Undefined),
+// the depth format and whether depth is read-only. Then come the generations of the objects the
+// list binds, shared and per function, since a replaced object may come back at the same address.
+constexpr size_t DRAW_LIST_HEADER = 6;
+
+// Appends commands to a DrawBundle's list
+struct DrawList {
+	std::vector<uint64_t>& words;
+
+	static uint64_t handle(const void* object) { return (uint64_t)(uintptr_t)object; }
+
+	void pipeline(WGPURenderPipeline pipeline) {
+		words.insert(words.end(), { DRAW_OP_PIPELINE, handle(pipeline) });
+	}
+	void bindGroup(uint32_t index, WGPUBindGroup group) {
+		words.insert(words.end(), { DRAW_OP_BIND_GROUP, index, handle(group), 0, 0 });
+	}
+	void bindGroup(uint32_t index, WGPUBindGroup group, uint32_t offset) {
+		words.insert(words.end(), { DRAW_OP_BIND_GROUP, index, handle(group), 1, offset });
+	}
+	void vertexBuffer(uint32_t slot, WGPUBuffer buffer, uint64_t offset, uint64_t size) {
+		words.insert(words.end(), { DRAW_OP_VERTEX_BUFFER, slot, handle(buffer), offset, size });
+	}
+	void vertexBuffer(uint32_t slot, const GpuBufferPool::Slice& slice) {
+		vertexBuffer(slot, slice.buffer, slice.offset, slice.size);
+	}
+	void indexBuffer(WGPUBuffer buffer, uint64_t offset, uint64_t size) {
+		words.insert(words.end(), { DRAW_OP_INDEX_BUFFER, handle(buffer), offset, size });
+	}
+	void indexBuffer(const GpuBufferPool::Slice& slice) {
+		indexBuffer(slice.buffer, slice.offset, slice.size);
+	}
+	void draw(uint32_t vertexCount, uint32_t instanceCount) {
+		words.insert(words.end(), { DRAW_OP_DRAW, vertexCount, instanceCount });
+	}
+	void drawIndexed(uint32_t indexCount) {
+		words.insert(words.end(), { DRAW_OP_DRAW_INDEXED, indexCount });
+	}
+	void drawIndirect(WGPUBuffer buffer, uint64_t offset) {
+		words.insert(words.end(), { DRAW_OP_DRAW_INDIRECT, handle(buffer), offset });
+	}
+	void drawIndexedIndirect(WGPUBuffer buffer, uint64_t offset) {
+		words.insert(words.end(), { DRAW_OP_DRAW_INDEXED_INDIRECT, handle(buffer), offset });
+	}
+	void parts(const std::vector<MeshPart>& parts) {
+		for (const MeshPart& part : parts) {
+			vertexBuffer(0, part.vertices);
+			indexBuffer(part.indices);
+			drawIndexed(part.indexCount);
+		}
+	}
+};
+
+// Record words[first..] into encoder
+void replayDrawList(WGPURenderBundleEncoder encoder, const std::vector<uint64_t>& words, size_t first) {
+	auto buffer = [](uint64_t word) { return (WGPUBuffer)(uintptr_t)word; };
+	for (size_t i = first; i < words.size(); i += 1 + DRAW_OP_ARGS[words[i]]) {
+		const uint64_t* a = &words[i + 1];
+		switch ((DrawOp)words[i]) {
+		case DRAW_OP_PIPELINE:
+			wgpuRenderBundleEncoderSetPipeline(encoder, (WGPURenderPipeline)(uintptr_t)a[0]);
+			break;
+		case DRAW_OP_BIND_GROUP: {
+			const uint32_t offset = (uint32_t)a[3];
+			wgpuRenderBundleEncoderSetBindGroup(encoder, (uint32_t)a[0], (WGPUBindGroup)(uintptr_t)a[1], a[2] ? 1 : 0, a[2] ? &offset : nullptr);
+			break;
+		}
+		case DRAW_OP_VERTEX_BUFFER:
+			wgpuRenderBundleEncoderSetVertexBuffer(encoder, (uint32_t)a[0], buffer(a[1]), a[2], a[3]);
+			break;
+		case DRAW_OP_INDEX_BUFFER:
+			wgpuRenderBundleEncoderSetIndexBuffer(encoder, buffer(a[0]), WGPUIndexFormat_Uint32, a[1], a[2]);
+			break;
+		case DRAW_OP_DRAW:
+			wgpuRenderBundleEncoderDraw(encoder, (uint32_t)a[0], (uint32_t)a[1], 0, 0);
+			break;
+		case DRAW_OP_DRAW_INDEXED:
+			wgpuRenderBundleEncoderDrawIndexed(encoder, (uint32_t)a[0], 1, 0, 0, 0);
+			break;
+		case DRAW_OP_DRAW_INDIRECT:
+			wgpuRenderBundleEncoderDrawIndirect(encoder, buffer(a[0]), a[1]);
+			break;
+		case DRAW_OP_DRAW_INDEXED_INDIRECT:
+			wgpuRenderBundleEncoderDrawIndexedIndirect(encoder, buffer(a[0]), a[1]);
+			break;
+		}
+	}
+}
+}
+
+// Runs after writeDrawCommands, whose arguments the indirect draws read and which may have
+// replaced the argument buffer and the function bind group
+void Application::updateDrawBundles() {
+	m_bundlesRecorded = 0;
+	m_sceneBundles.clear();
+
+	m_transparentSceneBundles.clear();
+
+	// The attachments lead each list, since a bundle only runs in passes that match them
+	std::vector<uint64_t> commands, transparentCommands;
+	auto begin = [this, &commands](uint64_t generation) {
+		commands.assign({ (uint64_t)m_swapChainFormat, (uint64_t)WGPUTextureFormat_Undefined, (uint64_t)m_depthTextureFormat, 0,
+			m_sceneGeneration, generation });
+		return DrawList{ commands };
+	};
+	auto beginTransparent = [this, &transparentCommands](uint64_t generation) {
+		transparentCommands.assign({ (uint64_t)OIT_ACCUM_FORMAT, (uint64_t)OIT_REVEALAGE_FORMAT, (uint64_t)m_depthTextureFormat, 1,
+			m_sceneGeneration, generation });
+		return DrawList{ transparentCommands };
+	};
+	auto update = [this](DrawBundle& bundle, std::vector<uint64_t>& list, std::vector<WGPURenderBundle>& pass, const char* label) {
+		if (list.size() <= DRAW_LIST_HEADER) {
+			if (bundle.bundle) wgpuRenderBundleRelease(bundle.bundle);
+			bundle = DrawBundle();
+			return;
+		}
+		if (!bundle.bundle || list != bundle.commands) {
+			bundle.commands.swap(list);
+			recordDrawBundle(bundle, label);
+		}
+		if (bundle.bundle) pass.push_back(bundle.bundle);
+	};
+
+	DrawList scene = begin(0);
+	if (m_showBoat) {
+		scene.pipeline(m_scenePipelines.boat);
+		scene.vertexBuffer(0, m_vertexBuffer, 0, m_vertexCount * sizeof(VertexAttributes));
+		scene.bindGroup(0, m_bindGroup);
+		scene.draw(m_vertexCount, 1);
+	}
+	if (m_showAxes && m_axesVertexCount > 0 && m_axesVertexBuffer) {
+		scene.pipeline(m_scenePipelines.axes);
+		scene.vertexBuffer(0, m_axesVertexBuffer, 0, m_axesVertexCount * sizeof(VertexAttributes));
+		scene.bindGroup(0, m_bindGroup);
+		scene.draw(m_axesVertexCount, 1);
+	}
+	update(m_axesBundle, commands, m_sceneBundles, "Axes bundle");
+
+	const size_t count = m_functions.size();
+	for (std::vector<DrawBundle>* bundles : { &m_functionBundles, &m_transparentBundles }) {
+		for (size_t f = count; f < bundles->size(); ++f) {
+			if ((*bundles)[f].bundle) wgpuRenderBundleRelease((*bundles)[f].bundle);
+		}
+		bundles->resize(count);
+	}
+
+	// Per-function draws read their arguments from m_drawArgsBuffer, so a culled slot draws nothing
+	// without a new bundle. Pieces of meshes split across buffers follow their first slice, so only
+	// they make culling part of the list.
+	auto slotOffset = [](size_t f, int slot) { return (f * DRAW_SLOTS_PER_FUNCTION + slot) * DRAW_SLOT_SIZE; };
+	auto slotDrawn = [this](size_t f, int slot) { return m_drawArgs[(f * DRAW_SLOTS_PER_FUNCTION + slot) * 5 + 1] != 0; };
+	for (size_t f = 0; f < count; ++f) {
+		const FunctionDefinition& fd = m_functions[f];
+		DrawList list = begin(fd.bundleGeneration);
+		DrawList transparent = beginTransparent(fd.bundleGeneration);
+		if (!fd.show) {
+			update(m_functionBundles[f], commands, m_sceneBundles, "Function bundle");
+			update(m_transparentBundles[f], transparentCommands, m_transparentSceneBundles, "Transparent function bundle");
+			continue;
+		}
+		const uint32_t uniformOffset = static_cast<uint32_t>(f * FUNCTION_UNIFORM_STRIDE);
+		const bool surface = fd.surfaceIndexCount > 0 && fd.surfaceBuffer && fd.surfaceIndexBuffer;
+		const bool gpuSurface = fd.gpuSurface && fd.gpuSurface->indexCount() > 0;
+		const bool heightfield = fd.heightfield && fd.surfaceLodLevels > 0;
+		const bool arrows = fd.arrowInstanceCount > 0 && fd.arrowInstanceBuffer;
+		const bool cubes = fd.cubeInstanceCount > 0 && fd.cubeInstanceBuffer;
+		const bool lines = fd.lineIndexCount > 0 && fd.lineBuffer && fd.lineIndexBuffer;
+		const FlowCompute* flow = fd.gpuFlow.get();
+		const bool flowLines = flow && flow->streamlineIndexCount() > 0;
+		const bool particles = flow && flow->particleVertexCount() > 0;
+
+		// Surfaces and tubes (TriangleList, "surface" pipeline), or "surfaceOit" when translucent
+		const bool translucent = fd.opacity < 1.0f;
+		DrawList& surfaces = translucent ? transparent : list;
+		if (surface || gpuSurface) {
+			surfaces.pipeline(translucent ? m_scenePipelines.surfaceOit : m_scenePipelines.surface);
+			surfaces.bindGroup(0, m_colormapBindGroup);
+			surfaces.bindGroup(1, m_functionBindGroup, uniformOffset);
+		}
+		if (surface) {
+			surfaces.vertexBuffer(0, fd.surfaceBuffer);
+			surfaces.indexBuffer(fd.surfaceIndexBuffer);
+			surfaces.drawIndexedIndirect(m_drawArgsBuffer, slotOffset(f, 0));
+			if (slotDrawn(f, 0)) surfaces.parts(fd.surfaceParts);
+		}
+		if (gpuSurface) {
+			const SurfaceCompute& gpu = *fd.gpuSurface;
+			surfaces.vertexBuffer(0, gpu.vertexBuffer(), 0, gpu.vertexCount() * sizeof(PackedVertex));
+			surfaces.indexBuffer(gpu.indexBuffer(), 0, gpu.indexCount() * sizeof(uint32_t));
+			surfaces.drawIndexed(gpu.indexCount());
+		}
+		if (heightfield) {
+			surfaces.pipeline(translucent ? m_scenePipelines.heightfieldOit : m_scenePipelines.heightfield);
+			surfaces.bindGroup(0, m_colormapBindGroup);
+			surfaces.bindGroup(1, m_functionBindGroup, uniformOffset);
+			surfaces.bindGroup(2, fd.heightfield->bindGroup());
+			surfaces.drawIndirect(m_drawArgsBuffer, slotOffset(f, 0));
+		}
+
+		// Arrows and scalar field cubes: one instanced draw of the shared unit mesh each
+		if (arrows || cubes) {
+			list.pipeline(m_scenePipelines.glyph);
+			list.bindGroup(0, m_bindGroup);
+		}
+		if (arrows) {
+			list.vertexBuffer(0, m_arrowVertexBuffer, 0, m_arrowVertexCount * sizeof(VertexAttributes));
+			list.vertexBuffer(1, fd.arrowInstanceBuffer);
+			list.drawIndirect(m_drawArgsBuffer, slotOffset(f, 2));
+		}
+		if (cubes) {
+			list.vertexBuffer(0, m_cubeVertexBuffer, 0, m_cubeVertexCount * sizeof(VertexAttributes));
+			list.vertexBuffer(1, fd.cubeInstanceBuffer);
+			list.drawIndirect(m_drawArgsBuffer, slotOffset(f, 3));
+		}
+
+		// Wireframe overlays, streamlines and particles (LineList, "lines" pipeline)
+		if (lines || flowLines || particles) {
+			list.pipeline(m_scenePipelines.lines);
+			list.bindGroup(0, m_bindGroup);
+			list.bindGroup(1, m_functionBindGroup, uniformOffset);
+		}
+		if (lines) {
+			list.vertexBuffer(0, fd.lineBuffer);
+			list.indexBuffer(fd.lineIndexBuffer);
+			list.drawIndexedIndirect(m_drawArgsBuffer, slotOffset(f, 1));
+			if (slotDrawn(f, 1)) list.parts(fd.lineParts);
+		}
+		if (flowLines) {
+			list.vertexBuffer(0, flow->streamlineVertexBuffer(), 0, flow->streamlineVertexCount() * sizeof(PackedVertex));
+			list.indexBuffer(flow->streamlineIndexBuffer(), 0, flow->streamlineIndexCount() * sizeof(uint32_t));
+			list.drawIndexed(flow->streamlineIndexCount());
+		}
+		if (particles) {
+			list.vertexBuffer(0, flow->particleVertexBuffer(), 0, flow->particleVertexCount() * sizeof(PackedVertex));
+			list.draw(flow->particleVertexCount(), 1);
+		}
+		update(m_functionBundles[f], commands, m_sceneBundles, "Function bundle");
+		update(m_transparentBundles[f], transparentCommands, m_transparentSceneBundles, "Transparent function bundle");
+	}
+}
+
+void Application::recordDrawBundle(DrawBundle& bundle, const char* label) {
+	if (bundle.bundle) wgpuRenderBundleRelease(bundle.bundle);
+
+	const std::vector<uint64_t>& header = bundle.commands;
+	const WGPUTextureFormat colorFormats[2] = { (WGPUTextureFormat)header[0], (WGPUTextureFormat)header[1] };
+	WGPURenderBundleEncoderDescriptor encoderDesc = {};
+	encoderDesc.label = label;
+	encoderDesc.colorFormatsCount = colorFormats[1] == WGPUTextureFormat_Undefined ? 1 : 2;
+	encoderDesc.colorFormats = colorFormats;
+	encoderDesc.depthStencilFormat = (WGPUTextureFormat)header[2];
+	encoderDesc.sampleCount = 1;
+	encoderDesc.depthReadOnly = header[3] != 0;
+	encoderDesc.stencilReadOnly = true;  // as in every scene pass
+	WGPURenderBundleEncoder encoder = wgpuDeviceCreateRenderBundleEncoder(m_device, &encoderDesc);
+	replayDrawList(encoder, bundle.commands, DRAW_LIST_HEADER);
+
+	WGPURenderBundleDescriptor bundleDesc = {};
+	bundleDesc.label = label;
+	bundle.bundle = wgpuRenderBundleEncoderFinish(encoder, &bundleDesc);
+	wgpuRenderBundleEncoderRelease(encoder);
+	++m_bundlesRecorded;
+}
+
+void Application::terminateDrawBundles() {
+	if (m_axesBundle.bundle) wgpuRenderBundleRelease(m_axesBundle.bundle);
+	m_axesBundle = DrawBundle();
+	for (std::vector<DrawBundle>* bundles : { &m_functionBundles, &m_transparentBundles }) {
+		for (DrawBundle& bundle : *bundles) {
+			if (bundle.bundle) wgpuRenderBundleRelease(bundle.bundle);
+		}
+		bundles->clear();
+	}
+	m_sceneBundles.clear();
+	m_transparentSceneBundles.clear();
+}
+
+// ─── Level of Detail ────────────────────────────────────────────────────────
+
+void Application::updateSurfaceLods() {
+	int width, height;
+	framebufferSize(width, height);
+	// Pixels per world unit at distance 1
+	const float pixelsPerUnit = height / (2.0f * std::tan(0.5f * m_fovy));
+	const vec3 eye = m_uniforms.cameraWorldPosition;
+
+	for (auto& fd : m_functions) {
+		if (!m_lodEnabled || fd.surfaceLodLevels <= 1) {
+			fd.surfaceLod = 0;
+			continue;
+		}
+		// Nearest point of the bounding sphere; inside it everything stays at full detail
+		float distance = glm::length(vec3(m_uniforms.modelMatrix * glm::vec4(fd.surfaceBounds.center(), 1.0f)) - eye) - fd.surfaceBounds.radius();
+		if (distance <= 0.0f) {
+			fd.surfaceLod = 0;
+			continue;
+		}
+		const float edgePixels = fd.surfaceEdgeLength * pixelsPerUnit / distance;
+
+		// Each level doubles the edge length. Stepping back to a finer level waits for a 25%
+		// margin, so a slow zoom across a threshold does not flicker between two levels.
+		int level = fd.surfaceLod;
+		while (level + 1 < fd.surfaceLodLevels && edgePixels * float(2 << level) <= LOD_MAX_EDGE_PIXELS) ++level;
+		while (level > 0 && edgePixels * float(1 << level) > LOD_MAX_EDGE_PIXELS * 1.25f) --level;
+		fd.surfaceLod = level;
+	}
+}
+
+bool Application::updateGpuSurface(FunctionDefinition& fd) {
+	fd.bundleGeneration = ++m_bundleGeneration;
+	fd.gpuStatus.clear();
+	if (!fd.gpuEvaluate || fd.inputDim != 2 || fd.wireframe || (fd.outputDim == 1 && fd.renderImplicit)) {
+		fd.gpuSurface.reset();
+		return false;
+	}
+	if (fd.adaptive) {
+		fd.gpuSurface.reset();
+		fd.gpuStatus = "adaptive sampling runs on the CPU";
+		return false;
+	}
+
+	if (!fd.gpuSurface) fd.gpuSurface = std::make_unique<SurfaceCompute>();
+	bool ok = fd.gpuSurface->updateShader(m_device, fd.parsers, fd.outputDim, fd.gpuStatus)
+		&& fd.gpuSurface->dispatch(m_device, m_queue,
+			fd.rangeMin[0], fd.rangeMax[0], fd.rangeMin[1], fd.rangeMax[1],
+			fd.resolution[0], fd.resolution[1], fd.gpuStatus);
+	if (!ok) {
+		std::cerr << "GPU surface evaluation unavailable for " << fd.name << ": " << fd.gpuStatus << std::endl;
+		fd.gpuSurface.reset();
+	}
+	return ok;
+}
+
+bool Application::updateGpuFlow(FunctionDefinition& fd) {
+	fd.bundleGeneration = ++m_bundleGeneration;
+	fd.gpuFlowStatus.clear();
+	const bool vectorField = fd.inputDim == 3 && fd.outputDim >= 2;
+	const bool streamlines = vectorField && fd.showStreamlines && fd.gpuStreamlines;
+	const bool particles = vectorField && fd.showParticles;
+	if (!streamlines && !particles) {
+		fd.gpuFlow.reset();
+		return false;
+	}
+
+	if (!fd.gpuFlow) fd.gpuFlow = std::make_unique<FlowCompute>();
+	bool ok = fd.gpuFlow->updateShader(m_device, fd.parsers, fd.outputDim, fd.gpuFlowStatus);
+	if (ok && streamlines) {
+		// The same step size and length as the CPU streamlines, from many more seeds
+		ok = fd.gpuFlow->dispatchStreamlines(m_device, m_queue, fd.rangeMin, fd.rangeMax,
+			fd.flowStreamlineCount, 200, fd.overlayVectorScale, fd.gpuFlowStatus);
+	} else {
+		fd.gpuFlow->terminateStreamlines();
+	}
+	if (ok && particles) {
+		ok = fd.gpuFlow->initParticles(m_device, m_queue, fd.rangeMin, fd.rangeMax, fd.particleCount, fd.gpuFlowStatus);
+	} else {
+		fd.gpuFlow->terminateParticles();
+	}
+	if (!ok) {
+		std::cerr << "GPU flow integration unavailable for " << fd.name << ": " << fd.gpuFlowStatus << std::endl;
+		fd.gpuFlow.reset();
+	}
+	return ok;
+}
+
+WGPUBuffer Application::createBuffer(const void* data, size_t size, WGPUBufferUsageFlags usage) {
+	WGPUBufferDescriptor bufferDesc = {};
+	bufferDesc.size = size;
+	bufferDesc.usage = WGPUBufferUsage_CopyDst | usage;
+	bufferDesc.mappedAtCreation = false;
+	WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+	wgpuQueueWriteBuffer(m_queue, buffer, 0, data, size);
+	return buffer;
+}
+
+// Evaluate every output component of fd over `count` samples of `stride` floats each.
+// Once the build is cancelled the outputs are zero, so the generators run out quickly.
+static void evaluateOutputs(const FunctionDefinition& fd, const float* inputs, size_t count, size_t stride,
+	const std::atomic<bool>* cancelled, std::vector<float>* out) {
+	const bool skip = cancelled && cancelled->load(std::memory_order_relaxed);
+	if (!skip && fd.fused.isCompiled()) {
+		float* planes[3] = {};
+		for (int i = 0; i < fd.outputDim; ++i) {
+			out[i].resize(count);
+			planes[i] = out[i].data();
+		}
+		fd.fused.evaluateBatch(inputs, count, planes, stride);
+		return;
+	}
+	for (int i = 0; i < fd.outputDim; ++i) {
+		if (skip) {
+			out[i].assign(count, 0.0f);
+			continue;
+		}
+		out[i].resize(count);
+		fd.parsers[i].evaluateBatch(inputs, count, out[i].data(), stride);
+	}
+}
+
+// Outputs of the samplers below, kept per thread so a build does not allocate them per tile
+static std::vector<float>* samplerScratch() {
+	thread_local std::vector<float> outputs[3];
+	return outputs;
+}
+
+// Take the generated instances over when nothing came before them
+static void appendInstances(std::vector<GlyphInstance>& dst, std::vector<GlyphInstance>&& src) {
+	if (dst.empty()) dst = std::move(src);
+	else dst.insert(dst.end(), src.begin(), src.end());
+}
+
+// Whether every output of fd was differentiated at compile time, in all of its inputs
+static bool hasDerivatives(const FunctionDefinition& fd) {
+	const size_t width = (fd.inputDim == 1) ? 3 : (size_t)fd.inputDim + 1;
+	for (int i = 0; i < fd.outputDim; ++i) {
+		if (!fd.parsers[i].hasDerivatives() || fd.parsers[i].derivativeCount() != width) return false;
+	}
+	return true;
+}
+
+// Like evaluateOutputs, but out[i] holds derivativeCount() floats per sample (value, then partials)
+static void evaluateDerivatives(const FunctionDefinition& fd, const float* inputs, size_t count, size_t stride,
+	const std::atomic<bool>* cancelled, std::vector<float>* out) {
+	const bool skip = cancelled && cancelled->load(std::memory_order_relaxed);
+	if (!skip && fd.fused.hasDerivatives()) {
+		float* planes[3] = {};
+		for (int i = 0; i < fd.outputDim; ++i) {
+			out[i].resize(count * fd.fused.derivativeCount());
+			planes[i] = out[i].data();
+		}
+		fd.fused.evaluateWithDerivatives(inputs, count, planes, stride);
+		return;
+	}
+	for (int i = 0; i < fd.outputDim; ++i) {
+		const size_t width = fd.parsers[i].derivativeCount();
+		if (skip) {
+			out[i].assign(count * width, 0.0f);
+			continue;
+		}
+		out[i].resize(count * width);
+		fd.parsers[i].evaluateWithDerivatives(inputs, count, out[i].data(), stride);
+	}
+}
+
+// Adaptive meshes start from resolution / ADAPTIVE_BASE_DIVISOR and refine to at most twice the resolution
+static constexpr int ADAPTIVE_BASE_DIVISOR = 8;
+
+static GraphObjects::AdaptiveOptions adaptiveOptions(const FunctionDefinition& fd) {
+	GraphObjects::AdaptiveOptions options;
+	options.tolerance = fd.adaptiveTolerance;
+	options.maxDepth = 4;
+	return options;
+}
+
+// Filled z = f(u, v) surfaces on a regular grid go to a Heightfield while the grid fits its texture
+static bool usesHeightfield(const FunctionDefinition& fd) {
+	return fd.inputDim == 2 && fd.outputDim == 1 && !fd.renderImplicit && !fd.wireframe && !fd.adaptive
+		&& fd.resolution[0] >= 1 && fd.resolution[1] >= 1
+		&& fd.resolution[0] < Heightfield::MAX_SIZE && fd.resolution[1] < Heightfield::MAX_SIZE;
+}
+
+static std::vector<float> isoLevels(const FunctionDefinition& fd) {
+	std::vector<float> levels(std::max(fd.isoLevelCount, 1));
+	for (size_t k = 0; k < levels.size(); ++k) levels[k] = fd.isovalue + k * fd.isoLevelSpacing;
+	return levels;
+}
+
+void Application::buildFunctionGeometry(const FunctionDefinition& fd, bool filledSurfaceOnGpu, bool streamlinesOnGpu,
+	uint32_t stages, const std::atomic<bool>* cancelled, FunctionGeometry& out) {
+	IndexedMesh& surfaceMesh = out.surfaceMesh;
+	IndexedMesh& lineMesh = out.lineMesh;
+	std::vector<GlyphInstance>& cubes = out.cubes;
+	vec3 col(fd.color[0], fd.color[1], fd.color[2]);
+	// Surfaces are generated white and tinted by color at draw time
+	const vec3 white(1.0f);
+	int n = fd.inputDim;
+	int m = fd.outputDim;
+	auto build = [stages](GeometryStage stage) { return (stages & (1u << stage)) != 0; };
+	const bool base = build(STAGE_BASE);
+
+	if (n == 1) {
+		// Curve: batch sampler t[] -> vec3[]
+		auto curveFunc = [&fd, m, cancelled](const float* ts, size_t count, glm::vec3* out) {
+			std::vector<float>* f = samplerScratch();
+			evaluateOutputs(fd, ts, count, 1, cancelled, f);
+			for (size_t k = 0; k < count; ++k) {
 				if (m == 1) {
-					float fval = (float)fd.parsers[0].evaluate(vals);
-					return glm::vec3(u, v, fval);
+					out[k] = glm::vec3(ts[k], f[0][k], 0.0f);
 				} else if (m == 2) {
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					float fy = (float)fd.parsers[1].evaluate(vals);
-					return glm::vec3(fx, fy, 0.0f);
+					float fx = f[0][k];
+					float fy = f[1][k];
+					// Map to selected plane: 0=xy, 1=xz, 2=yz
+					if (fd.curvePlane == 0) out[k] = glm::vec3(fx, fy, 0.0f);      // xy plane
+					else if (fd.curvePlane == 1) out[k] = glm::vec3(fx, 0.0f, fy); // xz plane
+					else out[k] = glm::vec3(0.0f, fx, fy);                          // yz plane
 				} else { // m == 3
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					float fy = (float)fd.parsers[1].evaluate(vals);
-					float fz = (float)fd.parsers[2].evaluate(vals);
-					return glm::vec3(fx, fy, fz);
+					out[k] = glm::vec3(f[0][k], f[1][k], f[2][k]);
+				}
+			}
+		};
+
+		// Exact tangents and curvature when every component could be differentiated
+		GraphObjects::CurveJetSampler curveJet;
+		if (hasDerivatives(fd)) {
+			curveJet = [&fd, m, cancelled](const float* ts, size_t count, glm::vec3* p, glm::vec3* dp, glm::vec3* ddp) {
+				std::vector<float>* f = samplerScratch();
+				evaluateDerivatives(fd, ts, count, 1, cancelled, f);
+				for (size_t k = 0; k < count; ++k) {
+					// (f, f', f'') per component
+					const float* a = &f[0][k * 3];
+					if (m == 1) {
+						p[k] = glm::vec3(ts[k], a[0], 0.0f);
+						dp[k] = glm::vec3(1.0f, a[1], 0.0f);
+						ddp[k] = glm::vec3(0.0f, a[2], 0.0f);
+					} else if (m == 2) {
+						const float* b = &f[1][k * 3];
+						glm::vec3 jets[3];
+						for (int d = 0; d < 3; ++d) {
+							if (fd.curvePlane == 0) jets[d] = glm::vec3(a[d], b[d], 0.0f);
+							else if (fd.curvePlane == 1) jets[d] = glm::vec3(a[d], 0.0f, b[d]);
+							else jets[d] = glm::vec3(0.0f, a[d], b[d]);
+						}
+						p[k] = jets[0];
+						dp[k] = jets[1];
+						ddp[k] = jets[2];
+					} else {
+						const float* b = &f[1][k * 3];
+						const float* c = &f[2][k * 3];
+						p[k] = glm::vec3(a[0], b[0], c[0]);
+						dp[k] = glm::vec3(a[1], b[1], c[1]);
+						ddp[k] = glm::vec3(a[2], b[2], c[2]);
+					}
 				}
 			};
+		}
 
-			if (fd.wireframe) {
-				// Wireframe: LineList via axes pipeline with purple color
-				vec3 wireframeColor(0.7f, 0.4f, 0.8f);
-				auto wfVerts = GraphObjects::generateParametricSurfaceWireframe(
-					surfFunc,
-					fd.rangeMin[0], fd.rangeMax[0],
-					fd.rangeMin[1], fd.rangeMax[1],
-					fd.resolution[0], fd.resolution[1], wireframeColor);
-				lineVerts.insert(lineVerts.end(), wfVerts.begin(), wfVerts.end());
-			} else {
-				// Filled surface
-				auto verts = GraphObjects::generateParametricSurface(
-					surfFunc,
-					fd.rangeMin[0], fd.rangeMax[0],
-					fd.rangeMin[1], fd.rangeMax[1],
-					fd.resolution[0], fd.resolution[1], true);
-				surfaceVerts.insert(surfaceVerts.end(), verts.begin(), verts.end());
-			}
+		// Use thinner tube for 2D curves, and support wireframe mode
+		float tubeRad = (m == 2) ? 0.01f : fd.tubeRadius;
+		if (!base) {
+			// Kept from the last build
+		} else if (!fd.wireframe && fd.adaptive) {
+			auto verts = GraphObjects::generateParametricCurveTubeAdaptive(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				std::max(fd.resolution[0] / ADAPTIVE_BASE_DIVISOR, 16), adaptiveOptions(fd), tubeRad, 8, white);
+			surfaceMesh.append(std::move(verts));
+			out.surfaceTinted = true;
+		} else if (!fd.wireframe) {
+			auto verts = GraphObjects::generateParametricCurveTube(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				fd.resolution[0], tubeRad, 8, white);
+			surfaceMesh.append(std::move(verts));
+			out.surfaceTinted = true;
+		} else {
+			// Wireframe: use line rendering with purple color
+			vec3 wireframeColor(0.7f, 0.4f, 0.8f);
+			auto curveLineVerts = GraphObjects::generateParametricCurve(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				fd.resolution[0], wireframeColor);
+			lineMesh.append(std::move(curveLineVerts));
+		}
 
-			// Normal vectors overlay
-			if (fd.showNormalVectors) {
-				int nCount = std::max(fd.overlayVectorCount, 2);
-				auto normalVerts = GraphObjects::generateSurfaceNormals(
-					surfFunc,
-					fd.rangeMin[0], fd.rangeMax[0],
-					fd.rangeMin[1], fd.rangeMax[1],
-					nCount, nCount,
-					fd.overlayVectorScale, vec3(0.2f, 0.4f, 1.0f), fd.flipNormalVectors);
-				surfaceVerts.insert(surfaceVerts.end(), normalVerts.begin(), normalVerts.end());
-			}
+		// Tangent vectors overlay
+		if (fd.showTangentVectors && build(STAGE_TANGENTS)) {
+			out.arrows[STAGE_TANGENTS] = GraphObjects::generateTangentVectors(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				fd.overlayVectorCount, fd.overlayVectorScale, vec3(1, 0, 0), curveJet);
+		}
+
+		// Normal vectors overlay for curves
+		if (fd.showNormalVectors && build(STAGE_NORMALS)) {
+			out.arrows[STAGE_NORMALS] = GraphObjects::generateCurveNormals(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				fd.overlayVectorCount, fd.overlayVectorScale, vec3(0, 1, 0), fd.flipNormalVectors, curveJet);
+		}
+
+		// Frenet frame overlay
+		if (fd.showFrenetFrame && build(STAGE_FRENET)) {
+			out.arrows[STAGE_FRENET] = GraphObjects::generateFrenetFrame(
+				curveFunc, fd.rangeMin[0], fd.rangeMax[0],
+				fd.frenetT, fd.overlayVectorScale, curveJet);
+		}
 
-			// Tangent vectors overlay for surfaces
-			if (fd.showTangentVectors) {
-				int tCount = std::max(fd.overlayVectorCount, 2);
-				auto tangentVerts = GraphObjects::generateSurfaceTangents(
-					surfFunc,
-					fd.rangeMin[0], fd.rangeMax[0],
-					fd.rangeMin[1], fd.rangeMax[1],
-					tCount, tCount,
-					fd.overlayVectorScale, vec3(1.0f, 0.2f, 0.2f), fd.surfaceTangentMode);
-				surfaceVerts.insert(surfaceVerts.end(), tangentVerts.begin(), tangentVerts.end());
+	} else if (n == 2) {
+		// Surface: batch sampler (u,v)[] -> vec3[]
+		auto surfFunc = [&fd, m, cancelled](const glm::vec2* uv, size_t count, glm::vec3* out) {
+			std::vector<float>* f = samplerScratch();
+			evaluateOutputs(fd, glm::value_ptr(uv[0]), count, 2, cancelled, f);
+			for (size_t k = 0; k < count; ++k) {
+				if (m == 1) out[k] = glm::vec3(uv[k].x, uv[k].y, f[0][k]);
+				else if (m == 2) out[k] = glm::vec3(f[0][k], f[1][k], 0.0f);
+				else out[k] = glm::vec3(f[0][k], f[1][k], f[2][k]);
 			}
+		};
+
+		// Exact normals when every component could be differentiated
+		GraphObjects::SurfaceJetSampler surfJet;
+		if (hasDerivatives(fd)) {
+			surfJet = [&fd, m, cancelled](const glm::vec2* uv, size_t count, glm::vec3* p, glm::vec3* dpdu, glm::vec3* dpdv) {
+				std::vector<float>* f = samplerScratch();
+				evaluateDerivatives(fd, glm::value_ptr(uv[0]), count, 2, cancelled, f);
+				for (size_t k = 0; k < count; ++k) {
+					// (f, df/du, df/dv) per component
+					const float* a = &f[0][k * 3];
+					if (m == 1) {
+						p[k] = glm::vec3(uv[k].x, uv[k].y, a[0]);
+						dpdu[k] = glm::vec3(1.0f, 0.0f, a[1]);
+						dpdv[k] = glm::vec3(0.0f, 1.0f, a[2]);
+						continue;
+					}
+					const float* b = &f[1][k * 3];
+					glm::vec3 c = (m == 3) ? glm::vec3(f[2][k * 3], f[2][k * 3 + 1], f[2][k * 3 + 2]) : glm::vec3(0.0f);
+					p[k] = glm::vec3(a[0], b[0], c[0]);
+					dpdu[k] = glm::vec3(a[1], b[1], c[1]);
+					dpdv[k] = glm::vec3(a[2], b[2], c[2]);
+				}
+			};
+		}
+
+		// Scalar functions (m=1): the height alone
+		auto scalarFunc2D = [&fd, cancelled](const glm::vec2* uv, size_t count, float* out) {
+			std::vector<float>* f = samplerScratch();
+			evaluateOutputs(fd, glm::value_ptr(uv[0]), count, 2, cancelled, f);
+			std::copy(f[0].begin(), f[0].end(), out);
+		};
+
+		if (!base) {
+			// Kept from the last build
+		} else if (m == 1 && fd.renderImplicit) {
+			// Implicit curves f(x, y) = level in the z = 0 plane
+			auto isolines = GraphObjects::generateIsolines(
+				scalarFunc2D,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				fd.resolution[0], fd.resolution[1], isoLevels(fd), col);
+			lineMesh.append(std::move(isolines));
+		} else if (fd.wireframe) {
+			// Wireframe: LineList via axes pipeline with purple color
+			vec3 wireframeColor(0.7f, 0.4f, 0.8f);
+			auto wfVerts = GraphObjects::generateParametricSurfaceWireframe(
+				surfFunc,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				fd.resolution[0], fd.resolution[1], wireframeColor);
+			lineMesh.append(std::move(wfVerts));
+		} else if (!filledSurfaceOnGpu && usesHeightfield(fd)) {
+			// Heights only, a float per grid point instead of a vertex
+			out.heightfield = GraphObjects::generateHeightfield(
+				scalarFunc2D,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				fd.resolution[0], fd.resolution[1]);
+			out.heightfieldSize[0] = fd.resolution[0] + 1;
+			out.heightfieldSize[1] = fd.resolution[1] + 1;
+			out.heightfieldRange[0] = fd.rangeMin[0];
+			out.heightfieldRange[1] = fd.rangeMax[0];
+			out.heightfieldRange[2] = fd.rangeMin[1];
+			out.heightfieldRange[3] = fd.rangeMax[1];
+			out.surfaceColormapped = true;
+		} else if (!filledSurfaceOnGpu && fd.adaptive) {
+			auto verts = GraphObjects::generateParametricSurfaceAdaptive(
+				surfFunc,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				std::max(fd.resolution[0] / ADAPTIVE_BASE_DIVISOR, 4), std::max(fd.resolution[1] / ADAPTIVE_BASE_DIVISOR, 4),
+				adaptiveOptions(fd), true, surfJet);
+			surfaceMesh.append(std::move(verts));
+			out.surfaceColormapped = true;
+		} else if (!filledSurfaceOnGpu) {
+			// Filled surface
+			auto verts = GraphObjects::generateParametricSurface(
+				surfFunc,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				fd.resolution[0], fd.resolution[1], true, surfJet);
+			surfaceMesh.append(std::move(verts));
+			out.surfaceColormapped = true;
+		}
 
-			// Gradient field overlay (only for R^2->R^1)
-			if (fd.showGradientField && m == 1) {
-				auto scalarFunc2D = [&fd](float u, float v) -> float {
-					double vals[2] = { (double)u, (double)v };
-					return (float)fd.parsers[0].evaluate(vals);
+		// Normal vectors overlay
+		if (fd.showNormalVectors && build(STAGE_NORMALS)) {
+			int nCount = std::max(fd.overlayVectorCount, 2);
+			out.arrows[STAGE_NORMALS] = GraphObjects::generateSurfaceNormals(
+				surfFunc,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				nCount, nCount,
+				fd.overlayVectorScale, vec3(0.2f, 0.4f, 1.0f), fd.flipNormalVectors, surfJet);
+		}
+
+		// Tangent vectors overlay for surfaces
+		if (fd.showTangentVectors && build(STAGE_TANGENTS)) {
+			int tCount = std::max(fd.overlayVectorCount, 2);
+			out.arrows[STAGE_TANGENTS] = GraphObjects::generateSurfaceTangents(
+				surfFunc,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				tCount, tCount,
+				fd.overlayVectorScale, vec3(1.0f, 0.2f, 0.2f), fd.surfaceTangentMode, surfJet);
+		}
+
+		// Gradient field overlay (only for R^2->R^1)
+		if (fd.showGradientField && m == 1 && !fd.renderImplicit && build(STAGE_GRADIENT)) {
+			GraphObjects::Gradient2DSampler gradient2D;
+			if (hasDerivatives(fd)) {
+				gradient2D = [&fd, cancelled](const glm::vec2* uv, size_t count, glm::vec2* grad) {
+					std::vector<float>* f = samplerScratch();
+					evaluateDerivatives(fd, glm::value_ptr(uv[0]), count, 2, cancelled, f);
+					for (size_t k = 0; k < count; ++k) grad[k] = glm::vec2(f[0][k * 3 + 1], f[0][k * 3 + 2]);
 				};
-				int gCount = std::max(fd.overlayVectorCount, 2);
-				auto gradVerts = GraphObjects::generateGradientField2D(
-					scalarFunc2D,
-					fd.rangeMin[0], fd.rangeMax[0],
-					fd.rangeMin[1], fd.rangeMax[1],
-					gCount, gCount,
-					fd.overlayVectorScale);
-				surfaceVerts.insert(surfaceVerts.end(), gradVerts.begin(), gradVerts.end());
 			}
+			int gCount = std::max(fd.overlayVectorCount, 2);
+			out.arrows[STAGE_GRADIENT] = GraphObjects::generateGradientField2D(
+				scalarFunc2D,
+				fd.rangeMin[0], fd.rangeMax[0],
+				fd.rangeMin[1], fd.rangeMax[1],
+				gCount, gCount,
+				fd.overlayVectorScale, gradient2D);
+		}
 
-		} else if (n == 3) {
-			vec3 rMin(fd.rangeMin[0], fd.rangeMin[1], fd.rangeMin[2]);
-			vec3 rMax(fd.rangeMax[0], fd.rangeMax[1], fd.rangeMax[2]);
-			glm::ivec3 res(fd.overlayVectorCount);  // Use overlayVectorCount for both arrows and streamlines
+	} else if (n == 3) {
+		vec3 rMin(fd.rangeMin[0], fd.rangeMin[1], fd.rangeMin[2]);
+		vec3 rMax(fd.rangeMax[0], fd.rangeMax[1], fd.rangeMax[2]);
+		glm::ivec3 res(fd.overlayVectorCount);  // Use overlayVectorCount for both arrows and streamlines
+
+		if (m == 1) {
+			// Scalar field: colored cubes, or the isosurfaces
+			auto scalarFunc = [&fd, cancelled](const glm::vec3* p, size_t count, float* out) {
+				std::vector<float>* f = samplerScratch();
+				evaluateOutputs(fd, glm::value_ptr(p[0]), count, 3, cancelled, f);
+				std::copy(f[0].begin(), f[0].end(), out);
+			};
 
-			if (m == 1) {
-				// Scalar field: colored cubes
-				auto scalarFunc = [&fd](glm::vec3 p) -> float {
-					double vals[3] = { (double)p.x, (double)p.y, (double)p.z };
-					return (float)fd.parsers[0].evaluate(vals);
+			GraphObjects::GradientSampler gradient;
+			if (hasDerivatives(fd)) {
+				gradient = [&fd, cancelled](const glm::vec3* p, size_t count, glm::vec3* grad) {
+					std::vector<float>* f = samplerScratch();
+					evaluateDerivatives(fd, glm::value_ptr(p[0]), count, 3, cancelled, f);
+					for (size_t k = 0; k < count; ++k) {
+						grad[k] = glm::vec3(f[0][k * 4 + 1], f[0][k * 4 + 2], f[0][k * 4 + 3]);
+					}
 				};
+			}
 
-				auto verts = GraphObjects::generateScalarField(
+			if (!base) {
+				// Kept from the last build
+			} else if (fd.renderImplicit) {
+				auto isosurface = GraphObjects::generateIsosurface(
+					scalarFunc, rMin, rMax, glm::ivec3(fd.isoResolution), isoLevels(fd), white, gradient);
+				surfaceMesh.append(std::move(isosurface));
+				// Several levels are told apart by the ramp instead
+				out.surfaceTinted = fd.isoLevelCount <= 1;
+			} else {
+				auto fieldCubes = GraphObjects::generateScalarField(
 					scalarFunc, rMin, rMax, res, 0.1f);
-				surfaceVerts.insert(surfaceVerts.end(), verts.begin(), verts.end());
-
-				// Gradient field overlay for R^3->R^1
-				if (fd.showGradientField) {
-					auto gradVerts = GraphObjects::generateGradientField3D(
-						scalarFunc, rMin, rMax, res, fd.overlayVectorScale);
-					surfaceVerts.insert(surfaceVerts.end(), gradVerts.begin(), gradVerts.end());
-				}
+				appendInstances(cubes, std::move(fieldCubes));
+			}
 
-			} else {
-				// Vector field (m==2 or m==3)
-				auto fieldFunc = [&fd, m](glm::vec3 p) -> glm::vec3 {
-					double vals[3] = { (double)p.x, (double)p.y, (double)p.z };
-					float fx = (float)fd.parsers[0].evaluate(vals);
-					float fy = (float)fd.parsers[1].evaluate(vals);
-					float fz = (m >= 3) ? (float)fd.parsers[2].evaluate(vals) : 0.0f;
-					return glm::vec3(fx, fy, fz);
-				};
+			// Gradient field overlay for R^3->R^1
+			if (fd.showGradientField && !fd.renderImplicit && build(STAGE_GRADIENT)) {
+				out.arrows[STAGE_GRADIENT] = GraphObjects::generateGradientField3D(
+					scalarFunc, rMin, rMax, res, fd.overlayVectorScale, gradient);
+			}
 
-				// Show vector field arrows
-				if (fd.showVectorField) {
-					auto verts = GraphObjects::generateVectorField(
-						fieldFunc, rMin, rMax, res, fd.arrowScale);
-					surfaceVerts.insert(surfaceVerts.end(), verts.begin(), verts.end());
+		} else {
+			// Vector field (m==2 or m==3)
+			auto fieldFunc = [&fd, m, cancelled](const glm::vec3* p, size_t count, glm::vec3* out) {
+				std::vector<float>* f = samplerScratch();
+				evaluateOutputs(fd, glm::value_ptr(p[0]), count, 3, cancelled, f);
+				for (size_t k = 0; k < count; ++k) {
+					float fz = (m >= 3) ? f[2][k] : 0.0f;
+					out[k] = glm::vec3(f[0][k], f[1][k], fz);
 				}
+			};
 
-				// Show streamlines
-				if (fd.showStreamlines) {
-					auto streamVerts = GraphObjects::generateStreamlines(
-						fieldFunc, rMin, rMax, res, fd.overlayVectorCount, fd.overlayVectorScale);
-					lineVerts.insert(lineVerts.end(), streamVerts.begin(), streamVerts.end());
-				}
+			// Show vector field arrows
+			if (fd.showVectorField && build(STAGE_VECTOR_FIELD)) {
+				out.arrows[STAGE_VECTOR_FIELD] = GraphObjects::generateVectorField(
+					fieldFunc, rMin, rMax, res, fd.arrowScale);
 			}
-		}
-	}
 
-	// Upload surface buffer (TriangleList)
-	if (!surfaceVerts.empty()) {
-		WGPUBufferDescriptor bufferDesc = {};
-		bufferDesc.size = surfaceVerts.size() * sizeof(VertexAttributes);
-		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
-		bufferDesc.mappedAtCreation = false;
-		m_surfaceVertexBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
-		wgpuQueueWriteBuffer(m_queue, m_surfaceVertexBuffer, 0, surfaceVerts.data(), bufferDesc.size);
-		m_surfaceVertexCount = static_cast<int>(surfaceVerts.size());
-	}
-
-	// Upload wireframe line buffer (LineList)
-	if (!lineVerts.empty()) {
-		WGPUBufferDescriptor bufferDesc = {};
-		bufferDesc.size = lineVerts.size() * sizeof(VertexAttributes);
-		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
-		bufferDesc.mappedAtCreation = false;
-		m_curveVertexBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
-		wgpuQueueWriteBuffer(m_queue, m_curveVertexBuffer, 0, lineVerts.data(), bufferDesc.size);
-		m_curveVertexCount = static_cast<int>(lineVerts.size());
+			// Show streamlines
+			if (fd.showStreamlines && !streamlinesOnGpu && base) {
+				auto streamVerts = GraphObjects::generateStreamlines(
+					fieldFunc, rMin, rMax, res, fd.overlayVectorCount, fd.overlayVectorScale);
+				lineMesh.append(std::move(streamVerts));
+			}
+		}
 	}
 }
 
@@ -1921,6 +3739,468 @@ void Application::loadPresets() {
 	}
 }
 
+// ─── Sessions ───────────────────────────────────────────────────────────────
+
+bool Application::saveSession(const std::string& path, bool includeMeshes) {
+	PROFILE_FUNCTION();
+	std::vector<SessionFile::CachedGeometry> cache;
+	if (includeMeshes) {
+		// Uploaded buffers have no CPU copy: every enabled stage is built again from a private
+		// snapshot, as the background builds do, one function per job
+		const size_t count = m_functions.size();
+		std::deque<FunctionDefinition> snapshots(count);
+		cache.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			const FunctionDefinition& fd = m_functions[i];
+			if (!fd.isValid) continue;
+			SessionFile::CachedGeometry& cached = cache[i];
+			functionStageKeys(fd, cached.keys);
+			for (int s = 0; s < STAGE_COUNT; ++s) {
+				if (cached.keys[s]) cached.stages |= 1u << s;
+			}
+			cached.filledSurfaceOnGpu = (fd.gpuSurface != nullptr);
+			cached.streamlinesOnGpu = (fd.gpuFlow && fd.gpuFlow->streamlineIndexCount() > 0);
+			snapshotFunction(fd, snapshots[i]);
+		}
+		JobSystem::shared().parallelFor(count, 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				SessionFile::CachedGeometry& cached = cache[i];
+				if (!cached.stages) continue;
+				FunctionGeometry& g = cached.geometry;
+				buildFunctionGeometry(snapshots[i], cached.filledSurfaceOnGpu, cached.streamlinesOnGpu,
+					cached.stages, nullptr, g);
+				finishFunctionGeometry(g);
+				// Meshes streamed straight into staging memory are packed here, so the file has one layout
+				if (g.surfaceVertices.empty() && !g.surfaceMesh.vertices.empty()) {
+					g.surfaceVertices = GraphObjects::packVertices(g.surfaceMesh.vertices, g.surfaceColormapped);
+					g.surfaceMesh.vertices = {};
+				}
+				if (g.lineVertices.empty() && !g.lineMesh.vertices.empty()) {
+					g.lineVertices = GraphObjects::packVertices(g.lineMesh.vertices);
+					g.lineMesh.vertices = {};
+				}
+			}
+		});
+	}
+
+	std::string error;
+	if (!SessionFile::save(path, m_functions, includeMeshes ? &cache : nullptr, error)) {
+		std::cerr << "Could not save session: " << error << std::endl;
+		m_sessionStatus = error;
+		return false;
+	}
+	std::error_code ec;
+	const uintmax_t bytes = std::filesystem::file_size(path, ec);
+	m_sessionStatus = "Saved " + path + (ec ? std::string() : " (" + std::to_string(bytes / 1024) + " KiB)");
+	return true;
+}
+
+bool Application::openSession(const std::string& path) {
+	PROFILE_FUNCTION();
+	std::deque<FunctionDefinition> functions;
+	std::vector<SessionFile::CachedGeometry> cache;
+	std::string error;
+	if (!SessionFile::load(path, functions, cache, error)) {
+		std::cerr << "Could not open session: " << error << std::endl;
+		m_sessionStatus = error;
+		return false;
+	}
+
+	for (auto& fd : m_functions) {
+		cancelGeometryBuild(fd);
+		releaseFunctionGeometry(fd);
+	}
+	m_functions = std::move(functions);
+
+	// Cached stages whose keys still match are uploaded as they are; updateGraphObjects builds the rest
+	int reused = 0, total = 0;
+	for (size_t i = 0; i < m_functions.size(); ++i) {
+		FunctionDefinition& fd = m_functions[i];
+		// Not compileFunctionDef, whose defaults would override the saved overlays
+		compileParsers(fd);
+		fd.dirty = true;
+		if (!fd.isValid) continue;
+
+		StageKeys keys;
+		functionStageKeys(fd, keys);
+		SessionFile::CachedGeometry& cached = cache[i];
+		uint32_t stages = 0;
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (!keys[s]) continue;
+			++total;
+			if ((cached.stages & (1u << s)) && cached.keys[s] == keys[s]) stages |= 1u << s;
+		}
+		// The base stage leaves out what the compute shaders draw, which depends on this device
+		if (stages & (1u << STAGE_BASE)) {
+			updateGpuSurface(fd);
+			updateGpuFlow(fd);
+			const bool streamlinesOnGpu = fd.gpuFlow && fd.gpuFlow->streamlineIndexCount() > 0;
+			if ((fd.gpuSurface != nullptr) != cached.filledSurfaceOnGpu || streamlinesOnGpu != cached.streamlinesOnGpu) {
+				stages &= ~(1u << STAGE_BASE);
+			}
+		}
+		if (!stages) continue;
+
+		uploadFunctionGeometry(fd, stages, cached.geometry);
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (!(stages & (1u << s))) continue;
+			fd.stageKeys[s] = keys[s];
+			++reused;
+		}
+	}
+	m_graphObjectsDirty = true;
+
+	m_sessionStatus = "Opened " + path + ": " + std::to_string(m_functions.size()) + " functions, "
+		+ std::to_string(reused) + " of " + std::to_string(total) + " stages from cached meshes";
+	std::cout << m_sessionStatus << std::endl;
+	return true;
+}
+
+// ─── Headless Batch ─────────────────────────────────────────────────────────
+
+namespace {
+// One image on its way back from the GPU
+struct BatchReadback {
+	enum State { Free, Mapping, Mapped, Failed };
+	WGPUBuffer buffer = nullptr;
+	std::atomic<int> state{Free};
+	std::string path;
+};
+
+void onBatchReadbackMapped(WGPUBufferMapAsyncStatus status, void* userdata) {
+	auto* slot = static_cast<BatchReadback*>(userdata);
+	slot->state = (status == WGPUBufferMapAsyncStatus_Success) ? BatchReadback::Mapped : BatchReadback::Failed;
+}
+
+// Pieces of text between separators, without surrounding spaces; empty pieces are dropped
+std::vector<std::string> splitList(const std::string& text, char separator) {
+	std::vector<std::string> pieces;
+	std::stringstream stream(text);
+	std::string piece;
+	while (std::getline(stream, piece, separator)) {
+		const size_t first = piece.find_first_not_of(" \t");
+		if (first == std::string::npos) continue;
+		pieces.push_back(piece.substr(first, piece.find_last_not_of(" \t") - first + 1));
+	}
+	return pieces;
+}
+
+std::string fileStem(const std::string& label) {
+	std::string stem;
+	for (char c : label) stem += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+	return stem.empty() ? "plot" : stem;
+}
+} // namespace
+
+void Application::pollDevice() {
+#ifdef WEBGPU_BACKEND_DAWN
+	wgpuDeviceTick(m_device);
+#elif defined(WEBGPU_BACKEND_WGPU)
+	wgpuDevicePoll(m_device, false, nullptr);
+#endif
+}
+
+bool Application::parseBatchItem(const std::string& item, std::deque<FunctionDefinition>& functions, std::string& label,
+	std::string& errorMsg) {
+	// A saved session, drawn with its own settings
+	const std::filesystem::path itemPath(item);
+	if (itemPath.extension() == ".graph") {
+		std::vector<SessionFile::CachedGeometry> cache;
+		if (!SessionFile::load(item, functions, cache, errorMsg)) return false;
+		for (auto& fd : functions) compileParsers(fd);
+		label = itemPath.stem().string();
+		return true;
+	}
+
+	FunctionDefinition fd;
+	const size_t equals = item.find('=');
+	if (equals != std::string::npos) {
+		// Inline: name(params)=expr;expr;expr, optionally followed by @min:max,min:max,min:max
+		const std::string head = item.substr(0, equals);
+		std::string body = item.substr(equals + 1), ranges;
+		const size_t at = body.rfind('@');
+		if (at != std::string::npos) {
+			ranges = body.substr(at + 1);
+			body = body.substr(0, at);
+		}
+		const size_t open = head.find('('), close = head.rfind(')');
+		const std::vector<std::string> params = (open != std::string::npos && close != std::string::npos && open < close)
+			? splitList(head.substr(open + 1, close - open - 1), ',') : std::vector<std::string>();
+		const std::vector<std::string> exprs = splitList(body, ';');
+		if (params.empty() || params.size() > 3 || exprs.empty() || exprs.size() > 3) {
+			errorMsg = "expected name(params)=expr;expr;expr with 1 to 3 of each";
+			return false;
+		}
+		fd.inputDim = static_cast<int>(params.size());
+		fd.outputDim = static_cast<int>(exprs.size());
+		fd.name = head.substr(0, open);
+		for (int i = 0; i < 3; ++i) {
+			fd.paramNames[i] = i < fd.inputDim ? params[i] : "";
+			fd.exprStrings[i] = i < fd.outputDim ? exprs[i] : "";
+		}
+		const std::vector<std::string> bounds = splitList(ranges, ',');
+		for (int i = 0; i < (int)bounds.size() && i < 3; ++i) {
+			float lo = 0.0f, hi = 0.0f;
+			if (std::sscanf(bounds[i].c_str(), "%f:%f", &lo, &hi) != 2 || !(lo < hi)) {
+				errorMsg = "range \"" + bounds[i] + "\" is not min:max";
+				return false;
+			}
+			fd.rangeMin[i] = lo;
+			fd.rangeMax[i] = hi;
+		}
+	} else {
+		// A preset, by name or as "n_m/name"; categories are searched in order for a bare name
+		const size_t slash = item.find('/');
+		const std::string category = slash == std::string::npos ? "" : item.substr(0, slash);
+		const std::string name = slash == std::string::npos ? item : item.substr(slash + 1);
+		std::map<std::string, const std::vector<Preset>*> categories;
+		for (const auto& [key, list] : m_presets) categories[key] = &list;
+		const Preset* preset = nullptr;
+		std::string presetKey;
+		for (const auto& [key, list] : categories) {
+			if (!category.empty() && key != category) continue;
+			for (const Preset& p : *list) {
+				if (p.name != name) continue;
+				preset = &p;
+				presetKey = key;
+				break;
+			}
+			if (preset) break;
+		}
+		if (!preset || presetKey.size() != 3) {
+			errorMsg = "no preset or definition named \"" + item + "\"";
+			return false;
+		}
+		fd.inputDim = presetKey[0] - '0';
+		fd.outputDim = presetKey[2] - '0';
+		resetNames(fd);
+		for (int i = 0; i < 3; ++i) fd.exprStrings[i] = i < (int)preset->exprs.size() ? preset->exprs[i] : "";
+		for (int i = 0; i < fd.inputDim; ++i) {
+			fd.rangeMin[i] = preset->ranges[2 * i];
+			fd.rangeMax[i] = preset->ranges[2 * i + 1];
+		}
+		fd.name = preset->name;
+	}
+
+	compileFunctionDef(fd);
+	if (!fd.isValid) {
+		errorMsg = fd.errorMsg;
+		return false;
+	}
+	label = fd.name;
+	functions.push_back(std::move(fd));
+	return true;
+}
+
+void Application::fitViewToFunctions() {
+	// The camera orbits the origin, so the corner farthest from it decides the distance
+	float radius = 0.0f;
+	for (const auto& fd : m_functions) {
+		if (!fd.show) continue;
+		for (const Aabb* box : { &fd.surfaceBounds, &fd.lineBounds, &fd.arrowBounds, &fd.cubeBounds }) {
+			if (box->empty()) continue;
+			for (int c = 0; c < 8; ++c) {
+				const vec3 corner((c & 1) ? box->max.x : box->min.x, (c & 2) ? box->max.y : box->min.y, (c & 4) ? box->max.z : box->min.z);
+				radius = std::max(radius, glm::length(corner));
+			}
+		}
+	}
+	if (!(radius > 0.0f)) return;
+	// Narrower of the two fields of view, and never past the far plane
+	const float halfFov = std::min(0.5f * m_fovy, std::atan(std::tan(0.5f * m_fovy) * m_aspectRatio));
+	const float distance = std::min(radius / std::sin(halfFov), 0.5f * m_farPlane);
+	m_cameraState.zoom = -std::log(distance);
+	updateViewMatrix();
+}
+
+bool Application::renderBatch(const BatchOptions& options) {
+	Profiler& profiler = Profiler::shared();
+	const auto startTime = std::chrono::steady_clock::now();
+	std::error_code ec;
+	std::filesystem::create_directories(options.outputDir, ec);
+
+	// Start from an empty scene rather than the default helix
+	for (auto& fd : m_functions) {
+		cancelGeometryBuild(fd);
+		releaseFunctionGeometry(fd);
+	}
+	m_functions.clear();
+
+	// Rows of a texture-to-buffer copy are padded to 256 bytes
+	const uint32_t width = m_headlessWidth, height = m_headlessHeight;
+	const uint32_t bytesPerRow = (width * 4 + 255) / 256 * 256;
+	const uint64_t readbackSize = (uint64_t)bytesPerRow * height;
+	std::vector<BatchReadback> slots(std::max(options.framesInFlight, 1));
+	for (BatchReadback& slot : slots) {
+		WGPUBufferDescriptor bufferDesc = {};
+		bufferDesc.label = "Batch readback";
+		bufferDesc.size = readbackSize;
+		bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+		bufferDesc.mappedAtCreation = false;
+		slot.buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+		if (!slot.buffer) {
+			std::cerr << "Could not create the batch readback buffers" << std::endl;
+			return false;
+		}
+	}
+
+	// PNGs are encoded on the workers; the slot is free again as soon as its pixels are copied out
+	std::atomic<int> encoding{0}, failures{0};
+	auto collectReadbacks = [&](bool wait) {
+		for (BatchReadback& slot : slots) {
+			while (wait && slot.state.load() == BatchReadback::Mapping) {
+				pollDevice();
+				std::this_thread::yield();
+			}
+			if (slot.state.load() == BatchReadback::Failed) {
+				std::cerr << "Could not read back " << slot.path << std::endl;
+				++failures;
+				slot.state = BatchReadback::Free;
+			}
+			if (slot.state.load() != BatchReadback::Mapped) continue;
+			const auto* data = static_cast<const uint8_t*>(wgpuBufferGetConstMappedRange(slot.buffer, 0, readbackSize));
+			auto pixels = std::make_shared<std::vector<uint8_t>>(data, data + readbackSize);
+			wgpuBufferUnmap(slot.buffer);
+			slot.state = BatchReadback::Free;
+			++encoding;
+			JobSystem::shared().submit([pixels, path = slot.path, width, height, bytesPerRow, &encoding, &failures] {
+				std::string error;
+				if (!ImageWriter::writePng(path, width, height, pixels->data(), bytesPerRow, error)) {
+					std::cerr << "Could not write image: " << error << std::endl;
+					++failures;
+				}
+				--encoding;
+			});
+		}
+	};
+
+	// Images whose geometry builds on the workers while earlier ones are drawn and read back
+	struct PendingImage {
+		std::deque<FunctionDefinition> functions;
+		std::string path;
+	};
+	std::deque<PendingImage> pending;
+	const size_t lookahead = slots.size() + JobSystem::shared().workerCount();
+	size_t nextItem = 0;
+	int skipped = 0, submitted = 0;
+	auto prepare = [&] {
+		while (pending.size() < lookahead && nextItem < options.items.size()) {
+			const size_t index = nextItem++;
+			const std::string& item = options.items[index];
+			PendingImage image;
+			std::string label, error;
+			if (!parseBatchItem(item, image.functions, label, error)) {
+				std::cerr << "Skipping \"" << item << "\": " << error << std::endl;
+				++skipped;
+				continue;
+			}
+			char prefix[24];
+			std::snprintf(prefix, sizeof(prefix), "%05zu_", index);
+			image.path = (std::filesystem::path(options.outputDir) / (prefix + fileStem(label) + ".png")).string();
+			for (auto& fd : image.functions) {
+				if (fd.show) scheduleFunctionGeometry(fd);
+			}
+			pending.push_back(std::move(image));
+		}
+	};
+
+	prepare();
+	while (!pending.empty()) {
+		profiler.beginFrame();
+		PendingImage image = std::move(pending.front());
+		pending.pop_front();
+		// Top the queue up first, so the workers keep building while this image waits for its own
+		prepare();
+		for (auto& fd : image.functions) {
+			while (fd.pendingBuild && !fd.pendingBuild->finished.load(std::memory_order_acquire)) {
+				collectReadbacks(false);
+				pollDevice();
+				std::this_thread::yield();
+			}
+			// The colormap range of a compute-evaluated surface
+			while (fd.gpuSurface && fd.gpuSurface->heightRangePending()) {
+				fd.gpuSurface->readHeightRange(m_device, m_queue);
+				pollDevice();
+				std::this_thread::yield();
+			}
+		}
+
+		// The previous image's buffers go through the deferred release, as after an edit
+		for (auto& fd : m_functions) releaseFunctionGeometry(fd);
+		m_functions = std::move(image.functions);
+		collectGeometryBuilds();
+		if (options.fitView) fitViewToFunctions();
+		updateSurfaceLods();
+		writeDrawCommands();
+		updateDrawBundles();
+
+		BatchReadback* slot = nullptr;
+		while (!slot) {
+			collectReadbacks(false);
+			for (BatchReadback& s : slots) {
+				if (s.state.load() == BatchReadback::Free) {
+					slot = &s;
+					break;
+				}
+			}
+			if (!slot) {
+				pollDevice();
+				std::this_thread::yield();
+			}
+		}
+		slot->path = image.path;
+
+		WGPUCommandEncoderDescriptor commandEncoderDesc = {};
+		commandEncoderDesc.label = "Batch command encoder";
+		WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &commandEncoderDesc);
+		encodeScene(encoder, m_offscreenView);
+
+		WGPUImageCopyTexture source = {};
+		source.texture = m_offscreenTexture;
+		source.mipLevel = 0;
+		source.origin = { 0, 0, 0 };
+		source.aspect = WGPUTextureAspect_All;
+		WGPUImageCopyBuffer destination = {};
+		destination.buffer = slot->buffer;
+		destination.layout.offset = 0;
+		destination.layout.bytesPerRow = bytesPerRow;
+		destination.layout.rowsPerImage = height;
+		const WGPUExtent3D copySize = { width, height, 1 };
+		wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination, &copySize);
+
+		WGPUCommandBufferDescriptor cmdBufferDescriptor = {};
+		cmdBufferDescriptor.label = "Batch command buffer";
+		profiler.resolveGpu(encoder);
+		WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDescriptor);
+		wgpuCommandEncoderRelease(encoder);
+		wgpuQueueSubmit(m_queue, 1, &command);
+		wgpuCommandBufferRelease(command);
+		m_geometryPool.onSubmit();
+		profiler.onSubmit();
+
+		// Queued behind the copy; the next images are drawn while it lands
+		slot->state = BatchReadback::Mapping;
+		wgpuBufferMapAsync(slot->buffer, WGPUMapMode_Read, 0, readbackSize, onBatchReadbackMapped, slot);
+		++submitted;
+		pollDevice();
+	}
+
+	collectReadbacks(true);
+	while (encoding.load() > 0) std::this_thread::yield();
+	for (BatchReadback& slot : slots) {
+		wgpuBufferDestroy(slot.buffer);
+		wgpuBufferRelease(slot.buffer);
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	const int written = submitted - failures.load();
+	std::cout << "Wrote " << written << " images to " << options.outputDir << " in " << seconds << " s ("
+		<< (seconds > 0.0 ? written / seconds : 0.0) << " per second)";
+	if (skipped > 0) std::cout << ", skipped " << skipped;
+	std::cout << std::endl;
+	return failures.load() == 0 && skipped == 0;
+}
+
 bool Application::initGui() {
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
@@ -1938,6 +4218,39 @@ void Application::terminateGui() {
 	ImGui_ImplWGPU_Shutdown();
 }
 
+void Application::drawProfilerWindow() {
+	Profiler& profiler = Profiler::shared();
+	ImGui::Begin("Profiler", &m_showProfiler);
+
+	bool enabled = profiler.enabled();
+	if (ImGui::Checkbox("Record", &enabled)) profiler.setEnabled(enabled);
+	ImGui::SameLine();
+	if (ImGui::Button("Write Chrome trace")) {
+		const std::string path = "trace.json";
+		m_traceStatus = profiler.writeChromeTrace(path) ? "Wrote " + path : "Could not write " + path;
+	}
+	if (!m_traceStatus.empty()) {
+		ImGui::SameLine();
+		ImGui::TextDisabled("%s", m_traceStatus.c_str());
+	}
+	if (!m_shaderStatus.empty()) ImGui::TextWrapped("Shaders: %s", m_shaderStatus.c_str());
+	if (!profiler.gpuEnabled()) ImGui::TextDisabled("No timestamp queries on this device: CPU phases only");
+	ImGui::TextDisabled("ms per frame over the last %d frames; CPU phases are summed over threads", Profiler::HISTORY);
+
+	// CPU phases first, then GPU passes, each with its rolling history
+	const std::vector<Profiler::Phase> phases = profiler.phases();
+	for (bool gpu : { false, true }) {
+		for (const Profiler::Phase& phase : phases) {
+			if (phase.gpu != gpu) continue;
+			char overlay[32];
+			snprintf(overlay, sizeof(overlay), "%.2f ms", phase.average);
+			ImGui::PlotHistogram(phase.name.c_str(), phase.ms.data(), Profiler::HISTORY, profiler.historyCursor(),
+				overlay, 0.0f, std::max(4.0f * phase.average, 1.0f), ImVec2(200, 36));
+		}
+	}
+	ImGui::End();
+}
+
 void Application::updateGui(WGPURenderPassEncoder renderPass) {
 	// Start the Dear ImGui frame
 	ImGui_ImplWGPU_NewFrame();
@@ -1946,7 +4259,6 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 
 	// Build our UI
 	{
-		bool dirty = false;
 		bool lightingChanged = false;
 
 		ImGui::Begin("Visualization");
@@ -1956,6 +4268,7 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 		int removeIdx = -1;
 		for (int fi = 0; fi < (int)m_functions.size(); ++fi) {
 			auto& fd = m_functions[fi];
+			bool dirty = false;
 			ImGui::PushID(fi);
 
 			// Build header label: "r(t)" or "S(u,v)" etc.
@@ -2014,24 +4327,27 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 							ImGui::Text("Isovalue"); ImGui::SameLine();
 							ImGui::SetNextItemWidth(80);
 							dirty |= ImGui::DragFloat("##isovalue", &fd.isovalue, 0.01f, -100.0f, 100.0f);
+							ImGui::Text("Levels"); ImGui::SameLine();
+							ImGui::SetNextItemWidth(80);
+							dirty |= ImGui::SliderInt("##isolevels", &fd.isoLevelCount, 1, 8);
+							if (fd.isoLevelCount > 1) {
+								ImGui::SameLine();
+								ImGui::Text("Spacing"); ImGui::SameLine();
+								ImGui::SetNextItemWidth(80);
+								dirty |= ImGui::DragFloat("##isospacing", &fd.isoLevelSpacing, 0.01f, 0.001f, 100.0f);
+							}
+							if (n == 3) {
+								ImGui::Text("Grid"); ImGui::SameLine();
+								ImGui::SetNextItemWidth(80);
+								dirty |= ImGui::SliderInt("##isores", &fd.isoResolution, 8, 256);
+							}
 						}
 					}
 				}
 
 				// Reset name + param names when either dim changes
 				if (fd.inputDim != prevInputDim || fd.outputDim != prevOutputDim) {
-					int n = fd.inputDim, m = fd.outputDim;
-					// Function name
-					if      (n == 1 && m >= 2)              fd.name = "r";
-					else if (n == 2 && m == 3)              fd.name = "s";
-					else if (n == 3 && m >= 2)              fd.name = "F";
-					else                                    fd.name = "f";
-					// Variable names
-					if      (n == 1 && m >= 2)              { fd.paramNames[0] = "t";  fd.paramNames[1] = "";  fd.paramNames[2] = ""; }
-					else if (n == 1)                        { fd.paramNames[0] = "x";  fd.paramNames[1] = "";  fd.paramNames[2] = ""; }
-					else if (n == 2 && m == 3)              { fd.paramNames[0] = "u";  fd.paramNames[1] = "v"; fd.paramNames[2] = ""; }
-					else if (n == 2)                        { fd.paramNames[0] = "x";  fd.paramNames[1] = "y"; fd.paramNames[2] = ""; }
-					else                                    { fd.paramNames[0] = "x";  fd.paramNames[1] = "y"; fd.paramNames[2] = "z"; }
+					resetNames(fd);
 					// Clear expressions
 					for (int i = 0; i < 3; ++i) fd.exprStrings[i] = "";
 				}
@@ -2062,6 +4378,8 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 					ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 0.2f, 0.2f, 1));
 					ImGui::TextWrapped("%s", fd.errorMsg.c_str());
 					ImGui::PopStyleColor();
+				} else if (fd.pendingBuild) {
+					ImGui::TextDisabled("Updating...");
 				}
 
 				// Presets (loaded from resources/presets.json)
@@ -2097,6 +4415,11 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 					ImGui::Text("%s max", fd.paramNames[0].c_str());
 					dirty |= ImGui::DragFloatExpr("##p0max", &fd.rangeMax[0], 0.1f, -50.0f, 50.0f);
 					ImGui::Text("Segments"); ImGui::SameLine(); dirty |= ImGui::DragInt("##segments", &fd.resolution[0], 1.0f, 10, 500);
+					dirty |= ImGui::Checkbox("Adaptive sampling", &fd.adaptive);
+					if (fd.adaptive) {
+						ImGui::Text("Tolerance"); ImGui::SameLine();
+						dirty |= ImGui::SliderFloat("##adaptivetol", &fd.adaptiveTolerance, 1e-4f, 1e-2f, "%.4f", ImGuiSliderFlags_Logarithmic);
+					}
 					if (fd.outputDim != 2) {
 						ImGui::Text("Tube Radius"); ImGui::SameLine(); dirty |= ImGui::DragFloat("##tuberadius", &fd.tubeRadius, 0.001f, 0.005f, 0.2f);
 					}
@@ -2115,8 +4438,23 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 					dirty |= ImGui::DragFloatExpr("##p1min", &fd.rangeMin[1], 0.1f, -50.0f, 50.0f);
 					ImGui::Text("%s max", fd.paramNames[1].c_str());
 					dirty |= ImGui::DragFloatExpr("##p1max", &fd.rangeMax[1], 0.1f, -50.0f, 50.0f);
-					ImGui::Text("%s Res", fd.paramNames[0].c_str()); ImGui::SameLine(); dirty |= ImGui::DragInt("##p0res", &fd.resolution[0], 1.0f, 4, 300);
-					ImGui::Text("%s Res", fd.paramNames[1].c_str()); ImGui::SameLine(); dirty |= ImGui::DragInt("##p1res", &fd.resolution[1], 1.0f, 4, 300);
+					// The compute path handles much finer meshes than CPU generation
+					const int maxRes = fd.gpuEvaluate ? 2000 : 300;
+					ImGui::Text("%s Res", fd.paramNames[0].c_str()); ImGui::SameLine(); dirty |= ImGui::DragInt("##p0res", &fd.resolution[0], 1.0f, 4, maxRes);
+					ImGui::Text("%s Res", fd.paramNames[1].c_str()); ImGui::SameLine(); dirty |= ImGui::DragInt("##p1res", &fd.resolution[1], 1.0f, 4, maxRes);
+					if (ImGui::Checkbox("Evaluate on GPU", &fd.gpuEvaluate)) {
+						dirty = true;
+						fd.resolution[0] = std::min(fd.resolution[0], fd.gpuEvaluate ? 2000 : 300);
+						fd.resolution[1] = std::min(fd.resolution[1], fd.gpuEvaluate ? 2000 : 300);
+					}
+					dirty |= ImGui::Checkbox("Adaptive sampling", &fd.adaptive);
+					if (fd.adaptive) {
+						ImGui::Text("Tolerance"); ImGui::SameLine();
+						dirty |= ImGui::SliderFloat("##adaptivetol", &fd.adaptiveTolerance, 1e-4f, 1e-2f, "%.4f", ImGuiSliderFlags_Logarithmic);
+					}
+					if (fd.gpuEvaluate && !fd.gpuStatus.empty()) {
+						ImGui::TextDisabled("Using CPU: %s", fd.gpuStatus.c_str());
+					}
 				} else if (fd.inputDim == 3) {
 					ImGui::Text("%s Min", fd.paramNames[0].c_str());
 					dirty |= ImGui::DragFloatExpr("##p0min", &fd.rangeMin[0], 0.1f, -50.0f, 50.0f);
@@ -2140,6 +4478,20 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 				ImGui::Text("Opacity"); ImGui::SameLine();
 				dirty |= ImGui::SliderFloat("##opacity", &fd.opacity, 0.0f, 1.0f);
 
+				// Height colouring lives in FunctionUniforms, so none of this rebuilds the mesh
+				if (fd.surfaceColormapped) {
+					ImGui::Text("Colormap"); ImGui::SameLine();
+					ImGui::Combo("##colormap", &fd.colormap, GraphObjects::COLORMAP_NAMES, GraphObjects::COLORMAP_COUNT);
+					if (ImGui::Checkbox("Auto range##colormap", &fd.colormapAutoRange) && !fd.colormapAutoRange) {
+						fd.colormapRange[0] = fd.surfaceScalarRange[0];
+						fd.colormapRange[1] = fd.surfaceScalarRange[1];
+					}
+					if (!fd.colormapAutoRange) {
+						ImGui::Text("Range"); ImGui::SameLine();
+						ImGui::DragFloat2("##colormaprange", fd.colormapRange, 0.05f);
+					}
+				}
+
 				// ── Overlay options ──
 				ImGui::Separator();
 				ImGui::Text("Overlays:");
@@ -2188,6 +4540,28 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 					} else {
 						dirty |= ImGui::Checkbox("Vector Field", &fd.showVectorField);
 						dirty |= ImGui::Checkbox("Streamlines", &fd.showStreamlines);
+						if (fd.showStreamlines) {
+							ImGui::Indent();
+							dirty |= ImGui::Checkbox("Integrate on GPU", &fd.gpuStreamlines);
+							if (fd.gpuStreamlines) {
+								ImGui::Text("Seeds"); ImGui::SameLine();
+								dirty |= ImGui::DragInt("##flowseeds", &fd.flowStreamlineCount, 16.0f, 1, FlowCompute::MAX_STREAMLINES);
+							}
+							ImGui::Unindent();
+						}
+						dirty |= ImGui::Checkbox("Particles", &fd.showParticles);
+						if (fd.showParticles) {
+							ImGui::Indent();
+							ImGui::Text("Count"); ImGui::SameLine();
+							dirty |= ImGui::DragInt("##particlecount", &fd.particleCount, 100.0f, 1, FlowCompute::MAX_PARTICLES);
+							// Read every frame, no rebuild needed
+							ImGui::Text("Speed"); ImGui::SameLine();
+							ImGui::DragFloat("##particlespeed", &fd.particleSpeed, 0.01f, 0.0f, 10.0f);
+							ImGui::Unindent();
+						}
+						if (!fd.gpuFlowStatus.empty()) {
+							ImGui::TextDisabled("GPU flow unavailable: %s", fd.gpuFlowStatus.c_str());
+						}
 					}
 				}
 				if (fd.showTangentVectors || fd.showNormalVectors || fd.showFrenetFrame || fd.showGradientField || fd.showVectorField || fd.showStreamlines) {
@@ -2202,12 +4576,20 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 
 			ImGui::PopID();
 			ImGui::Separator();
+
+			// Only the edited function is recompiled and regenerated
+			if (dirty) {
+				compileFunctionDef(fd);
+				fd.dirty = true;
+				m_graphObjectsDirty = true;
+			}
 		}
 
 		// Remove function if requested
 		if (removeIdx >= 0 && removeIdx < (int)m_functions.size()) {
+			cancelGeometryBuild(m_functions[removeIdx]);
+			releaseFunctionGeometry(m_functions[removeIdx]);
 			m_functions.erase(m_functions.begin() + removeIdx);
-			dirty = true;
 		}
 
 		// Add function button
@@ -2224,20 +4606,12 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 			newFd.resolution[0] = 200;
 			compileFunctionDef(newFd);
 			m_functions.push_back(std::move(newFd));
-			dirty = true;
+			m_graphObjectsDirty = true;
 		}
 
 		ImGui::PopItemWidth();
 		ImGui::End(); // Visualization
 
-		// Recompile all expressions when dirty
-		if (dirty) {
-			for (auto& fd : m_functions) {
-				compileFunctionDef(fd);
-			}
-			m_graphObjectsDirty = true;
-		}
-
 		// ── Settings window ──
 		ImGui::Begin("Settings");
 		ImGui::PushItemWidth(150);
@@ -2269,6 +4643,14 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 		// ── Display ──
 		if (ImGui::CollapsingHeader("Display")) {
 			ImGui::Checkbox("Show Boat", &m_showBoat);
+			ImGui::Checkbox("Level of detail", &m_lodEnabled);
+			ImGui::Checkbox("Frustum culling", &m_cullingEnabled);
+			if (m_cullingEnabled) {
+				ImGui::SameLine();
+				ImGui::TextDisabled("(%d culled)", m_culledDraws);
+			}
+			ImGui::TextDisabled("%d render bundles, %d re-recorded", (int)(m_sceneBundles.size() + m_transparentSceneBundles.size()), m_bundlesRecorded);
+			ImGui::Checkbox("Profiler", &m_showProfiler);
 		}
 
 		ImGui::Separator();
@@ -2284,6 +4666,18 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 			ImGui::Text("K Specular"); ImGui::SameLine(); lightingChanged |= ImGui::DragFloat("##kspecular", &m_lightingUniforms.ks, 0.01f, 0.0f, 1.0f);
 		}
 
+		ImGui::Separator();
+
+		// ── Session ──
+		if (ImGui::CollapsingHeader("Session")) {
+			ImGui::Text("File"); ImGui::SameLine(); ImGui::InputText("##sessionpath", &m_sessionPath);
+			ImGui::Checkbox("Include meshes", &m_sessionIncludeMeshes);
+			if (ImGui::Button("Save")) saveSession(m_sessionPath, m_sessionIncludeMeshes);
+			ImGui::SameLine();
+			if (ImGui::Button("Open")) openSession(m_sessionPath);
+			if (!m_sessionStatus.empty()) ImGui::TextDisabled("%s", m_sessionStatus.c_str());
+		}
+
 		ImGui::PopItemWidth();
 		ImGui::End(); // Settings
 
@@ -2383,6 +4777,8 @@ void Application::updateGui(WGPURenderPassEncoder renderPass) {
 		}
 	}
 
+	if (m_showProfiler) drawProfilerWindow();
+
 	// Draw the UI
 	ImGui::EndFrame();
 	// Convert the UI defined above into low-level drawing commands
@@ -32,11 +32,19 @@
 #include <array>
 #include "webgpu-utils.h"
 #include "ExpressionParser.h"
+#include "ResourceManager.h"
+#include "SurfaceCompute.h"
+#include "FlowCompute.h"
+#include "Heightfield.h"
+#include "GpuBufferPool.h"
+#include "GraphObjects.h"
+#include <atomic>
 #include <memory>
 #include <unordered_map>
 #include <string>
 #include <functional>
 #include <deque>
+#include <filesystem>
 #include <vector>
 #include <utility>
 
@@ -49,6 +57,30 @@ struct Preset {
 
 // Forward declare
 struct GLFWwindow;
+struct GeometryTask;
+
+// A piece of a mesh too large for one buffer, with its own slices; drawn whole at full detail
+struct MeshPart {
+	GpuBufferPool::Slice vertices;
+	GpuBufferPool::Slice indices;
+	uint32_t indexCount = 0;
+};
+
+// Independently cached parts of a function's geometry, each rebuilt only when its own inputs change.
+// The base stage is the surface, tube, lines and cubes; every arrow overlay is a stage of its own,
+// so moving the Frenet frame re-samples one point instead of the whole curve.
+enum GeometryStage {
+	STAGE_BASE,
+	STAGE_TANGENTS,
+	STAGE_NORMALS,
+	STAGE_FRENET,
+	STAGE_GRADIENT,
+	STAGE_VECTOR_FIELD,
+	STAGE_COUNT
+};
+using StageKeys = std::array<uint64_t, STAGE_COUNT>;
+constexpr uint32_t ALL_STAGES = (1u << STAGE_COUNT) - 1;
+constexpr uint32_t ARROW_STAGES = ALL_STAGES & ~(1u << STAGE_BASE);
 
 // Generalized R^n -> R^m function definition
 struct FunctionDefinition {
@@ -58,6 +90,7 @@ struct FunctionDefinition {
 	std::string paramNames[3] = {"t","",""};
 	std::string exprStrings[3] = {"cos(t)","sin(t)","t/(2*pi)"};
 	ExpressionParser parsers[3];
+	FusedExpression fused;               // parsers[0..outputDim) as one program, when they fuse
 	bool isValid = false;
 	std::string errorMsg;
 	bool show = true;
@@ -70,6 +103,19 @@ struct FunctionDefinition {
 	float arrowScale = 0.3f;
 	int vfResolution = 5;
 	int curvePlane = 0;                  // For R^1->R^2 curves: 0=xy, 1=xz, 2=yz
+	bool adaptive = false;               // curve tubes and filled surfaces: refine where the shape bends
+	float adaptiveTolerance = 1e-3f;     // allowed deviation, relative to the bounding box diagonal
+	// Scalar functions (m=1, n>=2): draw the level sets f = isovalue + k * isoLevelSpacing, k < isoLevelCount,
+	// as isolines (n=2) or isosurfaces (n=3) instead of the height surface or the cube glyphs
+	bool renderImplicit = false;
+	float isovalue = 0.0f;
+	int isoLevelCount = 1;
+	float isoLevelSpacing = 0.5f;
+	int isoResolution = 64;              // n=3: samples per axis of the extraction grid
+	// Filled surfaces colour by height through the colormap texture; these only change FunctionUniforms
+	int colormap = 0;                    // row of GraphObjects::colormapTexels
+	bool colormapAutoRange = true;       // span the uploaded surface's own heights
+	float colormapRange[2] = {0.0f, 1.0f};
 
 	// Overlay options
 	bool wireframe = false;           // surfaces (n=2) and curves (n=1): render as wireframe/lines
@@ -84,12 +130,117 @@ struct FunctionDefinition {
 	bool showStreamlines = false;     // vector fields (n=3, m>=2): show streamlines
 	int overlayVectorCount = 10;      // how many tangent/normal arrows to show
 	float overlayVectorScale = 0.3f;  // scale of overlay arrows
+
+	// Surfaces (n=2): evaluate the filled mesh in a compute shader instead of on the CPU
+	bool gpuEvaluate = false;
+	std::string gpuStatus;            // why the GPU path fell back to the CPU, empty while it's active
+	std::unique_ptr<SurfaceCompute> gpuSurface;  // TriangleList, "surface" pipeline; null when not in use
+
+	// Vector fields (n=3, m>=2): integrate in a compute shader, with many more seeds than the CPU traces
+	bool gpuStreamlines = false;
+	int flowStreamlineCount = 4096;   // seeds spread through the whole box
+	bool showParticles = false;       // particles carried by the field, advected every frame
+	int particleCount = 20000;
+	float particleSpeed = 1.0f;       // field units travelled per second at unit speed
+	std::string gpuFlowStatus;        // why the GPU streamlines or particles are unavailable
+	std::unique_ptr<FlowCompute> gpuFlow;  // LineLists, "lines" pipeline; null when neither is in use
+
+	// Cached GPU geometry, regenerated stage by stage when stageKeys change
+	bool dirty = true;                // set by the GUI when any setting of this function changed
+	StageKeys stageKeys = {};         // hash of everything each uploaded stage was built from, 0 for none
+	// Arrows of each stage, kept so that rebuilding one overlay reuses the others
+	std::array<std::vector<GlyphInstance>, STAGE_COUNT> stageArrows;
+	bool surfaceTinted = false;       // surface vertices are white, tinted by color in FunctionUniforms
+	// R^2 -> R^1 surfaces: heights for the "heightfield" pipeline, drawn in place of surfaceBuffer.
+	// Null unless the base stage is one; kept across rebuilds so a new range rewrites it in place.
+	std::unique_ptr<Heightfield> heightfield;
+	// Application::m_bundleGeneration when any object the function's bundles bind was last replaced
+	uint64_t bundleGeneration = 0;
+	// Slices of Application::m_geometryPool
+	GpuBufferPool::Slice surfaceBuffer;  // PackedVertex TriangleList, "surface" pipeline
+	GpuBufferPool::Slice surfaceIndexBuffer;
+	int surfaceVertexCount = 0;
+	int surfaceIndexCount = 0;
+	// LOD chain packed after the full-detail indices: level l is surfaceLodCount[l] indices from surfaceLodFirst[l]
+	int surfaceLodLevels = 0;
+	uint32_t surfaceLodFirst[GraphObjects::LOD_LEVELS] = {};
+	uint32_t surfaceLodCount[GraphObjects::LOD_LEVELS] = {};
+	float surfaceEdgeLength = 0.0f;             // mean longest triangle edge at full detail
+	int surfaceLod = 0;                         // level picked by updateSurfaceLods, drawn this frame
+	bool surfaceColormapped = false;            // vertices carry their height instead of a colour
+	float surfaceScalarRange[2] = {0.0f, 0.0f}; // heights spanned by the finite vertices
+	// Pieces that did not fit in the first slices above; a split surface has no LOD chain
+	std::vector<MeshPart> surfaceParts;
+	GpuBufferPool::Slice lineBuffer;     // LineList, "lines" pipeline
+	GpuBufferPool::Slice lineIndexBuffer;
+	int lineVertexCount = 0;
+	int lineIndexCount = 0;
+	std::vector<MeshPart> lineParts;
+	GpuBufferPool::Slice arrowInstanceBuffer;  // GlyphInstance per arrow, "glyph" pipeline
+	int arrowInstanceCount = 0;
+	GpuBufferPool::Slice cubeInstanceBuffer;   // GlyphInstance per scalar field sample
+	int cubeInstanceCount = 0;
+	// World-space boxes of the uploaded geometry, tested against the view frustum every frame
+	Aabb surfaceBounds, lineBounds, arrowBounds, cubeBounds;
+
+	// Background rebuild in flight; the buffers above keep being drawn until it lands
+	std::shared_ptr<GeometryTask> pendingBuild;
+};
+
+// CPU-side geometry of one function, ready to upload
+struct FunctionGeometry {
+	IndexedMesh surfaceMesh;              // TriangleList, lit "surface" pipeline
+	IndexedMesh lineMesh;                 // LineList, unlit "axes" pipeline (wireframe overlays)
+	// Instances of the shared arrow mesh ("glyph" pipeline), per stage
+	std::array<std::vector<GlyphInstance>, STAGE_COUNT> arrows;
+	std::vector<GlyphInstance> cubes;     // instances of the shared cube mesh
+
+	// Filled in on the worker once the generators are done, which also frees the meshes' vertices
+	std::vector<PackedVertex> surfaceVertices;  // surfaceMesh.vertices, as uploaded
+	std::vector<PackedVertex> lineVertices;
+	// Left empty for meshes over STREAMED_UPLOAD_SIZE, whose vertices are packed straight into staging memory
+	Aabb surfaceBounds, lineBounds, cubeBounds;
+	float surfaceEdgeLength = 0.0f;       // mean longest triangle edge of surfaceMesh
+	// surfaceMesh.indices then holds every LOD level back to back, as FunctionDefinition does
+	int surfaceLodLevels = 0;
+	uint32_t surfaceLodFirst[GraphObjects::LOD_LEVELS] = {};
+	uint32_t surfaceLodCount[GraphObjects::LOD_LEVELS] = {};
+	bool surfaceColormapped = false;      // set by the generators: surfaceVertices hold heights, not colours
+	float surfaceScalarRange[2] = {0.0f, 0.0f};
+	bool surfaceTinted = false;
+	// Heightfield surfaces leave surfaceMesh empty: heights of a heightfieldSize[0] x heightfieldSize[1]
+	// grid over heightfieldRange (uMin, uMax, vMin, vMax), u fastest. The LOD fields above count vertices.
+	std::vector<float> heightfield;
+	int heightfieldSize[2] = {0, 0};
+	float heightfieldRange[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// One background geometry build. The task owns a snapshot of the function with its own
+// parsers, so the worker never reads the live definition the GUI is editing.
+struct GeometryTask {
+	FunctionDefinition snapshot;
+	StageKeys keys = {};                  // functionStageKeys of the snapshot
+	uint32_t stages = 0;                  // bit per GeometryStage to build; the others are left as they are
+	bool filledSurfaceOnGpu = false;
+	bool streamlinesOnGpu = false;
+	std::atomic<bool> cancelled{false};   // superseded; evaluation short-circuits and the result is dropped
+	std::atomic<bool> finished{false};    // result is complete
+	FunctionGeometry result;
+};
+
+// A render bundle and the commands it was recorded from, as words: an opcode, then its
+// arguments. The words are also the cache key, since equal lists record equal bundles.
+struct DrawBundle {
+	WGPURenderBundle bundle = nullptr;
+	std::vector<uint64_t> commands;
 };
 
 class Application {
 public:
 	// A function called only once at the beginning. Returns false is init failed.
 	bool onInit();
+	// Without a window: the scene is drawn into an offscreen texture of this size instead of the swap chain
+	bool onInitHeadless(uint32_t width, uint32_t height);
 
 	// A function called at each frame, guaranteed never to be called before `onInit`.
 	void onFrame();
@@ -108,6 +259,16 @@ public:
 	void onMouseButton(int button, int action, int mods);
 	void onScroll(double xoffset, double yoffset);
 
+	// Headless batch, after onInitHeadless: one PNG per item. An item is a presets.json name (or
+	// "n_m/name"), an inline "name(params)=expr;expr;expr@min:max,min:max" or a .graph session.
+	struct BatchOptions {
+		std::vector<std::string> items;
+		std::string outputDir = ".";
+		int framesInFlight = 3;      // images drawn ahead of the oldest readback
+		bool fitView = true;         // orbit distance framing each image's geometry
+	};
+	bool renderBatch(const BatchOptions& options);
+
 	WGPUSupportedLimits m_supported_limits;
 	WGPURequiredLimits m_current_limits;
 
@@ -116,34 +277,97 @@ private:
 	bool initWindowAndDevice();
 	void terminateWindowAndDevice();
 
-	// Init swap chain
+	// Init swap chain, or the offscreen target when headless
 	bool initSwapChain();
 	void terminateSwapChain();
+	void framebufferSize(int& width, int& height) const;  // of the window, or of the offscreen target
 
 	//Init depth buffer
 	bool initDepthBuffer();
 	void terminateDepthBuffer();
 
+	// Order-independent transparency: the screen-sized targets (with the depth buffer) and the
+	// pipeline that composites them over the scene
+	bool initOitTargets();
+	void terminateOitTargets();
+	bool initOitComposite();
+	void terminateOitComposite();
+
 	// Init Boat Render Pipeline
-	bool initRenderPipeline(const std::string& pipelineName, const std::string& shaderFileName, WGPUPrimitiveTopology topology);
+	// instanced adds a per-instance GlyphInstance buffer in slot 1
+	// packed pipelines read PackedVertex instead of VertexAttributes, plus a FunctionUniforms block at group 1
+	// transparent pipelines run fs_oit into the OIT targets, testing depth without writing it
+	// heightfield pipelines run vs_heightfield with no vertex buffer, a Heightfield bound at group 2
+	bool initRenderPipeline(const std::string& pipelineName, const std::string& shaderFileName, WGPUPrimitiveTopology topology, bool instanced = false, bool packed = false, bool transparent = false, bool heightfield = false);
+	struct PipelineRecipe;
+	WGPURenderPipeline createRenderPipeline(const PipelineRecipe& recipe, WGPUShaderModule module);
 	void terminateRenderPipeline(const std::string& pipelineName);
 	void terminateRenderPipelines();
+	// Look the scene pipelines up by name once, after they are all created
+	void resolveScenePipelines();
+	// Hot reload: every pipeline of a WGSL file that changed on disk is created again from its recipe.
+	// A file that fails to compile leaves the previous pipelines in place; geometry is never touched.
+	void reloadChangedShaders();
+	bool reloadShader(const std::string& shaderFileName);
 
 
 	// Init texture
 	bool initTexture();
 	void terminateTexture();
 
+	// Colormap lookup texture, bound in place of the boat texture for function surfaces
+	bool initColormapTexture();
+	void terminateColormapTexture();
+
 	// Boat
 	bool initGeometry();
 	void terminateGeometry();
 
-	bool initArrowGeometry(float length, float headLength, float headAngle);
+	// Unit arrow and cube meshes shared by every glyph instance
+	bool initGlyphGeometry();
+	void terminateGlyphGeometry();
 
 	// Graph objects (parametric curves, surfaces, vector fields)
 	bool initGraphObjects();
 	void terminateGraphObjects();
 	void updateGraphObjects();
+	// Runs on a worker thread: reads only fd, which is a task's private snapshot
+	static void buildFunctionGeometry(const FunctionDefinition& fd, bool filledSurfaceOnGpu, bool streamlinesOnGpu,
+		uint32_t stages, const std::atomic<bool>* cancelled, FunctionGeometry& out);
+	// Start rebuilding the stages of fd whose settings changed since their upload; clears fd.dirty
+	void scheduleFunctionGeometry(FunctionDefinition& fd);
+	void submitGeometryBuild(FunctionDefinition& fd, const StageKeys& keys, uint32_t stages);
+	void collectGeometryBuilds();
+	void cancelGeometryBuild(FunctionDefinition& fd, bool wait = false);
+	// Replace the buffers of the given stages; the arrows are taken out of geometry
+	void uploadFunctionGeometry(FunctionDefinition& fd, uint32_t stages, FunctionGeometry& geometry);
+	// One part holding every index, or several holding the first splitCount once the mesh outgrows a slice.
+	// Vertices come from packed, or are packed from raw chunk by chunk when packed is empty.
+	std::vector<MeshPart> uploadMeshParts(const std::vector<PackedVertex>& packed,
+		const std::vector<ResourceManager::VertexAttributes>& raw, bool heightScalar,
+		const std::vector<uint32_t>& indices, size_t splitCount, int primitiveSize);
+	void releaseFunctionGeometry(FunctionDefinition& fd, uint32_t stages = ALL_STAGES);
+	bool updateGpuSurface(FunctionDefinition& fd);
+	bool updateGpuFlow(FunctionDefinition& fd);
+	// Pick each function's LOD level from the projected size of its triangles
+	void updateSurfaceLods();
+	// Bounds, edge length and packed vertices, computed on the worker after the generators
+	static void finishFunctionGeometry(FunctionGeometry& geometry);
+
+	// Frustum culling and indirect draws
+	void updateFrustum();
+	bool isVisible(const Aabb& box) const;
+	void writeDrawCommands();
+	// Scene and transparency passes into target, as recorded by updateDrawBundles
+	void encodeScene(WGPUCommandEncoder encoder, WGPUTextureView target);
+	// Colormap range and row per function, into m_functionUniformBuffer
+	void writeFunctionUniforms();
+
+	// Render bundles for the scene pass, re-recorded only when their commands change
+	void updateDrawBundles();
+	void recordDrawBundle(DrawBundle& bundle, const char* label);
+	void terminateDrawBundles();
+	WGPUBuffer createBuffer(const void* data, size_t size, WGPUBufferUsageFlags usage);
 
 	// Compile all expressions in a FunctionDefinition
 	void compileFunctionDef(FunctionDefinition& fd);
@@ -176,7 +400,16 @@ private:
 	bool initGui(); // called in onInit
 	void terminateGui(); // called in onFinish
 	void updateGui(WGPURenderPassEncoder renderPass); // called in onFrame
+	void drawProfilerWindow(); // called in updateGui
 	void loadPresets();
+	// Sessions (SessionFile): the function list, and optionally its meshes so that opening skips their rebuild
+	bool saveSession(const std::string& path, bool includeMeshes);
+	bool openSession(const std::string& path);
+	// Headless batch helpers
+	bool parseBatchItem(const std::string& item, std::deque<FunctionDefinition>& functions, std::string& label,
+		std::string& errorMsg);
+	void fitViewToFunctions();
+	void pollDevice();  // delivers map and work-done callbacks without a frame loop
 
 private:
 	// (Just aliases to make notations lighter)
@@ -213,6 +446,16 @@ private:
 	};
 	static_assert(sizeof(LightingUniforms) % 16 == 0);
 
+	// Per-function block of the packed pipelines, at offset f * FUNCTION_UNIFORM_STRIDE
+	struct FunctionUniforms {
+		float scalarMin = 0.0f;      // colormap range of the vertex scalar
+		float scalarMax = 0.0f;
+		float colormapRow = 0.0f;    // texture v of the selected map's row
+		uint32_t colormapped = 0;    // 0: the colour word is RGBA8
+		vec4 tint = vec4(1.0f);      // rgb multiplies the base colour, so a recolour needs no rebuild; a is opacity
+	};
+	static_assert(sizeof(FunctionUniforms) % 16 == 0);
+
 	struct CameraState {
 		// angles.x is the rotation of the camera around the global vertical axis, affected by mouse.x
 		// angles.y is the rotation of the camera around its local horizontal axis, affected by mouse.y
@@ -255,13 +498,61 @@ private:
 	// Swap Chain
 	WGPUSwapChain m_swapChain = nullptr;
 
+	// Headless target in its place, read back after each image
+	bool m_headless = false;
+	uint32_t m_headlessWidth = 0;
+	uint32_t m_headlessHeight = 0;
+	WGPUTexture m_offscreenTexture = nullptr;
+	WGPUTextureView m_offscreenView = nullptr;
+
 	// Depth Buffer
 	WGPUTextureFormat m_depthTextureFormat = WGPUTextureFormat_Depth24Plus;
 	WGPUTexture m_depthTexture = nullptr;
 	WGPUTextureView m_depthTextureView = nullptr;
 
-	std::unordered_map<std::string, WGPUShaderModule> m_shaderModuleMap;
+	// Weighted-blended OIT. Functions with opacity below 1 sum into the accumulation target and
+	// multiply the revealage target down after the opaque scene, then one full-screen draw blends
+	// the average colour over it. No sorting, and the cost is the same for any overlap.
+	static constexpr WGPUTextureFormat OIT_ACCUM_FORMAT = WGPUTextureFormat_RGBA16Float;
+	static constexpr WGPUTextureFormat OIT_REVEALAGE_FORMAT = WGPUTextureFormat_R8Unorm;
+	WGPUTexture m_oitAccumTexture = nullptr;
+	WGPUTextureView m_oitAccumView = nullptr;
+	WGPUTexture m_oitRevealageTexture = nullptr;
+	WGPUTextureView m_oitRevealageView = nullptr;
+	WGPUShaderModule m_oitCompositeModule = nullptr;
+	WGPUBindGroupLayout m_oitBindGroupLayout = nullptr;
+	WGPURenderPipeline m_oitCompositePipeline = nullptr;
+	WGPUBindGroup m_oitBindGroup = nullptr;        // both targets, recreated with them
+
+	std::unordered_map<std::string, WGPUShaderModule> m_shaderModuleMap;  // by WGSL file, shared by its pipelines
 	std::unordered_map<std::string, WGPURenderPipeline> m_pipelines;
+	// The arguments of initRenderPipeline for each entry of m_pipelines, to create it again on reload
+	struct PipelineRecipe {
+		std::string shaderFileName;
+		WGPUPrimitiveTopology topology = WGPUPrimitiveTopology_TriangleList;
+		bool instanced = false;
+		bool packed = false;
+		bool transparent = false;
+		bool heightfield = false;
+	};
+	std::unordered_map<std::string, PipelineRecipe> m_pipelineRecipes;
+	// Modification times of the WGSL files behind m_pipelines, polled by reloadChangedShaders
+	static constexpr double SHADER_POLL_INTERVAL = 0.25;  // seconds
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_shaderFileTimes;
+	double m_lastShaderPoll = 0.0;
+	std::string m_shaderStatus;  // last reload or compile error, shown in the Profiler window
+	// The entries of m_pipelines drawn every frame, without the string lookups
+	struct ScenePipelines {
+		WGPURenderPipeline boat = nullptr;
+		WGPURenderPipeline axes = nullptr;
+		WGPURenderPipeline surface = nullptr;
+		WGPURenderPipeline lines = nullptr;
+		WGPURenderPipeline glyph = nullptr;
+		WGPURenderPipeline surfaceOit = nullptr;
+		WGPURenderPipeline heightfield = nullptr;
+		WGPURenderPipeline heightfieldOit = nullptr;
+	};
+	ScenePipelines m_scenePipelines;
 
 
 	// Render Pipeline
@@ -272,6 +563,8 @@ private:
 	WGPUSampler m_sampler = nullptr;
 	WGPUTexture m_texture = nullptr;
 	WGPUTextureView m_textureView = nullptr;
+	WGPUTexture m_colormapTexture = nullptr;
+	WGPUTextureView m_colormapTextureView = nullptr;
 
 	// Geometry
 	WGPUBuffer m_vertexBuffer = nullptr;
@@ -282,19 +575,25 @@ private:
 
 	WGPUBuffer m_arrowVertexBuffer = nullptr;
 	int m_arrowVertexCount = 0;
+	WGPUBuffer m_cubeVertexBuffer = nullptr;
+	int m_cubeVertexCount = 0;
 
 	// Uniforms
 	WGPUBuffer m_uniformBuffer = nullptr;
 	MyUniforms m_uniforms;
+	float m_previousTime = 0.0f;  // m_uniforms.time of the last frame, for the particle step
 	WGPUBuffer m_lightingUniformBuffer = nullptr;
 	LightingUniforms m_lightingUniforms;
 	bool m_lightingUniformsChanged = true;
 
 	// Bind Group Layout
 	WGPUBindGroupLayout m_bindGroupLayout = nullptr;
+	WGPUBindGroupLayout m_functionBindGroupLayout = nullptr;
+	WGPUBindGroupLayout m_heightfieldBindGroupLayout = nullptr;
 
 	// Bind Group
 	WGPUBindGroup m_bindGroup = nullptr;
+	WGPUBindGroup m_colormapBindGroup = nullptr;   // m_bindGroup with the colormap texture at binding 1
 
 	CameraState m_cameraState;
 	DragState m_drag;
@@ -304,23 +603,62 @@ private:
 	float m_nearPlane;
 	float m_farPlane;
 
-	// Graph objects buffers
-	WGPUBuffer m_surfaceVertexBuffer = nullptr;
-	int m_surfaceVertexCount = 0;
-	WGPUBuffer m_curveVertexBuffer = nullptr;
-	int m_curveVertexCount = 0;
+	// Graph objects: buffers live in each FunctionDefinition, this flags that at least one is dirty
 	bool m_graphObjectsDirty = true;
 
-	// Deferred buffer destruction (wait N frames before destroying)
-	static constexpr int BUFFER_RELEASE_DELAY = 5;  // Increased from 3 to reduce crashes
-	std::vector<std::pair<WGPUBuffer, int>> m_pendingBufferReleases;
+	// Function geometry is suballocated here; freed ranges are reused once the GPU has finished with them
+	static constexpr uint64_t GEOMETRY_POOL_PAGE_SIZE = 16 << 20;
+	// Meshes whose packed vertices exceed this skip the CPU-side packed copy
+	static constexpr uint64_t STREAMED_UPLOAD_SIZE = 64ull << 20;
+	GpuBufferPool m_geometryPool;
 	int m_framesSinceLastUpdate = 0;  // Throttle geometry updates
-	void deferBufferRelease(WGPUBuffer buffer);
-	void processPendingReleases();
+
+	// Coarser levels are drawn while their triangle edges stay under this many pixels on screen
+	static constexpr float LOD_MAX_EDGE_PIXELS = 6.0f;
+	bool m_lodEnabled = true;
+
+	// World-space frustum planes (xyz = inward normal, w = offset), from projection * view * model
+	std::array<glm::vec4, 6> m_frustumPlanes = {};
+	bool m_cullingEnabled = true;
+	// Indirect arguments, DRAW_SLOTS_PER_FUNCTION slots per function: surface, lines, arrows, cubes.
+	// A culled object gets instanceCount 0, so a compute pass could take over culling later.
+	static constexpr int DRAW_SLOTS_PER_FUNCTION = 4;
+	static constexpr uint64_t DRAW_SLOT_SIZE = 5 * sizeof(uint32_t);  // DrawIndexedIndirect layout
+	WGPUBuffer m_drawArgsBuffer = nullptr;
+	size_t m_drawArgsCapacity = 0;  // in functions
+	std::vector<uint32_t> m_drawArgs;  // CPU copy of this frame's arguments
+	int m_culledDraws = 0;          // last frame, for the stats line
+	// FunctionUniforms per function, sized with the draw arguments; only changed blocks are rewritten
+	static constexpr uint64_t FUNCTION_UNIFORM_STRIDE = 256;  // the largest minUniformBufferOffsetAlignment
+	WGPUBuffer m_functionUniformBuffer = nullptr;
+	WGPUBindGroup m_functionBindGroup = nullptr;
+	std::vector<FunctionUniforms> m_functionUniforms;  // as last written
+	// Scene draws as render bundles: the boat and axes, then one per function. Culling and LOD
+	// only change the indirect arguments, so a bundle lives until its buffers or pipelines do.
+	// Translucent surfaces go in a second bundle per function, for the OIT pass.
+	DrawBundle m_axesBundle;
+	// Bumped whenever a bound object is replaced: handle values alone cannot tell, as a new object
+	// may be allocated where a released one was. m_sceneGeneration covers the shared objects.
+	uint64_t m_bundleGeneration = 0;
+	uint64_t m_sceneGeneration = 0;
+	std::vector<DrawBundle> m_functionBundles;
+	std::vector<DrawBundle> m_transparentBundles;
+	std::vector<WGPURenderBundle> m_sceneBundles;        // this frame's, in draw order
+	std::vector<WGPURenderBundle> m_transparentSceneBundles;
+	int m_bundlesRecorded = 0;                     // last frame, for the stats line
 
 	// Boat visibility
 	bool m_showBoat = false;
 
+	// Profiler window; the trace is written next to the working directory
+	bool m_showProfiler = false;
+	std::string m_traceStatus;
+
+	// Session file of the Settings window, relative to the working directory like the trace
+	std::string m_sessionPath = "session.graph";
+	bool m_sessionIncludeMeshes = true;
+	std::string m_sessionStatus;
+
 	// Function definitions (generalized R^n -> R^m)
 	std::deque<FunctionDefinition> m_functions;
 
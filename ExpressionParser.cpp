@@ -1,6 +1,66 @@
 #include "ExpressionParser.h"
+#include "SimdMath.h"
 #include "tinyexpr/tinyexpr.h"
 #include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+// Samples processed per pass over the bytecode
+static constexpr size_t BATCH_CHUNK = 256;
+
+// tinyexpr reads variables through pointers into m_vars, so the tree-walk fallback
+// is the one evaluation path that can't run concurrently
+static std::mutex& treeWalkMutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+// tinyexpr's private node type for folded constants (TE_CONSTANT in tinyexpr.c)
+static constexpr int TE_CONSTANT_TYPE = 1;
+
+using Fn1 = double (*)(double);
+using Fn2 = double (*)(double, double);
+
+// tinyexpr's arithmetic operators are static in tinyexpr.c, so recover their
+// addresses once by compiling tiny probe expressions.
+struct OperatorTable {
+	const void* add = nullptr;
+	const void* sub = nullptr;
+	const void* mul = nullptr;
+	const void* divide = nullptr;
+	const void* negate = nullptr;
+	const void* comma = nullptr;
+};
+
+static const OperatorTable& operatorTable() {
+	static const OperatorTable table = [] {
+		OperatorTable t;
+		double x = 0.0, y = 0.0;
+		te_variable vars[2] = {
+			{"x", &x, TE_VARIABLE, nullptr},
+			{"y", &y, TE_VARIABLE, nullptr},
+		};
+		auto probe = [&vars](const char* expr) -> const void* {
+			int error = 0;
+			te_expr* e = te_compile(expr, vars, 2, &error);
+			const void* fn = e ? e->function : nullptr;
+			te_free(e);
+			return fn;
+		};
+		t.add = probe("x+y");
+		t.sub = probe("x-y");
+		t.mul = probe("x*y");
+		t.divide = probe("x/y");
+		t.negate = probe("-x");
+		t.comma = probe("x,y");
+		return t;
+	}();
+	return table;
+}
 
 ExpressionParser::ExpressionParser() {}
 
@@ -9,8 +69,10 @@ ExpressionParser::~ExpressionParser() {
 }
 
 ExpressionParser::ExpressionParser(ExpressionParser&& other) noexcept
-	: m_expr(other.m_expr), m_vars(std::move(other.m_vars)), m_names(std::move(other.m_names)) {
+	: m_expr(other.m_expr), m_vars(std::move(other.m_vars)), m_names(std::move(other.m_names)),
+	  m_program(std::move(other.m_program)), m_derivatives(std::move(other.m_derivatives)) {
 	other.m_expr = nullptr;
+	other.clearProgram();
 }
 
 ExpressionParser& ExpressionParser::operator=(ExpressionParser&& other) noexcept {
@@ -19,7 +81,10 @@ ExpressionParser& ExpressionParser::operator=(ExpressionParser&& other) noexcept
 		m_expr = other.m_expr;
 		m_vars = std::move(other.m_vars);
 		m_names = std::move(other.m_names);
+		m_program = std::move(other.m_program);
+		m_derivatives = std::move(other.m_derivatives);
 		other.m_expr = nullptr;
+		other.clearProgram();
 	}
 	return *this;
 }
@@ -29,6 +94,13 @@ void ExpressionParser::free() {
 		te_free(m_expr);
 		m_expr = nullptr;
 	}
+	clearProgram();
+}
+
+void ExpressionParser::clearProgram() {
+	m_program = Program();
+	m_derivatives = Program();
+	m_emitFailed = false;
 }
 
 bool ExpressionParser::compile(const std::string& expr, const std::vector<std::string>& varNames, std::string& errorMsg) {
@@ -55,6 +127,13 @@ bool ExpressionParser::compile(const std::string& expr, const std::vector<std::s
 		return false;
 	}
 
+	// Lower the tree to bytecode; if it uses something we can't express, keep the tree walk
+	if (!buildProgram()) {
+		clearProgram();
+	} else if (!buildDerivatives()) {
+		m_derivatives = Program();
+	}
+
 	errorMsg.clear();
 	return true;
 }
@@ -69,3 +148,793 @@ double ExpressionParser::evaluate(const double* values) {
 
 	return te_eval(m_expr);
 }
+
+// ─── Bytecode ────────────────────────────────────────────────────────────────
+
+bool ExpressionParser::buildProgram() {
+	m_emitFailed = false;
+	uint16_t result = emitNode(m_expr, 0);
+	if (m_emitFailed || result == NO_REGISTER) return false;
+
+	// Constants are appended while emitting, so temporaries only get absolute
+	// register numbers once the whole tree is done
+	const uint16_t base = static_cast<uint16_t>(m_vars.size() + m_program.constants.size());
+	auto fix = [base](uint16_t& reg) {
+		if (reg & TEMP_FLAG) reg = base + (reg & ~TEMP_FLAG);
+	};
+	for (auto& in : m_program.code) {
+		fix(in.dst);
+		fix(in.a);
+		fix(in.b);
+	}
+	fix(result);
+	m_program.outputs = { result };
+	return true;
+}
+
+// Bytecode operation for a tinyexpr function pointer; Call1/Call2 if there is no dedicated opcode
+ExpressionParser::OpCode ExpressionParser::opcodeFor(const void* f, int arity) {
+	const OperatorTable& ops = operatorTable();
+	if (arity == 2) {
+		if (f == ops.add)                                    return OpCode::Add;
+		if (f == ops.sub)                                    return OpCode::Sub;
+		if (f == ops.mul)                                    return OpCode::Mul;
+		if (f == ops.divide)                                 return OpCode::Div;
+		if (f == (const void*)static_cast<Fn2>(std::pow))   return OpCode::Pow;
+		if (f == (const void*)static_cast<Fn2>(std::fmod))  return OpCode::Mod;
+		if (f == (const void*)static_cast<Fn2>(std::atan2)) return OpCode::Atan2;
+		return OpCode::Call2;
+	}
+	if (f == ops.negate)                                 return OpCode::Neg;
+	if (f == (const void*)static_cast<Fn1>(std::fabs))  return OpCode::Abs;
+	if (f == (const void*)static_cast<Fn1>(std::sqrt))  return OpCode::Sqrt;
+	if (f == (const void*)static_cast<Fn1>(std::exp))   return OpCode::Exp;
+	if (f == (const void*)static_cast<Fn1>(std::log))   return OpCode::Log;
+	if (f == (const void*)static_cast<Fn1>(std::log10)) return OpCode::Log10;
+	if (f == (const void*)static_cast<Fn1>(std::sin))   return OpCode::Sin;
+	if (f == (const void*)static_cast<Fn1>(std::cos))   return OpCode::Cos;
+	if (f == (const void*)static_cast<Fn1>(std::tan))   return OpCode::Tan;
+	if (f == (const void*)static_cast<Fn1>(std::asin))  return OpCode::Asin;
+	if (f == (const void*)static_cast<Fn1>(std::acos))  return OpCode::Acos;
+	if (f == (const void*)static_cast<Fn1>(std::atan))  return OpCode::Atan;
+	if (f == (const void*)static_cast<Fn1>(std::sinh))  return OpCode::Sinh;
+	if (f == (const void*)static_cast<Fn1>(std::cosh))  return OpCode::Cosh;
+	if (f == (const void*)static_cast<Fn1>(std::tanh))  return OpCode::Tanh;
+	if (f == (const void*)static_cast<Fn1>(std::floor)) return OpCode::Floor;
+	if (f == (const void*)static_cast<Fn1>(std::ceil))  return OpCode::Ceil;
+	return OpCode::Call1;
+}
+
+// Emit code for a subtree. Temporaries are allocated by stack depth, so a node
+// evaluated at `depth` may use temporaries depth.. and leaves its result in the
+// temporary at `depth` (variables and constants are referenced in place).
+uint16_t ExpressionParser::emitNode(const te_expr* node, uint16_t depth) {
+	if (m_emitFailed) return NO_REGISTER;
+
+	const int type = node->type & 0x1F;
+
+	if (type == TE_CONSTANT_TYPE) {
+		m_program.constants.push_back(node->value);
+		return static_cast<uint16_t>(m_vars.size() + m_program.constants.size() - 1);
+	}
+	if (type == TE_VARIABLE) {
+		ptrdiff_t index = node->bound - m_vars.data();
+		if (index < 0 || index >= (ptrdiff_t)m_vars.size()) { m_emitFailed = true; return NO_REGISTER; }
+		return static_cast<uint16_t>(index);
+	}
+
+	const int arity = (type >= TE_FUNCTION0 && type <= TE_FUNCTION7) ? (type & 7) : -1;
+	if (arity < 1 || arity > 2) { m_emitFailed = true; return NO_REGISTER; }
+
+	const OperatorTable& ops = operatorTable();
+	const te_expr* lhs = static_cast<const te_expr*>(node->parameters[0]);
+
+	// Pure left operand of a comma is dead code
+	if (arity == 2 && node->function == ops.comma) {
+		return emitNode(static_cast<const te_expr*>(node->parameters[1]), depth);
+	}
+
+	uint16_t a = emitNode(lhs, depth);
+	uint16_t b = 0;
+	if (arity == 2) {
+		b = emitNode(static_cast<const te_expr*>(node->parameters[1]), (a & TEMP_FLAG) ? depth + 1 : depth);
+	}
+	if (m_emitFailed) return NO_REGISTER;
+
+	Instruction ins;
+	ins.a = a;
+	ins.b = b;
+	ins.fn = nullptr;
+	ins.dst = TEMP_FLAG | depth;
+	m_program.tempCount = std::max<uint16_t>(m_program.tempCount, depth + 1);
+
+	const void* f = node->function;
+	ins.op = opcodeFor(f, arity);
+	if (ins.op == OpCode::Call1 || ins.op == OpCode::Call2) ins.fn = f;
+	m_program.code.push_back(ins);
+	return ins.dst;
+}
+
+// ─── Differentiation ─────────────────────────────────────────────────────────
+
+// Expression DAG for symbolic differentiation. Nodes are hash-consed, so equal subexpressions
+// (the cos(t) in both x' and y'', say) are built and evaluated once, and every new node is
+// simplified on the way in so derivatives don't fill up with x*1 and 0+y.
+struct ExpressionParser::Symbolic {
+	enum class Kind : uint8_t { Constant, Variable, Operation };
+
+	struct Node {
+		Kind kind;
+		OpCode op = OpCode::Add;
+		int a = -1, b = -1;
+		double value = 0.0;          // Constant
+		int variable = -1;           // Variable
+	};
+
+	std::vector<Node> nodes;
+	std::map<std::tuple<int, int, int, int, int, uint64_t>, int> interned;
+	std::map<std::pair<int, int>, int> derivatives;  // (node, variable) -> node
+	const std::vector<double>* vars = nullptr;       // tinyexpr's bound variable storage
+	bool failed = false;                             // hit a function with no derivative rule
+
+	int intern(const Node& n) {
+		uint64_t bits = 0;
+		std::memcpy(&bits, &n.value, sizeof(bits));
+		auto key = std::make_tuple((int)n.kind, (int)n.op, n.a, n.b, n.variable, bits);
+		auto it = interned.find(key);
+		if (it != interned.end()) return it->second;
+		nodes.push_back(n);
+		interned.emplace(key, (int)nodes.size() - 1);
+		return (int)nodes.size() - 1;
+	}
+
+	int constant(double value) {
+		Node n{Kind::Constant};
+		n.value = value;
+		return intern(n);
+	}
+
+	int variable(int index) {
+		Node n{Kind::Variable};
+		n.variable = index;
+		return intern(n);
+	}
+
+	bool isConstant(int i, double value) const {
+		return nodes[i].kind == Kind::Constant && nodes[i].value == value;
+	}
+
+	static double fold(OpCode op, double a, double b) {
+		switch (op) {
+		case OpCode::Add:   return a + b;
+		case OpCode::Sub:   return a - b;
+		case OpCode::Mul:   return a * b;
+		case OpCode::Div:   return a / b;
+		case OpCode::Neg:   return -a;
+		case OpCode::Pow:   return std::pow(a, b);
+		case OpCode::Mod:   return std::fmod(a, b);
+		case OpCode::Atan2: return std::atan2(a, b);
+		case OpCode::Abs:   return std::fabs(a);
+		case OpCode::Sqrt:  return std::sqrt(a);
+		case OpCode::Exp:   return std::exp(a);
+		case OpCode::Log:   return std::log(a);
+		case OpCode::Log10: return std::log10(a);
+		case OpCode::Sin:   return std::sin(a);
+		case OpCode::Cos:   return std::cos(a);
+		case OpCode::Tan:   return std::tan(a);
+		case OpCode::Asin:  return std::asin(a);
+		case OpCode::Acos:  return std::acos(a);
+		case OpCode::Atan:  return std::atan(a);
+		case OpCode::Sinh:  return std::sinh(a);
+		case OpCode::Cosh:  return std::cosh(a);
+		case OpCode::Tanh:  return std::tanh(a);
+		case OpCode::Floor: return std::floor(a);
+		case OpCode::Ceil:  return std::ceil(a);
+		case OpCode::Sign:  return (a > 0.0) - (a < 0.0);
+		case OpCode::Trunc: return std::trunc(a);
+		case OpCode::Call1:
+		case OpCode::Call2: break;
+		}
+		return 0.0;
+	}
+
+	int op(OpCode code, int a, int b = -1) {
+		const bool binary = b >= 0;
+		if (nodes[a].kind == Kind::Constant && (!binary || nodes[b].kind == Kind::Constant)) {
+			return constant(fold(code, nodes[a].value, binary ? nodes[b].value : 0.0));
+		}
+		switch (code) {
+		case OpCode::Add:
+			if (isConstant(a, 0.0)) return b;
+			if (isConstant(b, 0.0)) return a;
+			break;
+		case OpCode::Sub:
+			if (isConstant(b, 0.0)) return a;
+			if (isConstant(a, 0.0)) return op(OpCode::Neg, b);
+			if (a == b) return constant(0.0);
+			break;
+		case OpCode::Mul:
+			if (isConstant(a, 0.0) || isConstant(b, 0.0)) return constant(0.0);
+			if (isConstant(a, 1.0)) return b;
+			if (isConstant(b, 1.0)) return a;
+			if (isConstant(a, -1.0)) return op(OpCode::Neg, b);
+			if (isConstant(b, -1.0)) return op(OpCode::Neg, a);
+			break;
+		case OpCode::Div:
+			if (isConstant(a, 0.0)) return constant(0.0);
+			if (isConstant(b, 1.0)) return a;
+			break;
+		case OpCode::Neg:
+			if (nodes[a].kind == Kind::Operation && nodes[a].op == OpCode::Neg) return nodes[a].a;
+			break;
+		case OpCode::Pow:
+			if (isConstant(b, 1.0)) return a;
+			if (isConstant(b, 0.0)) return constant(1.0);
+			break;
+		default:
+			break;
+		}
+		Node n{Kind::Operation};
+		n.op = code;
+		n.a = a;
+		n.b = b;
+		return intern(n);
+	}
+
+	// Mirror of emitNode: the tinyexpr tree as DAG nodes
+	int fromTree(const te_expr* node) {
+		if (failed) return 0;
+		const int type = node->type & 0x1F;
+		if (type == TE_CONSTANT_TYPE) return constant(node->value);
+		if (type == TE_VARIABLE) return variable((int)(node->bound - vars->data()));
+
+		const int arity = type & 7;
+		const te_expr* lhs = static_cast<const te_expr*>(node->parameters[0]);
+		const te_expr* rhs = arity == 2 ? static_cast<const te_expr*>(node->parameters[1]) : nullptr;
+		if (arity == 2 && node->function == operatorTable().comma) return fromTree(rhs);
+
+		OpCode code = opcodeFor(node->function, arity);
+		if (code == OpCode::Call1 || code == OpCode::Call2) {
+			failed = true;
+			return 0;
+		}
+		int a = fromTree(lhs);
+		int b = rhs ? fromTree(rhs) : -1;
+		return failed ? 0 : op(code, a, b);
+	}
+
+	int derivative(int i, int var) {
+		auto cached = derivatives.find({i, var});
+		if (cached != derivatives.end()) return cached->second;
+
+		const Node n = nodes[i];   // copied: building nodes below may reallocate
+		int d;
+		if (n.kind == Kind::Constant) {
+			d = constant(0.0);
+		} else if (n.kind == Kind::Variable) {
+			d = constant(n.variable == var ? 1.0 : 0.0);
+		} else {
+			const int a = n.a, b = n.b;
+			const int da = derivative(a, var);
+			const int db = b >= 0 ? derivative(b, var) : constant(0.0);
+			if (isConstant(da, 0.0) && isConstant(db, 0.0)) {
+				d = constant(0.0);
+			} else {
+				d = rule(n.op, i, a, b, da, db);
+			}
+		}
+		derivatives[{i, var}] = d;
+		return d;
+	}
+
+	// d(f) for f = op(a, b), given da and db
+	int rule(OpCode code, int f, int a, int b, int da, int db) {
+		auto add = [this](int x, int y) { return op(OpCode::Add, x, y); };
+		auto sub = [this](int x, int y) { return op(OpCode::Sub, x, y); };
+		auto mul = [this](int x, int y) { return op(OpCode::Mul, x, y); };
+		auto div = [this](int x, int y) { return op(OpCode::Div, x, y); };
+		auto one = constant(1.0);
+
+		switch (code) {
+		case OpCode::Add:   return add(da, db);
+		case OpCode::Sub:   return sub(da, db);
+		case OpCode::Mul:   return add(mul(da, b), mul(a, db));
+		case OpCode::Div:   return div(sub(da, mul(f, db)), b);
+		case OpCode::Neg:   return op(OpCode::Neg, da);
+		case OpCode::Pow:
+			// Constant exponents keep negative bases working: b a^(b-1) a'
+			if (isConstant(db, 0.0)) return mul(mul(b, op(OpCode::Pow, a, sub(b, one))), da);
+			return mul(f, add(mul(db, op(OpCode::Log, a)), div(mul(b, da), a)));
+		case OpCode::Mod:   return sub(da, mul(op(OpCode::Trunc, div(a, b)), db));
+		case OpCode::Atan2: return div(sub(mul(b, da), mul(a, db)), add(mul(a, a), mul(b, b)));
+		case OpCode::Abs:   return mul(op(OpCode::Sign, a), da);
+		case OpCode::Sqrt:  return div(da, mul(constant(2.0), f));
+		case OpCode::Exp:   return mul(f, da);
+		case OpCode::Log:   return div(da, a);
+		case OpCode::Log10: return div(da, mul(a, constant(2.302585092994045684)));
+		case OpCode::Sin:   return mul(op(OpCode::Cos, a), da);
+		case OpCode::Cos:   return op(OpCode::Neg, mul(op(OpCode::Sin, a), da));
+		case OpCode::Tan:   return mul(add(one, mul(f, f)), da);
+		case OpCode::Asin:  return div(da, op(OpCode::Sqrt, sub(one, mul(a, a))));
+		case OpCode::Acos:  return op(OpCode::Neg, div(da, op(OpCode::Sqrt, sub(one, mul(a, a)))));
+		case OpCode::Atan:  return div(da, add(one, mul(a, a)));
+		case OpCode::Sinh:  return mul(op(OpCode::Cosh, a), da);
+		case OpCode::Cosh:  return mul(op(OpCode::Sinh, a), da);
+		case OpCode::Tanh:  return mul(sub(one, mul(f, f)), da);
+		case OpCode::Floor:
+		case OpCode::Ceil:
+		case OpCode::Sign:
+		case OpCode::Trunc: return constant(0.0);
+		case OpCode::Call1:
+		case OpCode::Call2: break;
+		}
+		failed = true;
+		return constant(0.0);
+	}
+};
+
+// Differentiate the expression and lower value + derivatives into one program
+bool ExpressionParser::buildDerivatives() {
+	Symbolic graph;
+	graph.vars = &m_vars;
+	const int value = graph.fromTree(m_expr);
+	if (graph.failed) return false;
+
+	const int varCount = (int)m_vars.size();
+	std::vector<int> roots = { value };
+	for (int v = 0; v < varCount; ++v) roots.push_back(graph.derivative(value, v));
+	if (varCount == 1) roots.push_back(graph.derivative(roots[1], 0));
+	if (graph.failed) return false;
+
+	Program program;
+	if (!lowerGraph(graph, roots, varCount, program)) return false;
+	m_derivatives = std::move(program);
+	return true;
+}
+
+// Unlike emitNode this keeps every DAG node that is still needed in a register, so
+// shared subexpressions are computed once; registers are recycled after their last use.
+bool ExpressionParser::lowerGraph(const Symbolic& graph, const std::vector<int>& roots, int varCount, Program& program) {
+	// Children always precede their parents, so node order is a valid schedule
+	const int nodeCount = (int)graph.nodes.size();
+	std::vector<int> lastUse(nodeCount, -1);
+	std::vector<char> live(nodeCount, 0);
+	for (int r : roots) live[r] = 1;
+	for (int i = nodeCount - 1; i >= 0; --i) {
+		if (!live[i] || graph.nodes[i].kind != Symbolic::Kind::Operation) continue;
+		for (int c : { graph.nodes[i].a, graph.nodes[i].b }) {
+			if (c < 0) continue;
+			live[c] = 1;
+			lastUse[c] = std::max(lastUse[c], i);
+		}
+	}
+	for (int r : roots) lastUse[r] = nodeCount;   // outputs stay put until the end
+
+	program = Program();
+	std::vector<uint16_t> reg(nodeCount, NO_REGISTER);
+	for (int i = 0; i < nodeCount; ++i) {
+		if (!live[i]) continue;
+		const Symbolic::Node& n = graph.nodes[i];
+		if (n.kind == Symbolic::Kind::Variable) {
+			reg[i] = (uint16_t)n.variable;
+		} else if (n.kind == Symbolic::Kind::Constant) {
+			program.constants.push_back(n.value);
+			reg[i] = (uint16_t)(varCount + program.constants.size() - 1);
+		}
+	}
+
+	// Temporaries are numbered from 0 with TEMP_FLAG and rebased once the constants are known
+	std::vector<uint16_t> freeTemps;
+	for (int i = 0; i < nodeCount; ++i) {
+		const Symbolic::Node& n = graph.nodes[i];
+		if (!live[i] || n.kind != Symbolic::Kind::Operation) continue;
+
+		Instruction ins;
+		ins.op = n.op;
+		ins.a = reg[n.a];
+		ins.b = n.b >= 0 ? reg[n.b] : 0;
+		ins.fn = nullptr;
+
+		// Operands read for the last time can hand their register to the result
+		for (int c : { n.a, n.b }) {
+			if (c >= 0 && lastUse[c] == i && (reg[c] & TEMP_FLAG)) {
+				freeTemps.push_back(reg[c]);
+				lastUse[c] = -1;
+			}
+		}
+		if (!freeTemps.empty()) {
+			ins.dst = freeTemps.back();
+			freeTemps.pop_back();
+		} else {
+			if (program.tempCount >= TEMP_FLAG - varCount - program.constants.size()) return false;
+			ins.dst = TEMP_FLAG | program.tempCount++;
+		}
+		reg[i] = ins.dst;
+		program.code.push_back(ins);
+	}
+
+	const uint16_t base = static_cast<uint16_t>(varCount + program.constants.size());
+	auto fix = [base](uint16_t r) { return (r & TEMP_FLAG) ? (uint16_t)(base + (r & ~TEMP_FLAG)) : r; };
+	for (auto& in : program.code) {
+		in.dst = fix(in.dst);
+		in.a = fix(in.a);
+		in.b = fix(in.b);
+	}
+	for (int r : roots) program.outputs.push_back(fix(reg[r]));
+	return true;
+}
+
+// Execute the program over n samples. Each register owns `stride` consecutive doubles.
+void ExpressionParser::runProgram(double* regs, size_t stride, size_t n) const {
+	for (const Instruction& in : m_program.code) {
+		double* d = regs + in.dst * stride;
+		const double* a = regs + in.a * stride;
+		const double* b = regs + in.b * stride;
+		switch (in.op) {
+		case OpCode::Add:   for (size_t i = 0; i < n; ++i) d[i] = a[i] + b[i]; break;
+		case OpCode::Sub:   for (size_t i = 0; i < n; ++i) d[i] = a[i] - b[i]; break;
+		case OpCode::Mul:   for (size_t i = 0; i < n; ++i) d[i] = a[i] * b[i]; break;
+		case OpCode::Div:   for (size_t i = 0; i < n; ++i) d[i] = a[i] / b[i]; break;
+		case OpCode::Neg:   for (size_t i = 0; i < n; ++i) d[i] = -a[i]; break;
+		case OpCode::Pow:   for (size_t i = 0; i < n; ++i) d[i] = std::pow(a[i], b[i]); break;
+		case OpCode::Mod:   for (size_t i = 0; i < n; ++i) d[i] = std::fmod(a[i], b[i]); break;
+		case OpCode::Atan2: for (size_t i = 0; i < n; ++i) d[i] = std::atan2(a[i], b[i]); break;
+		case OpCode::Abs:   for (size_t i = 0; i < n; ++i) d[i] = std::fabs(a[i]); break;
+		case OpCode::Sqrt:  for (size_t i = 0; i < n; ++i) d[i] = std::sqrt(a[i]); break;
+		case OpCode::Exp:   for (size_t i = 0; i < n; ++i) d[i] = std::exp(a[i]); break;
+		case OpCode::Log:   for (size_t i = 0; i < n; ++i) d[i] = std::log(a[i]); break;
+		case OpCode::Log10: for (size_t i = 0; i < n; ++i) d[i] = std::log10(a[i]); break;
+		case OpCode::Sin:   for (size_t i = 0; i < n; ++i) d[i] = std::sin(a[i]); break;
+		case OpCode::Cos:   for (size_t i = 0; i < n; ++i) d[i] = std::cos(a[i]); break;
+		case OpCode::Tan:   for (size_t i = 0; i < n; ++i) d[i] = std::tan(a[i]); break;
+		case OpCode::Asin:  for (size_t i = 0; i < n; ++i) d[i] = std::asin(a[i]); break;
+		case OpCode::Acos:  for (size_t i = 0; i < n; ++i) d[i] = std::acos(a[i]); break;
+		case OpCode::Atan:  for (size_t i = 0; i < n; ++i) d[i] = std::atan(a[i]); break;
+		case OpCode::Sinh:  for (size_t i = 0; i < n; ++i) d[i] = std::sinh(a[i]); break;
+		case OpCode::Cosh:  for (size_t i = 0; i < n; ++i) d[i] = std::cosh(a[i]); break;
+		case OpCode::Tanh:  for (size_t i = 0; i < n; ++i) d[i] = std::tanh(a[i]); break;
+		case OpCode::Floor: for (size_t i = 0; i < n; ++i) d[i] = std::floor(a[i]); break;
+		case OpCode::Ceil:  for (size_t i = 0; i < n; ++i) d[i] = std::ceil(a[i]); break;
+		case OpCode::Sign:  for (size_t i = 0; i < n; ++i) d[i] = (a[i] > 0.0) - (a[i] < 0.0); break;
+		case OpCode::Trunc: for (size_t i = 0; i < n; ++i) d[i] = std::trunc(a[i]); break;
+		case OpCode::Call1: {
+			Fn1 f = reinterpret_cast<Fn1>(in.fn);
+			for (size_t i = 0; i < n; ++i) d[i] = f(a[i]);
+			break;
+		}
+		case OpCode::Call2: {
+			Fn2 f = reinterpret_cast<Fn2>(in.fn);
+			for (size_t i = 0; i < n; ++i) d[i] = f(a[i], b[i]);
+			break;
+		}
+		}
+	}
+}
+
+// Float32 execution: the common opcodes go through the SIMD kernels, the rest loop over libm.
+void ExpressionParser::runProgram(const Program& program, float* regs, size_t stride, size_t n) {
+	const SimdMath::Kernels& k = SimdMath::kernels();
+	for (const Instruction& in : program.code) {
+		float* d = regs + in.dst * stride;
+		const float* a = regs + in.a * stride;
+		const float* b = regs + in.b * stride;
+		switch (in.op) {
+		case OpCode::Add:   k.add(a, b, d, n); break;
+		case OpCode::Sub:   k.sub(a, b, d, n); break;
+		case OpCode::Mul:   k.mul(a, b, d, n); break;
+		case OpCode::Div:   k.div(a, b, d, n); break;
+		case OpCode::Neg:   k.neg(a, d, n); break;
+		case OpCode::Pow:   k.pow(a, b, d, n); break;
+		case OpCode::Abs:   k.abs(a, d, n); break;
+		case OpCode::Sqrt:  k.sqrt(a, d, n); break;
+		case OpCode::Exp:   k.exp(a, d, n); break;
+		case OpCode::Log:   k.log(a, d, n); break;
+		case OpCode::Sin:   k.sin(a, d, n); break;
+		case OpCode::Cos:   k.cos(a, d, n); break;
+		case OpCode::Log10:
+			k.log(a, d, n);
+			for (size_t i = 0; i < n; ++i) d[i] *= 0.434294481903251828f;
+			break;
+		case OpCode::Mod:   for (size_t i = 0; i < n; ++i) d[i] = std::fmod(a[i], b[i]); break;
+		case OpCode::Atan2: for (size_t i = 0; i < n; ++i) d[i] = std::atan2(a[i], b[i]); break;
+		case OpCode::Tan:   for (size_t i = 0; i < n; ++i) d[i] = std::tan(a[i]); break;
+		case OpCode::Asin:  for (size_t i = 0; i < n; ++i) d[i] = std::asin(a[i]); break;
+		case OpCode::Acos:  for (size_t i = 0; i < n; ++i) d[i] = std::acos(a[i]); break;
+		case OpCode::Atan:  for (size_t i = 0; i < n; ++i) d[i] = std::atan(a[i]); break;
+		case OpCode::Sinh:  for (size_t i = 0; i < n; ++i) d[i] = std::sinh(a[i]); break;
+		case OpCode::Cosh:  for (size_t i = 0; i < n; ++i) d[i] = std::cosh(a[i]); break;
+		case OpCode::Tanh:  for (size_t i = 0; i < n; ++i) d[i] = std::tanh(a[i]); break;
+		case OpCode::Floor: for (size_t i = 0; i < n; ++i) d[i] = std::floor(a[i]); break;
+		case OpCode::Ceil:  for (size_t i = 0; i < n; ++i) d[i] = std::ceil(a[i]); break;
+		case OpCode::Sign:  for (size_t i = 0; i < n; ++i) d[i] = (float)((a[i] > 0.0f) - (a[i] < 0.0f)); break;
+		case OpCode::Trunc: for (size_t i = 0; i < n; ++i) d[i] = std::trunc(a[i]); break;
+		case OpCode::Call1: {
+			Fn1 f = reinterpret_cast<Fn1>(in.fn);
+			for (size_t i = 0; i < n; ++i) d[i] = (float)f(a[i]);
+			break;
+		}
+		case OpCode::Call2: {
+			Fn2 f = reinterpret_cast<Fn2>(in.fn);
+			for (size_t i = 0; i < n; ++i) d[i] = (float)f(a[i], b[i]);
+			break;
+		}
+		}
+	}
+}
+
+void ExpressionParser::evaluateBatch(const double* inputs, size_t n, double* out) const {
+	evaluateBatch(inputs, n, out, m_names.size());
+}
+
+void ExpressionParser::evaluateBatch(const double* inputs, size_t n, double* out, size_t stride) const {
+	if (!m_expr) {
+		std::fill(out, out + n, 0.0);
+		return;
+	}
+
+	const size_t varCount = m_vars.size();
+
+	// Tree-walk fallback for expressions the bytecode can't represent
+	if (!isCompiled()) {
+		std::lock_guard<std::mutex> lock(treeWalkMutex());
+		for (size_t s = 0; s < n; ++s) {
+			for (size_t v = 0; v < varCount; ++v) m_vars[v] = inputs[s * stride + v];
+			out[s] = te_eval(m_expr);
+		}
+		return;
+	}
+
+	// Per-thread register file: BATCH_CHUNK doubles per register
+	thread_local std::vector<double> regs;
+	const std::vector<double>& constants = m_program.constants;
+	const size_t regCount = varCount + constants.size() + m_program.tempCount;
+	if (regs.size() < regCount * BATCH_CHUNK) regs.resize(regCount * BATCH_CHUNK);
+	double* r = regs.data();
+
+	for (size_t c = 0; c < constants.size(); ++c) {
+		std::fill(r + (varCount + c) * BATCH_CHUNK, r + (varCount + c + 1) * BATCH_CHUNK, constants[c]);
+	}
+
+	for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+		const size_t len = std::min(BATCH_CHUNK, n - base);
+
+		// De-interleave this chunk's inputs into the variable registers
+		for (size_t v = 0; v < varCount; ++v) {
+			double* dst = r + v * BATCH_CHUNK;
+			const double* src = inputs + base * stride + v;
+			for (size_t i = 0; i < len; ++i) dst[i] = src[i * stride];
+		}
+
+		runProgram(r, BATCH_CHUNK, len);
+
+		const double* result = r + m_program.outputs[0] * BATCH_CHUNK;
+		std::copy(result, result + len, out + base);
+	}
+}
+
+void ExpressionParser::evaluateBatch(const float* inputs, size_t n, float* out, size_t stride) const {
+	if (!m_expr) {
+		std::fill(out, out + n, 0.0f);
+		return;
+	}
+
+	if (!isCompiled()) {
+		const size_t varCount = m_vars.size();
+		std::lock_guard<std::mutex> lock(treeWalkMutex());
+		for (size_t s = 0; s < n; ++s) {
+			for (size_t v = 0; v < varCount; ++v) m_vars[v] = inputs[s * stride + v];
+			out[s] = (float)te_eval(m_expr);
+		}
+		return;
+	}
+
+	float* outs[1] = { out };
+	runBatch(m_program, m_vars.size(), inputs, n, stride, outs, 1);
+}
+
+bool ExpressionParser::evaluateWithDerivatives(const float* inputs, size_t n, float* out, size_t stride) const {
+	if (!hasDerivatives()) return false;
+	float* outs[1] = { out };
+	runBatch(m_derivatives, m_vars.size(), inputs, n, stride, outs, m_derivatives.outputs.size());
+	return true;
+}
+
+void ExpressionParser::runBatch(const Program& program, size_t varCount, const float* inputs, size_t n, size_t stride,
+	float* const* out, size_t width) {
+	const size_t outCount = program.outputs.size();
+
+	thread_local std::vector<float> regs;
+	const size_t regCount = varCount + program.constants.size() + program.tempCount;
+	if (regs.size() < regCount * BATCH_CHUNK) regs.resize(regCount * BATCH_CHUNK);
+	float* r = regs.data();
+
+	for (size_t c = 0; c < program.constants.size(); ++c) {
+		std::fill(r + (varCount + c) * BATCH_CHUNK, r + (varCount + c + 1) * BATCH_CHUNK, (float)program.constants[c]);
+	}
+
+	for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+		const size_t len = std::min(BATCH_CHUNK, n - base);
+
+		for (size_t v = 0; v < varCount; ++v) {
+			float* dst = r + v * BATCH_CHUNK;
+			const float* src = inputs + base * stride + v;
+			for (size_t i = 0; i < len; ++i) dst[i] = src[i * stride];
+		}
+
+		runProgram(program, r, BATCH_CHUNK, len);
+
+		// Interleave the outputs back into samples
+		for (size_t o = 0; o < outCount; ++o) {
+			const float* result = r + program.outputs[o] * BATCH_CHUNK;
+			float* dst = out[o / width] + base * width + o % width;
+			if (width == 1) std::copy(result, result + len, dst);
+			else for (size_t i = 0; i < len; ++i) dst[i * width] = result[i];
+		}
+	}
+}
+
+// libm semantics for pow: WGSL's pow is undefined for negative bases
+const char* ExpressionParser::wgslPrelude() {
+	return R"(
+fn te_pow(a: f32, b: f32) -> f32 {
+	if (b == 0.0) { return 1.0; }
+	if (a >= 0.0) { return pow(a, b); }
+	if (fract(b) != 0.0) {
+		let nanBits = 0x7fc00000u; // not a const-expression, which may not produce NaN
+		return bitcast<f32>(nanBits);
+	}
+	let r = pow(-a, b);
+	return select(r, -r, (i32(b) & 1) == 1);
+}
+)";
+}
+
+bool ExpressionParser::generateWgsl(const std::string& fnName, std::string& out) const {
+	if (!isCompiled()) return false;
+	return emitWgsl(m_program, m_vars.size(), fnName, out);
+}
+
+bool ExpressionParser::generateWgslDerivatives(const std::string& fnName, std::string& out) const {
+	if (!hasDerivatives() || derivativeCount() > 4) return false;
+	return emitWgsl(m_derivatives, m_vars.size(), fnName, out);
+}
+
+bool ExpressionParser::emitWgsl(const Program& program, size_t varCount, const std::string& fnName, std::string& out) {
+	const size_t tempBase = varCount + program.constants.size();
+
+	std::vector<std::string> constants;
+	for (double c : program.constants) {
+		if (!std::isfinite(c) || std::fabs(c) > 3.4e38) return false;
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.9g", c);
+		std::string lit = buf;
+		if (lit.find_first_of(".e") == std::string::npos) lit += ".0";
+		constants.push_back(c < 0.0 ? "(" + lit + ")" : lit);
+	}
+
+	auto reg = [&](uint16_t r) -> std::string {
+		if (r < varCount) return "v" + std::to_string(r);
+		if (r < tempBase) return constants[r - varCount];
+		return "t" + std::to_string(r - tempBase);
+	};
+
+	std::string body;
+	for (const Instruction& in : program.code) {
+		const std::string a = reg(in.a), b = reg(in.b);
+		std::string e;
+		switch (in.op) {
+		case OpCode::Add:   e = a + " + " + b; break;
+		case OpCode::Sub:   e = a + " - " + b; break;
+		case OpCode::Mul:   e = a + " * " + b; break;
+		case OpCode::Div:   e = a + " / " + b; break;
+		case OpCode::Neg:   e = "-" + a; break;
+		case OpCode::Pow:   e = "te_pow(" + a + ", " + b + ")"; break;
+		case OpCode::Mod:   e = a + " % " + b; break; // truncated remainder, like fmod
+		case OpCode::Atan2: e = "atan2(" + a + ", " + b + ")"; break;
+		case OpCode::Abs:   e = "abs(" + a + ")"; break;
+		case OpCode::Sqrt:  e = "sqrt(" + a + ")"; break;
+		case OpCode::Exp:   e = "exp(" + a + ")"; break;
+		case OpCode::Log:   e = "log(" + a + ")"; break;
+		case OpCode::Log10: e = "log(" + a + ") * 0.434294482"; break;
+		case OpCode::Sin:   e = "sin(" + a + ")"; break;
+		case OpCode::Cos:   e = "cos(" + a + ")"; break;
+		case OpCode::Tan:   e = "tan(" + a + ")"; break;
+		case OpCode::Asin:  e = "asin(" + a + ")"; break;
+		case OpCode::Acos:  e = "acos(" + a + ")"; break;
+		case OpCode::Atan:  e = "atan(" + a + ")"; break;
+		case OpCode::Sinh:  e = "sinh(" + a + ")"; break;
+		case OpCode::Cosh:  e = "cosh(" + a + ")"; break;
+		case OpCode::Tanh:  e = "tanh(" + a + ")"; break;
+		case OpCode::Floor: e = "floor(" + a + ")"; break;
+		case OpCode::Ceil:  e = "ceil(" + a + ")"; break;
+		case OpCode::Sign:  e = "sign(" + a + ")"; break;
+		case OpCode::Trunc: e = "trunc(" + a + ")"; break;
+		case OpCode::Call1:
+		case OpCode::Call2:
+			return false;
+		}
+		body += "\t" + reg(in.dst) + " = " + e + ";\n";
+	}
+
+	std::string args;
+	for (size_t v = 0; v < varCount; ++v) {
+		if (v) args += ", ";
+		args += "v" + std::to_string(v) + ": f32";
+	}
+
+	// One output is a scalar, up to four a vector
+	const size_t outputCount = program.outputs.size();
+	if (outputCount < 1 || outputCount > 4) return false;
+	const std::string type = outputCount == 1 ? "f32" : "vec" + std::to_string(outputCount) + "f";
+	std::string result;
+	for (size_t o = 0; o < outputCount; ++o) {
+		if (o) result += ", ";
+		result += reg(program.outputs[o]);
+	}
+	if (outputCount > 1) result = type + "(" + result + ")";
+
+	out = "fn " + fnName + "(" + args + ") -> " + type + " {\n";
+	for (uint16_t t = 0; t < program.tempCount; ++t) out += "\tvar t" + std::to_string(t) + ": f32;\n";
+	out += body;
+	out += "\treturn " + result + ";\n}\n";
+	return true;
+}
+
+// ─── Fused Components ───────────────────────────────────────────────────────
+
+bool FusedExpression::build(const ExpressionParser* parsers, int count) {
+	clear();
+	if (count <= 0) return false;
+	const size_t varCount = parsers[0].m_vars.size();
+	for (int c = 0; c < count; ++c) {
+		if (!parsers[c].isValid() || parsers[c].m_vars.size() != varCount) return false;
+	}
+
+	// Variables are interned by index, so every component's t (or u, v) is the same node
+	ExpressionParser::Symbolic graph;
+	std::vector<int> values;
+	for (int c = 0; c < count; ++c) {
+		graph.vars = &parsers[c].m_vars;
+		values.push_back(graph.fromTree(parsers[c].m_expr));
+		if (graph.failed) return false;
+	}
+
+	ExpressionParser::Program program;
+	if (!ExpressionParser::lowerGraph(graph, values, (int)varCount, program)) return false;
+
+	// The derivatives of all components share one graph too: cos(t) and its derivative -sin(t)
+	// are built once for x, y and their second derivatives
+	std::vector<int> jets;
+	for (int value : values) {
+		jets.push_back(value);
+		for (size_t v = 0; v < varCount; ++v) jets.push_back(graph.derivative(value, (int)v));
+		if (varCount == 1) jets.push_back(graph.derivative(jets[jets.size() - 1], 0));
+	}
+	ExpressionParser::Program derivatives;
+	if (!graph.failed && ExpressionParser::lowerGraph(graph, jets, (int)varCount, derivatives)) {
+		m_derivatives = std::move(derivatives);
+		m_derivativeCount = jets.size() / count;
+	}
+
+	m_values = std::move(program);
+	m_varCount = varCount;
+	return true;
+}
+
+void FusedExpression::clear() {
+	m_values = ExpressionParser::Program();
+	m_derivatives = ExpressionParser::Program();
+	m_varCount = 0;
+	m_derivativeCount = 0;
+}
+
+void FusedExpression::evaluateBatch(const float* inputs, size_t n, float* const* out, size_t stride) const {
+	if (!isCompiled()) return;
+	ExpressionParser::runBatch(m_values, m_varCount, inputs, n, stride, out, 1);
+}
+
+bool FusedExpression::evaluateWithDerivatives(const float* inputs, size_t n, float* const* out, size_t stride) const {
+	if (m_derivatives.outputs.empty()) return false;
+	ExpressionParser::runBatch(m_derivatives, m_varCount, inputs, n, stride, out, m_derivativeCount);
+	return true;
+}
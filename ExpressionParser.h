@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -23,12 +25,120 @@ public:
 	// Evaluate the compiled expression. values array must match varNames order.
 	double evaluate(const double* values);
 
+	// Evaluate n samples at once. inputs holds n consecutive samples of varCount() values each
+	// (or `stride` values each, of which the first varCount() are read).
+	// The batch calls are safe to run concurrently on one parser.
+	void evaluateBatch(const double* inputs, size_t n, double* out) const;
+	void evaluateBatch(const double* inputs, size_t n, double* out, size_t stride) const;
+
+	// Float32 variant run through the SIMD kernels (SimdMath.h), several samples per instruction.
+	// Precision is float plus a few ulp of approximation error, which is plenty for plotting.
+	void evaluateBatch(const float* inputs, size_t n, float* out, size_t stride) const;
+
+	// Value and exact derivatives in one pass, from a program differentiated symbolically at
+	// compile time. Writes derivativeCount() floats per sample to out: f, df/dv0, ..., and for
+	// one-variable expressions d2f/dv0^2 last. Returns false, writing nothing, when the expression
+	// calls a function with no known derivative; callers then fall back to finite differences.
+	bool evaluateWithDerivatives(const float* inputs, size_t n, float* out, size_t stride) const;
+	bool hasDerivatives() const { return !m_derivatives.outputs.empty(); }
+	size_t derivativeCount() const { return m_derivatives.outputs.size(); }
+
+	// Emit the compiled program as a WGSL function `fn <name>(v0: f32, ...) -> f32`, one
+	// argument per variable. Returns false for functions WGSL has no equivalent of (fac, ncr, ...).
+	// The generated code calls the helpers in wgslPrelude(), which must be included once per shader.
+	bool generateWgsl(const std::string& fnName, std::string& out) const;
+	// Same for the evaluateWithDerivatives program: the function returns a vecNf of the
+	// derivativeCount() values. False when the expression is not differentiable.
+	bool generateWgslDerivatives(const std::string& fnName, std::string& out) const;
+	static const char* wgslPrelude();
+
 	bool isValid() const { return m_expr != nullptr; }
+	bool isCompiled() const { return !m_program.outputs.empty(); }
+	size_t varCount() const { return m_names.size(); }
 
 	void free();
 
 private:
+	friend class FusedExpression;
+
+	// Flat register bytecode compiled from the tinyexpr tree.
+	// Registers are laid out as [variables][constants][temporaries].
+	enum class OpCode : uint8_t {
+		Add, Sub, Mul, Div, Neg, Pow, Mod, Atan2,
+		Abs, Sqrt, Exp, Log, Log10, Sin, Cos, Tan,
+		Asin, Acos, Atan, Sinh, Cosh, Tanh, Floor, Ceil,
+		Call1, Call2,                    // any other pure tinyexpr function, via pointer
+		Sign, Trunc,                     // only emitted by differentiation
+	};
+
+	struct Instruction {
+		OpCode op;
+		uint16_t dst, a, b;
+		const void* fn;                  // Call1/Call2 only
+	};
+
+	// Bytecode plus the constants it reads; each output names the register holding one result
+	struct Program {
+		std::vector<Instruction> code;
+		std::vector<double> constants;
+		uint16_t tempCount = 0;
+		std::vector<uint16_t> outputs;
+	};
+
+	// Hash-consed expression DAG the derivative and fused programs are built from (ExpressionParser.cpp)
+	struct Symbolic;
+
+	static constexpr uint16_t NO_REGISTER = 0xffff;
+	static constexpr uint16_t TEMP_FLAG = 0x8000;     // marks a depth-relative temporary while emitting
+
+	static OpCode opcodeFor(const void* fn, int arity);
+	bool buildProgram();
+	uint16_t emitNode(const te_expr* node, uint16_t depth);
+	bool buildDerivatives();
+	// Schedule the nodes roots depend on into out, whose outputs are roots in order
+	static bool lowerGraph(const Symbolic& graph, const std::vector<int>& roots, int varCount, Program& out);
+	static bool emitWgsl(const Program& program, size_t varCount, const std::string& fnName, std::string& out);
+	void runProgram(double* regs, size_t stride, size_t n) const;
+	static void runProgram(const Program& program, float* regs, size_t stride, size_t n);
+	// Run program over n samples. Output o goes to out[o / width], which holds width floats per sample.
+	static void runBatch(const Program& program, size_t varCount, const float* inputs, size_t n, size_t stride,
+		float* const* out, size_t width);
+	void clearProgram();
+
 	te_expr* m_expr = nullptr;
-	std::vector<double> m_vars;         // storage bound by pointer to tinyexpr
+	mutable std::vector<double> m_vars; // storage bound by pointer to tinyexpr (tree-walk fallback)
 	std::vector<std::string> m_names;   // keep names alive for te_variable
+
+	Program m_program;                  // the value, outputs[0]
+	Program m_derivatives;              // see evaluateWithDerivatives; empty if not differentiable
+	bool m_emitFailed = false;
+};
+
+// Every output component of one function in a single program. The components are merged into
+// one hash-consed DAG with constants folded, so a subexpression they share (the radius in both
+// of Butterfly's components, cos(u) in a torus) is evaluated once per sample.
+class FusedExpression {
+public:
+	// Fuse count compiled parsers over the same variables. Returns false, leaving this empty, when
+	// one of them calls a function the DAG has no opcode for; evaluate the parsers one by one then.
+	bool build(const ExpressionParser* parsers, int count);
+	void clear();
+
+	// out[c] receives component c of each of the n samples
+	void evaluateBatch(const float* inputs, size_t n, float* const* out, size_t stride) const;
+	// out[c] receives derivativeCount() floats per sample, laid out as by
+	// ExpressionParser::evaluateWithDerivatives. Returns false when not built.
+	bool evaluateWithDerivatives(const float* inputs, size_t n, float* const* out, size_t stride) const;
+
+	bool isCompiled() const { return !m_values.outputs.empty(); }
+	bool hasDerivatives() const { return !m_derivatives.outputs.empty(); }
+	size_t componentCount() const { return m_values.outputs.size(); }
+	size_t derivativeCount() const { return m_derivativeCount; }
+	size_t instructionCount() const { return m_values.code.size(); }
+
+private:
+	ExpressionParser::Program m_values;       // one output per component
+	ExpressionParser::Program m_derivatives;  // derivativeCount() outputs per component
+	size_t m_varCount = 0;
+	size_t m_derivativeCount = 0;
 };
@@ -0,0 +1,548 @@
+#include "FlowCompute.h"
+#include "ExpressionParser.h"
+#include "GraphObjects.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+static constexpr uint32_t WORKGROUP_SIZE = 64;
+// Seconds a particle lives before it is scattered again, so the box never drains
+static constexpr float PARTICLE_LIFETIME = 5.0f;
+static constexpr uint32_t BINDING_COUNT = 5;
+
+// Shader body shared by every generated field; fieldAt() is prepended per function
+static const char* FLOW_COMPUTE_WGSL = R"(
+struct Params {
+	boxMin: vec3f,
+	stepSize: f32,
+	boxMax: vec3f,
+	time: f32,
+	count: u32,
+	steps: u32,
+	dt: f32,
+	lifetime: f32,
+};
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read_write> speedRange: array<atomic<u32>, 4>;  // [0] max speed, as float bits
+@group(0) @binding(2) var<storage, read_write> vertices: array<u32>;               // PackedVertex, 5 words each
+@group(0) @binding(3) var<storage, read_write> indices: array<u32>;                // streamline LineList
+@group(0) @binding(4) var<storage, read_write> particles: array<vec4f>;            // position, age
+
+// Same ramp as GraphObjects::magnitudeToColor
+fn magnitudeToColor(tIn: f32) -> vec3f {
+	let t = clamp(tIn, 0.0, 1.0);
+	if (t < 0.25) { return vec3f(0.0, t / 0.25, 1.0); }
+	if (t < 0.5) { return vec3f(0.0, 1.0, 1.0 - (t - 0.25) / 0.25); }
+	if (t < 0.75) { return vec3f((t - 0.5) / 0.25, 1.0, 0.0); }
+	return vec3f(1.0, 1.0 - (t - 0.75) / 0.25, 0.0);
+}
+
+// The R3 sequence: every prefix of it spreads evenly through the unit cube
+fn r3(i: u32) -> vec3f {
+	let g = 1.2207440846;
+	return fract(vec3f(0.5) + f32(i) * vec3f(1.0 / g, 1.0 / (g * g), 1.0 / (g * g * g)));
+}
+
+fn pcg(v: u32) -> u32 {
+	let state = v * 747796405u + 2891336453u;
+	let word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+fn random3(seed: u32) -> vec3f {
+	let a = pcg(seed);
+	let b = pcg(a);
+	let c = pcg(b);
+	return vec3f(f32(a), f32(b), f32(c)) / 4294967295.0;
+}
+
+fn inBox(p: vec3f) -> bool {
+	return all(p >= params.boxMin) && all(p <= params.boxMax);
+}
+
+// Averaged RK4 velocity over a step of h, as the CPU streamlines use it
+fn rk4(p: vec3f, h: f32) -> vec3f {
+	let k1 = fieldAt(p);
+	let k2 = fieldAt(p + k1 * (h * 0.5));
+	let k3 = fieldAt(p + k2 * (h * 0.5));
+	let k4 = fieldAt(p + k3 * h);
+	return (k1 + 2.0 * k2 + 2.0 * k3 + k4) / 6.0;
+}
+
+fn writeVertex(k: u32, p: vec3f, color: u32) {
+	let o = k * 5u;
+	vertices[o + 0u] = bitcast<u32>(p.x);
+	vertices[o + 1u] = bitcast<u32>(p.y);
+	vertices[o + 2u] = bitcast<u32>(p.z);
+	vertices[o + 3u] = pack2x16snorm(vec2f(0.0, 1.0));  // octahedral (0, 1, 0)
+	vertices[o + 4u] = color;
+}
+
+fn recordSpeed(speed: f32) {
+	// Non-negative floats order like their bits
+	if (speed <= 3.4e38) { atomicMax(&speedRange[0], bitcast<u32>(speed)); }
+}
+
+fn speedColor(speed: f32) -> u32 {
+	let maxSpeed = max(bitcast<f32>(atomicLoad(&speedRange[0])), 1e-6);
+	return pack4x8unorm(vec4f(magnitudeToColor(speed / maxSpeed), 1.0));
+}
+
+// One streamline per invocation, steps + 1 points. Where a line stops, its remaining points
+// repeat the last one, so the leftover segments have no length and draw nothing.
+@compute @workgroup_size(64)
+fn traceStreamlines(@builtin(global_invocation_id) id: vec3u) {
+	let s = id.x;
+	if (s >= params.count) { return; }
+	let first = s * (params.steps + 1u);
+	var p = mix(params.boxMin, params.boxMax, r3(s));
+	var alive = true;
+	var speed = 0.0;
+	for (var k = 0u; k <= params.steps; k = k + 1u) {
+		var vel = vec3f(0.0);
+		if (alive && k < params.steps) {
+			vel = rk4(p, params.stepSize);
+			speed = length(vel);
+			recordSpeed(speed);
+		}
+		// The colour word holds the speed until colorStreamlines knows the range
+		writeVertex(first + k, p, bitcast<u32>(speed));
+		if (k == params.steps) { break; }
+		let segment = (s * params.steps + k) * 2u;
+		indices[segment] = first + k;
+		indices[segment + 1u] = first + k + 1u;
+
+		if (!alive) { continue; }
+		let next = p + vel * params.stepSize;
+		// Stagnation point, or the line left the box
+		if (!(speed >= 1e-6) || !inBox(next)) {
+			alive = false;
+			continue;
+		}
+		p = next;
+	}
+}
+
+@compute @workgroup_size(64)
+fn colorStreamlines(@builtin(global_invocation_id) id: vec3u) {
+	let k = id.x;
+	if (k >= params.count * (params.steps + 1u)) { return; }
+	vertices[k * 5u + 4u] = speedColor(bitcast<f32>(vertices[k * 5u + 4u]));
+}
+
+@compute @workgroup_size(64)
+fn seedParticles(@builtin(global_invocation_id) id: vec3u) {
+	let i = id.x;
+	if (i >= params.count) { return; }
+	let p = mix(params.boxMin, params.boxMax, r3(i));
+	// Staggered ages, so the particles do not all respawn together
+	particles[i] = vec4f(p, random3(i).x * params.lifetime);
+	writeVertex(2u * i, p, 0u);
+	writeVertex(2u * i + 1u, p, 0u);
+}
+
+// One RK4 step of stepSize per particle, drawn as a streak back along its velocity
+@compute @workgroup_size(64)
+fn advectParticles(@builtin(global_invocation_id) id: vec3u) {
+	let i = id.x;
+	if (i >= params.count) { return; }
+	let q = particles[i];
+	let age = q.w + params.dt;
+	let vel = rk4(q.xyz, params.stepSize);
+	let speed = length(vel);
+	let next = q.xyz + vel * params.stepSize;
+	if (age > params.lifetime || !(speed >= 1e-6) || !inBox(next)) {
+		// Respawn at a point hashed from the index and the time, so respawns never line up
+		let p = mix(params.boxMin, params.boxMax, random3(i * 9781u + bitcast<u32>(params.time)));
+		particles[i] = vec4f(p, 0.0);
+		writeVertex(2u * i, p, 0u);
+		writeVertex(2u * i + 1u, p, 0u);
+		return;
+	}
+	particles[i] = vec4f(next, age);
+	recordSpeed(speed);
+
+	let maxSpeed = max(bitcast<f32>(atomicLoad(&speedRange[0])), 1e-6);
+	let tail = next - vel / maxSpeed * (0.02 * length(params.boxMax - params.boxMin));
+	let color = speedColor(speed);
+	writeVertex(2u * i, tail, color);
+	writeVertex(2u * i + 1u, next, color);
+}
+)";
+
+static_assert(sizeof(PackedVertex) == 5 * sizeof(uint32_t), "the shader writes 5 words per vertex");
+
+static uint32_t groups(size_t count) {
+	return (uint32_t)((count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE);
+}
+
+// Invalid objects come back as handles, not null: the validation error scope says whether they are usable
+static bool popErrorScope(WGPUDevice device, std::string& message) {
+	struct ScopeResult {
+		bool done = false;
+		WGPUErrorType type = WGPUErrorType_NoError;
+		std::string message;
+	} result;
+	wgpuDevicePopErrorScope(device, [](WGPUErrorType type, char const* message, void* userdata) {
+		ScopeResult& result = *reinterpret_cast<ScopeResult*>(userdata);
+		result.type = type;
+		if (message) result.message = message;
+		result.done = true;
+	}, &result);
+	while (!result.done) {
+#ifdef __EMSCRIPTEN__
+		// The browser answers from its event loop: spinning here would never let it (ASYNCIFY)
+		emscripten_sleep(0);
+#else
+#ifdef WEBGPU_BACKEND_DAWN
+		wgpuDeviceTick(device);
+#elif defined(WEBGPU_BACKEND_WGPU)
+		wgpuDevicePoll(device, false, nullptr);
+#endif
+		std::this_thread::yield();
+#endif
+	}
+	message = result.message;
+	return result.type == WGPUErrorType_NoError;
+}
+
+FlowCompute::~FlowCompute() {
+	terminate();
+}
+
+bool FlowCompute::updateShader(WGPUDevice device, const ExpressionParser* parsers, int outputDim, std::string& errorMsg) {
+	std::string source = ExpressionParser::wgslPrelude();
+	for (int i = 0; i < outputDim; ++i) {
+		std::string fn;
+		if (!parsers[i].generateWgsl("f" + std::to_string(i), fn)) {
+			errorMsg = "Expression " + std::to_string(i + 1) + " uses a function not available on the GPU";
+			return false;
+		}
+		source += fn;
+	}
+
+	// Every parser of a function shares the same variable list; extra variables read 0
+	std::string args;
+	for (size_t v = 0; v < parsers[0].varCount(); ++v) {
+		if (v) args += ", ";
+		args += v == 0 ? "p.x" : v == 1 ? "p.y" : v == 2 ? "p.z" : "0.0";
+	}
+	auto call = [&args](int i) { return "f" + std::to_string(i) + "(" + args + ")"; };
+
+	source += "\nfn fieldAt(p: vec3f) -> vec3f {\n\treturn vec3f(";
+	source += call(0) + ", " + call(1) + ", " + (outputDim >= 3 ? call(2) : std::string("0.0"));
+	source += ");\n}\n";
+	source += FLOW_COMPUTE_WGSL;
+
+	size_t hash = std::hash<std::string>{}(source);
+	if (m_tracePipeline && hash == m_sourceHash) return true;
+
+	// The bind groups belong to the old layout
+	terminateStreamlines();
+	terminateParticles();
+	terminatePipelines();
+	std::string scopeMessage;
+	wgpuDevicePushErrorScope(device, WGPUErrorFilter_Validation);
+	const bool created = initPipelines(device, source);
+	if (!popErrorScope(device, scopeMessage) || !created) {
+		errorMsg = "Could not create the flow compute pipelines";
+		if (!scopeMessage.empty()) errorMsg += ": " + scopeMessage;
+		terminatePipelines();
+		return false;
+	}
+	m_sourceHash = hash;
+	return true;
+}
+
+bool FlowCompute::initPipelines(WGPUDevice device, const std::string& source) {
+	m_shaderModule = ResourceManager::createShaderModule(source, device);
+	if (!m_shaderModule) return false;
+
+	std::vector<WGPUBindGroupLayoutEntry> entries(BINDING_COUNT, WGPUBindGroupLayoutEntry{});
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		entries[i].binding = i;
+		entries[i].visibility = WGPUShaderStage_Compute;
+		entries[i].buffer.type = WGPUBufferBindingType_Storage;
+	}
+	entries[0].buffer.type = WGPUBufferBindingType_Uniform;
+	entries[0].buffer.minBindingSize = sizeof(Params);
+
+	WGPUBindGroupLayoutDescriptor bindGroupLayoutDesc{};
+	bindGroupLayoutDesc.entryCount = (uint32_t)entries.size();
+	bindGroupLayoutDesc.entries = entries.data();
+	m_bindGroupLayout = wgpuDeviceCreateBindGroupLayout(device, &bindGroupLayoutDesc);
+
+	WGPUPipelineLayoutDescriptor layoutDesc{};
+	layoutDesc.bindGroupLayoutCount = 1;
+	layoutDesc.bindGroupLayouts = &m_bindGroupLayout;
+	m_pipelineLayout = wgpuDeviceCreatePipelineLayout(device, &layoutDesc);
+
+	WGPUComputePipelineDescriptor pipelineDesc{};
+	pipelineDesc.layout = m_pipelineLayout;
+	pipelineDesc.compute.module = m_shaderModule;
+	auto create = [&](const char* label, const char* entryPoint) {
+		pipelineDesc.label = label;
+		pipelineDesc.compute.entryPoint = entryPoint;
+		return wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+	};
+	m_tracePipeline = create("Streamline trace", "traceStreamlines");
+	m_colorPipeline = create("Streamline colour", "colorStreamlines");
+	m_seedPipeline = create("Particle seed", "seedParticles");
+	m_advectPipeline = create("Particle advection", "advectParticles");
+
+	if (!m_dummyBuffer) m_dummyBuffer = createBuffer(device, 16, WGPUBufferUsage_Storage, "Flow unused binding");
+
+	return m_tracePipeline && m_colorPipeline && m_seedPipeline && m_advectPipeline && m_dummyBuffer;
+}
+
+void FlowCompute::terminatePipelines() {
+	if (m_advectPipeline) wgpuComputePipelineRelease(m_advectPipeline);
+	if (m_seedPipeline) wgpuComputePipelineRelease(m_seedPipeline);
+	if (m_colorPipeline) wgpuComputePipelineRelease(m_colorPipeline);
+	if (m_tracePipeline) wgpuComputePipelineRelease(m_tracePipeline);
+	if (m_pipelineLayout) wgpuPipelineLayoutRelease(m_pipelineLayout);
+	if (m_bindGroupLayout) wgpuBindGroupLayoutRelease(m_bindGroupLayout);
+	if (m_shaderModule) wgpuShaderModuleRelease(m_shaderModule);
+	if (m_dummyBuffer) wgpuBufferRelease(m_dummyBuffer);
+	m_advectPipeline = nullptr;
+	m_seedPipeline = nullptr;
+	m_colorPipeline = nullptr;
+	m_tracePipeline = nullptr;
+	m_pipelineLayout = nullptr;
+	m_bindGroupLayout = nullptr;
+	m_shaderModule = nullptr;
+	m_dummyBuffer = nullptr;
+	m_sourceHash = 0;
+}
+
+WGPUBuffer FlowCompute::createBuffer(WGPUDevice device, size_t size, WGPUBufferUsageFlags usage, const char* label) {
+	WGPUBufferDescriptor bufferDesc{};
+	bufferDesc.label = label;
+	bufferDesc.size = size;
+	bufferDesc.usage = usage | WGPUBufferUsage_CopyDst;
+	bufferDesc.mappedAtCreation = false;
+	return wgpuDeviceCreateBuffer(device, &bufferDesc);
+}
+
+uint64_t FlowCompute::maxBindingSize(WGPUDevice device) const {
+	WGPUSupportedLimits limits{};
+	wgpuDeviceGetLimits(device, &limits);
+	return std::min<uint64_t>(limits.limits.maxStorageBufferBindingSize, limits.limits.maxBufferSize);
+}
+
+bool FlowCompute::initBinding(WGPUDevice device, Binding& binding, WGPUBuffer vertices, size_t vertexBytes,
+	WGPUBuffer indices, size_t indexBytes, WGPUBuffer particles, size_t particleBytes) {
+	if (!binding.params) {
+		binding.params = createBuffer(device, sizeof(Params), WGPUBufferUsage_Uniform, "Flow params");
+		binding.speedRange = createBuffer(device, 4 * sizeof(uint32_t), WGPUBufferUsage_Storage, "Flow speed range");
+	}
+	if (!binding.params || !binding.speedRange || !vertices || !indices || !particles) return false;
+
+	std::vector<WGPUBindGroupEntry> bindings(BINDING_COUNT, WGPUBindGroupEntry{});
+	const WGPUBuffer buffers[BINDING_COUNT] = { binding.params, binding.speedRange, vertices, indices, particles };
+	const size_t sizes[BINDING_COUNT] = { sizeof(Params), 4 * sizeof(uint32_t), vertexBytes, indexBytes, particleBytes };
+	for (uint32_t i = 0; i < BINDING_COUNT; ++i) {
+		bindings[i].binding = i;
+		bindings[i].buffer = buffers[i];
+		bindings[i].size = sizes[i];
+	}
+
+	WGPUBindGroupDescriptor bindGroupDesc{};
+	bindGroupDesc.layout = m_bindGroupLayout;
+	bindGroupDesc.entryCount = (uint32_t)bindings.size();
+	bindGroupDesc.entries = bindings.data();
+	if (binding.bindGroup) wgpuBindGroupRelease(binding.bindGroup);
+	binding.bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+	return binding.bindGroup != nullptr;
+}
+
+void FlowCompute::terminateBinding(Binding& binding) {
+	if (binding.bindGroup) wgpuBindGroupRelease(binding.bindGroup);
+	if (binding.speedRange) wgpuBufferRelease(binding.speedRange);
+	if (binding.params) wgpuBufferRelease(binding.params);
+	binding = Binding();
+}
+
+// ─── Streamlines ────────────────────────────────────────────────────────────
+
+bool FlowCompute::dispatchStreamlines(WGPUDevice device, WGPUQueue queue, const float* rangeMin, const float* rangeMax,
+	int seedCount, int steps, float stepSize, std::string& errorMsg) {
+	PROFILE_FUNCTION();
+
+	m_lineVertexCount = 0;
+	m_lineIndexCount = 0;
+	if (!m_tracePipeline || seedCount < 1 || steps < 1) return false;
+	seedCount = std::min(seedCount, MAX_STREAMLINES);
+
+	const size_t vertexCount = (size_t)seedCount * (steps + 1);
+	const size_t indexCount = (size_t)seedCount * steps * 2;
+	const size_t vertexBytes = vertexCount * sizeof(PackedVertex);
+	const size_t indexBytes = indexCount * sizeof(uint32_t);
+	const uint64_t maxBinding = maxBindingSize(device);
+	if (vertexBytes > maxBinding || indexBytes > maxBinding) {
+		errorMsg = "Streamlines need " + std::to_string(vertexBytes >> 20) + " MB, above the device limit of "
+			+ std::to_string(maxBinding >> 20) + " MB";
+		return false;
+	}
+
+	// Sized exactly: the line pipeline draws the whole index buffer
+	terminateStreamlines();
+	m_lineVertexBuffer = createBuffer(device, vertexBytes, WGPUBufferUsage_Storage | WGPUBufferUsage_Vertex, "Streamline vertices");
+	m_lineIndexBuffer = createBuffer(device, indexBytes, WGPUBufferUsage_Storage | WGPUBufferUsage_Index, "Streamline indices");
+	if (!initBinding(device, m_lines, m_lineVertexBuffer, vertexBytes, m_lineIndexBuffer, indexBytes, m_dummyBuffer, 16)) {
+		errorMsg = "Could not allocate the streamline buffers";
+		terminateStreamlines();
+		return false;
+	}
+
+	Params params = {};
+	std::copy(rangeMin, rangeMin + 3, params.boxMin);
+	std::copy(rangeMax, rangeMax + 3, params.boxMax);
+	params.stepSize = stepSize;
+	params.count = (uint32_t)seedCount;
+	params.steps = (uint32_t)steps;
+	wgpuQueueWriteBuffer(queue, m_lines.params, 0, &params, sizeof(Params));
+	const uint32_t rangeInit[4] = {};
+	wgpuQueueWriteBuffer(queue, m_lines.speedRange, 0, rangeInit, sizeof(rangeInit));
+
+	WGPUCommandEncoderDescriptor encoderDesc{};
+	encoderDesc.label = "Streamline compute encoder";
+	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+
+	WGPUComputePassDescriptor passDesc{};
+	passDesc.label = "Streamline compute pass";
+	WGPUComputePassTimestampWrite timestamps[2];
+	passDesc.timestampWriteCount = Profiler::shared().computePassTimestamps("Streamline compute pass", timestamps);
+	passDesc.timestampWrites = timestamps;
+	WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+	wgpuComputePassEncoderSetBindGroup(pass, 0, m_lines.bindGroup, 0, nullptr);
+
+	// Separate dispatches, so the colours see the speed range of every line
+	wgpuComputePassEncoderSetPipeline(pass, m_tracePipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(seedCount), 1, 1);
+	wgpuComputePassEncoderSetPipeline(pass, m_colorPipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(vertexCount), 1, 1);
+
+	wgpuComputePassEncoderEnd(pass);
+	wgpuComputePassEncoderRelease(pass);
+
+	WGPUCommandBufferDescriptor cmdBufferDesc{};
+	cmdBufferDesc.label = "Streamline compute commands";
+	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+	wgpuCommandEncoderRelease(encoder);
+	wgpuQueueSubmit(queue, 1, &command);
+	wgpuCommandBufferRelease(command);
+
+	m_lineVertexCount = (int)vertexCount;
+	m_lineIndexCount = (int)indexCount;
+	return true;
+}
+
+void FlowCompute::terminateStreamlines() {
+	terminateBinding(m_lines);
+	if (m_lineIndexBuffer) wgpuBufferRelease(m_lineIndexBuffer);
+	if (m_lineVertexBuffer) wgpuBufferRelease(m_lineVertexBuffer);
+	m_lineIndexBuffer = nullptr;
+	m_lineVertexBuffer = nullptr;
+	m_lineVertexCount = 0;
+	m_lineIndexCount = 0;
+}
+
+// ─── Particles ──────────────────────────────────────────────────────────────
+
+bool FlowCompute::initParticles(WGPUDevice device, WGPUQueue queue, const float* rangeMin, const float* rangeMax,
+	int count, std::string& errorMsg) {
+	PROFILE_FUNCTION();
+
+	terminateParticles();
+	if (!m_seedPipeline || count < 1) return false;
+	count = std::min(count, MAX_PARTICLES);
+
+	const size_t particleBytes = (size_t)count * 4 * sizeof(float);
+	const size_t vertexBytes = (size_t)count * 2 * sizeof(PackedVertex);
+	m_particleBuffer = createBuffer(device, particleBytes, WGPUBufferUsage_Storage, "Particles");
+	m_particleVertexBuffer = createBuffer(device, vertexBytes, WGPUBufferUsage_Storage | WGPUBufferUsage_Vertex, "Particle streaks");
+	if (!initBinding(device, m_particles, m_particleVertexBuffer, vertexBytes, m_dummyBuffer, 16, m_particleBuffer, particleBytes)) {
+		errorMsg = "Could not allocate the particle buffers";
+		terminateParticles();
+		return false;
+	}
+
+	m_particleParams = {};
+	std::copy(rangeMin, rangeMin + 3, m_particleParams.boxMin);
+	std::copy(rangeMax, rangeMax + 3, m_particleParams.boxMax);
+	m_particleParams.count = (uint32_t)count;
+	m_particleParams.lifetime = PARTICLE_LIFETIME;
+	wgpuQueueWriteBuffer(queue, m_particles.params, 0, &m_particleParams, sizeof(Params));
+	const uint32_t rangeInit[4] = {};
+	wgpuQueueWriteBuffer(queue, m_particles.speedRange, 0, rangeInit, sizeof(rangeInit));
+
+	WGPUCommandEncoderDescriptor encoderDesc{};
+	encoderDesc.label = "Particle seed encoder";
+	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+	WGPUComputePassDescriptor passDesc{};
+	passDesc.label = "Particle seed pass";
+	WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+	wgpuComputePassEncoderSetBindGroup(pass, 0, m_particles.bindGroup, 0, nullptr);
+	wgpuComputePassEncoderSetPipeline(pass, m_seedPipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(count), 1, 1);
+	wgpuComputePassEncoderEnd(pass);
+	wgpuComputePassEncoderRelease(pass);
+
+	WGPUCommandBufferDescriptor cmdBufferDesc{};
+	cmdBufferDesc.label = "Particle seed commands";
+	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+	wgpuCommandEncoderRelease(encoder);
+	wgpuQueueSubmit(queue, 1, &command);
+	wgpuCommandBufferRelease(command);
+
+	m_particleCount = count;
+	return true;
+}
+
+void FlowCompute::encodeParticles(WGPUQueue queue, WGPUCommandEncoder encoder, float time, float dt, float speed) {
+	if (!m_particleCount || !m_particles.bindGroup) return;
+
+	// A long frame (a stall, a drag of the window) would otherwise fling every particle out of the box
+	dt = std::clamp(dt, 0.0f, 0.1f);
+	m_particleParams.time = time;
+	m_particleParams.dt = dt;
+	m_particleParams.stepSize = dt * speed;
+	wgpuQueueWriteBuffer(queue, m_particles.params, 0, &m_particleParams, sizeof(Params));
+
+	WGPUComputePassDescriptor passDesc{};
+	passDesc.label = "Particle pass";
+	WGPUComputePassTimestampWrite timestamps[2];
+	passDesc.timestampWriteCount = Profiler::shared().computePassTimestamps("Particle pass", timestamps);
+	passDesc.timestampWrites = timestamps;
+	WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+	wgpuComputePassEncoderSetBindGroup(pass, 0, m_particles.bindGroup, 0, nullptr);
+	wgpuComputePassEncoderSetPipeline(pass, m_advectPipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(m_particleCount), 1, 1);
+	wgpuComputePassEncoderEnd(pass);
+	wgpuComputePassEncoderRelease(pass);
+}
+
+void FlowCompute::terminateParticles() {
+	terminateBinding(m_particles);
+	if (m_particleVertexBuffer) wgpuBufferRelease(m_particleVertexBuffer);
+	if (m_particleBuffer) wgpuBufferRelease(m_particleBuffer);
+	m_particleVertexBuffer = nullptr;
+	m_particleBuffer = nullptr;
+	m_particleCount = 0;
+}
+
+void FlowCompute::terminate() {
+	terminateStreamlines();
+	terminateParticles();
+	terminatePipelines();
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ExpressionParser;
+
+// Integrates a vector field R^3 -> R^3 (or R^2, with z = 0) on the GPU.
+// The compiled expressions become a WGSL compute shader that traces RK4 streamlines,
+// one invocation per seed, into PackedVertex / LineList buffers for the "lines" pipeline,
+// and advects particles a step per frame, each drawn as a short streak.
+// Seeds fill the box evenly from a low-discrepancy sequence, so any count covers it.
+class FlowCompute {
+public:
+	static constexpr int MAX_STREAMLINES = 16384;
+	static constexpr int MAX_PARTICLES = 1 << 18;
+
+	FlowCompute() = default;
+	~FlowCompute();
+
+	FlowCompute(const FlowCompute&) = delete;
+	FlowCompute& operator=(const FlowCompute&) = delete;
+
+	// (Re)build the shader for these parsers; outputDim 2 integrates (f0, f1, 0).
+	// Returns false and sets errorMsg if an expression has no WGSL equivalent.
+	bool updateShader(WGPUDevice device, const ExpressionParser* parsers, int outputDim, std::string& errorMsg);
+
+	// Trace seedCount streamlines of up to steps RK4 steps each inside the box. Lines stop where
+	// the field stagnates or leaves the box, like GraphObjects::generateStreamlines.
+	bool dispatchStreamlines(WGPUDevice device, WGPUQueue queue, const float* rangeMin, const float* rangeMax,
+		int seedCount, int steps, float stepSize, std::string& errorMsg);
+
+	// Scatter count particles through the box; encodeParticles then moves them every frame
+	bool initParticles(WGPUDevice device, WGPUQueue queue, const float* rangeMin, const float* rangeMax,
+		int count, std::string& errorMsg);
+	// Record one advection step of dt seconds at time (MyUniforms::time), before the pass that draws them
+	void encodeParticles(WGPUQueue queue, WGPUCommandEncoder encoder, float time, float dt, float speed);
+
+	WGPUBuffer streamlineVertexBuffer() const { return m_lineVertexBuffer; }
+	WGPUBuffer streamlineIndexBuffer() const { return m_lineIndexBuffer; }
+	int streamlineVertexCount() const { return m_lineVertexCount; }
+	int streamlineIndexCount() const { return m_lineIndexCount; }
+	// Two vertices per particle, a non-indexed LineList
+	WGPUBuffer particleVertexBuffer() const { return m_particleVertexBuffer; }
+	int particleVertexCount() const { return m_particleCount * 2; }
+
+	void terminateStreamlines();
+	void terminateParticles();
+	void terminate();
+
+private:
+	// The same structure as in the generated shader, replicated in C++
+	struct Params {
+		float boxMin[3];
+		float stepSize;
+		float boxMax[3];
+		float time;
+		uint32_t count;
+		uint32_t steps;
+		float dt;
+		float lifetime;
+	};
+	static_assert(sizeof(Params) % 16 == 0);
+
+	// Buffers and bind group of one of the two uses of the shader
+	struct Binding {
+		WGPUBuffer params = nullptr;
+		WGPUBuffer speedRange = nullptr;  // atomic max speed, as float bits
+		WGPUBindGroup bindGroup = nullptr;
+	};
+
+	bool initPipelines(WGPUDevice device, const std::string& source);
+	void terminatePipelines();
+	bool initBinding(WGPUDevice device, Binding& binding, WGPUBuffer vertices, size_t vertexBytes,
+		WGPUBuffer indices, size_t indexBytes, WGPUBuffer particles, size_t particleBytes);
+	void terminateBinding(Binding& binding);
+	WGPUBuffer createBuffer(WGPUDevice device, size_t size, WGPUBufferUsageFlags usage, const char* label);
+	uint64_t maxBindingSize(WGPUDevice device) const;
+
+	size_t m_sourceHash = 0;
+	WGPUShaderModule m_shaderModule = nullptr;
+	WGPUBindGroupLayout m_bindGroupLayout = nullptr;
+	WGPUPipelineLayout m_pipelineLayout = nullptr;
+	WGPUComputePipeline m_tracePipeline = nullptr;     // positions and speeds along each streamline
+	WGPUComputePipeline m_colorPipeline = nullptr;     // streamline colours from the speed range
+	WGPUComputePipeline m_seedPipeline = nullptr;      // particle start positions
+	WGPUComputePipeline m_advectPipeline = nullptr;    // one step per particle, and its streak
+
+	// Unused bindings point here; WebGPU has no null buffer bindings
+	WGPUBuffer m_dummyBuffer = nullptr;
+
+	Binding m_lines;
+	WGPUBuffer m_lineVertexBuffer = nullptr;
+	WGPUBuffer m_lineIndexBuffer = nullptr;
+	int m_lineVertexCount = 0;
+	int m_lineIndexCount = 0;
+
+	Binding m_particles;
+	Params m_particleParams = {};
+	WGPUBuffer m_particleBuffer = nullptr;             // vec4 per particle: position, age
+	WGPUBuffer m_particleVertexBuffer = nullptr;
+	int m_particleCount = 0;
+};
@@ -0,0 +1,229 @@
+#include "GpuBufferPool.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+GpuBufferPool::~GpuBufferPool() {
+	terminate();
+}
+
+bool GpuBufferPool::init(WGPUDevice device, WGPUQueue queue, WGPUBufferUsageFlags usage, uint64_t pageSize, uint64_t maxBufferSize) {
+	m_device = device;
+	m_queue = queue;
+	m_usage = usage | WGPUBufferUsage_CopyDst;
+	m_maxBufferSize = maxBufferSize / ALIGNMENT * ALIGNMENT;
+	m_pageSize = std::min(alignUp(pageSize, ALIGNMENT), m_maxBufferSize);
+	m_fences = std::make_shared<FenceState>();
+	return addPage(m_pageSize);
+}
+
+void GpuBufferPool::terminate() {
+	for (Page& page : m_pages) {
+		wgpuBufferDestroy(page.buffer);
+		wgpuBufferRelease(page.buffer);
+	}
+	m_pages.clear();
+	m_retired.clear();
+	for (auto& retired : m_retiredBuffers) {
+		wgpuBufferDestroy(retired.first);
+		wgpuBufferRelease(retired.first);
+	}
+	m_retiredBuffers.clear();
+	m_used = 0;
+	// Callbacks still in flight only touch their own reference to the old state
+	m_fences.reset();
+}
+
+uint64_t GpuBufferPool::capacity() const {
+	uint64_t total = 0;
+	for (const Page& page : m_pages) total += page.size;
+	return total;
+}
+
+// ─── Allocation ─────────────────────────────────────────────────────────────
+
+GpuBufferPool::Slice GpuBufferPool::upload(const void* data, uint64_t size) {
+	Slice slice;
+	if (size == 0 || m_pages.empty()) return slice;
+	reclaim();
+	if (!allocate(alignUp(size, ALIGNMENT), slice)) {
+		std::cerr << "Buffer pool: " << size << " bytes exceed the " << m_maxBufferSize << " byte buffer limit" << std::endl;
+		return slice;
+	}
+	// writeBuffer wants a multiple of 4 bytes; every vertex and index format we upload is
+	wgpuQueueWriteBuffer(m_queue, slice.buffer, slice.offset, data, size);
+	slice.size = size;
+	return slice;
+}
+
+GpuBufferPool::Slice GpuBufferPool::upload(uint64_t count, uint64_t stride, const Fill& fill) {
+	Slice slice;
+	const uint64_t size = count * stride;
+	if (size == 0 || stride % 4 != 0 || m_pages.empty()) return slice;
+	reclaim();
+	if (!allocate(alignUp(size, ALIGNMENT), slice)) {
+		std::cerr << "Buffer pool: " << size << " bytes exceed the " << m_maxBufferSize << " byte buffer limit" << std::endl;
+		return slice;
+	}
+	slice.size = size;
+
+	WGPUCommandEncoderDescriptor encoderDesc = {};
+	encoderDesc.label = "Geometry staging copies";
+	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+	const uint64_t chunk = std::max<uint64_t>(STAGING_CHUNK_SIZE / stride, 1);
+	bool failed = false;
+	for (uint64_t first = 0; first < count && !failed; first += chunk) {
+		const uint64_t n = std::min(chunk, count - first);
+		WGPUBufferDescriptor bufferDesc = {};
+		bufferDesc.label = "Geometry staging";
+		bufferDesc.size = n * stride;
+		bufferDesc.usage = WGPUBufferUsage_CopySrc;
+		bufferDesc.mappedAtCreation = true;
+		WGPUBuffer staging = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+		void* dst = staging ? wgpuBufferGetMappedRange(staging, 0, n * stride) : nullptr;
+		if (!dst) {
+			std::cerr << "Buffer pool: could not map a " << n * stride << " byte staging buffer" << std::endl;
+			failed = true;
+		} else {
+			fill(dst, first, n);
+			wgpuBufferUnmap(staging);
+			wgpuCommandEncoderCopyBufferToBuffer(encoder, staging, 0, slice.buffer, slice.offset + first * stride, n * stride);
+		}
+		// Destroyed on the fence of the frame that follows, long after the copy below
+		retire(staging);
+	}
+
+	WGPUCommandBufferDescriptor cmdBufferDesc = {};
+	cmdBufferDesc.label = "Geometry staging copies";
+	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+	wgpuCommandEncoderRelease(encoder);
+	if (!failed) wgpuQueueSubmit(m_queue, 1, &command);
+	wgpuCommandBufferRelease(command);
+	if (failed) release(slice);
+	return slice;
+}
+
+bool GpuBufferPool::allocate(uint64_t size, Slice& slice) {
+	if (size > m_maxBufferSize) return false;
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		for (uint32_t p = 0; p < m_pages.size(); ++p) {
+			auto& ranges = m_pages[p].freeRanges;
+			auto it = std::find_if(ranges.begin(), ranges.end(), [size](const Range& r) { return r.size >= size; });
+			if (it == ranges.end()) continue;
+			slice.buffer = m_pages[p].buffer;
+			slice.offset = it->offset;
+			slice.page = p;
+			it->offset += size;
+			it->size -= size;
+			if (it->size == 0) ranges.erase(it);
+			m_used += size;
+			return true;
+		}
+		if (attempt == 0 && !addPage(size)) return false;
+	}
+	return false;
+}
+
+bool GpuBufferPool::addPage(uint64_t minSize) {
+	// Grow geometrically so a long drag settles on a handful of pages
+	uint64_t size = m_pages.empty() ? m_pageSize : m_pages.back().size * 2;
+	size = std::min(std::max(size, alignUp(minSize, ALIGNMENT)), m_maxBufferSize);
+
+	WGPUBufferDescriptor bufferDesc = {};
+	bufferDesc.label = "Geometry pool page";
+	bufferDesc.size = size;
+	bufferDesc.usage = m_usage;
+	bufferDesc.mappedAtCreation = false;
+	WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+	if (!buffer) {
+		std::cerr << "Buffer pool: could not create a " << size << " byte page" << std::endl;
+		return false;
+	}
+
+	Page page;
+	page.buffer = buffer;
+	page.size = size;
+	page.freeRanges.push_back({0, size});
+	m_pages.push_back(std::move(page));
+	return true;
+}
+
+void GpuBufferPool::freeRange(uint32_t page, Range range) {
+	auto& ranges = m_pages[page].freeRanges;
+	auto next = std::lower_bound(ranges.begin(), ranges.end(), range.offset,
+		[](const Range& r, uint64_t offset) { return r.offset < offset; });
+
+	// Coalesce with the neighbours so large meshes keep finding room
+	if (next != ranges.end() && range.offset + range.size == next->offset) {
+		next->offset = range.offset;
+		next->size += range.size;
+	} else {
+		next = ranges.insert(next, range);
+	}
+	if (next != ranges.begin()) {
+		auto prev = next - 1;
+		if (prev->offset + prev->size == next->offset) {
+			prev->size += next->size;
+			ranges.erase(next);
+		}
+	}
+	m_used -= range.size;
+}
+
+// ─── Fenced Reuse ───────────────────────────────────────────────────────────
+
+void GpuBufferPool::release(Slice& slice) {
+	if (slice.buffer && slice.page < m_pages.size() && m_pages[slice.page].buffer == slice.buffer) {
+		m_retired.push_back({slice.page, {slice.offset, alignUp(slice.size, ALIGNMENT)}, m_nextFence});
+	}
+	slice = Slice();
+}
+
+void GpuBufferPool::retire(WGPUBuffer buffer) {
+	if (buffer) m_retiredBuffers.push_back({buffer, m_nextFence});
+}
+
+void GpuBufferPool::onSubmit() {
+	if (!m_fences) return;
+	reclaim();
+	const bool pending = (!m_retired.empty() && m_retired.back().fence == m_nextFence)
+		|| (!m_retiredBuffers.empty() && m_retiredBuffers.back().second == m_nextFence);
+	if (!pending) return;
+
+	// Fires once everything submitted so far, including this frame, has finished
+	auto* signal = new FenceSignal{m_fences, m_nextFence};
+	wgpuQueueOnSubmittedWorkDone(m_queue, 0, onWorkDone, signal);
+	++m_nextFence;
+}
+
+void GpuBufferPool::onWorkDone(WGPUQueueWorkDoneStatus status, void* userdata) {
+	auto* signal = static_cast<FenceSignal*>(userdata);
+	// On error or device loss nothing will read the pages again either
+	(void)status;
+	signal->state->completed = std::max(signal->state->completed, signal->fence);
+	delete signal;
+}
+
+void GpuBufferPool::reclaim() {
+	const uint64_t completed = m_fences->completed;
+	auto done = std::stable_partition(m_retired.begin(), m_retired.end(),
+		[completed](const Retired& r) { return r.fence > completed; });
+	for (auto it = done; it != m_retired.end(); ++it) freeRange(it->page, it->range);
+	m_retired.erase(done, m_retired.end());
+
+	for (auto it = m_retiredBuffers.begin(); it != m_retiredBuffers.end(); ) {
+		if (it->second > completed) {
+			++it;
+			continue;
+		}
+		wgpuBufferDestroy(it->first);
+		wgpuBufferRelease(it->first);
+		it = m_retiredBuffers.erase(it);
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Suballocates vertex, index and instance data from a few large persistent buffers.
+// Uploads take a first-fit range out of a page's free list and write it with
+// wgpuQueueWriteBuffer; a new, larger page is created only when nothing fits.
+// Data that should never exist in CPU memory all at once is instead filled chunk by
+// chunk into staging buffers mapped at creation and copied in on the GPU.
+// Released ranges are fenced with wgpuQueueOnSubmittedWorkDone and go back to the
+// free list once every submission that could still read them has finished, so
+// regenerating geometry every frame costs no driver allocations.
+class GpuBufferPool {
+public:
+	struct Slice {
+		WGPUBuffer buffer = nullptr;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t page = 0;
+
+		explicit operator bool() const { return buffer != nullptr; }
+	};
+
+	GpuBufferPool() = default;
+	~GpuBufferPool();
+
+	GpuBufferPool(const GpuBufferPool&) = delete;
+	GpuBufferPool& operator=(const GpuBufferPool&) = delete;
+
+	// usage is what slices are bound as (CopyDst is added); no page grows past maxBufferSize
+	bool init(WGPUDevice device, WGPUQueue queue, WGPUBufferUsageFlags usage, uint64_t pageSize, uint64_t maxBufferSize);
+	void terminate();
+
+	// Copy size bytes into a free range. Returns an empty slice if they cannot fit in one buffer.
+	Slice upload(const void* data, uint64_t size);
+
+	// Writes count elements starting at element first into dst
+	using Fill = std::function<void(void* dst, uint64_t first, uint64_t count)>;
+	// Upload count elements of stride bytes (a multiple of 4) through fill, at most
+	// STAGING_CHUNK_SIZE bytes at a time. The copies are submitted before this returns.
+	Slice upload(uint64_t count, uint64_t stride, const Fill& fill);
+
+	// Largest slice an upload can return
+	uint64_t maxSliceSize() const { return m_maxBufferSize; }
+
+	// Give the range back once the GPU is done with it; resets slice
+	void release(Slice& slice);
+
+	// Destroy a standalone buffer on the same fence, for the few that live outside the pool
+	void retire(WGPUBuffer buffer);
+
+	// Call right after each wgpuQueueSubmit: fences the releases made since the last call
+	void onSubmit();
+
+	uint64_t capacity() const;
+	uint64_t used() const { return m_used; }
+
+private:
+	// Slice offsets and sizes stay multiples of this (vertex, index and copy alignment all divide it)
+	static constexpr uint64_t ALIGNMENT = 16;
+	static constexpr uint64_t STAGING_CHUNK_SIZE = 8ull << 20;
+
+	struct Range {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct Page {
+		WGPUBuffer buffer = nullptr;
+		uint64_t size = 0;
+		std::vector<Range> freeRanges;  // sorted by offset, never adjacent
+	};
+
+	struct Retired {
+		uint32_t page;
+		Range range;
+		uint64_t fence;
+	};
+
+	// Shared with the work-done callbacks, which may outlive the pool
+	struct FenceState {
+		uint64_t completed = 0;
+	};
+
+	// Owned by one pending wgpuQueueOnSubmittedWorkDone callback
+	struct FenceSignal {
+		std::shared_ptr<FenceState> state;
+		uint64_t fence;
+	};
+
+	bool allocate(uint64_t size, Slice& slice);
+	bool addPage(uint64_t minSize);
+	void freeRange(uint32_t page, Range range);
+	void reclaim();
+
+	static void onWorkDone(WGPUQueueWorkDoneStatus status, void* userdata);
+
+	WGPUDevice m_device = nullptr;
+	WGPUQueue m_queue = nullptr;
+	WGPUBufferUsageFlags m_usage = WGPUBufferUsage_None;
+	uint64_t m_pageSize = 0;
+	uint64_t m_maxBufferSize = 0;
+	uint64_t m_used = 0;
+
+	std::vector<Page> m_pages;
+	std::vector<Retired> m_retired;
+	std::vector<std::pair<WGPUBuffer, uint64_t>> m_retiredBuffers;
+	uint64_t m_nextFence = 1;   // signalled by the onSubmit after the current frame's releases
+	std::shared_ptr<FenceState> m_fences;
+};
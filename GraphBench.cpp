@@ -0,0 +1,554 @@
+// Headless benchmark: runs every preset in resources/presets.json through the
+// GraphObjects generators it would use in the app, at several resolutions, plus the
+// expression evaluator on its own. Needs no window or GPU device.
+//
+//   GraphBench [--presets <file>] [--json <file>] [--repeat <n>] [--filter <text>] [--quick]
+//
+// A table goes to stdout; --json writes the same rows for tracking trends over time.
+
+#include "GraphObjects.h"
+#include "ExpressionParser.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef RESOURCE_DIR
+#define RESOURCE_DIR "resources"
+#endif
+
+using json = nlohmann::json;
+using vec2 = glm::vec2;
+using vec3 = glm::vec3;
+
+// ─── Allocation Tracking ────────────────────────────────────────────────────
+
+namespace {
+std::atomic<size_t> g_liveBytes{0};
+std::atomic<size_t> g_peakBytes{0};
+std::atomic<size_t> g_allocations{0};
+
+// Each block carries its size in front so delete can account for it
+constexpr size_t HEADER = alignof(std::max_align_t);
+
+void* trackedAlloc(size_t size) {
+	void* block = std::malloc(size + HEADER);
+	if (!block) throw std::bad_alloc();
+	*static_cast<size_t*>(block) = size;
+	size_t live = g_liveBytes.fetch_add(size) + size;
+	size_t peak = g_peakBytes.load();
+	while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live)) {}
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	return static_cast<char*>(block) + HEADER;
+}
+
+void trackedFree(void* ptr) {
+	if (!ptr) return;
+	void* block = static_cast<char*>(ptr) - HEADER;
+	g_liveBytes.fetch_sub(*static_cast<size_t*>(block));
+	std::free(block);
+}
+}
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+
+// ─── Functions ──────────────────────────────────────────────────────────────
+
+namespace {
+struct BenchFunction {
+	std::string key;       // "n_m"
+	std::string name;
+	int n = 1, m = 1;
+	ExpressionParser parsers[3];
+	FusedExpression fused;
+	float rangeMin[3] = {}, rangeMax[3] = {};
+	bool differentiable = false;
+};
+
+// The variable names the app would give this shape, with the alternatives presets use
+std::vector<std::vector<std::string>> candidateNames(int n) {
+	if (n == 1) return { {"t"}, {"x"} };
+	if (n == 2) return { {"u", "v"}, {"x", "y"} };
+	return { {"x", "y", "z"} };
+}
+
+bool compileFunction(BenchFunction& f, const std::vector<std::string>& exprs, std::string& error) {
+	for (const auto& names : candidateNames(f.n)) {
+		bool ok = true;
+		for (int i = 0; i < f.m && ok; ++i) ok = f.parsers[i].compile(exprs[i], names, error);
+		if (!ok) continue;
+		const size_t width = (f.n == 1) ? 3 : (size_t)f.n + 1;
+		f.differentiable = true;
+		for (int i = 0; i < f.m; ++i) {
+			f.differentiable &= f.parsers[i].hasDerivatives() && f.parsers[i].derivativeCount() == width;
+		}
+		f.fused.build(f.parsers, f.m);
+		return true;
+	}
+	return false;
+}
+
+// Per-thread evaluation outputs, as in the app's samplers
+std::vector<float>* scratch() {
+	thread_local std::vector<float> outputs[3];
+	return outputs;
+}
+
+// Counts every sample the generators ask for
+std::atomic<size_t> g_samples{0};
+
+// The components one parser at a time, as before they were fused
+void evaluateComponents(const BenchFunction& f, const float* inputs, size_t count, std::vector<float>* out) {
+	g_samples.fetch_add(count, std::memory_order_relaxed);
+	for (int i = 0; i < f.m; ++i) {
+		out[i].resize(count);
+		f.parsers[i].evaluateBatch(inputs, count, out[i].data(), f.n);
+	}
+}
+
+void evaluate(const BenchFunction& f, const float* inputs, size_t count, std::vector<float>* out) {
+	if (!f.fused.isCompiled()) {
+		evaluateComponents(f, inputs, count, out);
+		return;
+	}
+	g_samples.fetch_add(count, std::memory_order_relaxed);
+	float* planes[3] = {};
+	for (int i = 0; i < f.m; ++i) {
+		out[i].resize(count);
+		planes[i] = out[i].data();
+	}
+	f.fused.evaluateBatch(inputs, count, planes, f.n);
+}
+
+void evaluateJets(const BenchFunction& f, const float* inputs, size_t count, std::vector<float>* out) {
+	g_samples.fetch_add(count, std::memory_order_relaxed);
+	if (f.fused.hasDerivatives()) {
+		float* planes[3] = {};
+		for (int i = 0; i < f.m; ++i) {
+			out[i].resize(count * f.fused.derivativeCount());
+			planes[i] = out[i].data();
+		}
+		f.fused.evaluateWithDerivatives(inputs, count, planes, f.n);
+		return;
+	}
+	for (int i = 0; i < f.m; ++i) {
+		out[i].resize(count * f.parsers[i].derivativeCount());
+		f.parsers[i].evaluateWithDerivatives(inputs, count, out[i].data(), f.n);
+	}
+}
+
+// Same embeddings as Application::buildFunctionGeometry (2D curves in the xy plane)
+vec3 curvePoint(int m, float t, const float* a, const float* b, const float* c) {
+	if (m == 1) return vec3(t, a[0], 0.0f);
+	if (m == 2) return vec3(a[0], b[0], 0.0f);
+	return vec3(a[0], b[0], c[0]);
+}
+
+GraphObjects::CurveSampler curveSampler(const BenchFunction& f) {
+	return [&f](const float* ts, size_t count, vec3* out) {
+		std::vector<float>* v = scratch();
+		evaluate(f, ts, count, v);
+		for (size_t k = 0; k < count; ++k) {
+			out[k] = curvePoint(f.m, ts[k], &v[0][k], f.m > 1 ? &v[1][k] : nullptr, f.m > 2 ? &v[2][k] : nullptr);
+		}
+	};
+}
+
+GraphObjects::CurveJetSampler curveJetSampler(const BenchFunction& f) {
+	if (!f.differentiable) return nullptr;
+	return [&f](const float* ts, size_t count, vec3* p, vec3* dp, vec3* ddp) {
+		std::vector<float>* v = scratch();
+		evaluateJets(f, ts, count, v);
+		for (size_t k = 0; k < count; ++k) {
+			vec3 jets[3];
+			for (int d = 0; d < 3; ++d) {
+				float a = v[0][k * 3 + d];
+				float b = f.m > 1 ? v[1][k * 3 + d] : 0.0f;
+				float c = f.m > 2 ? v[2][k * 3 + d] : 0.0f;
+				jets[d] = (f.m == 1) ? vec3(d == 0 ? ts[k] : (d == 1 ? 1.0f : 0.0f), a, 0.0f) : vec3(a, b, c);
+			}
+			p[k] = jets[0];
+			dp[k] = jets[1];
+			ddp[k] = jets[2];
+		}
+	};
+}
+
+GraphObjects::SurfaceSampler surfaceSampler(const BenchFunction& f) {
+	return [&f](const vec2* uv, size_t count, vec3* out) {
+		std::vector<float>* v = scratch();
+		evaluate(f, &uv[0].x, count, v);
+		for (size_t k = 0; k < count; ++k) {
+			if (f.m == 1) out[k] = vec3(uv[k].x, uv[k].y, v[0][k]);
+			else if (f.m == 2) out[k] = vec3(v[0][k], v[1][k], 0.0f);
+			else out[k] = vec3(v[0][k], v[1][k], v[2][k]);
+		}
+	};
+}
+
+GraphObjects::SurfaceJetSampler surfaceJetSampler(const BenchFunction& f) {
+	if (!f.differentiable) return nullptr;
+	return [&f](const vec2* uv, size_t count, vec3* p, vec3* dpdu, vec3* dpdv) {
+		std::vector<float>* v = scratch();
+		evaluateJets(f, &uv[0].x, count, v);
+		for (size_t k = 0; k < count; ++k) {
+			const float* a = &v[0][k * 3];
+			if (f.m == 1) {
+				p[k] = vec3(uv[k].x, uv[k].y, a[0]);
+				dpdu[k] = vec3(1.0f, 0.0f, a[1]);
+				dpdv[k] = vec3(0.0f, 1.0f, a[2]);
+				continue;
+			}
+			const float* b = &v[1][k * 3];
+			vec3 c = (f.m == 3) ? vec3(v[2][k * 3], v[2][k * 3 + 1], v[2][k * 3 + 2]) : vec3(0.0f);
+			p[k] = vec3(a[0], b[0], c[0]);
+			dpdu[k] = vec3(a[1], b[1], c[1]);
+			dpdv[k] = vec3(a[2], b[2], c[2]);
+		}
+	};
+}
+
+GraphObjects::FieldSampler fieldSampler(const BenchFunction& f) {
+	return [&f](const vec3* p, size_t count, vec3* out) {
+		std::vector<float>* v = scratch();
+		evaluate(f, &p[0].x, count, v);
+		for (size_t k = 0; k < count; ++k) {
+			out[k] = vec3(v[0][k], v[1][k], f.m > 2 ? v[2][k] : 0.0f);
+		}
+	};
+}
+
+GraphObjects::ScalarSampler scalarSampler(const BenchFunction& f) {
+	return [&f](const vec3* p, size_t count, float* out) {
+		std::vector<float>* v = scratch();
+		evaluate(f, &p[0].x, count, v);
+		std::copy(v[0].begin(), v[0].end(), out);
+	};
+}
+
+GraphObjects::Scalar2DSampler scalar2DSampler(const BenchFunction& f) {
+	return [&f](const vec2* uv, size_t count, float* out) {
+		std::vector<float>* v = scratch();
+		evaluate(f, &uv[0].x, count, v);
+		std::copy(v[0].begin(), v[0].end(), out);
+	};
+}
+
+// Halfway between the extremes of f over a coarse grid of the box, so the level set is not empty
+float midLevel(const BenchFunction& f) {
+	const int g = 9;
+	std::vector<float> params;
+	for (int i = 0; i < g * g * g; ++i) {
+		const int c[3] = { i % g, i / g % g, i / (g * g) };
+		for (int d = 0; d < f.n; ++d) params.push_back(f.rangeMin[d] + (f.rangeMax[d] - f.rangeMin[d]) * c[d] / (g - 1));
+	}
+	std::vector<float>* v = scratch();
+	evaluate(f, params.data(), params.size() / f.n, v);
+	float lo = INFINITY, hi = -INFINITY;
+	for (float x : v[0]) {
+		if (!std::isfinite(x)) continue;
+		lo = std::min(lo, x);
+		hi = std::max(hi, x);
+	}
+	return lo <= hi ? 0.5f * (lo + hi) : 0.0f;
+}
+
+// ─── Runs ───────────────────────────────────────────────────────────────────
+
+// What one generator call produced; bytes is what the app would upload
+struct Output {
+	size_t vertices = 0;
+	size_t instances = 0;
+	size_t bytes = 0;
+
+	void add(const std::vector<GraphObjects::VertexAttributes>& v) {
+		vertices += v.size();
+		bytes += v.size() * sizeof(PackedVertex);
+	}
+	void add(const IndexedMesh& mesh) {
+		vertices += mesh.vertices.size();
+		bytes += mesh.vertices.size() * sizeof(PackedVertex) + mesh.indices.size() * sizeof(uint32_t);
+		for (const auto& lod : mesh.lods) bytes += lod.size() * sizeof(uint32_t);
+	}
+	void add(const std::vector<GlyphInstance>& glyphs) {
+		instances += glyphs.size();
+		bytes += glyphs.size() * sizeof(GlyphInstance);
+	}
+};
+
+struct Case {
+	std::string generator;
+	int resolution;
+	std::function<Output()> run;
+};
+
+struct Result {
+	std::string preset, key, generator;
+	int resolution = 0;
+	double seconds = 0.0;      // best of the repeats
+	size_t samples = 0;
+	Output output;
+	size_t peakBytes = 0;      // above what was live before the run
+	size_t allocations = 0;
+};
+
+std::vector<Case> casesFor(const BenchFunction& f, bool quick) {
+	const float* lo = f.rangeMin;
+	const float* hi = f.rangeMax;
+	std::vector<Case> cases;
+	GraphObjects::AdaptiveOptions adaptive;
+
+	if (f.n == 1) {
+		auto curve = curveSampler(f);
+		auto jet = curveJetSampler(f);
+		for (int segments : quick ? std::vector<int>{ 500 } : std::vector<int>{ 200, 2000, 20000 }) {
+			cases.push_back({ "generateParametricCurve", segments, [=] {
+				Output o; o.add(GraphObjects::generateParametricCurve(curve, lo[0], hi[0], segments)); return o; } });
+			cases.push_back({ "generateParametricCurveTube", segments, [=] {
+				Output o; o.add(GraphObjects::generateParametricCurveTube(curve, lo[0], hi[0], segments)); return o; } });
+			cases.push_back({ "generateParametricCurveTubeAdaptive", segments, [=] {
+				Output o; o.add(GraphObjects::generateParametricCurveTubeAdaptive(curve, lo[0], hi[0], std::max(segments / 8, 16), adaptive)); return o; } });
+			cases.push_back({ "generateTangentVectors", segments, [=] {
+				Output o; o.add(GraphObjects::generateTangentVectors(curve, lo[0], hi[0], segments, 0.3f, vec3(1, 0, 0), jet)); return o; } });
+			cases.push_back({ "generateCurveNormals", segments, [=] {
+				Output o; o.add(GraphObjects::generateCurveNormals(curve, lo[0], hi[0], segments, 0.3f, vec3(0, 1, 0), false, jet)); return o; } });
+		}
+		cases.push_back({ "generateFrenetFrame", 1, [=] {
+			Output o; o.add(GraphObjects::generateFrenetFrame(curve, lo[0], hi[0], 0.5f, 0.5f, jet)); return o; } });
+	} else if (f.n == 2) {
+		auto surface = surfaceSampler(f);
+		auto jet = surfaceJetSampler(f);
+		for (int res : quick ? std::vector<int>{ 64 } : std::vector<int>{ 50, 200, 800 }) {
+			cases.push_back({ "generateParametricSurface", res, [=] {
+				Output o; o.add(GraphObjects::generateParametricSurface(surface, lo[0], hi[0], lo[1], hi[1], res, res, true, jet)); return o; } });
+			cases.push_back({ "generateParametricSurfaceAdaptive", res, [=] {
+				Output o; o.add(GraphObjects::generateParametricSurfaceAdaptive(surface, lo[0], hi[0], lo[1], hi[1],
+					std::max(res / 8, 4), std::max(res / 8, 4), adaptive, true, jet)); return o; } });
+			cases.push_back({ "generateParametricSurfaceWireframe", res, [=] {
+				Output o; o.add(GraphObjects::generateParametricSurfaceWireframe(surface, lo[0], hi[0], lo[1], hi[1], res, res)); return o; } });
+			const int arrows = std::max(res / 10, 2);
+			cases.push_back({ "generateSurfaceNormals", arrows, [=] {
+				Output o; o.add(GraphObjects::generateSurfaceNormals(surface, lo[0], hi[0], lo[1], hi[1], arrows, arrows,
+					0.3f, vec3(0, 0, 1), false, jet)); return o; } });
+			cases.push_back({ "generateSurfaceTangents", arrows, [=] {
+				Output o; o.add(GraphObjects::generateSurfaceTangents(surface, lo[0], hi[0], lo[1], hi[1], arrows, arrows,
+					0.3f, vec3(1, 0, 0), 0, jet)); return o; } });
+			if (f.m == 1) {
+				auto scalar = scalar2DSampler(f);
+				cases.push_back({ "generateGradientField2D", arrows, [=] {
+					Output o; o.add(GraphObjects::generateGradientField2D(scalar, lo[0], hi[0], lo[1], hi[1], arrows, arrows)); return o; } });
+				const std::vector<float> levels = { midLevel(f) };
+				cases.push_back({ "generateIsolines", res, [=] {
+					Output o; o.add(GraphObjects::generateIsolines(scalar, lo[0], hi[0], lo[1], hi[1], res, res, levels)); return o; } });
+			}
+		}
+	} else {
+		const vec3 boxMin(lo[0], lo[1], lo[2]), boxMax(hi[0], hi[1], hi[2]);
+		for (int res : quick ? std::vector<int>{ 5 } : std::vector<int>{ 5, 10, 20 }) {
+			const glm::ivec3 grid(res);
+			if (f.m == 1) {
+				auto scalar = scalarSampler(f);
+				cases.push_back({ "generateScalarField", res, [=] {
+					Output o; o.add(GraphObjects::generateScalarField(scalar, boxMin, boxMax, grid)); return o; } });
+				cases.push_back({ "generateGradientField3D", res, [=] {
+					Output o; o.add(GraphObjects::generateGradientField3D(scalar, boxMin, boxMax, grid)); return o; } });
+			} else {
+				auto field = fieldSampler(f);
+				cases.push_back({ "generateVectorField", res, [=] {
+					Output o; o.add(GraphObjects::generateVectorField(field, boxMin, boxMax, grid)); return o; } });
+				cases.push_back({ "generateStreamlines", res, [=] {
+					Output o; o.add(GraphObjects::generateStreamlines(field, boxMin, boxMax, grid, res * res)); return o; } });
+			}
+		}
+	}
+
+	if (f.n == 3 && f.m == 1) {
+		const vec3 boxMin(lo[0], lo[1], lo[2]), boxMax(hi[0], hi[1], hi[2]);
+		auto scalar = scalarSampler(f);
+		const std::vector<float> levels = { midLevel(f) };
+		for (int res : quick ? std::vector<int>{ 32 } : std::vector<int>{ 32, 64, 128 }) {
+			cases.push_back({ "generateIsosurface", res, [=] {
+				Output o; o.add(GraphObjects::generateIsosurface(scalar, boxMin, boxMax, glm::ivec3(res), levels)); return o; } });
+		}
+	}
+
+	// The evaluator alone, over one million parameter points
+	const size_t count = quick ? (1 << 16) : (1 << 20);
+	cases.push_back({ "evaluateBatch", (int)count, [&f, count] {
+		std::vector<float> inputs(count * f.n);
+		for (size_t k = 0; k < inputs.size(); ++k) inputs[k] = f.rangeMin[k % f.n] + (f.rangeMax[k % f.n] - f.rangeMin[k % f.n]) * (k / f.n) / count;
+		std::vector<float> out[3];
+		evaluate(f, inputs.data(), count, out);
+		return Output();
+	} });
+	if (f.fused.isCompiled() && f.m > 1) {
+		cases.push_back({ "evaluateComponents", (int)count, [&f, count] {
+			std::vector<float> inputs(count * f.n);
+			for (size_t k = 0; k < inputs.size(); ++k) inputs[k] = f.rangeMin[k % f.n] + (f.rangeMax[k % f.n] - f.rangeMin[k % f.n]) * (k / f.n) / count;
+			std::vector<float> out[3];
+			evaluateComponents(f, inputs.data(), count, out);
+			return Output();
+		} });
+	}
+	if (f.differentiable) {
+		cases.push_back({ "evaluateWithDerivatives", (int)count, [&f, count] {
+			std::vector<float> inputs(count * f.n);
+			for (size_t k = 0; k < inputs.size(); ++k) inputs[k] = f.rangeMin[k % f.n] + (f.rangeMax[k % f.n] - f.rangeMin[k % f.n]) * (k / f.n) / count;
+			std::vector<float> out[3];
+			evaluateJets(f, inputs.data(), count, out);
+			return Output();
+		} });
+	}
+	return cases;
+}
+
+Result runCase(const BenchFunction& f, const Case& c, int repeat) {
+	Result r;
+	r.preset = f.name;
+	r.key = f.key;
+	r.generator = c.generator;
+	r.resolution = c.resolution;
+	r.seconds = 1e30;
+	for (int i = 0; i < repeat; ++i) {
+		g_samples = 0;
+		const size_t liveBefore = g_liveBytes.load();
+		g_peakBytes = liveBefore;
+		const size_t allocationsBefore = g_allocations.load();
+
+		auto start = std::chrono::steady_clock::now();
+		Output output = c.run();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Allocation figures are the same every repeat; keep the fastest time
+		r.peakBytes = g_peakBytes.load() - liveBefore;
+		r.allocations = g_allocations.load() - allocationsBefore;
+		r.samples = g_samples.load();
+		r.output = output;
+		r.seconds = std::min(r.seconds, seconds);
+	}
+	return r;
+}
+
+void usage() {
+	std::cerr << "usage: GraphBench [--presets <file>] [--json <file>] [--repeat <n>] [--filter <text>] [--quick]" << std::endl;
+}
+}
+
+int main(int argc, char** argv) {
+	std::string presetsPath = RESOURCE_DIR "/presets.json";
+	std::string jsonPath;
+	std::string filter;
+	int repeat = 3;
+	bool quick = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--presets" && hasValue) presetsPath = argv[++i];
+		else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+		else if (arg == "--repeat" && hasValue) repeat = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--filter" && hasValue) filter = argv[++i];
+		else if (arg == "--quick") quick = true;
+		else {
+			usage();
+			return 2;
+		}
+	}
+
+	// Time the generators themselves, not the instrumentation
+	Profiler::shared().setEnabled(false);
+
+	std::ifstream presetsFile(presetsPath);
+	if (!presetsFile) {
+		std::cerr << "Could not open " << presetsPath << std::endl;
+		return 1;
+	}
+	json presets;
+	try {
+		presets = json::parse(presetsFile);
+	} catch (const std::exception& e) {
+		std::cerr << "Error parsing " << presetsPath << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	std::vector<Result> results;
+	std::printf("%-24s %-36s %7s %10s %12s %12s %10s %10s %8s\n",
+		"preset", "generator", "res", "ms", "samples/s", "verts/s", "KB out", "KB peak", "allocs");
+	for (auto& [key, list] : presets.items()) {
+		int n = key[0] - '0', m = key[2] - '0';
+		if (n < 1 || n > 3 || m < 1 || m > 3) continue;
+		for (auto& entry : list) {
+			BenchFunction f;
+			f.key = key;
+			f.name = entry["name"].get<std::string>();
+			f.n = n;
+			f.m = m;
+			auto exprs = entry["exprs"].get<std::vector<std::string>>();
+			auto ranges = entry["ranges"].get<std::vector<float>>();
+			for (int i = 0; i < 3 && 2 * i + 1 < (int)ranges.size(); ++i) {
+				f.rangeMin[i] = ranges[2 * i];
+				f.rangeMax[i] = ranges[2 * i + 1];
+			}
+			std::string error;
+			if ((int)exprs.size() < m || !compileFunction(f, exprs, error)) {
+				std::cerr << "Skipping " << key << " " << f.name << ": " << error << std::endl;
+				continue;
+			}
+
+			for (const Case& c : casesFor(f, quick)) {
+				if (!filter.empty() && (f.name + " " + c.generator).find(filter) == std::string::npos) continue;
+				Result r = runCase(f, c, repeat);
+				const double produced = double(r.output.vertices + r.output.instances);
+				std::printf("%-24s %-36s %7d %10.3f %12.3g %12.3g %10.1f %10.1f %8zu\n",
+					(key + " " + f.name).substr(0, 24).c_str(), r.generator.c_str(), r.resolution, r.seconds * 1e3,
+					r.samples / r.seconds, produced / r.seconds, r.output.bytes / 1024.0, r.peakBytes / 1024.0, r.allocations);
+				results.push_back(std::move(r));
+			}
+		}
+	}
+
+	if (!jsonPath.empty()) {
+		json rows = json::array();
+		for (const Result& r : results) {
+			rows.push_back({
+				{"preset", r.preset}, {"key", r.key}, {"generator", r.generator}, {"resolution", r.resolution},
+				{"seconds", r.seconds}, {"samples", r.samples},
+				{"samplesPerSecond", r.samples / r.seconds},
+				{"vertices", r.output.vertices}, {"instances", r.output.instances},
+				{"verticesPerSecond", (r.output.vertices + r.output.instances) / r.seconds},
+				{"bytes", r.output.bytes}, {"peakBytes", r.peakBytes}, {"allocations", r.allocations},
+			});
+		}
+		json report = {
+			{"timestamp", (int64_t)std::time(nullptr)},
+			{"threads", JobSystem::shared().workerCount() + 1},
+			{"repeat", repeat},
+			{"quick", quick},
+			{"results", rows},
+		};
+		std::ofstream out(jsonPath);
+		out << report.dump(1) << std::endl;
+		if (!out) {
+			std::cerr << "Could not write " << jsonPath << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -1,8 +1,13 @@
 #include "GraphObjects.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include <glm/glm.hpp>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
+#include <unordered_map>
 
+using vec2 = glm::vec2;
 using vec3 = glm::vec3;
 using VertexAttributes = ResourceManager::VertexAttributes;
 
@@ -34,11 +39,157 @@ vec3 GraphObjects::heightToColor(float height, float minH, float maxH) {
 	return magnitudeToColor(t);
 }
 
+// ─── Indexed Mesh ───────────────────────────────────────────────────────────
+
+void IndexedMesh::append(const IndexedMesh& other) {
+	if (indices.empty()) lods = other.lods;
+	else if (!other.empty()) lods.clear();
+	const uint32_t base = (uint32_t)vertices.size();
+	vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+	indices.reserve(indices.size() + other.indices.size());
+	for (uint32_t i : other.indices) indices.push_back(base + i);
+}
+
+void IndexedMesh::append(const std::vector<VertexAttributes>& verts) {
+	if (!verts.empty()) lods.clear();
+	const uint32_t base = (uint32_t)vertices.size();
+	vertices.insert(vertices.end(), verts.begin(), verts.end());
+	indices.reserve(indices.size() + verts.size());
+	for (uint32_t i = 0; i < (uint32_t)verts.size(); ++i) indices.push_back(base + i);
+}
+
+void IndexedMesh::append(IndexedMesh&& other) {
+	if (!vertices.empty()) {
+		append(static_cast<const IndexedMesh&>(other));
+		return;
+	}
+	*this = std::move(other);
+}
+
+void IndexedMesh::append(std::vector<VertexAttributes>&& verts) {
+	if (!vertices.empty()) {
+		append(static_cast<const std::vector<VertexAttributes>&>(verts));
+		return;
+	}
+	lods.clear();
+	vertices = std::move(verts);
+	indices.resize(vertices.size());
+	for (uint32_t i = 0; i < (uint32_t)indices.size(); ++i) indices[i] = i;
+}
+
+Aabb IndexedMesh::bounds() const {
+	Aabb box;
+	for (const auto& v : vertices) {
+		const glm::vec3& p = v.position;
+		if (std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z)) box.add(p);
+	}
+	return box;
+}
+
+// ─── Sampling Utilities ─────────────────────────────────────────────────────
+
+// Samples per job when a batch is split across the JobSystem
+constexpr size_t SAMPLE_TILE = 4096;
+
+// Evaluate a batch sampler over n inputs as independent tiles on the job pool.
+// Samplers only read their compiled expressions, so tiles can run concurrently.
+template <class Sampler, class In, class Out>
+static void sampleTiled(const Sampler& sampler, const In* in, size_t n, Out* out) {
+	JobSystem::shared().parallelFor(n, SAMPLE_TILE, [&](size_t begin, size_t end) {
+		sampler(in + begin, end - begin, out + begin);
+	});
+}
+
+std::vector<vec2> GraphObjects::parameterGrid(float uMin, float uMax, float vMin, float vMax, int uCount, int vCount) {
+	std::vector<vec2> params;
+	params.reserve((size_t)std::max(uCount, 0) * std::max(vCount, 0));
+	for (int i = 0; i < uCount; ++i) {
+		float u = uMin + (uMax - uMin) * i / std::max(uCount - 1, 1);
+		for (int j = 0; j < vCount; ++j) {
+			float v = vMin + (vMax - vMin) * j / std::max(vCount - 1, 1);
+			params.push_back(vec2(u, v));
+		}
+	}
+	return params;
+}
+
+void GraphObjects::sampleCurveJet(const CurveSampler& curveFunc, const CurveJetSampler& curveJet,
+	const std::vector<float>& ts, float eps,
+	std::vector<vec3>& p, std::vector<vec3>& dp, std::vector<vec3>* ddp) {
+
+	const size_t n = ts.size();
+	p.resize(n);
+	dp.resize(n);
+	if (ddp) ddp->resize(n);
+
+	if (curveJet) {
+		JobSystem::shared().parallelFor(n, SAMPLE_TILE, [&](size_t begin, size_t end) {
+			// The plain sampler's second derivative is not wanted everywhere; keep a scratch tile for it
+			std::vector<vec3> scratch(ddp ? 0 : end - begin);
+			vec3* second = ddp ? ddp->data() + begin : scratch.data();
+			curveJet(ts.data() + begin, end - begin, p.data() + begin, dp.data() + begin, second);
+		});
+		return;
+	}
+
+	// [t][t+eps][t-eps], each block n long
+	std::vector<float> params(n * 3);
+	for (size_t k = 0; k < n; ++k) {
+		params[k] = ts[k];
+		params[n + k] = ts[k] + eps;
+		params[n * 2 + k] = ts[k] - eps;
+	}
+	std::vector<vec3> samples(params.size());
+	sampleTiled(curveFunc, params.data(), params.size(), samples.data());
+
+	for (size_t k = 0; k < n; ++k) {
+		p[k] = samples[k];
+		dp[k] = (samples[n + k] - samples[n * 2 + k]) / (2.0f * eps);
+		if (ddp) (*ddp)[k] = (samples[n + k] - 2.0f * samples[k] + samples[n * 2 + k]) / (eps * eps);
+	}
+}
+
+void GraphObjects::sampleSurfaceJet(const SurfaceSampler& surfaceFunc, const SurfaceJetSampler& surfaceJet,
+	const std::vector<vec2>& uv, float eps,
+	std::vector<vec3>& p, std::vector<vec3>& dpdu, std::vector<vec3>& dpdv) {
+
+	const size_t n = uv.size();
+	p.resize(n);
+	dpdu.resize(n);
+	dpdv.resize(n);
+
+	if (surfaceJet) {
+		JobSystem::shared().parallelFor(n, SAMPLE_TILE, [&](size_t begin, size_t end) {
+			surfaceJet(uv.data() + begin, end - begin, p.data() + begin, dpdu.data() + begin, dpdv.data() + begin);
+		});
+		return;
+	}
+
+	// [p][+u][-u][+v][-v], each block n long
+	std::vector<vec2> params(n * 5);
+	for (size_t k = 0; k < n; ++k) {
+		params[k] = uv[k];
+		params[n * 1 + k] = uv[k] + vec2(eps, 0);
+		params[n * 2 + k] = uv[k] - vec2(eps, 0);
+		params[n * 3 + k] = uv[k] + vec2(0, eps);
+		params[n * 4 + k] = uv[k] - vec2(0, eps);
+	}
+	std::vector<vec3> samples(params.size());
+	sampleTiled(surfaceFunc, params.data(), params.size(), samples.data());
+
+	for (size_t k = 0; k < n; ++k) {
+		p[k] = samples[k];
+		dpdu[k] = (samples[n * 1 + k] - samples[n * 2 + k]) / (2.0f * eps);
+		dpdv[k] = (samples[n * 3 + k] - samples[n * 4 + k]) / (2.0f * eps);
+	}
+}
+
 // ─── Arrow Mesh ─────────────────────────────────────────────────────────────
 
 std::vector<VertexAttributes> GraphObjects::generateArrowMesh(
 	float shaftLength, float shaftRadius, float headLength, float headRadius,
 	int segments, vec3 color) {
+	PROFILE_FUNCTION();
 
 	std::vector<VertexAttributes> verts;
 
@@ -123,14 +274,126 @@ std::vector<VertexAttributes> GraphObjects::generateArrowMesh(
 	return verts;
 }
 
+// ─── Glyphs ──────────────────────────────────────────────────────────────────
+
+std::vector<VertexAttributes> GraphObjects::unitArrowMesh() {
+	return generateArrowMesh(0.7f, 1.0f, 0.3f, 3.0f, 6, vec3(1, 1, 1));
+}
+
+std::vector<VertexAttributes> GraphObjects::unitCubeMesh() {
+	return generateColoredCube(1.0f, vec3(1, 1, 1));
+}
+
+GlyphInstance GraphObjects::arrowGlyph(vec3 pos, vec3 dir, float len, float radius, vec3 color) {
+	return {pos, len, glm::normalize(dir), radius, packColor(color)};
+}
+
+vec2 GraphObjects::glyphMeshExtent(const std::vector<VertexAttributes>& mesh) {
+	vec2 extent(0.0f);
+	for (const VertexAttributes& v : mesh) {
+		extent.x = std::max(extent.x, std::sqrt(v.position.x * v.position.x + v.position.y * v.position.y));
+		extent.y = std::max(extent.y, std::abs(v.position.z));
+	}
+	return extent;
+}
+
+Aabb GraphObjects::glyphBounds(const std::vector<GlyphInstance>& glyphs, vec2 meshExtent) {
+	// The cross section is scaled by length * radius and the axis by length; the two are
+	// perpendicular, so no vertex is farther from the glyph's position than this
+	Aabb box;
+	for (const GlyphInstance& g : glyphs) {
+		const float across = meshExtent.x * g.radius;
+		float reach = g.length * std::sqrt(across * across + meshExtent.y * meshExtent.y);
+		box.add(g.position - vec3(reach));
+		box.add(g.position + vec3(reach));
+	}
+	return box;
+}
+
+uint32_t GraphObjects::packColor(vec3 color) {
+	glm::uvec3 c = glm::uvec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return c.x | (c.y << 8) | (c.z << 16) | (255u << 24);
+}
+
+// ─── Packed Vertices ────────────────────────────────────────────────────────
+
+uint32_t GraphObjects::packNormal(vec3 n) {
+	// Project onto the octahedron |x|+|y|+|z| = 1, then fold the lower half over the diagonals
+	float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	vec2 p = (l1 > 1e-20f) ? vec2(n.x, n.y) / l1 : vec2(0.0f);
+	if (l1 > 1e-20f && n.z < 0.0f) {
+		vec2 sign(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+		p = (1.0f - vec2(std::abs(p.y), std::abs(p.x))) * sign;
+	}
+	auto snorm16 = [](float x) { return (uint32_t)(uint16_t)(int16_t)std::lround(glm::clamp(x, -1.0f, 1.0f) * 32767.0f); };
+	return snorm16(p.x) | (snorm16(p.y) << 16);
+}
+
+std::vector<PackedVertex> GraphObjects::packVertices(const std::vector<VertexAttributes>& vertices, bool heightScalar) {
+	std::vector<PackedVertex> packed(vertices.size());
+	packVertices(vertices.data(), vertices.size(), packed.data(), heightScalar);
+	return packed;
+}
+
+void GraphObjects::packVertices(const VertexAttributes* vertices, size_t count, PackedVertex* out, bool heightScalar) {
+	JobSystem::shared().parallelFor(count, SAMPLE_TILE, [&](size_t first, size_t last) {
+		for (size_t k = first; k < last; ++k) {
+			const VertexAttributes& v = vertices[k];
+			uint32_t color;
+			if (heightScalar) std::memcpy(&color, &v.position.z, sizeof(color));
+			else color = packColor(v.color);
+			out[k] = {v.position, packNormal(v.normal), color};
+		}
+	});
+}
+
+// ─── Colormaps ──────────────────────────────────────────────────────────────
+
+const char* const GraphObjects::COLORMAP_NAMES[COLORMAP_COUNT] = { "Rainbow", "Viridis", "Plasma", "Cool-warm", "Grayscale" };
+
+std::vector<uint32_t> GraphObjects::colormapTexels() {
+	// Evenly spaced stops, linearly interpolated (viridis and plasma as in matplotlib)
+	static const std::vector<vec3> stops[COLORMAP_COUNT] = {
+		{},
+		{ {0.267f, 0.005f, 0.329f}, {0.282f, 0.157f, 0.471f}, {0.243f, 0.286f, 0.537f}, {0.192f, 0.408f, 0.557f},
+		  {0.149f, 0.510f, 0.557f}, {0.122f, 0.620f, 0.537f}, {0.208f, 0.718f, 0.475f}, {0.431f, 0.808f, 0.345f},
+		  {0.710f, 0.871f, 0.169f}, {0.992f, 0.906f, 0.145f} },
+		{ {0.051f, 0.031f, 0.529f}, {0.275f, 0.012f, 0.624f}, {0.447f, 0.004f, 0.659f}, {0.612f, 0.090f, 0.620f},
+		  {0.741f, 0.216f, 0.525f}, {0.847f, 0.341f, 0.420f}, {0.929f, 0.475f, 0.325f}, {0.984f, 0.624f, 0.227f},
+		  {0.992f, 0.792f, 0.149f}, {0.941f, 0.976f, 0.129f} },
+		{ {0.231f, 0.298f, 0.753f}, {0.553f, 0.690f, 0.996f}, {0.867f, 0.867f, 0.867f}, {0.957f, 0.604f, 0.482f},
+		  {0.706f, 0.016f, 0.149f} },
+		{ {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f} },
+	};
+
+	std::vector<uint32_t> texels(COLORMAP_COUNT * COLORMAP_SIZE);
+	for (int map = 0; map < COLORMAP_COUNT; ++map) {
+		const std::vector<vec3>& s = stops[map];
+		for (int i = 0; i < COLORMAP_SIZE; ++i) {
+			float t = i / float(COLORMAP_SIZE - 1);
+			vec3 c;
+			if (s.empty()) {
+				c = magnitudeToColor(t);
+			} else {
+				float x = t * (s.size() - 1);
+				size_t k = std::min((size_t)x, s.size() - 2);
+				c = glm::mix(s[k], s[k + 1], x - k);
+			}
+			texels[map * COLORMAP_SIZE + i] = packColor(c);
+		}
+	}
+	return texels;
+}
+
 // ─── Vector Field ───────────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateVectorField(
-	std::function<vec3(vec3)> fieldFunc,
+std::vector<GlyphInstance> GraphObjects::generateVectorField(
+	const FieldSampler& fieldFunc,
 	vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 	float arrowScale) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 
 	vec3 step = (rangeMax - rangeMin) / vec3(
 		std::max(resolution.x - 1, 1),
@@ -139,78 +402,62 @@ std::vector<VertexAttributes> GraphObjects::generateVectorField(
 	);
 
 	// First pass: evaluate field and find max magnitude
-	struct ArrowInfo { vec3 pos; vec3 dir; float mag; };
-	std::vector<ArrowInfo> arrows;
-	float maxMag = 0.001f;
-
+	std::vector<vec3> positions((size_t)std::max(resolution.x, 0) * std::max(resolution.y, 0) * std::max(resolution.z, 0));
+	size_t k = 0;
 	for (int ix = 0; ix < resolution.x; ++ix) {
 		for (int iy = 0; iy < resolution.y; ++iy) {
 			for (int iz = 0; iz < resolution.z; ++iz) {
-				vec3 pos = rangeMin + vec3(ix, iy, iz) * step;
-				vec3 dir = fieldFunc(pos);
-				float mag = glm::length(dir);
-				maxMag = std::max(maxMag, mag);
-				arrows.push_back({pos, dir, mag});
+				positions[k++] = rangeMin + vec3(ix, iy, iz) * step;
 			}
 		}
 	}
+	std::vector<vec3> dirs(positions.size());
+	sampleTiled(fieldFunc, positions.data(), positions.size(), dirs.data());
+
+	float maxMag = 0.001f;
+	for (const vec3& d : dirs) maxMag = std::max(maxMag, glm::length(d));
 
 	const float minLen = 0.05f * arrowScale;
 	const float maxLen = 0.8f * arrowScale;
 
-	for (auto& arrow : arrows) {
-		if (arrow.mag < 1e-6f) continue;
+	glyphs.reserve(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		float mag = glm::length(dirs[i]);
+		if (mag < 1e-6f) continue;
 
-		float normalizedMag = arrow.mag / maxMag;
+		float normalizedMag = mag / maxMag;
 		float len = minLen + (maxLen - minLen) * normalizedMag;
 		vec3 color = magnitudeToColor(normalizedMag);
 
-		// Generate arrow mesh along +Z
-		auto mesh = generateArrowMesh(
-			len * 0.7f,   // shaft length
-			len * 0.04f,  // shaft radius
-			len * 0.3f,   // head length
-			len * 0.1f,   // head radius
-			6, color);
-
-		// Build rotation from +Z to arrow direction
-		vec3 dir = glm::normalize(arrow.dir);
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + arrow.pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		// Thicker than the overlay arrows so the field reads at a distance
+		glyphs.push_back(arrowGlyph(positions[i], dirs[i], len, 0.035f, color));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Parametric Curve ───────────────────────────────────────────────────────
 
 std::vector<VertexAttributes> GraphObjects::generateParametricCurve(
-	std::function<vec3(float)> curveFunc,
+	const CurveSampler& curveFunc,
 	float tMin, float tMax, int segments,
 	vec3 color) {
+	PROFILE_FUNCTION();
 
 	std::vector<VertexAttributes> verts;
+	if (segments < 1) return verts;
 	float dt = (tMax - tMin) / segments;
 
-	for (int i = 0; i < segments; ++i) {
-		float t0 = tMin + i * dt;
-		float t1 = tMin + (i + 1) * dt;
-
-		vec3 p0 = curveFunc(t0);
-		vec3 p1 = curveFunc(t1);
+	// Each interior point is shared by two segments, so sample it once
+	std::vector<float> ts(segments + 1);
+	for (int i = 0; i <= segments; ++i) ts[i] = tMin + i * dt;
+	std::vector<vec3> points(segments + 1);
+	sampleTiled(curveFunc, ts.data(), ts.size(), points.data());
 
-		verts.push_back({p0, {0, 0, 0}, color, {0, 0}});
-		verts.push_back({p1, {0, 0, 0}, color, {0, 0}});
+	verts.resize((size_t)segments * 2);
+	for (int i = 0; i < segments; ++i) {
+		verts[2 * i] = {points[i], {0, 0, 0}, color, {0, 0}};
+		verts[2 * i + 1] = {points[i + 1], {0, 0, 0}, color, {0, 0}};
 	}
 
 	return verts;
@@ -218,22 +465,32 @@ std::vector<VertexAttributes> GraphObjects::generateParametricCurve(
 
 // ─── Parametric Curve Tube ──────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateParametricCurveTube(
-	std::function<vec3(float)> curveFunc,
+IndexedMesh GraphObjects::generateParametricCurveTube(
+	const CurveSampler& curveFunc,
 	float tMin, float tMax, int segments,
 	float tubeRadius, int tubeSegments,
 	vec3 color) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> verts;
-	if (segments < 1) return verts;
+	if (segments < 1 || tubeSegments < 1) return IndexedMesh();
 
 	float dt = (tMax - tMin) / segments;
 
 	// Sample curve points
+	std::vector<float> ts(segments + 1);
+	for (int i = 0; i <= segments; ++i) ts[i] = tMin + i * dt;
 	std::vector<vec3> points(segments + 1);
-	for (int i = 0; i <= segments; ++i) {
-		points[i] = curveFunc(tMin + i * dt);
-	}
+	sampleTiled(curveFunc, ts.data(), ts.size(), points.data());
+
+	return tubeAlongPoints(points, tubeRadius, tubeSegments, color);
+}
+
+IndexedMesh GraphObjects::tubeAlongPoints(const std::vector<vec3>& points,
+	float tubeRadius, int tubeSegments, vec3 color) {
+
+	IndexedMesh mesh;
+	if (points.size() < 2 || tubeSegments < 1) return mesh;
+	const int segments = (int)points.size() - 1;
 
 	// Compute tangents via finite differences
 	std::vector<vec3> tangents(segments + 1);
@@ -274,230 +531,529 @@ std::vector<VertexAttributes> GraphObjects::generateParametricCurveTube(
 		binormals[i] = glm::cross(ti, normals[i]);
 	}
 
-	// Generate tube rings and connect with triangles
-	// Each ring has tubeSegments vertices
-	auto ringPoint = [&](int curveIdx, int ringIdx) -> vec3 {
-		float angle = 2.0f * GPI * ringIdx / tubeSegments;
-		float c = cosf(angle), s = sinf(angle);
-		return points[curveIdx] + tubeRadius * (c * normals[curveIdx] + s * binormals[curveIdx]);
-	};
-
-	auto ringNormal = [&](int curveIdx, int ringIdx) -> vec3 {
-		float angle = 2.0f * GPI * ringIdx / tubeSegments;
-		float c = cosf(angle), s = sinf(angle);
-		return glm::normalize(c * normals[curveIdx] + s * binormals[curveIdx]);
-	};
+	// One ring of tubeSegments vertices per curve point
+	mesh.vertices.reserve((size_t)(segments + 1) * tubeSegments);
+	for (int i = 0; i <= segments; ++i) {
+		for (int j = 0; j < tubeSegments; ++j) {
+			float angle = 2.0f * GPI * j / tubeSegments;
+			float c = cosf(angle), s = sinf(angle);
+			vec3 radial = c * normals[i] + s * binormals[i];
+			mesh.vertices.push_back({points[i] + tubeRadius * radial, glm::normalize(radial), color, {0, 0}});
+		}
+	}
 
+	// Connect consecutive rings with two triangles per quad
+	auto ring = [tubeSegments](int i, int j) { return (uint32_t)(i * tubeSegments + j); };
+	mesh.indices.reserve((size_t)segments * tubeSegments * 6);
 	for (int i = 0; i < segments; ++i) {
 		for (int j = 0; j < tubeSegments; ++j) {
 			int j1 = (j + 1) % tubeSegments;
+			mesh.indices.insert(mesh.indices.end(), {
+				ring(i, j), ring(i, j1), ring(i + 1, j),
+				ring(i + 1, j), ring(i, j1), ring(i + 1, j1),
+			});
+		}
+	}
+
+	addTubeLods(mesh, segments, tubeSegments);
+	return mesh;
+}
 
-			vec3 p00 = ringPoint(i, j);
-			vec3 p01 = ringPoint(i, j1);
-			vec3 p10 = ringPoint(i + 1, j);
-			vec3 p11 = ringPoint(i + 1, j1);
-
-			vec3 n00 = ringNormal(i, j);
-			vec3 n01 = ringNormal(i, j1);
-			vec3 n10 = ringNormal(i + 1, j);
-			vec3 n11 = ringNormal(i + 1, j1);
-
-			// Triangle 1
-			verts.push_back({p00, n00, color, {0, 0}});
-			verts.push_back({p01, n01, color, {0, 0}});
-			verts.push_back({p10, n10, color, {0, 0}});
-
-			// Triangle 2
-			verts.push_back({p10, n10, color, {0, 0}});
-			verts.push_back({p01, n01, color, {0, 0}});
-			verts.push_back({p11, n11, color, {0, 0}});
+// ─── Level of Detail ────────────────────────────────────────────────────────
+
+// Grid lines 0, stride, 2*stride, ... plus the last one, so every level spans the full range
+static std::vector<int> strideLines(int segments, int stride) {
+	std::vector<int> lines;
+	for (int i = 0; i < segments; i += stride) lines.push_back(i);
+	lines.push_back(segments);
+	return lines;
+}
+
+void GraphObjects::addGridLods(IndexedMesh& mesh, int uSegments, int vSegments) {
+	mesh.lods.clear();
+	const uint32_t vCount = (uint32_t)vSegments + 1;
+	for (int level = 1; level < LOD_LEVELS; ++level) {
+		const int stride = 1 << level;
+		if (uSegments < stride * 2 && vSegments < stride * 2) break;
+		std::vector<int> us = strideLines(uSegments, stride);
+		std::vector<int> vs = strideLines(vSegments, stride);
+
+		std::vector<uint32_t> indices;
+		indices.reserve((us.size() - 1) * (vs.size() - 1) * 6);
+		for (size_t a = 0; a + 1 < us.size(); ++a) {
+			for (size_t b = 0; b + 1 < vs.size(); ++b) {
+				uint32_t k00 = (uint32_t)us[a] * vCount + vs[b];
+				uint32_t k10 = (uint32_t)us[a + 1] * vCount + vs[b];
+				uint32_t k01 = (uint32_t)us[a] * vCount + vs[b + 1];
+				uint32_t k11 = (uint32_t)us[a + 1] * vCount + vs[b + 1];
+				indices.insert(indices.end(), { k00, k10, k11, k00, k11, k01 });
+			}
 		}
+		mesh.lods.push_back(std::move(indices));
 	}
+}
 
-	return verts;
+void GraphObjects::addTubeLods(IndexedMesh& mesh, int segments, int tubeSegments) {
+	mesh.lods.clear();
+	// Only the rings thin out; the cross section keeps its shape
+	auto ring = [tubeSegments](int i, int j) { return (uint32_t)(i * tubeSegments + j); };
+	for (int level = 1; level < LOD_LEVELS; ++level) {
+		const int stride = 1 << level;
+		if (segments < stride * 2) break;
+		std::vector<int> rings = strideLines(segments, stride);
+
+		std::vector<uint32_t> indices;
+		indices.reserve((rings.size() - 1) * tubeSegments * 6);
+		for (size_t a = 0; a + 1 < rings.size(); ++a) {
+			int i0 = rings[a], i1 = rings[a + 1];
+			for (int j = 0; j < tubeSegments; ++j) {
+				int j1 = (j + 1) % tubeSegments;
+				indices.insert(indices.end(), {
+					ring(i0, j), ring(i0, j1), ring(i1, j),
+					ring(i1, j), ring(i0, j1), ring(i1, j1),
+				});
+			}
+		}
+		mesh.lods.push_back(std::move(indices));
+	}
 }
 
 // ─── Parametric Surface ─────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateParametricSurface(
-	std::function<vec3(float, float)> surfaceFunc,
+IndexedMesh GraphObjects::generateParametricSurface(
+	const SurfaceSampler& surfaceFunc,
 	float uMin, float uMax, float vMin, float vMax,
 	int uSegments, int vSegments,
-	bool colorByHeight) {
+	bool colorByHeight,
+	const SurfaceJetSampler& surfaceJet) {
+	PROFILE_FUNCTION();
 
-	float du = (uMax - uMin) / uSegments;
-	float dv = (vMax - vMin) / vSegments;
+	const int vCount = vSegments + 1;
+	std::vector<vec2> params = parameterGrid(uMin, uMax, vMin, vMax, uSegments + 1, vCount);
+	const size_t gridSize = params.size();
+	std::vector<vec3> positions, dpdu, dpdv;
+	sampleSurfaceJet(surfaceFunc, surfaceJet, params, 1e-4f, positions, dpdu, dpdv);
 
-	// Evaluate positions and find height range
-	std::vector<std::vector<vec3>> positions(uSegments + 1, std::vector<vec3>(vSegments + 1));
+	// Height range
 	float minH = 1e9f, maxH = -1e9f;
+	for (size_t k = 0; k < gridSize; ++k) {
+		minH = std::min(minH, positions[k].z);
+		maxH = std::max(maxH, positions[k].z);
+	}
 
-	for (int i = 0; i <= uSegments; ++i) {
-		for (int j = 0; j <= vSegments; ++j) {
-			float u = uMin + i * du;
-			float v = vMin + j * dv;
-			positions[i][j] = surfaceFunc(u, v);
-			float h = positions[i][j].z;
-			minH = std::min(minH, h);
-			maxH = std::max(maxH, h);
+	// One vertex per grid point
+	IndexedMesh mesh;
+	mesh.vertices.resize(gridSize);
+	JobSystem::shared().parallelFor(gridSize, SAMPLE_TILE, [&](size_t first, size_t last) {
+		for (size_t k = first; k < last; ++k) {
+			vec3 n = glm::cross(dpdu[k], dpdv[k]);
+			float len = glm::length(n);
+			if (len > 1e-8f) n /= len;
+			else n = vec3(0, 0, 1);
+
+			const vec3& p = positions[k];
+			vec3 c = colorByHeight ? heightToColor(p.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
+			mesh.vertices[k] = {p, n, c, {0, 0}};
+		}
+	});
+
+	// Two triangles per cell
+	mesh.indices.reserve((size_t)uSegments * vSegments * 6);
+	for (int i = 0; i < uSegments; ++i) {
+		for (int j = 0; j < vSegments; ++j) {
+			uint32_t k00 = (uint32_t)(i * vCount + j);
+			uint32_t k10 = k00 + vCount;
+			uint32_t k01 = k00 + 1;
+			uint32_t k11 = k10 + 1;
+			mesh.indices.insert(mesh.indices.end(), { k00, k10, k11, k00, k11, k01 });
 		}
 	}
 
-	// Compute normals via finite differences
-	std::vector<std::vector<vec3>> normals(uSegments + 1, std::vector<vec3>(vSegments + 1));
-	float eps = 1e-4f;
+	addGridLods(mesh, uSegments, vSegments);
+	return mesh;
+}
 
-	for (int i = 0; i <= uSegments; ++i) {
-		for (int j = 0; j <= vSegments; ++j) {
-			float u = uMin + i * du;
-			float v = vMin + j * dv;
+std::vector<float> GraphObjects::generateHeightfield(
+	const Scalar2DSampler& scalarFunc,
+	float uMin, float uMax, float vMin, float vMax,
+	int uSegments, int vSegments) {
+	PROFILE_FUNCTION();
+
+	// parameterGrid runs its second axis fastest, so ask for (v, u) and swap each pair
+	std::vector<vec2> params = parameterGrid(vMin, vMax, uMin, uMax, vSegments + 1, uSegments + 1);
+	for (vec2& p : params) p = vec2(p.y, p.x);
+	std::vector<float> heights(params.size());
+	sampleTiled(scalarFunc, params.data(), params.size(), heights.data());
+	return heights;
+}
 
-			vec3 dpdu = (surfaceFunc(u + eps, v) - surfaceFunc(u - eps, v)) / (2.0f * eps);
-			vec3 dpdv = (surfaceFunc(u, v + eps) - surfaceFunc(u, v - eps)) / (2.0f * eps);
+// ─── Adaptive Sampling ──────────────────────────────────────────────────────
 
-			vec3 n = glm::cross(dpdu, dpdv);
-			float len = glm::length(n);
-			if (len > 1e-8f) n /= len;
-			else n = vec3(0, 0, 1);
+// Bounding box diagonal of the finite samples, so tolerances follow the size of the shape
+static float boundingDiagonal(const vec3* p, size_t n) {
+	vec3 lo(1e30f), hi(-1e30f);
+	for (size_t k = 0; k < n; ++k) {
+		if (!std::isfinite(p[k].x) || !std::isfinite(p[k].y) || !std::isfinite(p[k].z)) continue;
+		lo = glm::min(lo, p[k]);
+		hi = glm::max(hi, p[k]);
+	}
+	return (hi.x >= lo.x) ? glm::length(hi - lo) : 0.0f;
+}
+
+// Cosine of the angle between two consecutive chords; 1 when either is degenerate
+static float bendCosine(vec3 a, vec3 b) {
+	float la = glm::length(a), lb = glm::length(b);
+	if (la < 1e-12f || lb < 1e-12f) return 1.0f;
+	return glm::dot(a, b) / (la * lb);
+}
+
+IndexedMesh GraphObjects::generateParametricCurveTubeAdaptive(
+	const CurveSampler& curveFunc,
+	float tMin, float tMax, int baseSegments,
+	const AdaptiveOptions& options,
+	float tubeRadius, int tubeSegments,
+	vec3 color) {
+	PROFILE_FUNCTION();
+
+	if (baseSegments < 1 || tubeSegments < 1) return IndexedMesh();
+
+	std::vector<float> ts(baseSegments + 1);
+	for (int i = 0; i <= baseSegments; ++i) ts[i] = tMin + (tMax - tMin) * i / baseSegments;
+	std::vector<vec3> points(ts.size());
+	sampleTiled(curveFunc, ts.data(), ts.size(), points.data());
+
+	const float tol = options.tolerance * std::max(boundingDiagonal(points.data(), points.size()), 1e-6f);
+	const float cosMax = cosf(options.maxAngle);
 
-			normals[i][j] = n;
+	// Each pass bisects the intervals the previous one split, sampling all their midpoints in one batch.
+	// refine[i] flags the interval [ts[i], ts[i+1]].
+	std::vector<char> refine(baseSegments, 1);
+	for (int depth = 0; depth < options.maxDepth; ++depth) {
+		std::vector<size_t> candidates;
+		for (size_t i = 0; i < refine.size(); ++i) {
+			if (refine[i]) candidates.push_back(i);
+		}
+		if (candidates.empty()) break;
+
+		std::vector<float> midTs(candidates.size());
+		for (size_t c = 0; c < candidates.size(); ++c) {
+			midTs[c] = 0.5f * (ts[candidates[c]] + ts[candidates[c] + 1]);
+		}
+		std::vector<vec3> mids(candidates.size());
+		sampleTiled(curveFunc, midTs.data(), midTs.size(), mids.data());
+
+		std::vector<float> nextTs;
+		std::vector<vec3> nextPoints;
+		std::vector<char> nextRefine;
+		nextTs.reserve(ts.size() + candidates.size());
+		nextPoints.reserve(ts.size() + candidates.size());
+		nextRefine.reserve(refine.size() + candidates.size());
+		size_t c = 0;
+		for (size_t i = 0; i + 1 < ts.size(); ++i) {
+			nextTs.push_back(ts[i]);
+			nextPoints.push_back(points[i]);
+			bool split = false;
+			if (c < candidates.size() && candidates[c] == i) {
+				const vec3& a = points[i];
+				const vec3& b = points[i + 1];
+				const vec3& mid = mids[c];
+				// Chord deviation, or a bend the straight segment would cut off
+				split = glm::length(mid - 0.5f * (a + b)) > tol || bendCosine(mid - a, b - mid) < cosMax;
+				if (split) {
+					nextTs.push_back(midTs[c]);
+					nextPoints.push_back(mid);
+					nextRefine.push_back(1);
+				}
+				++c;
+			}
+			nextRefine.push_back(split ? 1 : 0);
 		}
+		nextTs.push_back(ts.back());
+		nextPoints.push_back(points.back());
+
+		ts.swap(nextTs);
+		points.swap(nextPoints);
+		refine.swap(nextRefine);
 	}
 
-	// Build triangle list
-	std::vector<VertexAttributes> verts;
+	return tubeAlongPoints(points, tubeRadius, tubeSegments, color);
+}
 
-	for (int i = 0; i < uSegments; ++i) {
-		for (int j = 0; j < vSegments; ++j) {
-			vec3 p00 = positions[i][j];
-			vec3 p10 = positions[i + 1][j];
-			vec3 p01 = positions[i][j + 1];
-			vec3 p11 = positions[i + 1][j + 1];
-
-			vec3 n00 = normals[i][j];
-			vec3 n10 = normals[i + 1][j];
-			vec3 n01 = normals[i][j + 1];
-			vec3 n11 = normals[i + 1][j + 1];
-
-			vec3 c00 = colorByHeight ? heightToColor(p00.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
-			vec3 c10 = colorByHeight ? heightToColor(p10.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
-			vec3 c01 = colorByHeight ? heightToColor(p01.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
-			vec3 c11 = colorByHeight ? heightToColor(p11.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
-
-			// Triangle 1
-			verts.push_back({p00, n00, c00, {0, 0}});
-			verts.push_back({p10, n10, c10, {0, 0}});
-			verts.push_back({p11, n11, c11, {0, 0}});
-
-			// Triangle 2
-			verts.push_back({p00, n00, c00, {0, 0}});
-			verts.push_back({p11, n11, c11, {0, 0}});
-			verts.push_back({p01, n01, c01, {0, 0}});
+IndexedMesh GraphObjects::generateParametricSurfaceAdaptive(
+	const SurfaceSampler& surfaceFunc,
+	float uMin, float uMax, float vMin, float vMax,
+	int uBase, int vBase,
+	const AdaptiveOptions& options,
+	bool colorByHeight,
+	const SurfaceJetSampler& surfaceJet) {
+	PROFILE_FUNCTION();
+
+	IndexedMesh mesh;
+	if (uBase < 1 || vBase < 1) return mesh;
+
+	// Cells and samples live on an integer lattice at the finest spacing
+	const int maxDepth = std::clamp(options.maxDepth, 0, 12);
+	const uint32_t rootSize = 1u << maxDepth;
+	const uint32_t nu = (uint32_t)uBase * rootSize;
+	const uint32_t nv = (uint32_t)vBase * rootSize;
+	auto latticeKey = [nv](uint32_t i, uint32_t j) { return (uint64_t)i * (nv + 1) + j; };
+
+	struct Cell {
+		uint32_t i, j, size;   // lower corner and edge length, in lattice steps
+	};
+
+	std::unordered_map<uint64_t, uint32_t> sampleIndex;
+	std::vector<vec2> params;
+	std::vector<vec3> samples;
+	std::vector<char> isCorner;     // corner of some cell; only these take part in triangulation
+
+	auto request = [&](uint32_t i, uint32_t j) {
+		auto inserted = sampleIndex.emplace(latticeKey(i, j), (uint32_t)params.size());
+		if (inserted.second) {
+			params.push_back(vec2(uMin + (uMax - uMin) * i / nu, vMin + (vMax - vMin) * j / nv));
+			isCorner.push_back(0);
 		}
+		return inserted.first->second;
+	};
+	auto find = [&](uint32_t i, uint32_t j) {
+		auto it = sampleIndex.find(latticeKey(i, j));
+		return it == sampleIndex.end() ? UINT32_MAX : it->second;
+	};
+	auto markCorners = [&](const Cell& c) {
+		isCorner[request(c.i, c.j)] = 1;
+		isCorner[request(c.i + c.size, c.j)] = 1;
+		isCorner[request(c.i + c.size, c.j + c.size)] = 1;
+		isCorner[request(c.i, c.j + c.size)] = 1;
+	};
+	// Evaluate every parameter requested since the last flush in one batch
+	auto flush = [&] {
+		size_t first = samples.size();
+		samples.resize(params.size());
+		sampleTiled(surfaceFunc, params.data() + first, params.size() - first, samples.data() + first);
+	};
+
+	std::vector<Cell> open, leaves;
+	for (int a = 0; a < uBase; ++a) {
+		for (int b = 0; b < vBase; ++b) {
+			Cell c = {(uint32_t)a * rootSize, (uint32_t)b * rootSize, rootSize};
+			markCorners(c);
+			open.push_back(c);
+		}
+	}
+	flush();
+
+	const float tol = options.tolerance * std::max(boundingDiagonal(samples.data(), samples.size()), 1e-6f);
+	const float cosMax = cosf(options.maxAngle);
+
+	// Refine breadth-first so each level's new samples go out as one batch
+	while (!open.empty() && open.front().size >= 2) {
+		for (const Cell& c : open) {
+			uint32_t h = c.size / 2;
+			request(c.i + h, c.j + h);
+			request(c.i + h, c.j);
+			request(c.i + c.size, c.j + h);
+			request(c.i + h, c.j + c.size);
+			request(c.i, c.j + h);
+		}
+		flush();
+
+		std::vector<Cell> next;
+		for (const Cell& c : open) {
+			uint32_t h = c.size / 2, s = c.size;
+			const vec3& p00 = samples[find(c.i, c.j)];
+			const vec3& p10 = samples[find(c.i + s, c.j)];
+			const vec3& p11 = samples[find(c.i + s, c.j + s)];
+			const vec3& p01 = samples[find(c.i, c.j + s)];
+
+			// Deviation of the centre and edge midpoints from the bilinear patch through the corners
+			float err = glm::length(samples[find(c.i + h, c.j + h)] - 0.25f * (p00 + p10 + p11 + p01));
+			err = std::max(err, glm::length(samples[find(c.i + h, c.j)] - 0.5f * (p00 + p10)));
+			err = std::max(err, glm::length(samples[find(c.i + s, c.j + h)] - 0.5f * (p10 + p11)));
+			err = std::max(err, glm::length(samples[find(c.i + h, c.j + s)] - 0.5f * (p11 + p01)));
+			err = std::max(err, glm::length(samples[find(c.i, c.j + h)] - 0.5f * (p01 + p00)));
+			// Fold across the diagonal of the two triangles the cell would become
+			float fold = bendCosine(glm::cross(p10 - p00, p11 - p00), glm::cross(p11 - p00, p01 - p00));
+
+			if (err > tol || fold < cosMax) {
+				for (Cell child : { Cell{c.i, c.j, h}, Cell{c.i + h, c.j, h}, Cell{c.i, c.j + h, h}, Cell{c.i + h, c.j + h, h} }) {
+					markCorners(child);
+					next.push_back(child);
+				}
+			} else {
+				leaves.push_back(c);
+			}
+		}
+		open.swap(next);
 	}
+	leaves.insert(leaves.end(), open.begin(), open.end());
+
+	// Triangulate each leaf from the corners along its boundary, counter-clockwise in (u, v).
+	// A finer neighbour's corners on a shared edge are picked up by both sides, so nothing cracks.
+	std::vector<uint32_t> vertexOf(samples.size(), UINT32_MAX);
+	std::vector<uint32_t> used;
+	auto vertex = [&](uint32_t sample) {
+		if (vertexOf[sample] == UINT32_MAX) {
+			vertexOf[sample] = (uint32_t)used.size();
+			used.push_back(sample);
+		}
+		return vertexOf[sample];
+	};
 
-	return verts;
+	std::vector<uint32_t> ring;
+	for (const Cell& c : leaves) {
+		const uint32_t s = c.size;
+		ring.clear();
+		auto visit = [&](uint32_t i, uint32_t j) {
+			uint32_t k = find(i, j);
+			if (k != UINT32_MAX && isCorner[k]) ring.push_back(vertex(k));
+		};
+		for (uint32_t d = 0; d < s; ++d) visit(c.i + d, c.j);
+		for (uint32_t d = 0; d < s; ++d) visit(c.i + s, c.j + d);
+		for (uint32_t d = 0; d < s; ++d) visit(c.i + s - d, c.j + s);
+		for (uint32_t d = 0; d < s; ++d) visit(c.i, c.j + s - d);
+
+		if (ring.size() == 4) {
+			mesh.indices.insert(mesh.indices.end(), { ring[0], ring[1], ring[2], ring[0], ring[2], ring[3] });
+		} else {
+			uint32_t centre = vertex(find(c.i + s / 2, c.j + s / 2));
+			for (size_t k = 0; k < ring.size(); ++k) {
+				mesh.indices.insert(mesh.indices.end(), { centre, ring[k], ring[(k + 1) % ring.size()] });
+			}
+		}
+	}
+
+	// Derivatives only at the vertices that made it into the mesh
+	const size_t count = used.size();
+	std::vector<vec2> usedParams(count);
+	for (size_t k = 0; k < count; ++k) usedParams[k] = params[used[k]];
+	std::vector<vec3> positions, dpdu, dpdv;
+	sampleSurfaceJet(surfaceFunc, surfaceJet, usedParams, 1e-4f, positions, dpdu, dpdv);
+
+	float minH = 1e9f, maxH = -1e9f;
+	for (uint32_t k : used) {
+		minH = std::min(minH, samples[k].z);
+		maxH = std::max(maxH, samples[k].z);
+	}
+
+	mesh.vertices.resize(count);
+	JobSystem::shared().parallelFor(count, SAMPLE_TILE, [&](size_t first, size_t last) {
+		for (size_t k = first; k < last; ++k) {
+			vec3 n = glm::cross(dpdu[k], dpdv[k]);
+			float len = glm::length(n);
+			if (len > 1e-8f) n /= len;
+			else n = vec3(0, 0, 1);
+
+			const vec3& p = samples[used[k]];
+			vec3 col = colorByHeight ? heightToColor(p.z, minH, maxH) : vec3(0.5f, 0.7f, 1.0f);
+			mesh.vertices[k] = {p, n, col, {0, 0}};
+		}
+	});
+
+	return mesh;
 }
 
 // ─── Parametric Surface Wireframe ────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateParametricSurfaceWireframe(
-	std::function<vec3(float, float)> surfaceFunc,
+IndexedMesh GraphObjects::generateParametricSurfaceWireframe(
+	const SurfaceSampler& surfaceFunc,
 	float uMin, float uMax, float vMin, float vMax,
 	int uSegments, int vSegments,
 	vec3 color) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> verts;
+	IndexedMesh mesh;
 	float du = (uMax - uMin) / uSegments;
 	float dv = (vMax - vMin) / vSegments;
 	vec3 zero(0, 0, 0);
 
+	// Sample the grid once; both line families index into it
+	const int vCount = vSegments + 1;
+	std::vector<vec2> params((size_t)(uSegments + 1) * vCount);
+	for (int i = 0; i <= uSegments; ++i) {
+		for (int j = 0; j <= vSegments; ++j) {
+			params[(size_t)i * vCount + j] = vec2(uMin + i * du, vMin + j * dv);
+		}
+	}
+	std::vector<vec3> grid(params.size());
+	sampleTiled(surfaceFunc, params.data(), params.size(), grid.data());
+	mesh.vertices.reserve(grid.size());
+	for (const vec3& p : grid) mesh.vertices.push_back({p, zero, color, {0, 0}});
+	auto at = [vCount](int i, int j) { return (uint32_t)(i * vCount + j); };
+
+	mesh.indices.reserve(((size_t)uSegments * vCount + (size_t)(uSegments + 1) * vSegments) * 2);
+
 	// U-direction lines (constant v)
 	for (int j = 0; j <= vSegments; ++j) {
-		float v = vMin + j * dv;
 		for (int i = 0; i < uSegments; ++i) {
-			float u0 = uMin + i * du;
-			float u1 = uMin + (i + 1) * du;
-			verts.push_back({surfaceFunc(u0, v), zero, color, {0, 0}});
-			verts.push_back({surfaceFunc(u1, v), zero, color, {0, 0}});
+			mesh.indices.push_back(at(i, j));
+			mesh.indices.push_back(at(i + 1, j));
 		}
 	}
 
 	// V-direction lines (constant u)
 	for (int i = 0; i <= uSegments; ++i) {
-		float u = uMin + i * du;
 		for (int j = 0; j < vSegments; ++j) {
-			float v0 = vMin + j * dv;
-			float v1 = vMin + (j + 1) * dv;
-			verts.push_back({surfaceFunc(u, v0), zero, color, {0, 0}});
-			verts.push_back({surfaceFunc(u, v1), zero, color, {0, 0}});
+			mesh.indices.push_back(at(i, j));
+			mesh.indices.push_back(at(i, j + 1));
 		}
 	}
 
-	return verts;
+	return mesh;
 }
 
 // ─── Tangent Vectors ────────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateTangentVectors(
-	std::function<vec3(float)> curveFunc,
+std::vector<GlyphInstance> GraphObjects::generateTangentVectors(
+	const CurveSampler& curveFunc,
 	float tMin, float tMax, int count,
-	float arrowScale, vec3 color) {
+	float arrowScale, vec3 color,
+	const CurveJetSampler& curveJet) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
-	if (count < 1) return allVerts;
+	std::vector<GlyphInstance> glyphs;
+	if (count < 1) return glyphs;
 
-	float eps = (tMax - tMin) * 1e-4f;
+	std::vector<float> ts(count);
+	for (int i = 0; i < count; ++i) ts[i] = tMin + (tMax - tMin) * i / std::max(count - 1, 1);
+	std::vector<vec3> positions, velocities;
+	sampleCurveJet(curveFunc, curveJet, ts, (tMax - tMin) * 1e-4f, positions, velocities, nullptr);
 
+	glyphs.reserve(count);
 	for (int i = 0; i < count; ++i) {
-		float t = tMin + (tMax - tMin) * i / std::max(count - 1, 1);
-		vec3 pos = curveFunc(t);
-		vec3 tangent = (curveFunc(t + eps) - curveFunc(t - eps)) / (2.0f * eps);
+		vec3 pos = positions[i];
+		vec3 tangent = velocities[i];
 		float mag = glm::length(tangent);
 		if (mag < 1e-6f) continue;
 		tangent /= mag;
 
-		float len = arrowScale;
-		auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, color);
-
-		// Rotate from +Z to tangent direction
-		vec3 dir = tangent;
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		glyphs.push_back(arrowGlyph(pos, tangent, arrowScale, 0.02f, color));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Surface Normals ────────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateSurfaceNormals(
-	std::function<vec3(float, float)> surfaceFunc,
+std::vector<GlyphInstance> GraphObjects::generateSurfaceNormals(
+	const SurfaceSampler& surfaceFunc,
 	float uMin, float uMax, float vMin, float vMax,
 	int uCount, int vCount,
-	float arrowScale, vec3 color, bool flipNormal) {
+	float arrowScale, vec3 color, bool flipNormal,
+	const SurfaceJetSampler& surfaceJet) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 	std::vector<vec3> placedPositions;  // Track arrow positions to avoid pole clustering
-	float eps = 1e-4f;
 	float minDist = 0.1f;  // Minimum distance between arrows (filters pole duplicates)
 
+	std::vector<vec3> positions, dpdus, dpdvs;
+	sampleSurfaceJet(surfaceFunc, surfaceJet, parameterGrid(uMin, uMax, vMin, vMax, uCount, vCount), 1e-4f,
+		positions, dpdus, dpdvs);
+
 	for (int i = 0; i < uCount; ++i) {
-		float u = uMin + (uMax - uMin) * i / std::max(uCount - 1, 1);
 		for (int j = 0; j < vCount; ++j) {
-			float v = vMin + (vMax - vMin) * j / std::max(vCount - 1, 1);
-
-			vec3 pos = surfaceFunc(u, v);
+			const size_t k = (size_t)i * vCount + j;
+			vec3 pos = positions[k];
 
 			// Check if this position is too close to an already-placed arrow (pole clustering)
 			bool tooClose = false;
@@ -509,56 +1065,41 @@ std::vector<VertexAttributes> GraphObjects::generateSurfaceNormals(
 			}
 			if (tooClose) continue;
 
-			vec3 dpdu = (surfaceFunc(u + eps, v) - surfaceFunc(u - eps, v)) / (2.0f * eps);
-			vec3 dpdv = (surfaceFunc(u, v + eps) - surfaceFunc(u, v - eps)) / (2.0f * eps);
-			vec3 normal = glm::cross(dpdu, dpdv);
+			vec3 normal = glm::cross(dpdus[k], dpdvs[k]);
 			if (flipNormal) normal = -normal;
 			float mag = glm::length(normal);
 			if (mag < 1e-8f) continue;
 			normal /= mag;
 
-			float len = arrowScale;
-			auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, color);
-
-			vec3 dir = normal;
-			vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-			vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-			vec3 yAxis = glm::cross(dir, xAxis);
-
-			for (auto& v : mesh) {
-				vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-				vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-				v.position = rotPos + pos;
-				v.normal = rotNorm;
-			}
-
-			allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+			glyphs.push_back(arrowGlyph(pos, normal, arrowScale, 0.02f, color));
 			placedPositions.push_back(pos);  // Record this position
 		}
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Frenet Frame ───────────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateFrenetFrame(
-	std::function<vec3(float)> curveFunc,
+std::vector<GlyphInstance> GraphObjects::generateFrenetFrame(
+	const CurveSampler& curveFunc,
 	float tMin, float tMax, float tNorm,
-	float arrowScale) {
+	float arrowScale,
+	const CurveJetSampler& curveJet) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 
-	float t = tMin + tNorm * (tMax - tMin);
-	float eps = (tMax - tMin) * 1e-4f;
+	std::vector<float> ts = { tMin + tNorm * (tMax - tMin) };
+	std::vector<vec3> samples, r1s, r2s;
+	sampleCurveJet(curveFunc, curveJet, ts, (tMax - tMin) * 1e-4f, samples, r1s, &r2s);
 
-	// First derivative (tangent)
-	vec3 r1 = (curveFunc(t + eps) - curveFunc(t - eps)) / (2.0f * eps);
-	// Second derivative
-	vec3 r2 = (curveFunc(t + eps) - 2.0f * curveFunc(t) + curveFunc(t - eps)) / (eps * eps);
+	// First derivative (tangent) and second derivative
+	vec3 r1 = r1s[0];
+	vec3 r2 = r2s[0];
 
 	float r1Mag = glm::length(r1);
-	if (r1Mag < 1e-6f) return allVerts;
+	if (r1Mag < 1e-6f) return glyphs;
 
 	vec3 T = r1 / r1Mag;
 
@@ -576,43 +1117,29 @@ std::vector<VertexAttributes> GraphObjects::generateFrenetFrame(
 		B = glm::cross(T, N);
 	}
 
-	vec3 pos = curveFunc(t);
+	vec3 pos = samples[0];
 
 	// Colors: T=red, N=green, B=blue
 	vec3 colors[3] = { vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1) };
 	vec3 dirs[3] = { T, N, B };
 
 	for (int k = 0; k < 3; ++k) {
-		float len = arrowScale;
-		auto mesh = generateArrowMesh(len * 0.7f, len * 0.025f, len * 0.3f, len * 0.07f, 6, colors[k]);
-
-		vec3 dir = dirs[k];
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		glyphs.push_back(arrowGlyph(pos, dirs[k], arrowScale, 0.025f, colors[k]));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Gradient Field 2D ──────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateGradientField2D(
-	std::function<float(float, float)> scalarFunc,
+std::vector<GlyphInstance> GraphObjects::generateGradientField2D(
+	const Scalar2DSampler& scalarFunc,
 	float uMin, float uMax, float vMin, float vMax,
 	int uCount, int vCount,
-	float arrowScale) {
+	float arrowScale,
+	const Gradient2DSampler& gradient) {
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 	float eps = 1e-3f;
 
 	// First pass: compute gradients and find max magnitude
@@ -620,23 +1147,40 @@ std::vector<VertexAttributes> GraphObjects::generateGradientField2D(
 	std::vector<GradInfo> grads;
 	float maxMag = 1e-6f;
 
-	for (int i = 0; i < uCount; ++i) {
-		float u = uMin + (uMax - uMin) * i / std::max(uCount - 1, 1);
-		for (int j = 0; j < vCount; ++j) {
-			float v = vMin + (vMax - vMin) * j / std::max(vCount - 1, 1);
-
-			float dfdu = (scalarFunc(u + eps, v) - scalarFunc(u - eps, v)) / (2.0f * eps);
-			float dfdv = (scalarFunc(u, v + eps) - scalarFunc(u, v - eps)) / (2.0f * eps);
-
-			// Gradient arrows displayed on xy-plane at z=0 for R^2->R^1 scalar fields
-			vec3 pos(u, v, 0.0f);
-			vec3 grad(dfdu, dfdv, 0.0f);
-			float mag = glm::length(grad);
-			maxMag = std::max(maxMag, mag);
-			grads.push_back({pos, grad, mag});
+	std::vector<vec2> grid = parameterGrid(uMin, uMax, vMin, vMax, uCount, vCount);
+	std::vector<vec2> gradients(grid.size());
+	if (gradient) {
+		JobSystem::shared().parallelFor(grid.size(), SAMPLE_TILE, [&](size_t begin, size_t end) {
+			gradient(grid.data() + begin, end - begin, gradients.data() + begin);
+		});
+	} else {
+		// Sample the four central-difference neighbours of every grid point in one batch
+		std::vector<vec2> params;
+		params.reserve(grid.size() * 4);
+		for (const vec2& uv : grid) {
+			params.push_back(uv + vec2(eps, 0));
+			params.push_back(uv - vec2(eps, 0));
+			params.push_back(uv + vec2(0, eps));
+			params.push_back(uv - vec2(0, eps));
+		}
+		std::vector<float> values(params.size());
+		sampleTiled(scalarFunc, params.data(), params.size(), values.data());
+		for (size_t k = 0; k < grid.size(); ++k) {
+			const float* f = &values[k * 4];
+			gradients[k] = vec2(f[0] - f[1], f[2] - f[3]) / (2.0f * eps);
 		}
 	}
 
+	for (size_t k = 0; k < grid.size(); ++k) {
+		// Gradient arrows displayed on xy-plane at z=0 for R^2->R^1 scalar fields
+		vec3 pos(grid[k], 0.0f);
+		vec3 grad(gradients[k], 0.0f);
+		float mag = glm::length(grad);
+		maxMag = std::max(maxMag, mag);
+		grads.push_back({pos, grad, mag});
+	}
+
+	glyphs.reserve(grads.size());
 	for (auto& g : grads) {
 		if (g.mag < 1e-6f) continue;
 
@@ -644,34 +1188,21 @@ std::vector<VertexAttributes> GraphObjects::generateGradientField2D(
 		float len = arrowScale * (0.2f + 0.8f * normalizedMag);
 		vec3 color = magnitudeToColor(normalizedMag);
 
-		auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, color);
-
-		vec3 dir = glm::normalize(g.grad);
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + g.pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		glyphs.push_back(arrowGlyph(g.pos, g.grad, len, 0.02f, color));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Gradient Field 3D ──────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateGradientField3D(
-	std::function<float(vec3)> scalarFunc,
+std::vector<GlyphInstance> GraphObjects::generateGradientField3D(
+	const ScalarSampler& scalarFunc,
 	vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
-	float arrowScale) {
+	float arrowScale,
+	const GradientSampler& gradient) {
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 	float eps = 1e-3f;
 
 	vec3 step = (rangeMax - rangeMin) / vec3(
@@ -684,22 +1215,48 @@ std::vector<VertexAttributes> GraphObjects::generateGradientField3D(
 	std::vector<GradInfo> grads;
 	float maxMag = 1e-6f;
 
+	std::vector<vec3> positions;
 	for (int ix = 0; ix < resolution.x; ++ix) {
 		for (int iy = 0; iy < resolution.y; ++iy) {
 			for (int iz = 0; iz < resolution.z; ++iz) {
-				vec3 pos = rangeMin + vec3(ix, iy, iz) * step;
-				float dfdx = (scalarFunc(pos + vec3(eps, 0, 0)) - scalarFunc(pos - vec3(eps, 0, 0))) / (2.0f * eps);
-				float dfdy = (scalarFunc(pos + vec3(0, eps, 0)) - scalarFunc(pos - vec3(0, eps, 0))) / (2.0f * eps);
-				float dfdz = (scalarFunc(pos + vec3(0, 0, eps)) - scalarFunc(pos - vec3(0, 0, eps))) / (2.0f * eps);
-
-				vec3 grad(dfdx, dfdy, dfdz);
-				float mag = glm::length(grad);
-				maxMag = std::max(maxMag, mag);
-				grads.push_back({pos, grad, mag});
+				positions.push_back(rangeMin + vec3(ix, iy, iz) * step);
 			}
 		}
 	}
 
+	std::vector<vec3> gradients(positions.size());
+	if (gradient) {
+		JobSystem::shared().parallelFor(positions.size(), SAMPLE_TILE, [&](size_t begin, size_t end) {
+			gradient(positions.data() + begin, end - begin, gradients.data() + begin);
+		});
+	} else {
+		// Sample the six central-difference neighbours of every grid point in one batch
+		std::vector<vec3> params;
+		params.reserve(positions.size() * 6);
+		for (const vec3& pos : positions) {
+			params.push_back(pos + vec3(eps, 0, 0));
+			params.push_back(pos - vec3(eps, 0, 0));
+			params.push_back(pos + vec3(0, eps, 0));
+			params.push_back(pos - vec3(0, eps, 0));
+			params.push_back(pos + vec3(0, 0, eps));
+			params.push_back(pos - vec3(0, 0, eps));
+		}
+		std::vector<float> values(params.size());
+		sampleTiled(scalarFunc, params.data(), params.size(), values.data());
+		for (size_t k = 0; k < positions.size(); ++k) {
+			const float* f = &values[k * 6];
+			gradients[k] = vec3(f[0] - f[1], f[2] - f[3], f[4] - f[5]) / (2.0f * eps);
+		}
+	}
+
+	for (size_t k = 0; k < positions.size(); ++k) {
+		const vec3& grad = gradients[k];
+		float mag = glm::length(grad);
+		maxMag = std::max(maxMag, mag);
+		grads.push_back({positions[k], grad, mag});
+	}
+
+	glyphs.reserve(grads.size());
 	for (auto& g : grads) {
 		if (g.mag < 1e-6f) continue;
 
@@ -707,29 +1264,16 @@ std::vector<VertexAttributes> GraphObjects::generateGradientField3D(
 		float len = arrowScale * (0.2f + 0.8f * normalizedMag);
 		vec3 color = magnitudeToColor(normalizedMag);
 
-		auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, color);
-
-		vec3 dir = glm::normalize(g.grad);
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + g.pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		glyphs.push_back(arrowGlyph(g.pos, g.grad, len, 0.02f, color));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 // ─── Colored Cube ───────────────────────────────────────────────────────────
 
 std::vector<VertexAttributes> GraphObjects::generateColoredCube(float halfSize, vec3 color) {
+	PROFILE_FUNCTION();
 	std::vector<VertexAttributes> verts;
 	float s = halfSize;
 
@@ -764,12 +1308,13 @@ std::vector<VertexAttributes> GraphObjects::generateColoredCube(float halfSize,
 
 // ─── Scalar Field ───────────────────────────────────────────────────────────
 
-std::vector<VertexAttributes> GraphObjects::generateScalarField(
-	std::function<float(vec3)> scalarFunc,
+std::vector<GlyphInstance> GraphObjects::generateScalarField(
+	const ScalarSampler& scalarFunc,
 	vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 	float cubeSize) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 
 	vec3 step = (rangeMax - rangeMin) / vec3(
 		std::max(resolution.x - 1, 1),
@@ -782,62 +1327,362 @@ std::vector<VertexAttributes> GraphObjects::generateScalarField(
 	std::vector<SampleInfo> samples;
 	float minVal = 1e9f, maxVal = -1e9f;
 
+	std::vector<vec3> positions;
 	for (int ix = 0; ix < resolution.x; ++ix) {
 		for (int iy = 0; iy < resolution.y; ++iy) {
 			for (int iz = 0; iz < resolution.z; ++iz) {
-				vec3 pos = rangeMin + vec3(ix, iy, iz) * step;
-				float val = scalarFunc(pos);
-				minVal = std::min(minVal, val);
-				maxVal = std::max(maxVal, val);
-				samples.push_back({pos, val});
+				positions.push_back(rangeMin + vec3(ix, iy, iz) * step);
 			}
 		}
 	}
+	std::vector<float> values(positions.size());
+	sampleTiled(scalarFunc, positions.data(), positions.size(), values.data());
+
+	for (size_t k = 0; k < positions.size(); ++k) {
+		minVal = std::min(minVal, values[k]);
+		maxVal = std::max(maxVal, values[k]);
+		samples.push_back({positions[k], values[k]});
+	}
 
 	float range = maxVal - minVal;
 	if (range < 1e-6f) range = 1.0f;
 
 	float halfSize = cubeSize * 0.5f;
 
+	glyphs.reserve(samples.size());
 	for (auto& sample : samples) {
 		float normalized = (sample.val - minVal) / range;
 		vec3 color = magnitudeToColor(normalized);
-		auto cube = generateColoredCube(halfSize, color);
 
-		// Translate cube to sample position
-		for (auto& v : cube) {
-			v.position += sample.pos;
+		// The unit cube has half-size 1, so length scales it uniformly
+		glyphs.push_back({sample.pos, halfSize, vec3(0, 0, 1), 1.0f, packColor(color)});
+	}
+
+	return glyphs;
+}
+
+// ─── Isosurface ─────────────────────────────────────────────────────────────
+
+// Cells per block edge when skipping space the surface does not pass through
+constexpr int ISO_BLOCK = 8;
+constexpr uint32_t NO_VERTEX = ~0u;
+
+// One level keeps the function's colour; several are told apart along the ramp
+static vec3 levelColor(size_t level, size_t levelCount, vec3 color) {
+	if (levelCount < 2) return color;
+	return GraphObjects::magnitudeToColor(float(level) / float(levelCount - 1));
+}
+
+IndexedMesh GraphObjects::generateIsosurface(
+	const ScalarSampler& scalarFunc,
+	vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
+	const std::vector<float>& levels, vec3 color,
+	const GradientSampler& gradient) {
+	PROFILE_FUNCTION();
+
+	IndexedMesh mesh;
+	const ivec3 n = glm::max(resolution, ivec3(2));   // samples per axis
+	const ivec3 cells = n - 1;
+	const vec3 step = (rangeMax - rangeMin) / vec3(cells);
+	const size_t sampleCount = (size_t)n.x * n.y * n.z;
+	const size_t cellCount = (size_t)cells.x * cells.y * cells.z;
+	auto sampleIndex = [&n](ivec3 s) { return ((size_t)s.z * n.y + s.y) * n.x + s.x; };
+	auto cellIndex = [&cells](ivec3 c) { return ((size_t)c.z * cells.y + c.y) * cells.x + c.x; };
+
+	// Samples x fastest; positions are made per tile rather than stored for the whole grid
+	std::vector<float> values(sampleCount);
+	JobSystem::shared().parallelFor(sampleCount, SAMPLE_TILE, [&](size_t begin, size_t end) {
+		thread_local std::vector<vec3> points;
+		points.resize(end - begin);
+		for (size_t k = begin; k < end; ++k) {
+			const size_t x = k % n.x, y = k / n.x % n.y, z = k / ((size_t)n.x * n.y);
+			points[k - begin] = rangeMin + vec3(float(x), float(y), float(z)) * step;
+		}
+		scalarFunc(points.data(), end - begin, values.data() + begin);
+	});
+
+	// Blocks of ISO_BLOCK^3 cells and the range of their samples, NaNs left out
+	const ivec3 blocks = (cells + ISO_BLOCK - 1) / ISO_BLOCK;
+	const size_t blockCount = (size_t)blocks.x * blocks.y * blocks.z;
+	auto blockCells = [&](size_t b, ivec3& lo, ivec3& hi) {
+		const ivec3 bc((int)(b % blocks.x), (int)(b / blocks.x % blocks.y), (int)(b / ((size_t)blocks.x * blocks.y)));
+		lo = bc * ISO_BLOCK;
+		hi = glm::min(lo + ISO_BLOCK, cells);
+	};
+	std::vector<vec2> blockRange(blockCount);
+	JobSystem::shared().parallelFor(blockCount, 16, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			ivec3 lo, hi;
+			blockCells(b, lo, hi);
+			vec2 range(INFINITY, -INFINITY);
+			for (int z = lo.z; z <= hi.z; ++z)
+			for (int y = lo.y; y <= hi.y; ++y)
+			for (int x = lo.x; x <= hi.x; ++x) {
+				const float v = values[sampleIndex(ivec3(x, y, z))];
+				if (!std::isfinite(v)) continue;
+				range.x = std::min(range.x, v);
+				range.y = std::max(range.y, v);
+			}
+			blockRange[b] = range;
+		}
+	});
+
+	std::vector<uint32_t> cellVertex(cellCount);
+	std::vector<size_t> activeBlocks;
+	std::vector<std::vector<std::pair<size_t, vec3>>> blockVertices;  // cell index and position
+	std::vector<std::vector<uint32_t>> blockIndices;
+
+	for (size_t l = 0; l < levels.size(); ++l) {
+		const float level = levels[l];
+		activeBlocks.clear();
+		for (size_t b = 0; b < blockCount; ++b) {
+			if (blockRange[b].x < level && blockRange[b].y >= level) activeBlocks.push_back(b);
+		}
+		if (activeBlocks.empty()) continue;
+		std::fill(cellVertex.begin(), cellVertex.end(), NO_VERTEX);
+		blockVertices.assign(activeBlocks.size(), {});
+		blockIndices.assign(activeBlocks.size(), {});
+
+		// One vertex per cell the level crosses, at the mean of its edge crossings
+		JobSystem::shared().parallelFor(activeBlocks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t a = begin; a < end; ++a) {
+				ivec3 lo, hi;
+				blockCells(activeBlocks[a], lo, hi);
+				for (int z = lo.z; z < hi.z; ++z)
+				for (int y = lo.y; y < hi.y; ++y)
+				for (int x = lo.x; x < hi.x; ++x) {
+					// Corner i sits at (i & 1, i >> 1 & 1, i >> 2 & 1)
+					float v[8];
+					int mask = 0;
+					bool finite = true;
+					for (int i = 0; i < 8; ++i) {
+						v[i] = values[sampleIndex(ivec3(x + (i & 1), y + (i >> 1 & 1), z + (i >> 2 & 1)))];
+						finite = finite && std::isfinite(v[i]);
+						mask |= (v[i] >= level) << i;
+					}
+					if (!finite || mask == 0 || mask == 0xFF) continue;
+
+					vec3 sum(0.0f);
+					int crossings = 0;
+					for (int i = 0; i < 8; ++i) {
+						for (int d = 1; d < 8; d <<= 1) {
+							const int j = i | d;
+							if ((i & d) || ((mask >> i) & 1) == ((mask >> j) & 1)) continue;
+							const float t = (level - v[i]) / (v[j] - v[i]);
+							const vec3 ci(float(i & 1), float(i >> 1 & 1), float(i >> 2 & 1));
+							const vec3 cj(float(j & 1), float(j >> 1 & 1), float(j >> 2 & 1));
+							sum += ci + t * (cj - ci);
+							++crossings;
+						}
+					}
+					const vec3 local = sum / float(crossings);
+					blockVertices[a].push_back({ cellIndex(ivec3(x, y, z)),
+						rangeMin + (vec3(float(x), float(y), float(z)) + local) * step });
+				}
+			}
+		});
+
+		const uint32_t levelBase = (uint32_t)mesh.vertices.size();
+		uint32_t next = levelBase;
+		for (const auto& verts : blockVertices) {
+			for (const auto& v : verts) cellVertex[v.first] = next++;
 		}
+		if (next == levelBase) continue;
+
+		// One quad around every grid edge the level crosses, joining the four cells that share it.
+		// Each sample owns the edges leaving it along +x, +y and +z.
+		JobSystem::shared().parallelFor(activeBlocks.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t a = begin; a < end; ++a) {
+				ivec3 lo, hi;
+				blockCells(activeBlocks[a], lo, hi);
+				std::vector<uint32_t>& out = blockIndices[a];
+				for (int z = lo.z; z < hi.z; ++z)
+				for (int y = lo.y; y < hi.y; ++y)
+				for (int x = lo.x; x < hi.x; ++x) {
+					const ivec3 s(x, y, z);
+					const float va = values[sampleIndex(s)];
+					for (int d = 0; d < 3; ++d) {
+						const int u = (d + 1) % 3, w = (d + 2) % 3;
+						// The four cells around the edge must all exist
+						if (s[u] < 1 || s[w] < 1) continue;
+						ivec3 e(0), eu(0), ew(0);
+						e[d] = 1; eu[u] = 1; ew[w] = 1;
+						const float vb = values[sampleIndex(s + e)];
+						if (!std::isfinite(va) || !std::isfinite(vb) || (va >= level) == (vb >= level)) continue;
+
+						const uint32_t c00 = cellVertex[cellIndex(s - eu - ew)];
+						const uint32_t c10 = cellVertex[cellIndex(s - ew)];
+						const uint32_t c11 = cellVertex[cellIndex(s)];
+						const uint32_t c01 = cellVertex[cellIndex(s - eu)];
+						// A neighbour with a NaN corner has no vertex; leave a hole there
+						if (c00 == NO_VERTEX || c10 == NO_VERTEX || c11 == NO_VERTEX || c01 == NO_VERTEX) continue;
+						// Counter-clockwise about +d, facing where the field increases
+						if (va < level) {
+							out.insert(out.end(), { c00, c10, c11, c00, c11, c01 });
+						} else {
+							out.insert(out.end(), { c00, c11, c10, c00, c01, c11 });
+						}
+					}
+				}
+			}
+		});
 
-		allVerts.insert(allVerts.end(), cube.begin(), cube.end());
+		const vec3 levelCol = levelColor(l, levels.size(), color);
+		mesh.vertices.resize(next);
+		for (const auto& verts : blockVertices) {
+			for (const auto& v : verts) {
+				mesh.vertices[cellVertex[v.first]] = { v.second, vec3(0, 0, 1), levelCol, {0, 0} };
+			}
+		}
+		for (const auto& indices : blockIndices) {
+			mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+		}
 	}
 
-	return allVerts;
+	// Normals along the gradient, exact when there is a gradient sampler
+	const size_t vertexCount = mesh.vertices.size();
+	std::vector<vec3> positions(vertexCount);
+	for (size_t k = 0; k < vertexCount; ++k) positions[k] = mesh.vertices[k].position;
+	std::vector<vec3> gradients(vertexCount);
+	if (gradient) {
+		JobSystem::shared().parallelFor(vertexCount, SAMPLE_TILE, [&](size_t begin, size_t end) {
+			gradient(positions.data() + begin, end - begin, gradients.data() + begin);
+		});
+	} else {
+		// A fraction of a cell, so the difference sees the surface and not the grid
+		const float eps = 0.25f * std::min(step.x, std::min(step.y, step.z));
+		std::vector<vec3> params;
+		params.reserve(vertexCount * 6);
+		for (const vec3& p : positions) {
+			params.push_back(p + vec3(eps, 0, 0));
+			params.push_back(p - vec3(eps, 0, 0));
+			params.push_back(p + vec3(0, eps, 0));
+			params.push_back(p - vec3(0, eps, 0));
+			params.push_back(p + vec3(0, 0, eps));
+			params.push_back(p - vec3(0, 0, eps));
+		}
+		std::vector<float> samples(params.size());
+		sampleTiled(scalarFunc, params.data(), params.size(), samples.data());
+		for (size_t k = 0; k < vertexCount; ++k) {
+			const float* f = &samples[k * 6];
+			gradients[k] = vec3(f[0] - f[1], f[2] - f[3], f[4] - f[5]);
+		}
+	}
+	for (size_t k = 0; k < vertexCount; ++k) {
+		const float len = glm::length(gradients[k]);
+		if (len > 0.0f && std::isfinite(len)) mesh.vertices[k].normal = gradients[k] / len;
+	}
+
+	return mesh;
 }
+
+// ─── Isolines ───────────────────────────────────────────────────────────────
+
+std::vector<VertexAttributes> GraphObjects::generateIsolines(
+	const Scalar2DSampler& scalarFunc,
+	float uMin, float uMax, float vMin, float vMax,
+	int uSegments, int vSegments,
+	const std::vector<float>& levels, vec3 color) {
+	PROFILE_FUNCTION();
+
+	uSegments = std::max(uSegments, 1);
+	vSegments = std::max(vSegments, 1);
+	const int uCount = uSegments + 1, vCount = vSegments + 1;
+	std::vector<vec2> params = parameterGrid(uMin, uMax, vMin, vMax, uCount, vCount);
+	std::vector<float> values(params.size());
+	sampleTiled(scalarFunc, params.data(), params.size(), values.data());
+
+	// Cell corners a (i, j), b (i+1, j), c (i+1, j+1), d (i, j+1); edge e runs from corner e to e+1
+	std::vector<std::vector<VertexAttributes>> rows(uSegments);
+	std::vector<VertexAttributes> verts;
+	for (size_t l = 0; l < levels.size(); ++l) {
+		const float level = levels[l];
+		const vec3 levelCol = levelColor(l, levels.size(), color);
+		JobSystem::shared().parallelFor(uSegments, 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				std::vector<VertexAttributes>& out = rows[i];
+				out.clear();
+				for (int j = 0; j < vSegments; ++j) {
+					const size_t corner[4] = {
+						i * vCount + j, (i + 1) * vCount + j, (i + 1) * vCount + j + 1, i * vCount + j + 1 };
+					float v[4];
+					int mask = 0;
+					bool finite = true;
+					for (int k = 0; k < 4; ++k) {
+						v[k] = values[corner[k]];
+						finite = finite && std::isfinite(v[k]);
+						mask |= (v[k] >= level) << k;
+					}
+					if (!finite || mask == 0 || mask == 0xF) continue;
+
+					vec3 cross[4];
+					int crossed[4], count = 0;
+					for (int e = 0; e < 4; ++e) {
+						const int k = (e + 1) % 4;
+						if (((mask >> e) & 1) == ((mask >> k) & 1)) continue;
+						const float t = (level - v[e]) / (v[k] - v[e]);
+						const vec2 p = params[corner[e]] + t * (params[corner[k]] - params[corner[e]]);
+						cross[e] = vec3(p, 0.0f);
+						crossed[count++] = e;
+					}
+					auto segment = [&](int e0, int e1) {
+						out.push_back({cross[e0], vec3(0, 0, 1), levelCol, {0, 0}});
+						out.push_back({cross[e1], vec3(0, 0, 1), levelCol, {0, 0}});
+					};
+					if (count == 2) {
+						segment(crossed[0], crossed[1]);
+						continue;
+					}
+					// Saddle: the centre decides whether the high corners a, c (mask 5) or b, d connect
+					const bool centreHigh = 0.25f * (v[0] + v[1] + v[2] + v[3]) >= level;
+					if ((mask == 5) == centreHigh) {
+						segment(0, 1);   // around b
+						segment(2, 3);   // around d
+					} else {
+						segment(3, 0);   // around a
+						segment(1, 2);   // around c
+					}
+				}
+			}
+		});
+		size_t total = verts.size();
+		for (const auto& row : rows) total += row.size();
+		verts.reserve(total);
+		for (const auto& row : rows) verts.insert(verts.end(), row.begin(), row.end());
+	}
+
+	return verts;
+}
+
 // Add these functions to the end of GraphObjects.cpp
 
-std::vector<VertexAttributes> GraphObjects::generateCurveNormals(
-	std::function<vec3(float)> curveFunc,
+std::vector<GlyphInstance> GraphObjects::generateCurveNormals(
+	const CurveSampler& curveFunc,
 	float tMin, float tMax, int count,
-	float arrowScale, vec3 color, bool flipNormal) {
+	float arrowScale, vec3 color, bool flipNormal,
+	const CurveJetSampler& curveJet) {
+	PROFILE_FUNCTION();
 
-	std::vector<VertexAttributes> allVerts;
-	if (count < 1) return allVerts;
+	std::vector<GlyphInstance> glyphs;
+	if (count < 1) return glyphs;
 
-	float eps = (tMax - tMin) * 1e-4f;
+	std::vector<float> ts(count);
+	for (int i = 0; i < count; ++i) ts[i] = tMin + (tMax - tMin) * i / std::max(count - 1, 1);
+	std::vector<vec3> positions, velocities, accelerations;
+	sampleCurveJet(curveFunc, curveJet, ts, (tMax - tMin) * 1e-4f, positions, velocities, &accelerations);
 
+	glyphs.reserve(count);
 	for (int i = 0; i < count; ++i) {
-		float t = tMin + (tMax - tMin) * i / std::max(count - 1, 1);
-		vec3 pos = curveFunc(t);
+		vec3 pos = positions[i];
 
 		// Compute tangent
-		vec3 tangent = (curveFunc(t + eps) - curveFunc(t - eps)) / (2.0f * eps);
+		vec3 tangent = velocities[i];
 		float mag = glm::length(tangent);
 		if (mag < 1e-6f) continue;
 		tangent /= mag;
 
-		// Compute second derivative for curvature
-		vec3 accel = (curveFunc(t + eps) - 2.0f * pos + curveFunc(t - eps)) / (eps * eps);
+		// Second derivative for curvature
+		const vec3& accel = accelerations[i];
 
 		// Normal is perpendicular to tangent, in the plane of curvature
 		vec3 normal = accel - glm::dot(accel, tangent) * tangent;
@@ -853,46 +1698,33 @@ std::vector<VertexAttributes> GraphObjects::generateCurveNormals(
 		// Apply flip if requested
 		if (flipNormal) normal = -normal;
 
-		float len = arrowScale;
-		auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, color);
-
-		// Rotate from +Z to normal direction
-		vec3 dir = normal;
-		vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-		vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-		vec3 yAxis = glm::cross(dir, xAxis);
-
-		for (auto& v : mesh) {
-			vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-			vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-			v.position = rotPos + pos;
-			v.normal = rotNorm;
-		}
-
-		allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+		glyphs.push_back(arrowGlyph(pos, normal, arrowScale, 0.02f, color));
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
-std::vector<VertexAttributes> GraphObjects::generateSurfaceTangents(
-	std::function<vec3(float, float)> surfaceFunc,
+std::vector<GlyphInstance> GraphObjects::generateSurfaceTangents(
+	const SurfaceSampler& surfaceFunc,
 	float uMin, float uMax, float vMin, float vMax,
 	int uCount, int vCount,
-	float arrowScale, vec3 color, int mode) {
+	float arrowScale, vec3 color, int mode,
+	const SurfaceJetSampler& surfaceJet) {
+	PROFILE_FUNCTION();
 
 	(void)color;  // Using custom colors for u and v directions
-	std::vector<VertexAttributes> allVerts;
+	std::vector<GlyphInstance> glyphs;
 	std::vector<vec3> placedPositions;  // Track arrow positions to avoid pole clustering
-	float eps = 1e-4f;
 	float minDist = 0.1f;  // Minimum distance between arrows (filters pole duplicates)
 
+	std::vector<vec3> positions, dpdus, dpdvs;
+	sampleSurfaceJet(surfaceFunc, surfaceJet, parameterGrid(uMin, uMax, vMin, vMax, uCount, vCount), 1e-4f,
+		positions, dpdus, dpdvs);
+
 	for (int i = 0; i < uCount; ++i) {
-		float u = uMin + (uMax - uMin) * i / std::max(uCount - 1, 1);
 		for (int j = 0; j < vCount; ++j) {
-			float v = vMin + (vMax - vMin) * j / std::max(vCount - 1, 1);
-
-			vec3 pos = surfaceFunc(u, v);
+			const size_t k = (size_t)i * vCount + j;
+			vec3 pos = positions[k];
 
 			// Check if this position is too close to an already-placed arrow (pole clustering)
 			bool tooClose = false;
@@ -904,39 +1736,21 @@ std::vector<VertexAttributes> GraphObjects::generateSurfaceTangents(
 			}
 			if (tooClose) continue;
 
-			vec3 dpdu = (surfaceFunc(u + eps, v) - surfaceFunc(u - eps, v)) / (2.0f * eps);
-			vec3 dpdv = (surfaceFunc(u, v + eps) - surfaceFunc(u, v - eps)) / (2.0f * eps);
-
 			// Show tangents based on mode: 0=both, 1=u only, 2=v only
-			vec3 tangents[2] = {dpdu, dpdv};
+			vec3 tangents[2] = {dpdus[k], dpdvs[k]};
 			vec3 colors[2] = {vec3(1.0f, 0.2f, 0.2f), vec3(0.2f, 1.0f, 0.2f)};
 			int startK = (mode == 2) ? 1 : 0;  // If v-only, start at k=1
 			int endK = (mode == 1) ? 1 : 2;    // If u-only, end at k=1
 
 			bool placedAny = false;
-			for (int k = startK; k < endK; ++k) {
-				vec3 tangent = tangents[k];
+			for (int d = startK; d < endK; ++d) {
+				vec3 tangent = tangents[d];
 				float mag = glm::length(tangent);
 				// Filter degenerate tangents more aggressively (poles, singularities)
 				if (mag < 1e-6f) continue;
 				tangent /= mag;
 
-				float len = arrowScale;
-				auto mesh = generateArrowMesh(len * 0.7f, len * 0.02f, len * 0.3f, len * 0.06f, 6, colors[k]);
-
-				vec3 dir = tangent;
-				vec3 ref = (std::abs(dir.y) < 0.99f) ? vec3(0, 1, 0) : vec3(1, 0, 0);
-				vec3 xAxis = glm::normalize(glm::cross(ref, dir));
-				vec3 yAxis = glm::cross(dir, xAxis);
-
-				for (auto& v : mesh) {
-					vec3 rotPos = xAxis * v.position.x + yAxis * v.position.y + dir * v.position.z;
-					vec3 rotNorm = xAxis * v.normal.x + yAxis * v.normal.y + dir * v.normal.z;
-					v.position = rotPos + pos;
-					v.normal = rotNorm;
-				}
-
-				allVerts.insert(allVerts.end(), mesh.begin(), mesh.end());
+				glyphs.push_back(arrowGlyph(pos, tangent, arrowScale, 0.02f, colors[d]));
 				placedAny = true;
 			}
 
@@ -947,16 +1761,16 @@ std::vector<VertexAttributes> GraphObjects::generateSurfaceTangents(
 		}
 	}
 
-	return allVerts;
+	return glyphs;
 }
 
 std::vector<VertexAttributes> GraphObjects::generateStreamlines(
-	std::function<vec3(vec3)> fieldFunc,
+	const FieldSampler& fieldFunc,
 	vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 	int numStreamlines, float stepSize) {
+	PROFILE_FUNCTION();
 
 	(void)numStreamlines;  // Unused - we generate one streamline per grid point
-	std::vector<VertexAttributes> allVerts;
 
 	vec3 step = (rangeMax - rangeMin) / vec3(
 		std::max(resolution.x - 1, 1),
@@ -964,67 +1778,99 @@ std::vector<VertexAttributes> GraphObjects::generateStreamlines(
 		std::max(resolution.z - 1, 1)
 	);
 
-	// Generate one streamline from each grid point (matching vector field positions)
-	for (int ix = 0; ix < resolution.x; ++ix) {
-		for (int iy = 0; iy < resolution.y; ++iy) {
-			for (int iz = 0; iz < resolution.z; ++iz) {
-				vec3 pos = rangeMin + vec3(ix, iy, iz) * step;
-
-		// Integrate streamline using RK4
-		int maxSteps = 200;
-		std::vector<vec3> streamline;
-		streamline.push_back(pos);
-
-		for (int step = 0; step < maxSteps; ++step) {
-			vec3 k1 = fieldFunc(pos);
-			vec3 k2 = fieldFunc(pos + k1 * (stepSize * 0.5f));
-			vec3 k3 = fieldFunc(pos + k2 * (stepSize * 0.5f));
-			vec3 k4 = fieldFunc(pos + k3 * stepSize);
-
-			vec3 vel = (k1 + 2.0f * k2 + 2.0f * k3 + k4) / 6.0f;
-			float mag = glm::length(vel);
-
-			if (mag < 1e-6f) break;  // Stagnation point
+	// Generate one streamline from each grid point (matching vector field positions).
+	// Streamlines are integrated in lockstep with RK4 so every stage is one batch.
+	const int maxSteps = 200;
+	const size_t seedCount = (size_t)std::max(resolution.x, 0) * std::max(resolution.y, 0) * std::max(resolution.z, 0);
+	auto seedPosition = [&](size_t k) {
+		const size_t ny = resolution.y, nz = resolution.z;
+		return rangeMin + vec3((float)(k / (ny * nz)), (float)(k / nz % ny), (float)(k % nz)) * step;
+	};
 
-			vec3 newPos = pos + vel * stepSize;
+	// Tiles of seeds are integrated independently on the job pool. A tile traces into
+	// fixed rows of a per-thread scratch, then keeps only the points it reached.
+	const size_t seedTile = 64;
+	const size_t tileCount = (seedCount + seedTile - 1) / seedTile;
+	std::vector<std::vector<vec3>> tilePoints(tileCount);
+	std::vector<uint32_t> lengths(seedCount, 1);
+	JobSystem::shared().parallelFor(seedCount, seedTile, [&](size_t first, size_t last) {
+		const size_t tile = last - first;
+		const size_t rowLength = (size_t)maxSteps + 1;
+		thread_local std::vector<vec3> rows;
+		if (rows.size() < tile * rowLength) rows.resize(tile * rowLength);
+
+		std::vector<size_t> active(tile);
+		for (size_t a = 0; a < tile; ++a) {
+			active[a] = a;
+			rows[a * rowLength] = seedPosition(first + a);
+		}
+		uint32_t* length = &lengths[first];
+
+		std::vector<vec3> pos(tile), probe(tile), k1(tile), k2(tile), k3(tile), k4(tile);
+		for (int stepIdx = 0; stepIdx < maxSteps && !active.empty(); ++stepIdx) {
+			const size_t n = active.size();
+			for (size_t a = 0; a < n; ++a) pos[a] = rows[active[a] * rowLength + length[active[a]] - 1];
+
+			fieldFunc(pos.data(), n, k1.data());
+			for (size_t a = 0; a < n; ++a) probe[a] = pos[a] + k1[a] * (stepSize * 0.5f);
+			fieldFunc(probe.data(), n, k2.data());
+			for (size_t a = 0; a < n; ++a) probe[a] = pos[a] + k2[a] * (stepSize * 0.5f);
+			fieldFunc(probe.data(), n, k3.data());
+			for (size_t a = 0; a < n; ++a) probe[a] = pos[a] + k3[a] * stepSize;
+			fieldFunc(probe.data(), n, k4.data());
+
+			size_t kept = 0;
+			for (size_t a = 0; a < n; ++a) {
+				vec3 vel = (k1[a] + 2.0f * k2[a] + 2.0f * k3[a] + k4[a]) / 6.0f;
+				float mag = glm::length(vel);
+
+				if (mag < 1e-6f) continue;  // Stagnation point
+
+				vec3 newPos = pos[a] + vel * stepSize;
+
+				// Check bounds
+				if (newPos.x < rangeMin.x || newPos.x > rangeMax.x ||
+				    newPos.y < rangeMin.y || newPos.y > rangeMax.y ||
+				    newPos.z < rangeMin.z || newPos.z > rangeMax.z) {
+					continue;
+				}
 
-			// Check bounds
-			if (newPos.x < rangeMin.x || newPos.x > rangeMax.x ||
-			    newPos.y < rangeMin.y || newPos.y > rangeMax.y ||
-			    newPos.z < rangeMin.z || newPos.z > rangeMax.z) {
-				break;
+				const size_t seed = active[a];
+				rows[seed * rowLength + length[seed]++] = newPos;
+				active[kept++] = seed;
 			}
-
-			pos = newPos;
-			streamline.push_back(pos);
+			active.resize(kept);
 		}
 
-				// Convert streamline to line segments
-				// Color based on z-position for visual variety
-				float zNorm = (float)iz / (float)std::max(resolution.z - 1, 1);
-				vec3 color = magnitudeToColor(zNorm);
-
-				for (size_t j = 0; j + 1 < streamline.size(); ++j) {
-					vec3 p0 = streamline[j];
-					vec3 p1 = streamline[j + 1];
-
-					VertexAttributes v0, v1;
-					v0.position = p0;
-					v0.normal = vec3(0, 1, 0);
-					v0.color = color;
-					v0.uv = glm::vec2(0, 0);
-
-					v1.position = p1;
-					v1.normal = vec3(0, 1, 0);
-					v1.color = color;
-					v1.uv = glm::vec2(0, 0);
-
-					allVerts.push_back(v0);
-					allVerts.push_back(v1);
-				}
+		std::vector<vec3>& points = tilePoints[first / seedTile];
+		size_t total = 0;
+		for (size_t a = 0; a < tile; ++a) total += length[a];
+		points.reserve(total);
+		for (size_t a = 0; a < tile; ++a) {
+			points.insert(points.end(), rows.begin() + a * rowLength, rows.begin() + a * rowLength + length[a]);
+		}
+	});
+
+	// Exact LineList size from the streamline lengths, then every segment written in place
+	std::vector<size_t> firstVertex(seedCount + 1, 0);
+	for (size_t k = 0; k < seedCount; ++k) firstVertex[k + 1] = firstVertex[k] + (lengths[k] - 1) * 2;
+	std::vector<VertexAttributes> allVerts(firstVertex[seedCount]);
+
+	JobSystem::shared().parallelFor(seedCount, seedTile, [&](size_t first, size_t last) {
+		const vec3* points = tilePoints[first / seedTile].data();
+		for (size_t k = first; k < last; ++k) {
+			// Color based on z-position for visual variety
+			float zNorm = (float)(k % resolution.z) / (float)std::max(resolution.z - 1, 1);
+			vec3 color = magnitudeToColor(zNorm);
+
+			VertexAttributes* out = allVerts.data() + firstVertex[k];
+			for (uint32_t j = 0; j + 1 < lengths[k]; ++j) {
+				*out++ = {points[j], vec3(0, 1, 0), color, {0, 0}};
+				*out++ = {points[j + 1], vec3(0, 1, 0), color, {0, 0}};
 			}
+			points += lengths[k];
 		}
-	}
+	});
 
 	return allVerts;
 }
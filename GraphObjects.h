@@ -2,120 +2,306 @@
 
 #include "ResourceManager.h"
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <functional>
 #include <vector>
 
+// Axis-aligned bounding box; empty (min > max) until a point is added
+struct Aabb {
+	glm::vec3 min = glm::vec3(1e30f);
+	glm::vec3 max = glm::vec3(-1e30f);
+
+	void add(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+	bool empty() const { return min.x > max.x; }
+	glm::vec3 center() const { return 0.5f * (min + max); }
+	float radius() const { return 0.5f * glm::length(max - min); }
+};
+
+// Unique vertices plus a uint32 index list (TriangleList or LineList, by generator)
+struct IndexedMesh {
+	std::vector<ResourceManager::VertexAttributes> vertices;
+	std::vector<uint32_t> indices;
+	// Coarser index lists over the same vertices, each skipping every other grid line or ring
+	// of the one before. Only regular grids and tubes have them; empty means full detail only.
+	std::vector<std::vector<uint32_t>> lods;
+
+	// Append another indexed mesh, rebasing its indices. The LOD chain survives only
+	// when one side is empty, since the levels of two pieces cannot be drawn separately.
+	void append(const IndexedMesh& other);
+	// Append non-indexed vertices, one index per vertex
+	void append(const std::vector<ResourceManager::VertexAttributes>& verts);
+	// As above, but an empty mesh takes the storage over instead of copying it
+	void append(IndexedMesh&& other);
+	void append(std::vector<ResourceManager::VertexAttributes>&& verts);
+	bool empty() const { return indices.empty(); }
+	// Box around the vertices that non-finite samples did not poison
+	Aabb bounds() const;
+};
+
+// One instance of a shared glyph mesh (arrow or cube) for the "glyph" pipeline.
+// The unit mesh's +Z axis is turned onto direction and scaled by length; the cross
+// section is scaled by length * radius.
+struct GlyphInstance {
+	glm::vec3 position;
+	float length;
+	glm::vec3 direction;   // unit length
+	float radius;
+	uint32_t color;        // RGBA8 unorm
+};
+static_assert(sizeof(GlyphInstance) == 9 * sizeof(float), "must match the glyph pipeline's instance layout");
+
+// Vertex layout of the "surface" and "lines" pipelines: 20 bytes against VertexAttributes' 44.
+// Graph geometry never uses uv, and an octahedral snorm16 normal is within 1e-4 of the float one.
+struct PackedVertex {
+	glm::vec3 position;
+	uint32_t normal;       // octahedral encoding, snorm16x2
+	uint32_t color;        // RGBA8 unorm, or the float bits of the colormap scalar (FunctionUniforms::colormapped)
+};
+static_assert(sizeof(PackedVertex) == 5 * sizeof(float), "must match the surface and lines pipelines' vertex layout");
+
 class GraphObjects {
 public:
 	using VertexAttributes = ResourceManager::VertexAttributes;
+	using vec2 = glm::vec2;
 	using vec3 = glm::vec3;
 	using ivec3 = glm::ivec3;
 
-	// Generate a single 3D arrow mesh (cone+cylinder) along +Z, at origin
+	// Batch samplers: evaluate n parameter points in one call, writing n results to out
+	using CurveSampler    = std::function<void(const float* t, size_t n, vec3* out)>;
+	using SurfaceSampler  = std::function<void(const vec2* uv, size_t n, vec3* out)>;
+	using FieldSampler    = std::function<void(const vec3* p, size_t n, vec3* out)>;
+	using ScalarSampler   = std::function<void(const vec3* p, size_t n, float* out)>;
+	using Scalar2DSampler = std::function<void(const vec2* uv, size_t n, float* out)>;
+
+	// Samplers that also return exact derivatives (ExpressionParser::evaluateWithDerivatives).
+	// Generators handed an empty one fall back to central differences of the plain sampler.
+	using CurveJetSampler    = std::function<void(const float* t, size_t n, vec3* p, vec3* dp, vec3* ddp)>;
+	using SurfaceJetSampler  = std::function<void(const vec2* uv, size_t n, vec3* p, vec3* dpdu, vec3* dpdv)>;
+	using GradientSampler    = std::function<void(const vec3* p, size_t n, vec3* grad)>;
+	using Gradient2DSampler  = std::function<void(const vec2* uv, size_t n, vec2* grad)>;
+
+	// Total levels in a LOD chain, full detail included
+	static constexpr int LOD_LEVELS = 3;
+
+	// Farthest reach of a unit glyph mesh across its axis (x: in units of length * radius) and
+	// along it (y: in units of length)
+	static vec2 glyphMeshExtent(const std::vector<VertexAttributes>& mesh);
+	// Box enclosing every glyph drawn with a mesh of that extent, whatever its direction
+	static Aabb glyphBounds(const std::vector<GlyphInstance>& glyphs, vec2 meshExtent);
+
+	// Octahedral snorm16x2 encoding of a unit normal; the shaders decode it with octDecode
+	static uint32_t packNormal(vec3 normal);
+	// heightScalar stores each position.z in the colour word, for meshes coloured through a colormap
+	static std::vector<PackedVertex> packVertices(const std::vector<VertexAttributes>& vertices, bool heightScalar = false);
+	// Same, into count packed vertices at out (mapped staging memory, for large meshes)
+	static void packVertices(const VertexAttributes* vertices, size_t count, PackedVertex* out, bool heightScalar = false);
+
+	// Colormaps sampled by the surface shader, one texture row of COLORMAP_SIZE texels each
+	static constexpr int COLORMAP_COUNT = 5;
+	static constexpr int COLORMAP_SIZE = 256;
+	static const char* const COLORMAP_NAMES[COLORMAP_COUNT];
+	// RGBA8 texels, row after row; row 0 is the magnitudeToColor ramp baked meshes use
+	static std::vector<uint32_t> colormapTexels();
+
+	// Generate a single 3D arrow mesh (cone+cylinder) along +Z, at origin.
+	// Called with (0.7, 1, 0.3, 3) it is the unit arrow the glyph instances are drawn with.
 	static std::vector<VertexAttributes> generateArrowMesh(
 		float shaftLength, float shaftRadius, float headLength, float headRadius,
 		int segments = 8, vec3 color = vec3(1, 0, 0));
 
-	// Generate a full vector field: arrows at grid sample points
-	static std::vector<VertexAttributes> generateVectorField(
-		std::function<vec3(vec3)> fieldFunc,
+	// Generate a full vector field: arrow glyphs at grid sample points
+	static std::vector<GlyphInstance> generateVectorField(
+		const FieldSampler& fieldFunc,
 		vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 		float arrowScale = 1.0f);
 
 	// Generate a parametric curve r(t) = (x(t), y(t), z(t))
 	// Returns LineList vertices (pairs of endpoints)
 	static std::vector<VertexAttributes> generateParametricCurve(
-		std::function<vec3(float)> curveFunc,
+		const CurveSampler& curveFunc,
 		float tMin, float tMax, int segments,
 		vec3 color = vec3(1, 1, 0));
 
-	// Generate a parametric curve as a tube mesh (TriangleList) for lit rendering
-	static std::vector<VertexAttributes> generateParametricCurveTube(
-		std::function<vec3(float)> curveFunc,
+	// Generate a parametric curve as an indexed tube mesh (TriangleList) for lit rendering
+	static IndexedMesh generateParametricCurveTube(
+		const CurveSampler& curveFunc,
 		float tMin, float tMax, int segments,
 		float tubeRadius = 0.03f, int tubeSegments = 8,
 		vec3 color = vec3(1, 1, 0));
 
+	// Adaptive sampling: start from a coarse uniform grid and keep splitting intervals / cells
+	// whose midpoints stray from the chord or bilinear patch by more than tolerance times the
+	// shape's bounding diagonal, or whose neighbouring pieces bend by more than maxAngle.
+	// The default tolerance is about a pixel when the shape fills a 1000 pixel viewport.
+	struct AdaptiveOptions {
+		float tolerance = 1e-3f;
+		float maxAngle = 0.2f;    // radians
+		int maxDepth = 4;         // finest spacing is the base spacing / 2^maxDepth
+	};
+
+	// Tube along an adaptively sampled curve, starting from baseSegments uniform intervals
+	static IndexedMesh generateParametricCurveTubeAdaptive(
+		const CurveSampler& curveFunc,
+		float tMin, float tMax, int baseSegments,
+		const AdaptiveOptions& options,
+		float tubeRadius = 0.03f, int tubeSegments = 8,
+		vec3 color = vec3(1, 1, 0));
+
 	// Generate a parametric surface r(u,v)
-	// Returns TriangleList vertices with normals for Blinn-Phong
-	static std::vector<VertexAttributes> generateParametricSurface(
-		std::function<vec3(float, float)> surfaceFunc,
+	// Returns the (uSegments+1) x (vSegments+1) vertex grid with normals for Blinn-Phong,
+	// indexed as a TriangleList
+	static IndexedMesh generateParametricSurface(
+		const SurfaceSampler& surfaceFunc,
 		float uMin, float uMax, float vMin, float vMax,
 		int uSegments, int vSegments,
-		bool colorByHeight = true);
+		bool colorByHeight = true,
+		const SurfaceJetSampler& surfaceJet = nullptr);
 
-	// Generate a scalar field visualization: small colored cubes at grid points
-	static std::vector<VertexAttributes> generateScalarField(
-		std::function<float(vec3)> scalarFunc,
+	// Heights z = f(u, v) on the same (uSegments+1) x (vSegments+1) grid, u fastest, as the
+	// Heightfield texture holds them. No vertices: the heightfield pipeline displaces the grid itself.
+	static std::vector<float> generateHeightfield(
+		const Scalar2DSampler& scalarFunc,
+		float uMin, float uMax, float vMin, float vMax,
+		int uSegments, int vSegments);
+
+	// Surface over a quadtree of (u, v) cells rooted at a uBase x vBase grid.
+	// Cells are fanned around their centre wherever a finer neighbour adds edge vertices,
+	// so the mesh has no T-junction cracks.
+	static IndexedMesh generateParametricSurfaceAdaptive(
+		const SurfaceSampler& surfaceFunc,
+		float uMin, float uMax, float vMin, float vMax,
+		int uBase, int vBase,
+		const AdaptiveOptions& options,
+		bool colorByHeight = true,
+		const SurfaceJetSampler& surfaceJet = nullptr);
+
+	// Generate a scalar field visualization: small colored cube glyphs at grid points
+	static std::vector<GlyphInstance> generateScalarField(
+		const ScalarSampler& scalarFunc,
 		vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 		float cubeSize = 0.1f);
 
-	// Generate a small colored cube centered at origin (12 triangles = 36 verts)
+	// Level sets f = level of a scalar field R^3->R^1, one per level, extracted with surface nets
+	// on a resolution^3 sample grid into a lit TriangleList. Blocks of cells whose samples all
+	// lie on one side of every level are skipped before any per-cell work, so the cost follows
+	// the surface area rather than the grid volume. One level takes color, several a ramp.
+	static IndexedMesh generateIsosurface(
+		const ScalarSampler& scalarFunc,
+		vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
+		const std::vector<float>& levels, vec3 color = vec3(1, 1, 0),
+		const GradientSampler& gradient = nullptr);
+
+	// Level sets f = level of a scalar function R^2->R^1 in the z = 0 plane, by marching
+	// squares over a (uSegments+1) x (vSegments+1) grid. Returns LineList vertices.
+	static std::vector<VertexAttributes> generateIsolines(
+		const Scalar2DSampler& scalarFunc,
+		float uMin, float uMax, float vMin, float vMax,
+		int uSegments, int vSegments,
+		const std::vector<float>& levels, vec3 color = vec3(1, 1, 0));
+
+	// Generate a small colored cube centered at origin (12 triangles = 36 verts).
+	// Called with halfSize 1 it is the unit cube the glyph instances are drawn with.
 	static std::vector<VertexAttributes> generateColoredCube(
 		float halfSize, vec3 color);
 
-	// Generate a parametric surface as wireframe (LineList)
-	static std::vector<VertexAttributes> generateParametricSurfaceWireframe(
-		std::function<vec3(float, float)> surfaceFunc,
+	// Generate a parametric surface as wireframe: the vertex grid indexed as a LineList
+	static IndexedMesh generateParametricSurfaceWireframe(
+		const SurfaceSampler& surfaceFunc,
 		float uMin, float uMax, float vMin, float vMax,
 		int uSegments, int vSegments,
 		vec3 color = vec3(1, 1, 1));
 
 	// Generate tangent vector arrows along a parametric curve
-	static std::vector<VertexAttributes> generateTangentVectors(
-		std::function<vec3(float)> curveFunc,
+	static std::vector<GlyphInstance> generateTangentVectors(
+		const CurveSampler& curveFunc,
 		float tMin, float tMax, int count,
-		float arrowScale = 0.3f, vec3 color = vec3(1, 0, 0));
+		float arrowScale = 0.3f, vec3 color = vec3(1, 0, 0),
+		const CurveJetSampler& curveJet = nullptr);
 
 	// Generate normal vector arrows along a parametric curve
-	static std::vector<VertexAttributes> generateCurveNormals(
-		std::function<vec3(float)> curveFunc,
+	static std::vector<GlyphInstance> generateCurveNormals(
+		const CurveSampler& curveFunc,
 		float tMin, float tMax, int count,
-		float arrowScale = 0.3f, vec3 color = vec3(0, 1, 0), bool flipNormal = false);
+		float arrowScale = 0.3f, vec3 color = vec3(0, 1, 0), bool flipNormal = false,
+		const CurveJetSampler& curveJet = nullptr);
 
 	// Generate normal vector arrows on a parametric surface
-	static std::vector<VertexAttributes> generateSurfaceNormals(
-		std::function<vec3(float, float)> surfaceFunc,
+	static std::vector<GlyphInstance> generateSurfaceNormals(
+		const SurfaceSampler& surfaceFunc,
 		float uMin, float uMax, float vMin, float vMax,
 		int uCount, int vCount,
-		float arrowScale = 0.3f, vec3 color = vec3(0, 0, 1), bool flipNormal = false);
+		float arrowScale = 0.3f, vec3 color = vec3(0, 0, 1), bool flipNormal = false,
+		const SurfaceJetSampler& surfaceJet = nullptr);
 
 	// Generate tangent vector arrows on a parametric surface (u and v directions)
-	static std::vector<VertexAttributes> generateSurfaceTangents(
-		std::function<vec3(float, float)> surfaceFunc,
+	static std::vector<GlyphInstance> generateSurfaceTangents(
+		const SurfaceSampler& surfaceFunc,
 		float uMin, float uMax, float vMin, float vMax,
 		int uCount, int vCount,
-		float arrowScale = 0.3f, vec3 color = vec3(1, 0, 0), int mode = 0);
+		float arrowScale = 0.3f, vec3 color = vec3(1, 0, 0), int mode = 0,
+		const SurfaceJetSampler& surfaceJet = nullptr);
 
 	// Generate Frenet frame (T/N/B) at a single point on a curve
-	static std::vector<VertexAttributes> generateFrenetFrame(
-		std::function<vec3(float)> curveFunc,
+	static std::vector<GlyphInstance> generateFrenetFrame(
+		const CurveSampler& curveFunc,
 		float tMin, float tMax, float tNorm,
-		float arrowScale = 0.5f);
+		float arrowScale = 0.5f,
+		const CurveJetSampler& curveJet = nullptr);
 
 	// Generate gradient field arrows for a scalar function R^2->R^1
-	static std::vector<VertexAttributes> generateGradientField2D(
-		std::function<float(float, float)> scalarFunc,
+	static std::vector<GlyphInstance> generateGradientField2D(
+		const Scalar2DSampler& scalarFunc,
 		float uMin, float uMax, float vMin, float vMax,
 		int uCount, int vCount,
-		float arrowScale = 0.3f);
+		float arrowScale = 0.3f,
+		const Gradient2DSampler& gradient = nullptr);
 
 	// Generate gradient field arrows for a scalar function R^3->R^1
-	static std::vector<VertexAttributes> generateGradientField3D(
-		std::function<float(vec3)> scalarFunc,
+	static std::vector<GlyphInstance> generateGradientField3D(
+		const ScalarSampler& scalarFunc,
 		vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
-		float arrowScale = 0.3f);
+		float arrowScale = 0.3f,
+		const GradientSampler& gradient = nullptr);
 
 	// Generate streamlines for a vector field R^3->R^3
 	static std::vector<VertexAttributes> generateStreamlines(
-		std::function<vec3(vec3)> fieldFunc,
+		const FieldSampler& fieldFunc,
 		vec3 rangeMin, vec3 rangeMax, ivec3 resolution,
 		int numStreamlines = 10, float stepSize = 0.1f);
 
 	// Map a value in [0,1] to a blue->green->red gradient (public for scalar field)
 	static vec3 magnitudeToColor(float t);
 
+	// Unit glyph meshes shared by every GlyphInstance
+	static std::vector<VertexAttributes> unitArrowMesh();
+	static std::vector<VertexAttributes> unitCubeMesh();
+
 private:
 	// Map height to color based on min/max range
 	static vec3 heightToColor(float height, float minH, float maxH);
+
+	// Arrow of total length len along dir (normalized here), shaft radius len * radius
+	static GlyphInstance arrowGlyph(vec3 pos, vec3 dir, float len, float radius, vec3 color);
+	static uint32_t packColor(vec3 color);
+
+	// Fill mesh.lods for a (uSegments+1) x (vSegments+1) row-major grid, or for tube rings
+	// of tubeSegments vertices around a curve of `segments` segments
+	static void addGridLods(IndexedMesh& mesh, int uSegments, int vSegments);
+	static void addTubeLods(IndexedMesh& mesh, int segments, int tubeSegments);
+
+	// Rotation-minimizing tube through points (at least two)
+	static IndexedMesh tubeAlongPoints(const std::vector<vec3>& points,
+		float tubeRadius, int tubeSegments, vec3 color);
+
+	// Positions and derivatives at every parameter: exact from the jet sampler when there
+	// is one, else central differences with step eps (ddp is only filled when non-null)
+	static void sampleCurveJet(const CurveSampler& curveFunc, const CurveJetSampler& curveJet,
+		const std::vector<float>& ts, float eps,
+		std::vector<vec3>& p, std::vector<vec3>& dp, std::vector<vec3>* ddp);
+	static void sampleSurfaceJet(const SurfaceSampler& surfaceFunc, const SurfaceJetSampler& surfaceJet,
+		const std::vector<vec2>& uv, float eps,
+		std::vector<vec3>& p, std::vector<vec3>& dpdu, std::vector<vec3>& dpdv);
+
+	// Row-major uCount x vCount parameter grid spanning both ranges
+	static std::vector<vec2> parameterGrid(float uMin, float uMax, float vMin, float vMax, int uCount, int vCount);
 };
@@ -0,0 +1,143 @@
+#include "Heightfield.h"
+#include "GraphObjects.h"
+
+#include <vector>
+
+Heightfield::~Heightfield() {
+	terminate();
+}
+
+WGPUBindGroupLayout Heightfield::createBindGroupLayout(WGPUDevice device) {
+	std::vector<WGPUBindGroupLayoutEntry> entries(2, WGPUBindGroupLayoutEntry{});
+
+	// Heights, read with textureLoad: float32 textures cannot be filtered everywhere
+	entries[0].binding = 0;
+	entries[0].visibility = WGPUShaderStage_Vertex;
+	entries[0].texture.sampleType = WGPUTextureSampleType_UnfilterableFloat;
+	entries[0].texture.viewDimension = WGPUTextureViewDimension_2D;
+
+	entries[1].binding = 1;
+	entries[1].visibility = WGPUShaderStage_Vertex;
+	entries[1].buffer.type = WGPUBufferBindingType_Uniform;
+	entries[1].buffer.minBindingSize = sizeof(Uniforms);
+
+	WGPUBindGroupLayoutDescriptor layoutDesc{};
+	layoutDesc.entryCount = (uint32_t)entries.size();
+	layoutDesc.entries = entries.data();
+	return wgpuDeviceCreateBindGroupLayout(device, &layoutDesc);
+}
+
+// ─── Levels of Detail ───────────────────────────────────────────────────────
+
+int Heightfield::levelCount(int uSegments, int vSegments) {
+	if (uSegments < 1 || vSegments < 1) return 0;
+	int levels = 1;
+	while (levels < GraphObjects::LOD_LEVELS) {
+		const int stride = 1 << levels;
+		if (uSegments < stride * 2 && vSegments < stride * 2) break;
+		++levels;
+	}
+	return levels;
+}
+
+uint32_t Heightfield::levelVertexCount(int uSegments, int vSegments, int level) {
+	// The last cell of a row is cut short by the grid edge, as in strideLines
+	const int stride = 1 << level;
+	const uint32_t uCells = (uint32_t)((uSegments + stride - 1) / stride);
+	const uint32_t vCells = (uint32_t)((vSegments + stride - 1) / stride);
+	return uCells * vCells * 6;
+}
+
+// ─── Upload ─────────────────────────────────────────────────────────────────
+
+bool Heightfield::upload(WGPUDevice device, WGPUQueue queue, WGPUBindGroupLayout layout,
+	const float* heights, int uCount, int vCount, const float range[4], std::string& errorMsg) {
+	if (uCount < 2 || vCount < 2 || uCount > MAX_SIZE || vCount > MAX_SIZE) {
+		errorMsg = "a " + std::to_string(uCount) + " x " + std::to_string(vCount) + " grid does not fit a height texture";
+		return false;
+	}
+
+	// Only a new resolution needs a new texture
+	WGPUExtent3D size = { (uint32_t)uCount, (uint32_t)vCount, 1 };
+	if (uCount != m_uCount || vCount != m_vCount) {
+		terminate();
+
+		WGPUTextureDescriptor textureDesc = {};
+		textureDesc.label = "Heightfield";
+		textureDesc.dimension = WGPUTextureDimension_2D;
+		textureDesc.format = WGPUTextureFormat_R32Float;
+		textureDesc.size = size;
+		textureDesc.mipLevelCount = 1;
+		textureDesc.sampleCount = 1;
+		textureDesc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst;
+		textureDesc.viewFormatCount = 0;
+		textureDesc.viewFormats = nullptr;
+		m_texture = wgpuDeviceCreateTexture(device, &textureDesc);
+
+		WGPUBufferDescriptor bufferDesc = {};
+		bufferDesc.size = sizeof(Uniforms);
+		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
+		bufferDesc.mappedAtCreation = false;
+		m_uniformBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+		if (!m_texture || !m_uniformBuffer) {
+			errorMsg = "could not allocate the height texture";
+			terminate();
+			return false;
+		}
+
+		WGPUTextureViewDescriptor viewDesc = {};
+		viewDesc.aspect = WGPUTextureAspect_All;
+		viewDesc.baseArrayLayer = 0;
+		viewDesc.arrayLayerCount = 1;
+		viewDesc.baseMipLevel = 0;
+		viewDesc.mipLevelCount = 1;
+		viewDesc.dimension = WGPUTextureViewDimension_2D;
+		viewDesc.format = textureDesc.format;
+		m_textureView = wgpuTextureCreateView(m_texture, &viewDesc);
+
+		std::vector<WGPUBindGroupEntry> bindings(2, WGPUBindGroupEntry{});
+		bindings[0].binding = 0;
+		bindings[0].textureView = m_textureView;
+		bindings[1].binding = 1;
+		bindings[1].buffer = m_uniformBuffer;
+		bindings[1].offset = 0;
+		bindings[1].size = sizeof(Uniforms);
+		WGPUBindGroupDescriptor bindGroupDesc = {};
+		bindGroupDesc.layout = layout;
+		bindGroupDesc.entryCount = (uint32_t)bindings.size();
+		bindGroupDesc.entries = bindings.data();
+		m_bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+		m_uCount = uCount;
+		m_vCount = vCount;
+	}
+
+	// Frames already submitted keep reading the old heights; the queue orders the write after them
+	WGPUImageCopyTexture destination = {};
+	destination.texture = m_texture;
+	destination.mipLevel = 0;
+	destination.origin = { 0, 0, 0 };
+	destination.aspect = WGPUTextureAspect_All;
+	WGPUTextureDataLayout source = {};
+	source.offset = 0;
+	source.bytesPerRow = (uint32_t)uCount * sizeof(float);
+	source.rowsPerImage = (uint32_t)vCount;
+	wgpuQueueWriteTexture(queue, &destination, heights, (size_t)uCount * vCount * sizeof(float), &source, &size);
+
+	Uniforms uniforms = { { range[0], range[2] }, { range[1], range[3] } };
+	wgpuQueueWriteBuffer(queue, m_uniformBuffer, 0, &uniforms, sizeof(uniforms));
+	return m_bindGroup != nullptr;
+}
+
+void Heightfield::terminate() {
+	// Released, not destroyed: recorded bundles and frames in flight may still hold the texture
+	if (m_bindGroup) wgpuBindGroupRelease(m_bindGroup);
+	if (m_textureView) wgpuTextureViewRelease(m_textureView);
+	if (m_texture) wgpuTextureRelease(m_texture);
+	if (m_uniformBuffer) wgpuBufferRelease(m_uniformBuffer);
+	m_bindGroup = nullptr;
+	m_textureView = nullptr;
+	m_texture = nullptr;
+	m_uniformBuffer = nullptr;
+	m_uCount = 0;
+	m_vCount = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <string>
+
+// Surface z = f(u, v) of a scalar function R^2 -> R^1, uploaded as an R32Float texture of its
+// heights and nothing else. The "heightfield" pipeline has no vertex buffer: vs_heightfield in
+// surface.wgsl turns vertex_index into a grid cell and corner, reads its height, and takes the
+// normal from the neighbouring texels. New heights or a new range at the same resolution are
+// rewritten into the same texture, so the bind group and the draw bundle survive them.
+class Heightfield {
+public:
+	// Every WebGPU device supports 2D textures this large on a side
+	static constexpr int MAX_SIZE = 8192;
+
+	Heightfield() = default;
+	~Heightfield();
+
+	Heightfield(const Heightfield&) = delete;
+	Heightfield& operator=(const Heightfield&) = delete;
+
+	// Group 2 of the heightfield pipelines: the height texture, then the (u, v) range
+	static WGPUBindGroupLayout createBindGroupLayout(WGPUDevice device);
+
+	// Levels of detail of a uSegments x vSegments grid, with the strides of GraphObjects::addGridLods.
+	// Level l draws six vertices per cell of 2^l x 2^l grid cells; the levels take consecutive
+	// vertex ranges, full detail first, which is how vs_heightfield tells them apart.
+	static int levelCount(int uSegments, int vSegments);
+	static uint32_t levelVertexCount(int uSegments, int vSegments, int level);
+
+	// heights holds uCount x vCount samples at evenly spaced (u, v), u fastest; range is uMin, uMax, vMin, vMax
+	bool upload(WGPUDevice device, WGPUQueue queue, WGPUBindGroupLayout layout,
+		const float* heights, int uCount, int vCount, const float range[4], std::string& errorMsg);
+
+	WGPUBindGroup bindGroup() const { return m_bindGroup; }
+
+	void terminate();
+
+private:
+	// The same structure as in surface.wgsl, replicated in C++
+	struct Uniforms {
+		float uvMin[2];
+		float uvMax[2];
+	};
+	static_assert(sizeof(Uniforms) % 16 == 0);
+
+	WGPUTexture m_texture = nullptr;
+	WGPUTextureView m_textureView = nullptr;
+	WGPUBuffer m_uniformBuffer = nullptr;
+	WGPUBindGroup m_bindGroup = nullptr;
+	int m_uCount = 0;
+	int m_vCount = 0;
+};
@@ -0,0 +1,258 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// ─── Checksums ──────────────────────────────────────────────────────────────
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> t = {};
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t[n] = c;
+		}
+		return t;
+	}();
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+	uint32_t a = 1, b = 0;
+	while (size > 0) {
+		// The most bytes before b can overflow 32 bits
+		const size_t block = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < block; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += block;
+		size -= block;
+	}
+	return (b << 16) | a;
+}
+
+void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+	for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(v >> shift));
+}
+
+// ─── Deflate ────────────────────────────────────────────────────────────────
+
+// LSB-first bit stream, as deflate packs it
+class BitWriter {
+public:
+	explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+	void put(uint32_t value, int count) {
+		m_bits |= (uint64_t)value << m_count;
+		m_count += count;
+		while (m_count >= 8) {
+			m_out.push_back(static_cast<uint8_t>(m_bits));
+			m_bits >>= 8;
+			m_count -= 8;
+		}
+	}
+	// Huffman codes are defined most significant bit first
+	void putCode(uint32_t code, int count) {
+		uint32_t reversed = 0;
+		for (int i = 0; i < count; ++i) reversed |= ((code >> i) & 1) << (count - 1 - i);
+		put(reversed, count);
+	}
+	void flush() {
+		if (m_count > 0) m_out.push_back(static_cast<uint8_t>(m_bits));
+		m_bits = 0;
+		m_count = 0;
+	}
+
+private:
+	std::vector<uint8_t>& m_out;
+	uint64_t m_bits = 0;
+	int m_count = 0;
+};
+
+constexpr uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+constexpr uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+constexpr uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+constexpr uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Literal/length symbol in the fixed code of RFC 1951, 3.2.6
+void putSymbol(BitWriter& w, int symbol) {
+	if (symbol < 144) w.putCode(0x30 + symbol, 8);
+	else if (symbol < 256) w.putCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280) w.putCode(symbol - 256, 7);
+	else w.putCode(0xC0 + symbol - 280, 8);
+}
+
+void putMatch(BitWriter& w, int length, int distance) {
+	int l = 28;
+	while (LENGTH_BASE[l] > length) --l;
+	putSymbol(w, 257 + l);
+	w.put(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+	int d = 29;
+	while (DISTANCE_BASE[d] > distance) --d;
+	w.putCode(d, 5);
+	w.put(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+}
+
+// zlib stream of one fixed-Huffman block, matches found through a short hash chain
+std::vector<uint8_t> zlibCompress(const std::vector<uint8_t>& data) {
+	constexpr int HASH_BITS = 15;
+	constexpr size_t WINDOW = 32768;
+	constexpr size_t MIN_MATCH = 3, MAX_MATCH = 258;
+	constexpr int MAX_CHAIN = 32;
+
+	std::vector<uint8_t> out = { 0x78, 0x01 };
+	BitWriter w(out);
+	w.put(1, 1);  // final block
+	w.put(1, 2);  // fixed codes
+
+	const size_t n = data.size();
+	std::vector<int64_t> head(size_t(1) << HASH_BITS, -1);
+	std::vector<int64_t> previous(WINDOW, -1);
+	auto hash = [&](size_t i) {
+		const uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+		return (v * 2654435761u) >> (32 - HASH_BITS);
+	};
+	auto insert = [&](size_t i) {
+		if (i + MIN_MATCH > n) return;
+		const uint32_t h = hash(i);
+		previous[i % WINDOW] = head[h];
+		head[h] = (int64_t)i;
+	};
+
+	size_t i = 0;
+	while (i < n) {
+		size_t bestLength = 0, bestDistance = 0;
+		if (i + MIN_MATCH <= n) {
+			const size_t maxLength = std::min(MAX_MATCH, n - i);
+			int64_t candidate = head[hash(i)];
+			for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && i - (size_t)candidate < WINDOW; ++chain) {
+				const uint8_t* a = &data[(size_t)candidate];
+				const uint8_t* b = &data[i];
+				size_t length = 0;
+				while (length < maxLength && a[length] == b[length]) ++length;
+				if (length > bestLength) {
+					bestLength = length;
+					bestDistance = i - (size_t)candidate;
+					if (length == maxLength) break;
+				}
+				// Older entries of the ring may have been overwritten by newer positions
+				const int64_t next = previous[(size_t)candidate % WINDOW];
+				if (next >= candidate) break;
+				candidate = next;
+			}
+		}
+		if (bestLength >= MIN_MATCH) {
+			putMatch(w, (int)bestLength, (int)bestDistance);
+			for (size_t k = 0; k < bestLength; ++k) insert(i + k);
+			i += bestLength;
+		} else {
+			putSymbol(w, data[i]);
+			insert(i);
+			++i;
+		}
+	}
+	putSymbol(w, 256);  // end of block
+	w.flush();
+	putBigEndian(out, adler32(data.data(), data.size()));
+	return out;
+}
+
+// ─── PNG ────────────────────────────────────────────────────────────────────
+
+void putChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+	putBigEndian(png, static_cast<uint32_t>(data.size()));
+	const size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	putBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+	const int p = a + b - c;
+	const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+} // namespace
+
+std::vector<uint8_t> ImageWriter::encodePng(uint32_t width, uint32_t height, const uint8_t* rgba, size_t stride) {
+	constexpr size_t BPP = 3;
+	const size_t rowBytes = (size_t)width * BPP;
+
+	// Each row with whichever filter leaves the smallest residuals, the usual heuristic
+	std::vector<uint8_t> filtered;
+	filtered.reserve((rowBytes + 1) * height);
+	std::vector<uint8_t> row(rowBytes), above(rowBytes, 0), candidate(rowBytes), best(rowBytes);
+	for (uint32_t y = 0; y < height; ++y) {
+		const uint8_t* src = rgba + y * stride;
+		for (uint32_t x = 0; x < width; ++x) std::memcpy(&row[x * BPP], src + x * 4, BPP);
+
+		uint64_t bestScore = UINT64_MAX;
+		uint8_t bestFilter = 0;
+		for (uint8_t filter = 0; filter < 5; ++filter) {
+			uint64_t score = 0;
+			for (size_t i = 0; i < rowBytes; ++i) {
+				const uint8_t a = i >= BPP ? row[i - BPP] : 0;
+				const uint8_t b = above[i];
+				const uint8_t c = i >= BPP ? above[i - BPP] : 0;
+				uint8_t predictor = 0;
+				switch (filter) {
+				case 1: predictor = a; break;
+				case 2: predictor = b; break;
+				case 3: predictor = static_cast<uint8_t>((a + b) / 2); break;
+				case 4: predictor = paeth(a, b, c); break;
+				}
+				candidate[i] = static_cast<uint8_t>(row[i] - predictor);
+				score += std::min<int>(candidate[i], 256 - candidate[i]);
+			}
+			if (score < bestScore) {
+				bestScore = score;
+				bestFilter = filter;
+				best.swap(candidate);
+			}
+		}
+		filtered.push_back(bestFilter);
+		filtered.insert(filtered.end(), best.begin(), best.end());
+		above.swap(row);
+	}
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<uint8_t> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });  // 8-bit RGB, deflate, adaptive filters, no interlace
+	putChunk(png, "IHDR", header);
+	putChunk(png, "IDAT", zlibCompress(filtered));
+	putChunk(png, "IEND", {});
+	return png;
+}
+
+bool ImageWriter::writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba, size_t stride,
+	std::string& errorMsg) {
+	const std::vector<uint8_t> png = encodePng(width, height, rgba, stride);
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		errorMsg = "could not open " + path + " for writing";
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+	if (!file) {
+		errorMsg = "could not write " + path;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Image files from pixels read back from the GPU. Thread-safe, so batch renders encode on the workers.
+class ImageWriter {
+public:
+	// 8-bit RGB PNG from RGBA8 rows stride bytes apart; alpha is dropped, the scene is opaque.
+	// Rows are filtered and deflated with the fixed Huffman codes: flat plot backgrounds shrink to
+	// almost nothing, without a zlib dependency.
+	static std::vector<uint8_t> encodePng(uint32_t width, uint32_t height, const uint8_t* rgba, size_t stride);
+	static bool writePng(const std::string& path, uint32_t width, uint32_t height, const uint8_t* rgba, size_t stride,
+		std::string& errorMsg);
+};
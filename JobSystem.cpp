@@ -0,0 +1,137 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace {
+// The pool this thread works for and the queue it owns; null outside any pool
+thread_local const JobSystem* t_pool = nullptr;
+thread_local size_t t_queue = 0;
+}
+
+JobSystem::JobSystem(unsigned workerCount) {
+	for (unsigned i = 0; i <= workerCount; ++i) m_queues.push_back(std::make_unique<Queue>());
+	for (unsigned i = 0; i < workerCount; ++i) m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (auto& thread : m_threads) thread.join();
+}
+
+JobSystem& JobSystem::shared() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	// No threads on the web without SharedArrayBuffer builds
+	static JobSystem pool(0);
+#else
+	static JobSystem pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+#endif
+	return pool;
+}
+
+// ─── Scheduling ─────────────────────────────────────────────────────────────
+
+void JobSystem::push(Job job) {
+	const size_t home = (t_pool == this) ? t_queue : m_queues.size() - 1;
+	{
+		std::lock_guard<std::mutex> lock(m_queues[home]->mutex);
+		m_queues[home]->jobs.push_back(std::move(job));
+	}
+	m_queued.fetch_add(1);
+	// Taking the wake mutex orders this against a worker's predicate check
+	{ std::lock_guard<std::mutex> lock(m_wakeMutex); }
+	m_wake.notify_one();
+}
+
+bool JobSystem::popFrom(size_t queue, bool back, Job& job) {
+	Queue& q = *m_queues[queue];
+	std::lock_guard<std::mutex> lock(q.mutex);
+	if (q.jobs.empty()) return false;
+	if (back) {
+		job = std::move(q.jobs.back());
+		q.jobs.pop_back();
+	} else {
+		job = std::move(q.jobs.front());
+		q.jobs.pop_front();
+	}
+	m_queued.fetch_sub(1);
+	return true;
+}
+
+bool JobSystem::runOne() {
+	const size_t queueCount = m_queues.size();
+	const size_t home = t_queue;
+
+	Job job;
+	// Newest local job first (cache-warm), then steal the oldest from everyone else
+	bool found = popFrom(home, true, job);
+	for (size_t k = 1; !found && k <= queueCount; ++k) {
+		found = popFrom((home + k) % queueCount, false, job);
+	}
+	if (!found) return false;
+	job();
+	return true;
+}
+
+void JobSystem::workerLoop(unsigned index) {
+	t_pool = this;
+	t_queue = index;
+	while (true) {
+		if (runOne()) continue;
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait(lock, [this] { return m_stop || m_queued.load() > 0; });
+		if (m_stop) return;
+	}
+}
+
+// ─── Parallel Loops ─────────────────────────────────────────────────────────
+
+void JobSystem::submit(Job job) {
+	if (m_threads.empty()) {
+		job();
+		return;
+	}
+	push(std::move(job));
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const RangeBody& body) {
+	if (count == 0) return;
+	grain = std::max<size_t>(grain, 1);
+	const size_t chunks = (count + grain - 1) / grain;
+	if (chunks == 1 || m_threads.empty()) {
+		body(0, count);
+		return;
+	}
+
+	// Chunks are claimed from a shared counter: the caller and up to one helper job per worker
+	// take them until none are left. A helper that starts after the loop has returned finds
+	// nothing to claim, so the counters live on the heap and body is never touched again.
+	struct Loop {
+		std::atomic<size_t> next{0};
+		std::atomic<size_t> done{0};
+	};
+	auto loop = std::make_shared<Loop>();
+	auto runChunks = [&body, count, grain, chunks](Loop& l) {
+		for (size_t c = l.next.fetch_add(1); c < chunks; c = l.next.fetch_add(1)) {
+			const size_t begin = c * grain;
+			body(begin, std::min(count, begin + grain));
+			l.done.fetch_add(1, std::memory_order_release);
+		}
+	};
+	const size_t helpers = std::min(chunks - 1, m_threads.size());
+	for (size_t h = 0; h < helpers; ++h) {
+		push([loop, runChunks] { runChunks(*loop); });
+	}
+	runChunks(*loop);
+
+	// The last chunks may still be running on other threads. A worker helps with queued jobs
+	// meanwhile so nested loops make progress; a thread outside the pool (the render thread)
+	// only ever runs chunks of its own loop, never somebody else's background job.
+	const bool inPool = (t_pool == this);
+	while (loop->done.load(std::memory_order_acquire) < chunks) {
+		if (!inPool || !runOne()) std::this_thread::yield();
+	}
+}
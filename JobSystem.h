@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for CPU geometry generation.
+// Every worker owns a deque: it pops its own jobs from the back and steals from the
+// front of the others'. Threads outside the pool push to a shared injection queue.
+// A worker waiting in parallelFor keeps running queued jobs, so parallel loops nest
+// (across functions, then across tiles of each sampling grid) without deadlocking.
+// A thread outside the pool only runs chunks of its own parallelFor.
+class JobSystem {
+public:
+	using Job = std::function<void()>;
+	using RangeBody = std::function<void(size_t begin, size_t end)>;
+
+	// workerCount 0 runs everything inline on the calling thread
+	explicit JobSystem(unsigned workerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Process-wide pool with one worker per hardware thread, minus the caller
+	static JobSystem& shared();
+
+	unsigned workerCount() const { return (unsigned)m_threads.size(); }
+
+	// Queue a job to run in the background. With no workers it runs before returning.
+	void submit(Job job);
+
+	// Run body over [0, count) in chunks of at most `grain` items and return once all are done.
+	// body must not throw; chunks may run in any order and on any thread.
+	void parallelFor(size_t count, size_t grain, const RangeBody& body);
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void push(Job job);
+	bool runOne();                      // workers only: pop local work, else steal; false if all were empty
+	bool popFrom(size_t queue, bool back, Job& job);
+	void workerLoop(unsigned index);
+
+	// m_queues[i] belongs to worker i; the last one is the injection queue
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t> m_queued{0};
+	bool m_stop = false;
+};
@@ -0,0 +1,263 @@
+#include "Profiler.h"
+
+#include "json.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+// Trace lane of the calling thread; 0 is reserved for the GPU
+uint32_t threadLane() {
+	static std::atomic<uint32_t> next{1};
+	thread_local uint32_t lane = next.fetch_add(1);
+	return lane;
+}
+}
+
+Profiler::Scope::Scope(const char* name)
+	: m_name(name), m_start(Profiler::shared().enabled() ? nowNs() : 0) {}
+
+Profiler::Scope::~Scope() {
+	if (m_start) Profiler::shared().record(m_name, m_start, nowNs());
+}
+
+Profiler& Profiler::shared() {
+	static Profiler profiler;
+	return profiler;
+}
+
+uint64_t Profiler::nowNs() {
+	using namespace std::chrono;
+	static const steady_clock::time_point epoch = steady_clock::now();
+	// Never 0, which Scope uses for "not timing"
+	return (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - epoch).count() + 1;
+}
+
+// ─── CPU Phases ─────────────────────────────────────────────────────────────
+
+size_t Profiler::phaseIndex(const char* name, bool gpu) {
+	// GPU passes get their own phase even when a CPU scope has the same name
+	std::string key = gpu ? std::string("GPU ") + name : std::string(name);
+	auto it = m_phaseIndex.find(key);
+	if (it != m_phaseIndex.end()) return it->second;
+	Phase phase;
+	phase.name = key;
+	phase.gpu = gpu;
+	m_phases.push_back(std::move(phase));
+	m_frameTotals.push_back(0.0f);
+	m_phaseIndex.emplace(std::move(key), m_phases.size() - 1);
+	return m_phases.size() - 1;
+}
+
+void Profiler::pushEvent(const Event& event) {
+	if (m_events.size() < MAX_EVENTS) m_events.push_back(event);
+	else m_events[m_nextEvent] = event;
+	m_nextEvent = (m_nextEvent + 1) % MAX_EVENTS;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs) {
+	if (!enabled()) return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_frameTotals[phaseIndex(name, false)] += (endNs - startNs) * 1e-6f;
+	pushEvent({ name, threadLane(), startNs, endNs });
+}
+
+void Profiler::beginFrame() {
+	collectGpu();
+	const uint64_t now = nowNs();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_frameStart && enabled()) {
+		m_frameTotals[phaseIndex("Frame", false)] += (now - m_frameStart) * 1e-6f;
+		m_framesRecorded = std::min(m_framesRecorded + 1, HISTORY);
+		// Summed over threads, so a phase running on every worker can exceed the frame
+		for (size_t i = 0; i < m_phases.size(); ++i) {
+			Phase& phase = m_phases[i];
+			phase.ms[m_cursor] = m_frameTotals[i];
+			float sum = 0.0f;
+			for (float ms : phase.ms) sum += ms;
+			phase.average = sum / m_framesRecorded;
+			m_frameTotals[i] = 0.0f;
+		}
+		m_cursor = (m_cursor + 1) % HISTORY;
+	}
+	m_frameStart = now;
+
+	// GPU passes of this frame go into the first free readback slot
+	m_currentSlot = -1;
+	if (!m_querySet || !enabled()) return;
+	for (int s = 0; s < READBACK_SLOTS; ++s) {
+		if (m_slots[s].state.load() != SlotState::Free) continue;
+		m_currentSlot = s;
+		m_slots[s].names.clear();
+		m_slots[s].frameStart = now;
+		break;
+	}
+}
+
+std::vector<Profiler::Phase> Profiler::phases() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_phases;
+}
+
+int Profiler::historyCursor() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cursor;
+}
+
+// ─── GPU Timestamps ─────────────────────────────────────────────────────────
+
+bool Profiler::initGpu(WGPUDevice device, WGPUQueue queue) {
+	if (!wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery)) return false;
+	m_device = device;
+	m_queue = queue;
+
+	WGPUQuerySetDescriptor querySetDesc = {};
+	querySetDesc.label = "Profiler timestamps";
+	querySetDesc.type = WGPUQueryType_Timestamp;
+	querySetDesc.count = 2 * MAX_GPU_PASSES;
+	m_querySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+
+	WGPUBufferDescriptor bufferDesc = {};
+	bufferDesc.label = "Profiler query resolve";
+	bufferDesc.size = 2 * MAX_GPU_PASSES * sizeof(uint64_t);
+	bufferDesc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+	bufferDesc.mappedAtCreation = false;
+	m_resolveBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+	bufferDesc.label = "Profiler readback";
+	bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+	for (ReadbackSlot& slot : m_slots) {
+		slot.buffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+		slot.state = SlotState::Free;
+	}
+
+	if (!m_querySet || !m_resolveBuffer) {
+		std::cerr << "Profiler: could not create the timestamp query set" << std::endl;
+		terminateGpu();
+		return false;
+	}
+	return true;
+}
+
+void Profiler::terminateGpu() {
+	for (ReadbackSlot& slot : m_slots) {
+		if (!slot.buffer) continue;
+		// A pending map is cancelled and its callback only touches the slot's state
+		wgpuBufferDestroy(slot.buffer);
+		wgpuBufferRelease(slot.buffer);
+		slot.buffer = nullptr;
+	}
+	if (m_resolveBuffer) {
+		wgpuBufferDestroy(m_resolveBuffer);
+		wgpuBufferRelease(m_resolveBuffer);
+		m_resolveBuffer = nullptr;
+	}
+	if (m_querySet) {
+		wgpuQuerySetDestroy(m_querySet);
+		wgpuQuerySetRelease(m_querySet);
+		m_querySet = nullptr;
+	}
+	m_currentSlot = -1;
+}
+
+uint32_t Profiler::beginGpuPass(const char* name) {
+	if (m_currentSlot < 0) return MAX_GPU_PASSES;
+	std::vector<const char*>& names = m_slots[m_currentSlot].names;
+	if (names.size() >= MAX_GPU_PASSES) return MAX_GPU_PASSES;
+	names.push_back(name);
+	return (uint32_t)names.size() - 1;
+}
+
+uint32_t Profiler::renderPassTimestamps(const char* name, WGPURenderPassTimestampWrite* writes) {
+	const uint32_t pass = beginGpuPass(name);
+	if (pass == MAX_GPU_PASSES) return 0;
+	writes[0] = { m_querySet, 2 * pass, WGPURenderPassTimestampLocation_Beginning };
+	writes[1] = { m_querySet, 2 * pass + 1, WGPURenderPassTimestampLocation_End };
+	return 2;
+}
+
+uint32_t Profiler::computePassTimestamps(const char* name, WGPUComputePassTimestampWrite* writes) {
+	const uint32_t pass = beginGpuPass(name);
+	if (pass == MAX_GPU_PASSES) return 0;
+	writes[0] = { m_querySet, 2 * pass, WGPUComputePassTimestampLocation_Beginning };
+	writes[1] = { m_querySet, 2 * pass + 1, WGPUComputePassTimestampLocation_End };
+	return 2;
+}
+
+void Profiler::resolveGpu(WGPUCommandEncoder encoder) {
+	if (m_currentSlot < 0) return;
+	ReadbackSlot& slot = m_slots[m_currentSlot];
+	if (slot.names.empty()) return;
+	// Queries are reused every frame; the queue orders this resolve after the passes that wrote them
+	const uint32_t queryCount = 2 * (uint32_t)slot.names.size();
+	wgpuCommandEncoderResolveQuerySet(encoder, m_querySet, 0, queryCount, m_resolveBuffer, 0);
+	wgpuCommandEncoderCopyBufferToBuffer(encoder, m_resolveBuffer, 0, slot.buffer, 0, queryCount * sizeof(uint64_t));
+	slot.state = SlotState::Encoded;
+}
+
+void Profiler::onSubmit() {
+	if (m_currentSlot < 0) return;
+	ReadbackSlot& slot = m_slots[m_currentSlot];
+	m_currentSlot = -1;
+	if (slot.state.load() != SlotState::Encoded) return;
+	slot.state = SlotState::Mapping;
+	wgpuBufferMapAsync(slot.buffer, WGPUMapMode_Read, 0, 2 * slot.names.size() * sizeof(uint64_t), onMapped, &slot);
+}
+
+void Profiler::onMapped(WGPUBufferMapAsyncStatus status, void* userdata) {
+	auto* slot = static_cast<ReadbackSlot*>(userdata);
+	slot->state = (status == WGPUBufferMapAsyncStatus_Success) ? SlotState::Mapped : SlotState::Free;
+}
+
+void Profiler::collectGpu() {
+	for (ReadbackSlot& slot : m_slots) {
+		if (slot.state.load() != SlotState::Mapped) continue;
+		const size_t bytes = 2 * slot.names.size() * sizeof(uint64_t);
+		const auto* ticks = static_cast<const uint64_t*>(wgpuBufferGetConstMappedRange(slot.buffer, 0, bytes));
+		if (ticks) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			// The GPU clock is unrelated to ours: lay the passes out from their frame's CPU start
+			const uint64_t origin = ticks[0];
+			for (size_t i = 0; i < slot.names.size(); ++i) {
+				const uint64_t begin = ticks[2 * i], end = ticks[2 * i + 1];
+				if (end < begin || begin < origin) continue;
+				m_frameTotals[phaseIndex(slot.names[i], true)] += (end - begin) * 1e-6f;
+				pushEvent({ slot.names[i], 0, slot.frameStart + (begin - origin), slot.frameStart + (end - origin) });
+			}
+		}
+		wgpuBufferUnmap(slot.buffer);
+		slot.state = SlotState::Free;
+	}
+}
+
+// ─── Chrome Trace ───────────────────────────────────────────────────────────
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+	nlohmann::json events = nlohmann::json::array();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// Oldest first once the ring has wrapped
+		const size_t count = m_events.size();
+		const size_t first = (count < MAX_EVENTS) ? 0 : m_nextEvent;
+		for (size_t k = 0; k < count; ++k) {
+			const Event& e = m_events[(first + k) % count];
+			events.push_back({
+				{"name", e.name}, {"ph", "X"}, {"pid", e.thread == 0 ? 2 : 1}, {"tid", e.thread},
+				{"ts", e.start * 1e-3}, {"dur", (e.end - e.start) * 1e-3},
+			});
+		}
+	}
+	events.push_back({ {"name", "process_name"}, {"ph", "M"}, {"pid", 1}, {"args", {{"name", "CPU"}}} });
+	events.push_back({ {"name", "process_name"}, {"ph", "M"}, {"pid", 2}, {"args", {{"name", "GPU"}}} });
+
+	std::ofstream file(path);
+	if (!file) {
+		std::cerr << "Profiler: could not write " << path << std::endl;
+		return false;
+	}
+	nlohmann::json trace = { {"traceEvents", events}, {"displayTimeUnit", "ms"} };
+	file << trace.dump();
+	return (bool)file;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Frame profiler. CPU scopes may be timed on any thread; GPU passes are timed with
+// timestamp queries when the device has the feature. Every phase is summed per frame
+// into a rolling history for the overlay, and the most recent events can be written
+// out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+class Profiler {
+public:
+	static constexpr int HISTORY = 120;              // frames kept per phase
+	static constexpr size_t MAX_EVENTS = 1 << 16;    // trace ring size
+	static constexpr uint32_t MAX_GPU_PASSES = 8;    // timed passes per frame
+
+	struct Phase {
+		std::string name;
+		bool gpu = false;
+		std::array<float, HISTORY> ms = {};  // ring, newest at historyCursor() - 1
+		float average = 0.0f;                // over the recorded history
+	};
+
+	// Times the enclosing block under name, which must outlive the profiler (a literal or __func__)
+	class Scope {
+	public:
+		explicit Scope(const char* name);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		const char* m_name;
+		uint64_t m_start;
+	};
+
+	static Profiler& shared();
+
+	void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+	bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// Main thread, once per frame before anything is timed: closes the previous frame
+	void beginFrame();
+	// Thread-safe; times are nowNs() values
+	void record(const char* name, uint64_t startNs, uint64_t endNs);
+	static uint64_t nowNs();
+
+	// GPU timing. initGpu returns false, and the pass helpers write nothing, without the
+	// timestamp-query feature.
+	bool initGpu(WGPUDevice device, WGPUQueue queue);
+	void terminateGpu();
+	bool gpuEnabled() const { return m_querySet != nullptr; }
+	// Fill writes[2] for a pass of this frame and return how many to pass in its descriptor
+	uint32_t renderPassTimestamps(const char* name, WGPURenderPassTimestampWrite* writes);
+	uint32_t computePassTimestamps(const char* name, WGPUComputePassTimestampWrite* writes);
+	// Resolve this frame's queries into encoder, then start reading them back after the submit
+	void resolveGpu(WGPUCommandEncoder encoder);
+	void onSubmit();
+
+	// Copy for the overlay: workers may add phases while it draws
+	std::vector<Phase> phases() const;
+	int historyCursor() const;
+
+	// Retained events as Chrome trace JSON
+	bool writeChromeTrace(const std::string& path) const;
+
+private:
+	Profiler() = default;
+
+	struct Event {
+		const char* name;
+		uint32_t thread;       // 0 is the GPU lane
+		uint64_t start;
+		uint64_t end;
+	};
+
+	enum class SlotState { Free, Encoded, Mapping, Mapped };
+
+	// One frame's worth of GPU queries on their way back to the CPU
+	struct ReadbackSlot {
+		WGPUBuffer buffer = nullptr;
+		std::atomic<SlotState> state{SlotState::Free};
+		std::vector<const char*> names;  // pass i owns queries 2i and 2i + 1
+		uint64_t frameStart = 0;         // GPU events are drawn from here in the trace
+	};
+	static constexpr int READBACK_SLOTS = 3;
+
+	size_t phaseIndex(const char* name, bool gpu);
+	void pushEvent(const Event& event);
+	void collectGpu();
+	static void onMapped(WGPUBufferMapAsyncStatus status, void* userdata);
+	uint32_t beginGpuPass(const char* name);
+
+	std::atomic<bool> m_enabled{true};
+
+	mutable std::mutex m_mutex;    // guards everything below up to the GPU state
+	std::vector<Phase> m_phases;
+	std::unordered_map<std::string, size_t> m_phaseIndex;
+	std::vector<float> m_frameTotals;  // per phase, for the frame being recorded
+	std::vector<Event> m_events;       // ring of MAX_EVENTS
+	size_t m_nextEvent = 0;
+	int m_cursor = 0;
+	int m_framesRecorded = 0;          // filled history entries
+	uint64_t m_frameStart = 0;
+
+	WGPUDevice m_device = nullptr;
+	WGPUQueue m_queue = nullptr;
+	WGPUQuerySet m_querySet = nullptr;
+	WGPUBuffer m_resolveBuffer = nullptr;
+	std::array<ReadbackSlot, READBACK_SLOTS> m_slots;
+	int m_currentSlot = -1;            // slot this frame's passes record into, -1 when all are busy
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
@@ -46,11 +46,15 @@ WGPUShaderModule ResourceManager::loadShaderModule(const path& path, WGPUDevice
 	file.seekg(0);
 	file.read(shaderSource.data(), size);
 
+	return createShaderModule(shaderSource, device);
+}
+
+WGPUShaderModule ResourceManager::createShaderModule(const std::string& source, WGPUDevice device) {
 	WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {};
 
 	shaderCodeDesc.chain.next = nullptr;
 	shaderCodeDesc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
-	shaderCodeDesc.code = shaderSource.c_str();
+	shaderCodeDesc.code = source.c_str();
 	WGPUShaderModuleDescriptor shaderDesc = {};
 	shaderDesc.nextInChain = &shaderCodeDesc.chain;
 #ifdef WEBGPU_BACKEND_WGPU
@@ -30,6 +30,7 @@
 #include "glm/glm.hpp"
 
 #include <vector>
+#include <string>
 #include <filesystem>
 
 class ResourceManager {
@@ -54,6 +55,9 @@ public:
 	// Load a shader from a WGSL file into a new shader module
 	static WGPUShaderModule loadShaderModule(const path& path, WGPUDevice device);
 
+	// Create a shader module from WGSL source held in memory (e.g. generated code)
+	static WGPUShaderModule createShaderModule(const std::string& source, WGPUDevice device);
+
 	// Load an 3D mesh from a standard .obj file into a vertex data buffer
 	static bool loadGeometryFromObj(const path& path, std::vector<VertexAttributes>& vertexData);
 
@@ -0,0 +1,307 @@
+#include "SessionFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x4E535247;  // "GRSN" in file order
+
+// ─── Archives ───────────────────────────────────────────────────────────────
+
+// Writer and Reader take the same calls in the same order, so each field list below is the format
+class Writer {
+public:
+	std::vector<char> bytes;
+
+	template <typename T>
+	void raw(const T* data, size_t count) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain data is written as bytes");
+		const char* p = reinterpret_cast<const char*>(data);
+		bytes.insert(bytes.end(), p, p + count * sizeof(T));
+	}
+
+	template <typename T>
+	void operator()(const T& value) { raw(&value, 1); }
+	void operator()(const bool& value) { uint8_t b = value ? 1 : 0; raw(&b, 1); }
+	void operator()(const std::string& s) {
+		uint32_t n = static_cast<uint32_t>(s.size());
+		raw(&n, 1);
+		raw(s.data(), n);
+	}
+	template <typename T, size_t N>
+	void operator()(const T (&a)[N]) { for (const T& v : a) (*this)(v); }
+	template <typename T>
+	void operator()(const std::vector<T>& v) {
+		uint64_t n = v.size();
+		raw(&n, 1);
+		raw(v.data(), v.size());
+	}
+};
+
+// Fails, and stays failed, on the first read past the end
+class Reader {
+public:
+	Reader(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+	bool ok = true;
+	size_t remaining() const { return m_size - m_pos; }
+
+	template <typename T>
+	void raw(T* data, size_t count) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain data is read as bytes");
+		if (!ok || count > remaining() / sizeof(T)) {
+			ok = false;
+			return;
+		}
+		std::memcpy(data, m_data + m_pos, count * sizeof(T));
+		m_pos += count * sizeof(T);
+	}
+
+	template <typename T>
+	void operator()(T& value) { raw(&value, 1); }
+	void operator()(bool& value) {
+		uint8_t b = 0;
+		raw(&b, 1);
+		value = b != 0;
+	}
+	void operator()(std::string& s) {
+		uint32_t n = 0;
+		raw(&n, 1);
+		if (!ok || n > remaining()) {
+			ok = false;
+			return;
+		}
+		s.assign(m_data + m_pos, n);
+		m_pos += n;
+	}
+	template <typename T, size_t N>
+	void operator()(T (&a)[N]) { for (T& v : a) (*this)(v); }
+	template <typename T>
+	void operator()(std::vector<T>& v) {
+		uint64_t n = 0;
+		raw(&n, 1);
+		// Checked before allocating, so a corrupt count cannot ask for more than the file holds
+		if (!ok || n > remaining() / sizeof(T)) {
+			ok = false;
+			return;
+		}
+		v.resize(static_cast<size_t>(n));
+		raw(v.data(), v.size());
+	}
+
+private:
+	const char* m_data;
+	size_t m_size;
+	size_t m_pos = 0;
+};
+
+// ─── Fields ─────────────────────────────────────────────────────────────────
+
+// Every setting of a FunctionDefinition; parsers, GPU objects and buffers are rebuilt from these
+template <typename Archive, typename Function>
+void settingsFields(Archive& ar, Function& fd) {
+	ar(fd.name);
+	ar(fd.inputDim);
+	ar(fd.outputDim);
+	ar(fd.paramNames);
+	ar(fd.exprStrings);
+	ar(fd.show);
+	ar(fd.color);
+	ar(fd.opacity);
+	ar(fd.rangeMin);
+	ar(fd.rangeMax);
+	ar(fd.resolution);
+	ar(fd.tubeRadius);
+	ar(fd.arrowScale);
+	ar(fd.vfResolution);
+	ar(fd.curvePlane);
+	ar(fd.adaptive);
+	ar(fd.adaptiveTolerance);
+	ar(fd.renderImplicit);
+	ar(fd.isovalue);
+	ar(fd.isoLevelCount);
+	ar(fd.isoLevelSpacing);
+	ar(fd.isoResolution);
+	ar(fd.colormap);
+	ar(fd.colormapAutoRange);
+	ar(fd.colormapRange);
+	ar(fd.wireframe);
+	ar(fd.showTangentVectors);
+	ar(fd.surfaceTangentMode);
+	ar(fd.showNormalVectors);
+	ar(fd.flipNormalVectors);
+	ar(fd.showFrenetFrame);
+	ar(fd.frenetT);
+	ar(fd.showGradientField);
+	ar(fd.showVectorField);
+	ar(fd.showStreamlines);
+	ar(fd.overlayVectorCount);
+	ar(fd.overlayVectorScale);
+	ar(fd.gpuEvaluate);
+	ar(fd.gpuStreamlines);
+	ar(fd.flowStreamlineCount);
+	ar(fd.showParticles);
+	ar(fd.particleCount);
+	ar(fd.particleSpeed);
+}
+
+// The base stage as finishFunctionGeometry leaves it
+template <typename Archive, typename Geometry>
+void baseStageFields(Archive& ar, Geometry& g) {
+	ar(g.surfaceColormapped);
+	ar(g.surfaceTinted);
+	ar(g.surfaceScalarRange);
+	ar(g.surfaceEdgeLength);
+	ar(g.surfaceLodLevels);
+	ar(g.surfaceLodFirst);
+	ar(g.surfaceLodCount);
+	ar(g.surfaceVertices);
+	ar(g.surfaceMesh.indices);
+	ar(g.lineVertices);
+	ar(g.lineMesh.indices);
+	ar(g.cubes);
+	ar(g.heightfield);
+	ar(g.heightfieldSize);
+	ar(g.heightfieldRange);
+	ar(g.surfaceBounds);
+	ar(g.lineBounds);
+	ar(g.cubeBounds);
+}
+
+bool indicesInRange(const std::vector<uint32_t>& indices, size_t vertexCount) {
+	for (uint32_t i : indices) {
+		if (i >= vertexCount) return false;
+	}
+	return true;
+}
+
+// vs_heightfield derives its cells from the texture size, so the vertex ranges must be the ones it decodes
+bool validHeightfield(const FunctionGeometry& g) {
+	const int uCount = g.heightfieldSize[0], vCount = g.heightfieldSize[1];
+	if (uCount < 2 || vCount < 2 || uCount > Heightfield::MAX_SIZE || vCount > Heightfield::MAX_SIZE) return false;
+	if ((uint64_t)uCount * vCount != g.heightfield.size() || !g.surfaceMesh.indices.empty()) return false;
+	if (g.surfaceLodLevels != Heightfield::levelCount(uCount - 1, vCount - 1)) return false;
+	uint32_t first = 0;
+	for (int l = 0; l < g.surfaceLodLevels; ++l) {
+		if (g.surfaceLodFirst[l] != first || g.surfaceLodCount[l] != Heightfield::levelVertexCount(uCount - 1, vCount - 1, l)) return false;
+		first += g.surfaceLodCount[l];
+	}
+	return indicesInRange(g.lineMesh.indices, g.lineVertices.size());
+}
+
+// The uploader trusts indices and LOD ranges, so a base stage is checked before it is kept
+bool validBaseStage(const FunctionGeometry& g) {
+	if (!g.heightfield.empty()) return validHeightfield(g);
+	const size_t indexCount = g.surfaceMesh.indices.size();
+	if (g.surfaceLodLevels < 0 || g.surfaceLodLevels > GraphObjects::LOD_LEVELS) return false;
+	if (indexCount > 0 && g.surfaceLodLevels == 0) return false;
+	for (int l = 0; l < g.surfaceLodLevels; ++l) {
+		if ((uint64_t)g.surfaceLodFirst[l] + g.surfaceLodCount[l] > indexCount) return false;
+	}
+	return indicesInRange(g.surfaceMesh.indices, g.surfaceVertices.size())
+		&& indicesInRange(g.lineMesh.indices, g.lineVertices.size());
+}
+
+} // namespace
+
+// ─── Save ───────────────────────────────────────────────────────────────────
+
+bool SessionFile::save(const std::string& path, const std::deque<FunctionDefinition>& functions,
+	const std::vector<CachedGeometry>* cache, std::string& errorMsg) {
+	Writer w;
+	w(MAGIC);
+	w(VERSION);
+	w(static_cast<uint32_t>(functions.size()));
+	for (size_t i = 0; i < functions.size(); ++i) {
+		settingsFields(w, functions[i]);
+
+		const CachedGeometry* cached = (cache && i < cache->size()) ? &(*cache)[i] : nullptr;
+		const uint32_t stages = cached ? cached->stages : 0;
+		w(stages);
+		if (!stages) continue;
+		for (uint64_t key : cached->keys) w(key);
+		w(cached->filledSurfaceOnGpu);
+		w(cached->streamlinesOnGpu);
+		if (stages & (1u << STAGE_BASE)) baseStageFields(w, cached->geometry);
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (s != STAGE_BASE && (stages & (1u << s))) w(cached->geometry.arrows[s]);
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		errorMsg = "could not open " + path + " for writing";
+		return false;
+	}
+	file.write(w.bytes.data(), static_cast<std::streamsize>(w.bytes.size()));
+	if (!file) {
+		errorMsg = "could not write " + path;
+		return false;
+	}
+	return true;
+}
+
+// ─── Load ───────────────────────────────────────────────────────────────────
+
+bool SessionFile::load(const std::string& path, std::deque<FunctionDefinition>& functions,
+	std::vector<CachedGeometry>& cache, std::string& errorMsg) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		errorMsg = "could not open " + path;
+		return false;
+	}
+	// One read into memory: uploading copies every mesh into staging memory anyway
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Reader r(bytes.data(), bytes.size());
+	uint32_t magic = 0, version = 0, count = 0;
+	r(magic);
+	r(version);
+	r(count);
+	if (!r.ok || magic != MAGIC) {
+		errorMsg = path + " is not a session file";
+		return false;
+	}
+	if (version != VERSION) {
+		errorMsg = path + " has session version " + std::to_string(version) + ", expected " + std::to_string(VERSION);
+		return false;
+	}
+
+	std::deque<FunctionDefinition> loaded;
+	std::vector<CachedGeometry> loadedCache;
+	for (uint32_t i = 0; i < count && r.ok; ++i) {
+		FunctionDefinition& fd = loaded.emplace_back();
+		CachedGeometry& cached = loadedCache.emplace_back();
+		settingsFields(r, fd);
+		if (fd.inputDim < 1 || fd.inputDim > 3 || fd.outputDim < 1 || fd.outputDim > 3) {
+			errorMsg = path + ": function " + std::to_string(i + 1) + " has invalid dimensions";
+			return false;
+		}
+
+		r(cached.stages);
+		if (!cached.stages) continue;
+		for (uint64_t& key : cached.keys) r(key);
+		r(cached.filledSurfaceOnGpu);
+		r(cached.streamlinesOnGpu);
+		if (cached.stages & (1u << STAGE_BASE)) baseStageFields(r, cached.geometry);
+		for (int s = 0; s < STAGE_COUNT; ++s) {
+			if (s != STAGE_BASE && (cached.stages & (1u << s))) r(cached.geometry.arrows[s]);
+		}
+		cached.stages &= ALL_STAGES;
+		// A damaged mesh only costs its rebuild
+		if (r.ok && (cached.stages & (1u << STAGE_BASE)) && !validBaseStage(cached.geometry)) {
+			cached = CachedGeometry();
+		}
+	}
+	if (!r.ok) {
+		errorMsg = path + " is truncated";
+		return false;
+	}
+
+	functions = std::move(loaded);
+	cache = std::move(loadedCache);
+	return true;
+}
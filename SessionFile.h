@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Application.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Versioned binary save of the function list. Each function can carry the geometry it was
+// drawn with, tagged with the StageKeys it was built from: on opening, the stages whose keys
+// still match are uploaded as they are and only the others are regenerated.
+// Little-endian, as on every platform the app builds for; reads are bounds-checked.
+class SessionFile {
+public:
+	static constexpr uint32_t VERSION = 2;  // 2: heightfield surfaces
+
+	// Geometry of one function as it was uploaded, with everything needed to upload it again
+	struct CachedGeometry {
+		uint32_t stages = 0;              // bit per GeometryStage stored; 0 for settings only
+		StageKeys keys = {};              // functionStageKeys of the settings it was built from
+		bool filledSurfaceOnGpu = false;  // the base stage leaves out what the compute shaders drew
+		bool streamlinesOnGpu = false;
+		FunctionGeometry geometry;        // packed vertices or heights only, LOD chain in surfaceMesh.indices
+	};
+
+	// cache is null, or has one entry per function
+	static bool save(const std::string& path, const std::deque<FunctionDefinition>& functions,
+		const std::vector<CachedGeometry>* cache, std::string& errorMsg);
+	// Replaces functions (uncompiled) and cache; both are untouched on failure
+	static bool load(const std::string& path, std::deque<FunctionDefinition>& functions,
+		std::vector<CachedGeometry>& cache, std::string& errorMsg);
+};
@@ -0,0 +1,231 @@
+#include "SimdMath.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_MATH_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SIMD_MATH_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define SIMD_MATH_WASM 1
+#include <wasm_simd128.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#include "SimdMathKernels.h"
+
+namespace {
+
+// ─── Lane Types ─────────────────────────────────────────────────────────────
+
+#if SIMD_MATH_SSE2
+struct Sse2 {
+	using F = __m128;
+	using I = __m128i;
+	using M = __m128;
+	static constexpr int W = 4;
+
+	static F load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+	static F set(float x) { return _mm_set1_ps(x); }
+	static I seti(int x) { return _mm_set1_epi32(x); }
+
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm_div_ps(a, b); }
+	static F fma(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static F sqrt(F a) { return _mm_sqrt_ps(a); }
+	static F min(F a, F b) { return _mm_min_ps(a, b); }
+	static F max(F a, F b) { return _mm_max_ps(a, b); }
+	static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static F neg(F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+	static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+	static M eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+	static M eqi(I a, I b) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+	static M mand(M a, M b) { return _mm_and_ps(a, b); }
+	static M mor(M a, M b) { return _mm_or_ps(a, b); }
+	static M mandnot(M a, M b) { return _mm_andnot_ps(a, b); }
+	static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+	static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+
+	static I roundi(F a) { return _mm_cvtps_epi32(a); }
+	static F tof(I a) { return _mm_cvtepi32_ps(a); }
+	static I asi(F a) { return _mm_castps_si128(a); }
+	static F asf(I a) { return _mm_castsi128_ps(a); }
+	static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+	static I andi(I a, I b) { return _mm_and_si128(a, b); }
+	static I ori(I a, I b) { return _mm_or_si128(a, b); }
+	static I shl23(I a) { return _mm_slli_epi32(a, 23); }
+	static I shr23(I a) { return _mm_srli_epi32(a, 23); }
+};
+#endif
+
+#if SIMD_MATH_NEON
+struct Neon {
+	using F = float32x4_t;
+	using I = int32x4_t;
+	using M = uint32x4_t;
+	static constexpr int W = 4;
+
+	static F load(const float* p) { return vld1q_f32(p); }
+	static void store(float* p, F v) { vst1q_f32(p, v); }
+	static F set(float x) { return vdupq_n_f32(x); }
+	static I seti(int x) { return vdupq_n_s32(x); }
+
+	static F add(F a, F b) { return vaddq_f32(a, b); }
+	static F sub(F a, F b) { return vsubq_f32(a, b); }
+	static F mul(F a, F b) { return vmulq_f32(a, b); }
+	static F div(F a, F b) { return vdivq_f32(a, b); }
+	static F fma(F a, F b, F c) { return vfmaq_f32(c, a, b); }
+	static F sqrt(F a) { return vsqrtq_f32(a); }
+	static F min(F a, F b) { return vminq_f32(a, b); }
+	static F max(F a, F b) { return vmaxq_f32(a, b); }
+	static F abs(F a) { return vabsq_f32(a); }
+	static F neg(F a) { return vnegq_f32(a); }
+
+	static M lt(F a, F b) { return vcltq_f32(a, b); }
+	static M le(F a, F b) { return vcleq_f32(a, b); }
+	static M eq(F a, F b) { return vceqq_f32(a, b); }
+	static M eqi(I a, I b) { return vceqq_s32(a, b); }
+	static M mand(M a, M b) { return vandq_u32(a, b); }
+	static M mor(M a, M b) { return vorrq_u32(a, b); }
+	static M mandnot(M a, M b) { return vbicq_u32(b, a); }
+	static bool any(M m) { return vmaxvq_u32(m) != 0; }
+	static F select(M m, F a, F b) { return vbslq_f32(m, a, b); }
+
+	static I roundi(F a) { return vcvtnq_s32_f32(a); }
+	static F tof(I a) { return vcvtq_f32_s32(a); }
+	static I asi(F a) { return vreinterpretq_s32_f32(a); }
+	static F asf(I a) { return vreinterpretq_f32_s32(a); }
+	static I addi(I a, I b) { return vaddq_s32(a, b); }
+	static I andi(I a, I b) { return vandq_s32(a, b); }
+	static I ori(I a, I b) { return vorrq_s32(a, b); }
+	static I shl23(I a) { return vshlq_n_s32(a, 23); }
+	static I shr23(I a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), 23)); }
+};
+#endif
+
+#if SIMD_MATH_WASM
+// All SIMD128 types are v128_t, so the float, int and mask views share one type
+struct Wasm {
+	using F = v128_t;
+	using I = v128_t;
+	using M = v128_t;
+	static constexpr int W = 4;
+
+	static F load(const float* p) { return wasm_v128_load(p); }
+	static void store(float* p, F v) { wasm_v128_store(p, v); }
+	static F set(float x) { return wasm_f32x4_splat(x); }
+	static I seti(int x) { return wasm_i32x4_splat(x); }
+
+	static F add(F a, F b) { return wasm_f32x4_add(a, b); }
+	static F sub(F a, F b) { return wasm_f32x4_sub(a, b); }
+	static F mul(F a, F b) { return wasm_f32x4_mul(a, b); }
+	static F div(F a, F b) { return wasm_f32x4_div(a, b); }
+	static F fma(F a, F b, F c) { return wasm_f32x4_add(wasm_f32x4_mul(a, b), c); }
+	static F sqrt(F a) { return wasm_f32x4_sqrt(a); }
+	static F min(F a, F b) { return wasm_f32x4_pmin(a, b); }
+	static F max(F a, F b) { return wasm_f32x4_pmax(a, b); }
+	static F abs(F a) { return wasm_f32x4_abs(a); }
+	static F neg(F a) { return wasm_f32x4_neg(a); }
+
+	static M lt(F a, F b) { return wasm_f32x4_lt(a, b); }
+	static M le(F a, F b) { return wasm_f32x4_le(a, b); }
+	static M eq(F a, F b) { return wasm_f32x4_eq(a, b); }
+	static M eqi(I a, I b) { return wasm_i32x4_eq(a, b); }
+	static M mand(M a, M b) { return wasm_v128_and(a, b); }
+	static M mor(M a, M b) { return wasm_v128_or(a, b); }
+	static M mandnot(M a, M b) { return wasm_v128_andnot(b, a); }
+	static bool any(M m) { return wasm_v128_any_true(m); }
+	static F select(M m, F a, F b) { return wasm_v128_bitselect(a, b, m); }
+
+	static I roundi(F a) { return wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(a)); }
+	static F tof(I a) { return wasm_f32x4_convert_i32x4(a); }
+	static I asi(F a) { return a; }
+	static F asf(I a) { return a; }
+	static I addi(I a, I b) { return wasm_i32x4_add(a, b); }
+	static I andi(I a, I b) { return wasm_v128_and(a, b); }
+	static I ori(I a, I b) { return wasm_v128_or(a, b); }
+	static I shl23(I a) { return wasm_i32x4_shl(a, 23); }
+	static I shr23(I a) { return wasm_u32x4_shr(a, 23); }
+};
+#endif
+
+// ─── Scalar Kernels ─────────────────────────────────────────────────────────
+
+void scalarAdd(const float* a, const float* b, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = a[i] + b[i]; }
+void scalarSub(const float* a, const float* b, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = a[i] - b[i]; }
+void scalarMul(const float* a, const float* b, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = a[i] * b[i]; }
+void scalarDiv(const float* a, const float* b, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = a[i] / b[i]; }
+void scalarPow(const float* a, const float* b, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::pow(a[i], b[i]); }
+void scalarNeg(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = -a[i]; }
+void scalarAbs(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::fabs(a[i]); }
+void scalarSqrt(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::sqrt(a[i]); }
+void scalarExp(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::exp(a[i]); }
+void scalarLog(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::log(a[i]); }
+void scalarSin(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::sin(a[i]); }
+void scalarCos(const float* a, float* d, size_t n) { for (size_t i = 0; i < n; ++i) d[i] = std::cos(a[i]); }
+
+} // namespace
+
+// ─── Dispatch ───────────────────────────────────────────────────────────────
+
+const SimdMath::Kernels& SimdMath::scalarKernels() {
+	static const Kernels k = {
+		"scalar", 1,
+		scalarAdd, scalarSub, scalarMul, scalarDiv, scalarPow,
+		scalarNeg, scalarAbs, scalarSqrt, scalarExp, scalarLog, scalarSin, scalarCos,
+	};
+	return k;
+}
+
+const SimdMath::Kernels* SimdMath::nativeKernels() {
+#if SIMD_MATH_SSE2
+	static const Kernels k = makeKernels<Sse2>("sse2");
+	return &k;
+#elif SIMD_MATH_NEON
+	static const Kernels k = makeKernels<Neon>("neon");
+	return &k;
+#elif SIMD_MATH_WASM
+	static const Kernels k = makeKernels<Wasm>("wasm-simd128");
+	return &k;
+#else
+	return nullptr;
+#endif
+}
+
+bool SimdMath::cpuHasAvx2() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 1);
+	const bool fma = (info[2] & (1 << 12)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) return false; // OS must save YMM state
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+const SimdMath::Kernels& SimdMath::kernels() {
+	static const Kernels* selected = [] {
+		if (const Kernels* k = avx2Kernels()) {
+			if (cpuHasAvx2()) return k;
+		}
+		if (const Kernels* k = nativeKernels()) return k;
+		return &scalarKernels();
+	}();
+	return *selected;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+// Float32 SIMD kernels for the expression evaluator.
+// Every kernel maps whole arrays (d[i] = op(a[i], b[i])); d may alias a or b.
+// The instruction set is picked once: at runtime on desktop x86 (AVX2 or SSE2),
+// at compile time elsewhere (NEON on arm64, SIMD128 on wasm, scalar otherwise).
+// sin/cos/exp/log/pow are polynomial approximations accurate to a few ulp over
+// the ranges a plot uses; sin/cos fall back to libm for |x| > 8192.
+class SimdMath {
+public:
+	using Unary = void (*)(const float* a, float* d, size_t n);
+	using Binary = void (*)(const float* a, const float* b, float* d, size_t n);
+
+	struct Kernels {
+		const char* name;
+		int lanes;
+		Binary add, sub, mul, div, pow;
+		Unary neg, abs, sqrt, exp, log, sin, cos;
+	};
+
+	// Best kernel set for this CPU, selected on first call
+	static const Kernels& kernels();
+
+	// Plain libm loops, used where no SIMD backend exists
+	static const Kernels& scalarKernels();
+
+private:
+	static const Kernels* nativeKernels(); // compile-time backend (SSE2 / NEON / SIMD128), or null
+	static const Kernels* avx2Kernels();   // null unless built for x86
+	static bool cpuHasAvx2();
+};
@@ -0,0 +1,65 @@
+// AVX2 + FMA backend. CMake builds this unit with -mavx2 -mfma (/arch:AVX2 on MSVC);
+// SimdMath::kernels() only selects it after checking the CPU at runtime.
+#include "SimdMath.h"
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define SIMD_MATH_AVX2 1
+#include <immintrin.h>
+#include "SimdMathKernels.h"
+
+namespace {
+
+struct Avx2 {
+	using F = __m256;
+	using I = __m256i;
+	using M = __m256;
+	static constexpr int W = 8;
+
+	static F load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+	static F set(float x) { return _mm256_set1_ps(x); }
+	static I seti(int x) { return _mm256_set1_epi32(x); }
+
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static F fma(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+	static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	static F min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F max(F a, F b) { return _mm256_max_ps(a, b); }
+	static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static F neg(F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+
+	static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static M eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static M eqi(I a, I b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+	static M mand(M a, M b) { return _mm256_and_ps(a, b); }
+	static M mor(M a, M b) { return _mm256_or_ps(a, b); }
+	static M mandnot(M a, M b) { return _mm256_andnot_ps(a, b); }
+	static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+	static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+
+	static I roundi(F a) { return _mm256_cvtps_epi32(a); }
+	static F tof(I a) { return _mm256_cvtepi32_ps(a); }
+	static I asi(F a) { return _mm256_castps_si256(a); }
+	static F asf(I a) { return _mm256_castsi256_ps(a); }
+	static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I andi(I a, I b) { return _mm256_and_si256(a, b); }
+	static I ori(I a, I b) { return _mm256_or_si256(a, b); }
+	static I shl23(I a) { return _mm256_slli_epi32(a, 23); }
+	static I shr23(I a) { return _mm256_srli_epi32(a, 23); }
+};
+
+} // namespace
+#endif
+
+const SimdMath::Kernels* SimdMath::avx2Kernels() {
+#if SIMD_MATH_AVX2
+	static const Kernels k = makeKernels<Avx2>("avx2");
+	return &k;
+#else
+	return nullptr;
+#endif
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+// Lane-generic kernel bodies shared by the SimdMath backends.
+// Included only by the backend translation units; each provides a lane type V with:
+//   F / I / M           float vector, int32 vector, lane mask
+//   W                   lane count
+//   load/store/set/seti, add/sub/mul/div/fma/sqrt/min/max/abs/neg
+//   lt/le/eq/eqi        comparisons -> M;  mand/mor/mandnot, any(M), select(M, a, b)
+//   roundi/tof/asi/asf  round-to-int, int->float and bit casts
+//   addi/andi/ori, shl23/shr23
+//
+// Everything here has internal linkage and no std templates are instantiated:
+// the AVX2 unit is built with -mavx2, and a shared inline function picked from
+// it by the linker would fault on older CPUs.
+
+#include "SimdMath.h"
+
+#include <math.h>
+
+namespace {
+
+// ─── Block Iteration ────────────────────────────────────────────────────────
+
+// Run `block` on every full group of W lanes, then once on a zero-padded tail.
+template <class V, class Block>
+inline void forEachBlock(const float* a, float* d, size_t n, Block block) {
+	size_t i = 0;
+	for (; i + V::W <= n; i += V::W) block(a + i, d + i);
+	if (i < n) {
+		float ta[V::W] = {}, td[V::W];
+		for (size_t k = i; k < n; ++k) ta[k - i] = a[k];
+		block(ta, td);
+		for (size_t k = i; k < n; ++k) d[k] = td[k - i];
+	}
+}
+
+template <class V, class Block>
+inline void forEachBlock(const float* a, const float* b, float* d, size_t n, Block block) {
+	size_t i = 0;
+	for (; i + V::W <= n; i += V::W) block(a + i, b + i, d + i);
+	if (i < n) {
+		float ta[V::W] = {}, tb[V::W] = {}, td[V::W];
+		for (size_t k = i; k < n; ++k) { ta[k - i] = a[k]; tb[k - i] = b[k]; }
+		block(ta, tb, td);
+		for (size_t k = i; k < n; ++k) d[k] = td[k - i];
+	}
+}
+
+// ─── Approximations ─────────────────────────────────────────────────────────
+// Cephes-style float polynomials after range reduction.
+
+template <class V> inline typename V::F infinity() { return V::asf(V::seti(0x7f800000)); }
+template <class V> inline typename V::F quietNaN() { return V::asf(V::seti(0x7fc00000)); }
+
+template <class V>
+inline typename V::F expApprox(typename V::F x) {
+	using F = typename V::F;
+	// Values past the float range are patched below
+	F xc = V::min(V::max(x, V::set(-87.3365448f)), V::set(88.7228391f));
+
+	F n = V::tof(V::roundi(V::mul(xc, V::set(1.44269504088896341f))));
+	F r = V::sub(xc, V::mul(n, V::set(0.693359375f)));
+	r = V::sub(r, V::mul(n, V::set(-2.12194440e-4f)));
+
+	F p = V::set(1.9875691500e-4f);
+	p = V::fma(p, r, V::set(1.3981999507e-3f));
+	p = V::fma(p, r, V::set(8.3334519073e-3f));
+	p = V::fma(p, r, V::set(4.1665795894e-2f));
+	p = V::fma(p, r, V::set(1.6666665459e-1f));
+	p = V::fma(p, r, V::set(5.0000001201e-1f));
+	p = V::fma(p, V::mul(r, r), V::add(r, V::set(1.0f)));
+
+	// n reaches 128 just below overflow; apply that last factor of two separately
+	auto top = V::lt(V::set(127.0f), n);
+	n = V::select(top, V::sub(n, V::set(1.0f)), n);
+	F scale = V::asf(V::shl23(V::addi(V::roundi(n), V::seti(127))));
+	F y = V::mul(V::mul(p, scale), V::select(top, V::set(2.0f), V::set(1.0f)));
+
+	y = V::select(V::lt(V::set(88.7228391f), x), infinity<V>(), y);
+	y = V::select(V::lt(x, V::set(-87.3365448f)), V::set(0.0f), y);
+	return V::select(V::eq(x, x), y, x); // propagate NaN
+}
+
+template <class V>
+inline typename V::F logApprox(typename V::F x) {
+	using F = typename V::F;
+	using I = typename V::I;
+	// Denormals are treated as the smallest normal
+	F xc = V::max(x, V::asf(V::seti(0x00800000)));
+
+	I bits = V::asi(xc);
+	F e = V::tof(V::addi(V::shr23(bits), V::seti(-126)));
+	F m = V::asf(V::ori(V::andi(bits, V::seti(0x007fffff)), V::seti(0x3f000000))); // [0.5, 1)
+
+	auto small = V::lt(m, V::set(0.707106781186547524f));
+	e = V::select(small, V::sub(e, V::set(1.0f)), e);
+	m = V::sub(V::select(small, V::add(m, m), m), V::set(1.0f));
+
+	F z = V::mul(m, m);
+	F y = V::set(7.0376836292e-2f);
+	y = V::fma(y, m, V::set(-1.1514610310e-1f));
+	y = V::fma(y, m, V::set(1.1676998740e-1f));
+	y = V::fma(y, m, V::set(-1.2420140846e-1f));
+	y = V::fma(y, m, V::set(1.4249322787e-1f));
+	y = V::fma(y, m, V::set(-1.6668057665e-1f));
+	y = V::fma(y, m, V::set(2.0000714765e-1f));
+	y = V::fma(y, m, V::set(-2.4999993993e-1f));
+	y = V::fma(y, m, V::set(3.3333331174e-1f));
+	y = V::mul(V::mul(y, m), z);
+	y = V::fma(e, V::set(-2.12194440e-4f), y);
+	y = V::fma(z, V::set(-0.5f), y);
+	y = V::add(m, y);
+	y = V::fma(e, V::set(0.693359375f), y);
+
+	y = V::select(V::eq(x, infinity<V>()), infinity<V>(), y);
+	y = V::select(V::eq(x, V::set(0.0f)), V::neg(infinity<V>()), y);
+	y = V::select(V::lt(x, V::set(0.0f)), quietNaN<V>(), y);
+	return V::select(V::eq(x, x), y, x);
+}
+
+// sin(x + quadrantOffset * pi/2); offset 1 gives cos
+template <class V, int quadrantOffset>
+inline typename V::F sinApprox(typename V::F x) {
+	using F = typename V::F;
+	using I = typename V::I;
+	I q = V::roundi(V::mul(x, V::set(0.636619772367581343f)));
+	F qf = V::tof(q);
+	// Three-part Cody-Waite reduction into [-pi/4, pi/4]
+	F r = V::sub(x, V::mul(qf, V::set(1.5703125f)));
+	r = V::sub(r, V::mul(qf, V::set(4.837512969970703125e-4f)));
+	r = V::sub(r, V::mul(qf, V::set(7.54978995489188216e-8f)));
+	q = V::addi(q, V::seti(quadrantOffset));
+
+	F r2 = V::mul(r, r);
+	F s = V::set(-1.9515295891e-4f);
+	s = V::fma(s, r2, V::set(8.3321608736e-3f));
+	s = V::fma(s, r2, V::set(-1.6666654611e-1f));
+	s = V::fma(V::mul(s, r2), r, r);
+
+	F c = V::set(2.443315711809948e-5f);
+	c = V::fma(c, r2, V::set(-1.388731625493765e-3f));
+	c = V::fma(c, r2, V::set(4.166664568298827e-2f));
+	c = V::fma(V::mul(c, r2), r2, V::fma(r2, V::set(-0.5f), V::set(1.0f)));
+
+	F y = V::select(V::eqi(V::andi(q, V::seti(1)), V::seti(1)), c, s);
+	return V::select(V::eqi(V::andi(q, V::seti(2)), V::seti(2)), V::neg(y), y);
+}
+
+template <class V>
+inline typename V::F powApprox(typename V::F a, typename V::F b) {
+	using F = typename V::F;
+	using I = typename V::I;
+	F r = expApprox<V>(V::mul(b, logApprox<V>(V::abs(a))));
+
+	// Negative bases: defined for integral exponents, odd ones flip the sign
+	auto exact = V::lt(V::abs(b), V::set(16777216.0f)); // below 2^24 every integer is representable
+	I ib = V::roundi(V::select(exact, b, V::set(0.0f)));
+	auto integral = V::mor(V::eq(V::tof(ib), b), V::mandnot(exact, V::eq(b, b)));
+	auto odd = V::mand(exact, V::eqi(V::andi(ib, V::seti(1)), V::seti(1)));
+
+	F neg = V::select(odd, V::neg(r), r);
+	neg = V::select(integral, neg, quietNaN<V>());
+	r = V::select(V::lt(a, V::set(0.0f)), neg, r);
+
+	// pow(x, 0) == pow(1, y) == 1, as in libm
+	auto one = V::mor(V::eq(b, V::set(0.0f)), V::eq(a, V::set(1.0f)));
+	return V::select(one, V::set(1.0f), r);
+}
+
+// ─── Array Kernels ──────────────────────────────────────────────────────────
+
+constexpr float SIN_FALLBACK_RANGE = 8192.0f;
+
+template <class V, int quadrantOffset>
+void sinArray(const float* a, float* d, size_t n) {
+	forEachBlock<V>(a, d, n, [](const float* pa, float* pd) {
+		typename V::F x = V::load(pa);
+		typename V::F y = sinApprox<V, quadrantOffset>(x);
+		// Reduction loses precision for large arguments; hand those lanes to libm
+		if (V::any(V::lt(V::set(SIN_FALLBACK_RANGE), V::abs(x)))) {
+			float tx[V::W], ty[V::W];
+			V::store(tx, x);
+			V::store(ty, y);
+			for (int l = 0; l < V::W; ++l) {
+				if (tx[l] > SIN_FALLBACK_RANGE || tx[l] < -SIN_FALLBACK_RANGE) ty[l] = quadrantOffset ? cosf(tx[l]) : sinf(tx[l]);
+			}
+			y = V::load(ty);
+		}
+		V::store(pd, y);
+	});
+}
+
+#define SIMD_UNARY(name, expr) \
+	template <class V> void name(const float* a, float* d, size_t n) { \
+		forEachBlock<V>(a, d, n, [](const float* pa, float* pd) { typename V::F x = V::load(pa); V::store(pd, expr); }); \
+	}
+#define SIMD_BINARY(name, expr) \
+	template <class V> void name(const float* a, const float* b, float* d, size_t n) { \
+		forEachBlock<V>(a, b, d, n, [](const float* pa, const float* pb, float* pd) { \
+			typename V::F x = V::load(pa), y = V::load(pb); V::store(pd, expr); }); \
+	}
+
+SIMD_BINARY(addArray, V::add(x, y))
+SIMD_BINARY(subArray, V::sub(x, y))
+SIMD_BINARY(mulArray, V::mul(x, y))
+SIMD_BINARY(divArray, V::div(x, y))
+SIMD_BINARY(powArray, powApprox<V>(x, y))
+SIMD_UNARY(negArray, V::neg(x))
+SIMD_UNARY(absArray, V::abs(x))
+SIMD_UNARY(sqrtArray, V::sqrt(x))
+SIMD_UNARY(expArray, expApprox<V>(x))
+SIMD_UNARY(logArray, logApprox<V>(x))
+
+#undef SIMD_UNARY
+#undef SIMD_BINARY
+
+template <class V>
+SimdMath::Kernels makeKernels(const char* name) {
+	SimdMath::Kernels k;
+	k.name = name;
+	k.lanes = V::W;
+	k.add = addArray<V>;
+	k.sub = subArray<V>;
+	k.mul = mulArray<V>;
+	k.div = divArray<V>;
+	k.pow = powArray<V>;
+	k.neg = negArray<V>;
+	k.abs = absArray<V>;
+	k.sqrt = sqrtArray<V>;
+	k.exp = expArray<V>;
+	k.log = logArray<V>;
+	k.sin = sinArray<V, 0>;
+	k.cos = sinArray<V, 1>;
+	return k;
+}
+
+} // namespace
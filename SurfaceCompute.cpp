@@ -0,0 +1,477 @@
+#include "SurfaceCompute.h"
+#include "ExpressionParser.h"
+#include "GraphObjects.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+static constexpr uint32_t WORKGROUP_SIZE = 8;
+
+// Shader body shared by every generated surface; surfaceJet() is prepended per function
+static const char* SURFACE_COMPUTE_WGSL = R"(
+// A surface point and its tangents
+struct SurfaceJet {
+	p: vec3f,
+	dpdu: vec3f,
+	dpdv: vec3f,
+};
+
+struct Params {
+	uMin: f32,
+	uMax: f32,
+	vMin: f32,
+	vMax: f32,
+	uSegments: u32,
+	vSegments: u32,
+	eps: f32,
+	_pad: f32,
+};
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read_write> heightRange: array<atomic<u32>, 2>;
+@group(0) @binding(2) var<storage, read_write> vertices: array<u32>;          // PackedVertex, 5 words per grid point
+@group(0) @binding(3) var<storage, read_write> indices: array<u32>;           // TriangleList, 6 per grid cell
+
+// Map floats to uints whose ordering matches, so atomicMin/Max give the height range
+fn orderedBits(x: f32) -> u32 {
+	let b = bitcast<u32>(x);
+	return select(b | 0x80000000u, ~b, (b & 0x80000000u) != 0u);
+}
+
+// Same encoding as GraphObjects::packNormal
+fn octEncode(n: vec3f) -> u32 {
+	var p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+	if (n.z < 0.0) {
+		p = (1.0 - abs(p.yx)) * select(vec2f(-1.0), vec2f(1.0), p >= vec2f(0.0));
+	}
+	return pack2x16snorm(p);
+}
+
+@compute @workgroup_size(8, 8)
+fn evalGrid(@builtin(global_invocation_id) id: vec3u) {
+	if (id.x > params.uSegments || id.y > params.vSegments) { return; }
+	let du = (params.uMax - params.uMin) / f32(params.uSegments);
+	let dv = (params.vMax - params.vMin) / f32(params.vSegments);
+	let u = params.uMin + f32(id.x) * du;
+	let v = params.vMin + f32(id.y) * dv;
+
+	let jet = surfaceJet(u, v);
+	let p = jet.p;
+	var n = cross(jet.dpdu, jet.dpdv);
+	let len = length(n);
+	if (len > 1e-8) { n = n / len; } else { n = vec3f(0.0, 0.0, 1.0); }
+
+	let o = (id.x * (params.vSegments + 1u) + id.y) * 5u;
+	vertices[o + 0u] = bitcast<u32>(p.x);
+	vertices[o + 1u] = bitcast<u32>(p.y);
+	vertices[o + 2u] = bitcast<u32>(p.z);
+	vertices[o + 3u] = octEncode(n);
+	// The colour word carries the height, as GraphObjects::packVertices does for colormapped meshes
+	vertices[o + 4u] = bitcast<u32>(p.z);
+
+	if (abs(p.z) <= 3.4e38) {
+		atomicMin(&heightRange[0], orderedBits(p.z));
+		atomicMax(&heightRange[1], orderedBits(p.z));
+	}
+}
+
+// Emit the two triangles of the cell a grid point anchors
+@compute @workgroup_size(8, 8)
+fn buildMesh(@builtin(global_invocation_id) id: vec3u) {
+	if (id.x >= params.uSegments || id.y >= params.vSegments) { return; }
+	let stride = params.vSegments + 1u;
+	let k00 = id.x * stride + id.y;
+	let k10 = k00 + stride;
+	let k01 = k00 + 1u;
+	let k11 = k10 + 1u;
+	let first = (id.x * params.vSegments + id.y) * 6u;
+	indices[first + 0u] = k00;
+	indices[first + 1u] = k10;
+	indices[first + 2u] = k11;
+	indices[first + 3u] = k00;
+	indices[first + 4u] = k11;
+	indices[first + 5u] = k01;
+}
+)";
+
+static_assert(sizeof(PackedVertex) == 5 * sizeof(uint32_t), "the shader writes 5 words per vertex");
+
+// Inverse of orderedBits in the shader
+static float fromOrderedBits(uint32_t k) {
+	const uint32_t bits = (k & 0x80000000u) ? k & 0x7fffffffu : ~k;
+	float x;
+	std::memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+SurfaceCompute::~SurfaceCompute() {
+	terminate();
+}
+
+bool SurfaceCompute::updateShader(WGPUDevice device, const ExpressionParser* parsers, int outputDim, std::string& errorMsg) {
+	std::string source = ExpressionParser::wgslPrelude();
+	for (int i = 0; i < outputDim; ++i) {
+		std::string fn;
+		if (!parsers[i].generateWgsl("f" + std::to_string(i), fn)) {
+			errorMsg = "Expression " + std::to_string(i + 1) + " uses a function not available on the GPU";
+			return false;
+		}
+		source += fn;
+	}
+
+	// Exact tangents when every component of f(u, v) differentiates symbolically, as on the CPU:
+	// fN_jet returns (fN, dfN/du, dfN/dv)
+	bool symbolic = parsers[0].varCount() == 2;
+	std::string jets;
+	for (int i = 0; i < outputDim && symbolic; ++i) {
+		std::string fn;
+		symbolic = parsers[i].generateWgslDerivatives("f" + std::to_string(i) + "_jet", fn);
+		jets += fn;
+	}
+
+	// Every parser of a function shares the same variable list; extra variables read 0
+	std::string args;
+	for (size_t v = 0; v < parsers[0].varCount(); ++v) {
+		if (v) args += ", ";
+		args += v == 0 ? "u" : v == 1 ? "v" : "0.0";
+	}
+	auto call = [&args](int i) { return "f" + std::to_string(i) + "(" + args + ")"; };
+
+	source += "\nfn surfacePoint(u: f32, v: f32) -> vec3f {\n\treturn vec3f(";
+	if (outputDim == 1) source += "u, v, " + call(0);
+	else if (outputDim == 2) source += call(0) + ", " + call(1) + ", 0.0";
+	else source += call(0) + ", " + call(1) + ", " + call(2);
+	source += ");\n}\n";
+
+	if (symbolic) {
+		source += jets;
+		// Value, d/du and d/dv of each coordinate of surfacePoint
+		std::string value[3], du[3], dv[3];
+		for (int c = 0; c < 3; ++c) {
+			const int i = outputDim == 1 ? c - 2 : c;
+			if (i >= 0 && i < outputDim) {
+				const std::string j = "j" + std::to_string(i);
+				value[c] = j + ".x";
+				du[c] = j + ".y";
+				dv[c] = j + ".z";
+			} else {
+				value[c] = outputDim == 1 ? (c == 0 ? "u" : "v") : "0.0";
+				du[c] = outputDim == 1 && c == 0 ? "1.0" : "0.0";
+				dv[c] = outputDim == 1 && c == 1 ? "1.0" : "0.0";
+			}
+		}
+		auto vec = [](const std::string* x) { return "vec3f(" + x[0] + ", " + x[1] + ", " + x[2] + ")"; };
+		source += "\nfn surfaceJet(u: f32, v: f32) -> SurfaceJet {\n";
+		for (int i = 0; i < outputDim; ++i) {
+			source += "\tlet j" + std::to_string(i) + " = f" + std::to_string(i) + "_jet(u, v);\n";
+		}
+		source += "\treturn SurfaceJet(" + vec(value) + ", " + vec(du) + ", " + vec(dv) + ");\n}\n";
+	} else {
+		// Central differences in f32: the step grows with the parameter, or u + h rounds back to u
+		// far from the origin, and the quotient divides by the spacing actually represented
+		source += R"(
+fn surfaceJet(u: f32, v: f32) -> SurfaceJet {
+	let hu = params.eps * max(1.0, abs(u));
+	let hv = params.eps * max(1.0, abs(v));
+	let dpdu = (surfacePoint(u + hu, v) - surfacePoint(u - hu, v)) / ((u + hu) - (u - hu));
+	let dpdv = (surfacePoint(u, v + hv) - surfacePoint(u, v - hv)) / ((v + hv) - (v - hv));
+	return SurfaceJet(surfacePoint(u, v), dpdu, dpdv);
+}
+)";
+	}
+	source += SURFACE_COMPUTE_WGSL;
+
+	size_t hash = std::hash<std::string>{}(source);
+	if (m_gridPipeline && hash == m_sourceHash) return true;
+
+	terminatePipelines();
+	if (!initPipelines(device, source)) {
+		errorMsg = "Could not create the surface compute pipelines";
+		return false;
+	}
+	m_sourceHash = hash;
+	return true;
+}
+
+bool SurfaceCompute::initPipelines(WGPUDevice device, const std::string& source) {
+	m_shaderModule = ResourceManager::createShaderModule(source, device);
+	if (!m_shaderModule) return false;
+
+	std::vector<WGPUBindGroupLayoutEntry> entries(4, WGPUBindGroupLayoutEntry{});
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		entries[i].binding = i;
+		entries[i].visibility = WGPUShaderStage_Compute;
+		entries[i].buffer.type = WGPUBufferBindingType_Storage;
+	}
+	entries[0].buffer.type = WGPUBufferBindingType_Uniform;
+	entries[0].buffer.minBindingSize = sizeof(Params);
+
+	WGPUBindGroupLayoutDescriptor bindGroupLayoutDesc{};
+	bindGroupLayoutDesc.entryCount = (uint32_t)entries.size();
+	bindGroupLayoutDesc.entries = entries.data();
+	m_bindGroupLayout = wgpuDeviceCreateBindGroupLayout(device, &bindGroupLayoutDesc);
+
+	WGPUPipelineLayoutDescriptor layoutDesc{};
+	layoutDesc.bindGroupLayoutCount = 1;
+	layoutDesc.bindGroupLayouts = &m_bindGroupLayout;
+	m_pipelineLayout = wgpuDeviceCreatePipelineLayout(device, &layoutDesc);
+
+	WGPUComputePipelineDescriptor pipelineDesc{};
+	pipelineDesc.layout = m_pipelineLayout;
+	pipelineDesc.compute.module = m_shaderModule;
+
+	pipelineDesc.label = "Surface grid";
+	pipelineDesc.compute.entryPoint = "evalGrid";
+	m_gridPipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+
+	pipelineDesc.label = "Surface mesh";
+	pipelineDesc.compute.entryPoint = "buildMesh";
+	m_meshPipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+
+	return m_gridPipeline != nullptr && m_meshPipeline != nullptr;
+}
+
+void SurfaceCompute::terminatePipelines() {
+	if (m_bindGroup) wgpuBindGroupRelease(m_bindGroup);
+	if (m_meshPipeline) wgpuComputePipelineRelease(m_meshPipeline);
+	if (m_gridPipeline) wgpuComputePipelineRelease(m_gridPipeline);
+	if (m_pipelineLayout) wgpuPipelineLayoutRelease(m_pipelineLayout);
+	if (m_bindGroupLayout) wgpuBindGroupLayoutRelease(m_bindGroupLayout);
+	if (m_shaderModule) wgpuShaderModuleRelease(m_shaderModule);
+	m_bindGroup = nullptr;
+	m_meshPipeline = nullptr;
+	m_gridPipeline = nullptr;
+	m_pipelineLayout = nullptr;
+	m_bindGroupLayout = nullptr;
+	m_shaderModule = nullptr;
+	m_sourceHash = 0;
+}
+
+bool SurfaceCompute::initBuffers(WGPUDevice device, size_t vertexBytes, size_t indexBytes) {
+	WGPUBufferDescriptor bufferDesc{};
+	bufferDesc.mappedAtCreation = false;
+
+	if (!m_paramsBuffer) {
+		bufferDesc.size = sizeof(Params);
+		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
+		m_paramsBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+		bufferDesc.size = 2 * sizeof(uint32_t);
+		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc;
+		m_rangeBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+	}
+	if (!m_rangeReadback) {
+		m_rangeReadback = new RangeReadback();
+		bufferDesc.size = 2 * sizeof(uint32_t);
+		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead;
+		m_rangeReadback->buffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+	}
+
+	// Grow only, so dragging the resolution down and back up doesn't reallocate
+	if (vertexBytes > m_vertexBytes) {
+		if (m_vertexBuffer) wgpuBufferRelease(m_vertexBuffer);
+		bufferDesc.size = vertexBytes;
+		bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Vertex;
+		m_vertexBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+		m_vertexBytes = vertexBytes;
+		if (m_bindGroup) wgpuBindGroupRelease(m_bindGroup);
+		m_bindGroup = nullptr;
+	}
+	if (indexBytes > m_indexBytes) {
+		if (m_indexBuffer) wgpuBufferRelease(m_indexBuffer);
+		bufferDesc.size = indexBytes;
+		bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Index;
+		m_indexBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+		m_indexBytes = indexBytes;
+		if (m_bindGroup) wgpuBindGroupRelease(m_bindGroup);
+		m_bindGroup = nullptr;
+	}
+	if (!m_paramsBuffer || !m_rangeBuffer || !m_rangeReadback->buffer || !m_vertexBuffer || !m_indexBuffer) return false;
+
+	if (!m_bindGroup) {
+		std::vector<WGPUBindGroupEntry> bindings(4, WGPUBindGroupEntry{});
+		bindings[0].binding = 0;
+		bindings[0].buffer = m_paramsBuffer;
+		bindings[0].size = sizeof(Params);
+		bindings[1].binding = 1;
+		bindings[1].buffer = m_rangeBuffer;
+		bindings[1].size = 2 * sizeof(uint32_t);
+		bindings[2].binding = 2;
+		bindings[2].buffer = m_vertexBuffer;
+		bindings[2].size = m_vertexBytes;
+		bindings[3].binding = 3;
+		bindings[3].buffer = m_indexBuffer;
+		bindings[3].size = m_indexBytes;
+
+		WGPUBindGroupDescriptor bindGroupDesc{};
+		bindGroupDesc.layout = m_bindGroupLayout;
+		bindGroupDesc.entryCount = (uint32_t)bindings.size();
+		bindGroupDesc.entries = bindings.data();
+		m_bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+	}
+	return m_bindGroup != nullptr;
+}
+
+void SurfaceCompute::terminateBuffers() {
+	// A readback in flight is freed by its callback
+	if (m_rangeReadback && m_rangeReadback->pending) {
+		m_rangeReadback->orphaned = true;
+	} else if (m_rangeReadback) {
+		if (m_rangeReadback->buffer) wgpuBufferRelease(m_rangeReadback->buffer);
+		delete m_rangeReadback;
+	}
+	m_rangeReadback = nullptr;
+	if (m_bindGroup) wgpuBindGroupRelease(m_bindGroup);
+	if (m_indexBuffer) wgpuBufferRelease(m_indexBuffer);
+	if (m_vertexBuffer) wgpuBufferRelease(m_vertexBuffer);
+	if (m_rangeBuffer) wgpuBufferRelease(m_rangeBuffer);
+	if (m_paramsBuffer) wgpuBufferRelease(m_paramsBuffer);
+	m_bindGroup = nullptr;
+	m_indexBuffer = nullptr;
+	m_vertexBuffer = nullptr;
+	m_rangeBuffer = nullptr;
+	m_paramsBuffer = nullptr;
+	m_vertexBytes = 0;
+	m_indexBytes = 0;
+	m_vertexCount = 0;
+	m_indexCount = 0;
+}
+
+bool SurfaceCompute::dispatch(WGPUDevice device, WGPUQueue queue,
+	float uMin, float uMax, float vMin, float vMax,
+	int uSegments, int vSegments, std::string& errorMsg) {
+	PROFILE_FUNCTION();
+
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	if (!m_gridPipeline || uSegments < 1 || vSegments < 1) return false;
+
+	const size_t vertexCount = (size_t)(uSegments + 1) * (vSegments + 1);
+	const size_t indexCount = (size_t)uSegments * vSegments * 6;
+	const size_t vertexBytes = vertexCount * sizeof(PackedVertex);
+	const size_t indexBytes = indexCount * sizeof(uint32_t);
+
+	WGPUSupportedLimits limits{};
+	wgpuDeviceGetLimits(device, &limits);
+	const uint64_t maxBinding = std::min<uint64_t>(limits.limits.maxStorageBufferBindingSize, limits.limits.maxBufferSize);
+	if (vertexBytes > maxBinding || indexBytes > maxBinding) {
+		errorMsg = "Mesh needs " + std::to_string(vertexBytes >> 20) + " MB, above the device limit of "
+			+ std::to_string(maxBinding >> 20) + " MB";
+		return false;
+	}
+
+	if (!initBuffers(device, vertexBytes, indexBytes)) {
+		errorMsg = "Could not allocate the surface compute buffers";
+		return false;
+	}
+
+	Params params = { uMin, uMax, vMin, vMax, (uint32_t)uSegments, (uint32_t)vSegments, 1e-3f, 0.0f };
+	wgpuQueueWriteBuffer(queue, m_paramsBuffer, 0, &params, sizeof(Params));
+	const uint32_t rangeInit[2] = { 0xffffffffu, 0u };
+	wgpuQueueWriteBuffer(queue, m_rangeBuffer, 0, rangeInit, sizeof(rangeInit));
+
+	WGPUCommandEncoderDescriptor encoderDesc{};
+	encoderDesc.label = "Surface compute encoder";
+	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+
+	WGPUComputePassDescriptor passDesc{};
+	passDesc.label = "Surface compute pass";
+	WGPUComputePassTimestampWrite timestamps[2];
+	passDesc.timestampWriteCount = Profiler::shared().computePassTimestamps("Surface compute pass", timestamps);
+	passDesc.timestampWrites = timestamps;
+	WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+	wgpuComputePassEncoderSetBindGroup(pass, 0, m_bindGroup, 0, nullptr);
+
+	// Heights and normals per grid point, then the indices of every cell
+	auto groups = [](int count) { return ((uint32_t)count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE; };
+	wgpuComputePassEncoderSetPipeline(pass, m_gridPipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(uSegments + 1), groups(vSegments + 1), 1);
+	wgpuComputePassEncoderSetPipeline(pass, m_meshPipeline);
+	wgpuComputePassEncoderDispatchWorkgroups(pass, groups(uSegments + 1), groups(vSegments + 1), 1);
+
+	wgpuComputePassEncoderEnd(pass);
+	wgpuComputePassEncoderRelease(pass);
+
+	// The height range follows the mesh back in the same submission, unless the last one is still mapping
+	++m_dispatchSerial;
+	const bool readRange = !m_rangeReadback->pending;
+	if (readRange) wgpuCommandEncoderCopyBufferToBuffer(encoder, m_rangeBuffer, 0, m_rangeReadback->buffer, 0, 2 * sizeof(uint32_t));
+
+	WGPUCommandBufferDescriptor cmdBufferDesc{};
+	cmdBufferDesc.label = "Surface compute commands";
+	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+	wgpuCommandEncoderRelease(encoder);
+	wgpuQueueSubmit(queue, 1, &command);
+	wgpuCommandBufferRelease(command);
+	if (readRange) mapHeightRange();
+
+	m_vertexCount = (int)vertexCount;
+	m_indexCount = (int)indexCount;
+	return true;
+}
+
+// ─── Height Range ───────────────────────────────────────────────────────────
+
+void SurfaceCompute::mapHeightRange() {
+	m_rangeReadback->pending = true;
+	m_rangeReadback->copiedSerial = m_dispatchSerial;
+	wgpuBufferMapAsync(m_rangeReadback->buffer, WGPUMapMode_Read, 0, 2 * sizeof(uint32_t), onHeightRangeMapped, m_rangeReadback);
+}
+
+void SurfaceCompute::onHeightRangeMapped(WGPUBufferMapAsyncStatus status, void* userdata) {
+	RangeReadback* readback = static_cast<RangeReadback*>(userdata);
+	readback->pending = false;
+	// A failed mapping keeps the previous range, rather than asking again forever
+	readback->readSerial = readback->copiedSerial;
+	if (status == WGPUBufferMapAsyncStatus_Success) {
+		if (!readback->orphaned) {
+			std::memcpy(readback->bits, wgpuBufferGetConstMappedRange(readback->buffer, 0, 2 * sizeof(uint32_t)), sizeof(readback->bits));
+		}
+		wgpuBufferUnmap(readback->buffer);
+	}
+	if (readback->orphaned) {
+		wgpuBufferRelease(readback->buffer);
+		delete readback;
+	}
+}
+
+void SurfaceCompute::readHeightRange(WGPUDevice device, WGPUQueue queue) {
+	if (!m_rangeReadback || m_rangeReadback->pending || !heightRangePending()) return;
+
+	// A dispatch went out while the previous range was mapping: copy its range now
+	WGPUCommandEncoderDescriptor encoderDesc{};
+	encoderDesc.label = "Surface range encoder";
+	WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+	wgpuCommandEncoderCopyBufferToBuffer(encoder, m_rangeBuffer, 0, m_rangeReadback->buffer, 0, 2 * sizeof(uint32_t));
+	WGPUCommandBufferDescriptor cmdBufferDesc{};
+	cmdBufferDesc.label = "Surface range commands";
+	WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+	wgpuCommandEncoderRelease(encoder);
+	wgpuQueueSubmit(queue, 1, &command);
+	wgpuCommandBufferRelease(command);
+	mapHeightRange();
+}
+
+bool SurfaceCompute::heightRangePending() const {
+	return m_rangeReadback && m_rangeReadback->readSerial != m_dispatchSerial;
+}
+
+bool SurfaceCompute::heightRange(float range[2]) const {
+	if (!m_rangeReadback || m_rangeReadback->readSerial == 0) return false;
+	const float lo = fromOrderedBits(m_rangeReadback->bits[0]);
+	const float hi = fromOrderedBits(m_rangeReadback->bits[1]);
+	// Untouched atomics: no finite height at all
+	if (!(lo <= hi)) return false;
+	range[0] = lo;
+	range[1] = hi;
+	return true;
+}
+
+void SurfaceCompute::terminate() {
+	terminateBuffers();
+	terminatePipelines();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class ExpressionParser;
+
+// Evaluates a parametric surface (u, v) -> R^3 on the GPU.
+// The compiled expressions are turned into a WGSL compute shader that writes the vertex
+// grid (PackedVertex layout) and its uint32 TriangleList indices straight
+// into GPU buffers, matching GraphObjects::generateParametricSurface.
+// Changing the ranges or resolution only costs a dispatch; the shader is rebuilt when the
+// generated source changes.
+class SurfaceCompute {
+public:
+	SurfaceCompute() = default;
+	~SurfaceCompute();
+
+	SurfaceCompute(const SurfaceCompute&) = delete;
+	SurfaceCompute& operator=(const SurfaceCompute&) = delete;
+
+	// (Re)build the shader for these parsers. outputDim 1 plots z = f(u, v), 2 maps to (f0, f1, 0).
+	// Returns false and sets errorMsg if an expression has no WGSL equivalent.
+	bool updateShader(WGPUDevice device, const ExpressionParser* parsers, int outputDim, std::string& errorMsg);
+
+	// Evaluate the surface into vertexBuffer() / indexBuffer(). Returns false and sets errorMsg if the mesh
+	// does not fit the device's storage buffer limits.
+	bool dispatch(WGPUDevice device, WGPUQueue queue,
+		float uMin, float uMax, float vMin, float vMax,
+		int uSegments, int vSegments, std::string& errorMsg);
+
+	// Height range of the latest dispatch, read back from the shader's atomics a frame or so later.
+	// readHeightRange, once per frame, copies the range of a dispatch made while the previous one was
+	// still mapping; heightRange gives the last range read, false before the first or if none was finite.
+	void readHeightRange(WGPUDevice device, WGPUQueue queue);
+	bool heightRange(float range[2]) const;
+	bool heightRangePending() const;
+
+	WGPUBuffer vertexBuffer() const { return m_vertexBuffer; }
+	WGPUBuffer indexBuffer() const { return m_indexBuffer; }
+	int vertexCount() const { return m_vertexCount; }
+	int indexCount() const { return m_indexCount; }
+
+	void terminate();
+
+private:
+	// The same structure as in the generated shader, replicated in C++
+	struct Params {
+		float uMin, uMax, vMin, vMax;
+		uint32_t uSegments, vSegments;
+		float eps;         // relative finite-difference step, for expressions without symbolic derivatives
+		float _pad;
+	};
+	static_assert(sizeof(Params) % 16 == 0);
+
+	bool initPipelines(WGPUDevice device, const std::string& source);
+	void terminatePipelines();
+	bool initBuffers(WGPUDevice device, size_t vertexBytes, size_t indexBytes);
+	void terminateBuffers();
+	void mapHeightRange();
+	static void onHeightRangeMapped(WGPUBufferMapAsyncStatus status, void* userdata);
+
+	// Outlives the SurfaceCompute when it is destroyed mid-mapping, until the callback frees it
+	struct RangeReadback {
+		WGPUBuffer buffer = nullptr;        // MapRead copy of m_rangeBuffer
+		bool pending = false;               // mapping in flight
+		bool orphaned = false;
+		uint32_t bits[2] = {};              // ordered bits of the min and max height
+		uint64_t copiedSerial = 0;          // dispatch whose range is being mapped
+		uint64_t readSerial = 0;            // dispatch whose range is in bits, 0 for none
+	};
+
+	size_t m_sourceHash = 0;
+	WGPUShaderModule m_shaderModule = nullptr;
+	WGPUBindGroupLayout m_bindGroupLayout = nullptr;
+	WGPUPipelineLayout m_pipelineLayout = nullptr;
+	WGPUComputePipeline m_gridPipeline = nullptr;   // positions + normals per grid point
+	WGPUComputePipeline m_meshPipeline = nullptr;   // indices per cell
+
+	WGPUBuffer m_paramsBuffer = nullptr;
+	WGPUBuffer m_rangeBuffer = nullptr;             // atomic min/max height, as order-preserving uints
+	RangeReadback* m_rangeReadback = nullptr;
+	uint64_t m_dispatchSerial = 0;
+	WGPUBuffer m_vertexBuffer = nullptr;
+	WGPUBuffer m_indexBuffer = nullptr;
+	size_t m_vertexBytes = 0;
+	size_t m_indexBytes = 0;
+	WGPUBindGroup m_bindGroup = nullptr;
+	int m_vertexCount = 0;
+	int m_indexCount = 0;
+};
@@ -1,21 +1,77 @@
-// #include <emscripten.h>
-// #include <webgpu/webgpu.h>
-
 #include "webgpu-utils.h"
 
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
 #include <glfw3webgpu.h>
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <string>
 #include <cmath>
 #include <unordered_map>
 
 #include "Application.h"
 
+// App --batch [--size WxH] [--out DIR] [--frames N] [--no-fit] [--list FILE] ITEM...
+// Renders one PNG per item without opening a window; see Application::BatchOptions for the items.
+static int runBatch(int argc, char** argv) {
+	Application::BatchOptions options;
+	uint32_t width = 512, height = 512;
+	for (int i = 2; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+		if (arg == "--size") {
+			if (std::sscanf(value, "%ux%u", &width, &height) != 2) {
+				std::cerr << "--size takes WxH, got \"" << value << "\"" << std::endl;
+				return 1;
+			}
+			++i;
+		} else if (arg == "--out") {
+			options.outputDir = value;
+			++i;
+		} else if (arg == "--frames") {
+			options.framesInFlight = std::max(1, std::atoi(value));
+			++i;
+		} else if (arg == "--no-fit") {
+			options.fitView = false;
+		} else if (arg == "--list") {
+			// One item per line; blank lines and # comments are skipped
+			std::ifstream list(value);
+			if (!list) {
+				std::cerr << "Could not open " << value << std::endl;
+				return 1;
+			}
+			for (std::string line; std::getline(list, line);) {
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (!line.empty() && line[0] != '#') options.items.push_back(line);
+			}
+			++i;
+		} else {
+			options.items.push_back(arg);
+		}
+	}
+	if (options.items.empty()) {
+		std::cerr << "Usage: App --batch [--size WxH] [--out DIR] [--frames N] [--no-fit] [--list FILE] ITEM..." << std::endl;
+		return 1;
+	}
+
+	Application app;
+	if (!app.onInitHeadless(width, height)) return 1;
+	const bool ok = app.renderBatch(options);
+	app.onFinish();
+	return ok ? 0 : 1;
+}
+
 // #include "glm/glm.hpp"
-int main (int, char**) {
+int main (int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--batch") return runBatch(argc, argv);
 
 	Application app;
 	if (!app.onInit()) return 1;
@@ -24,11 +80,20 @@ int main (int, char**) {
 	std::cout << "Current Vertex Buffer size: " << app.m_current_limits.limits.maxBufferSize << " bytes\t" << app.m_current_limits.limits.maxBufferSize/44 << " VAStructs" << std::endl;
 
 
+#ifdef __EMSCRIPTEN__
+	// The browser drives frames from requestAnimationFrame; blocking here would freeze the page.
+	// main unwinds without returning (simulate_infinite_loop), so app stays alive.
+	emscripten_set_main_loop_arg([](void* userData) {
+		Application& app = *reinterpret_cast<Application*>(userData);
+		app.onFrame();
+	}, &app, 0, true);
+#else
 	while (app.isRunning()) {
 		app.onFrame();
 	}
 
 	app.onFinish();
+#endif
 
     return 0;
 }
@@ -0,0 +1,24 @@
+// Resolves the weighted-blended transparency targets written by surface.wgsl's fs_oit.
+// Blended over the scene with SrcAlpha / OneMinusSrcAlpha.
+@group(0) @binding(0) var accumTexture: texture_2d<f32>;
+@group(0) @binding(1) var revealageTexture: texture_2d<f32>;
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> @builtin(position) vec4f {
+	// One triangle covering the screen
+	let uv = vec2f(f32((index << 1u) & 2u), f32(index & 2u));
+	return vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+
+@fragment
+fn fs_main(@builtin(position) position: vec4f) -> @location(0) vec4f {
+	let coord = vec2i(position.xy);
+	let revealage = textureLoad(revealageTexture, coord, 0).r;
+	if (revealage >= 0.9999) {
+		discard;
+	}
+	// Keep overflowed half floats finite, or the average becomes inf / inf
+	let accum = min(textureLoad(accumTexture, coord, 0), vec4f(65504.0));
+	let average = accum.rgb / max(accum.a, 1e-5);
+	return vec4f(average, 1.0 - revealage);
+}
@@ -0,0 +1,35 @@
+// Unlit LineList for function wireframes and streamlines, PackedVertex layout
+struct VertexInput {
+	@location(0) position: vec3f,
+	@location(1) normal: vec2f,
+	@location(2) color: u32,
+};
+
+struct VertexOutput {
+	@builtin(position) position: vec4f,
+	@location(0) color: vec3f,
+};
+
+struct MyUniforms {
+	projectionMatrix: mat4x4f,
+	viewMatrix: mat4x4f,
+	modelMatrix: mat4x4f,
+	color: vec4f,
+	cameraWorldPosition: vec3f,
+	time: f32,
+};
+
+@group(0) @binding(0) var<uniform> uMyUniforms: MyUniforms;
+
+@vertex
+fn vs_main(in: VertexInput) -> VertexOutput {
+	var out: VertexOutput;
+	out.position = uMyUniforms.projectionMatrix * uMyUniforms.viewMatrix * uMyUniforms.modelMatrix * vec4f(in.position, 1.0);
+	out.color = unpack4x8unorm(in.color).rgb;
+	return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+	return vec4f(in.color, 1.0);
+}
@@ -1,15 +1,15 @@
+// PackedVertex: octahedral snorm16 normal, RGBA8 colour or colormap scalar
 struct VertexInput {
 	@location(0) position: vec3f,
-	@location(1) normal: vec3f,
-	@location(2) color: vec3f,
-	@location(3) uv: vec2f,
+	@location(1) normal: vec2f,
+	@location(2) color: u32,
 };
 
 struct VertexOutput {
 	@builtin(position) position: vec4f,
 	@location(0) color: vec3f,
 	@location(1) normal: vec3f,
-	@location(2) uv: vec2f,
+	@location(2) scalar: f32,
 	@location(3) viewDirection: vec3<f32>,
 };
 
@@ -30,25 +30,113 @@ struct LightingUniforms {
 	ks: f32,
 }
 
+struct FunctionUniforms {
+	scalarMin: f32,
+	scalarMax: f32,
+	colormapRow: f32,
+	colormapped: u32,
+	tint: vec4f,
+};
+
 @group(0) @binding(0) var<uniform> uMyUniforms: MyUniforms;
 @group(0) @binding(1) var baseColorTexture: texture_2d<f32>;
 @group(0) @binding(2) var textureSampler: sampler;
 @group(0) @binding(3) var<uniform> uLighting: LightingUniforms;
+@group(1) @binding(0) var<uniform> uFunction: FunctionUniforms;
+
+const COLORMAP_SIZE: f32 = 256.0;
+
+// Inverse of GraphObjects::packNormal
+fn octDecode(e: vec2f) -> vec3f {
+	var n = vec3f(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	let t = max(-n.z, 0.0);
+	n.x += select(t, -t, n.x >= 0.0);
+	n.y += select(t, -t, n.y >= 0.0);
+	return normalize(n);
+}
 
 @vertex
 fn vs_main(in: VertexInput) -> VertexOutput {
 	var out: VertexOutput;
 	let worldPosition = uMyUniforms.modelMatrix * vec4<f32>(in.position, 1.0);
 	out.position = uMyUniforms.projectionMatrix * uMyUniforms.viewMatrix * worldPosition;
-	out.normal = (uMyUniforms.modelMatrix * vec4f(in.normal, 0.0)).xyz;
-	out.color = in.color;
-	out.uv = in.uv;
+	out.normal = (uMyUniforms.modelMatrix * vec4f(octDecode(in.normal), 0.0)).xyz;
+	out.color = unpack4x8unorm(in.color).rgb;
+	out.scalar = bitcast<f32>(in.color);
 	out.viewDirection = uMyUniforms.cameraWorldPosition - worldPosition.xyz;
 	return out;
 }
 
-@fragment
-fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+// Heightfield pipelines (Heightfield.h): no vertex buffer, the heights of the grid at group 2
+struct HeightfieldUniforms {
+	uvMin: vec2f,
+	uvMax: vec2f,
+};
+
+@group(2) @binding(0) var heightTexture: texture_2d<f32>;
+@group(2) @binding(1) var<uniform> uHeightfield: HeightfieldUniforms;
+
+const LOD_LEVELS: u32 = 3u;  // GraphObjects::LOD_LEVELS
+
+fn heightAt(p: vec2u) -> f32 {
+	return textureLoad(heightTexture, vec2i(p), 0).r;
+}
+
+fn gridPoint(p: vec2u, segments: vec2u) -> vec2f {
+	return mix(uHeightfield.uvMin, uHeightfield.uvMax, vec2f(p) / vec2f(segments));
+}
+
+// Infinities and NaNs, which the comparison operators may be compiled to ignore
+fn finiteValue(x: f32) -> bool {
+	return (bitcast<u32>(x) & 0x7f800000u) != 0x7f800000u;
+}
+
+// Six vertices per cell in the corner order of GraphObjects::addGridLods, level after level
+@vertex
+fn vs_heightfield(@builtin(vertex_index) vertexIndex: u32) -> VertexOutput {
+	let segments = textureDimensions(heightTexture) - vec2u(1u);
+	var index = vertexIndex;
+	var stride = 1u;
+	var cells = segments;
+	for (var level = 1u; level < LOD_LEVELS && index >= cells.x * cells.y * 6u; level++) {
+		index -= cells.x * cells.y * 6u;
+		stride *= 2u;
+		cells = (segments + vec2u(stride - 1u)) / stride;
+	}
+	var corners = array<vec2u, 6>(vec2u(0u, 0u), vec2u(1u, 0u), vec2u(1u, 1u), vec2u(0u, 0u), vec2u(1u, 1u), vec2u(0u, 1u));
+	let cell = vec2u((index / 6u) % cells.x, (index / 6u) / cells.x);
+	let lo = min(cell * stride, segments);
+	let hi = min((cell + vec2u(1u)) * stride, segments);
+	let p = min((cell + corners[index % 6u]) * stride, segments);
+
+	// Central differences one stride away, one-sided at the edges
+	let h = heightAt(p);
+	let left = vec2u(select(p.x - stride, 0u, p.x < stride), p.y);
+	let right = vec2u(min(p.x + stride, segments.x), p.y);
+	let down = vec2u(p.x, select(p.y - stride, 0u, p.y < stride));
+	let up = vec2u(p.x, min(p.y + stride, segments.y));
+	let dhdu = (heightAt(right) - heightAt(left)) / (gridPoint(right, segments).x - gridPoint(left, segments).x);
+	let dhdv = (heightAt(up) - heightAt(down)) / (gridPoint(up, segments).y - gridPoint(down, segments).y);
+	var normal = vec3f(-dhdu, -dhdv, 1.0);
+	normal = select(vec3f(0.0, 0.0, 1.0), normal, finiteValue(dhdu) && finiteValue(dhdv));
+
+	// A cell with a non-finite corner collapses to a point, so both its triangles are dropped
+	let drawn = finiteValue(heightAt(lo)) && finiteValue(heightAt(vec2u(hi.x, lo.y)))
+		&& finiteValue(heightAt(vec2u(lo.x, hi.y))) && finiteValue(heightAt(hi));
+	let gridPosition = select(vec3f(gridPoint(lo, segments), 0.0), vec3f(gridPoint(p, segments), h), drawn);
+
+	var out: VertexOutput;
+	let worldPosition = uMyUniforms.modelMatrix * vec4<f32>(gridPosition, 1.0);
+	out.position = uMyUniforms.projectionMatrix * uMyUniforms.viewMatrix * worldPosition;
+	out.normal = (uMyUniforms.modelMatrix * vec4f(normalize(normal), 0.0)).xyz;
+	out.color = vec3f(1.0);
+	out.scalar = h;
+	out.viewDirection = uMyUniforms.cameraWorldPosition - worldPosition.xyz;
+	return out;
+}
+
+// Lit colour of a fragment, shared by the opaque and transparent entry points
+fn shade(in: VertexOutput) -> vec3f {
 	var N = normalize(in.normal);
 	let V = normalize(in.viewDirection);
 
@@ -57,7 +145,14 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
 		N = -N;
 	}
 
-	let baseColor = in.color;
+	// Colormapped meshes look their colour up per fragment; a flat range gets
+	// the same fallback colour as GraphObjects::heightToColor
+	let span = uFunction.scalarMax - uFunction.scalarMin;
+	let t = clamp((in.scalar - uFunction.scalarMin) / max(span, 1e-6), 0.0, 1.0);
+	let u = mix(0.5, COLORMAP_SIZE - 0.5, t) / COLORMAP_SIZE;
+	var mapped = textureSample(baseColorTexture, textureSampler, vec2f(u, uFunction.colormapRow)).rgb;
+	mapped = select(mapped, vec3f(0.5, 0.7, 1.0), span < 1e-6);
+	let baseColor = select(in.color, mapped, uFunction.colormapped != 0u) * uFunction.tint.rgb;
 	let kd = uLighting.kd;
 	let ks = uLighting.ks;
 	let hardness = uLighting.hardness;
@@ -76,6 +171,29 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
 
 		color += baseColor * kd * diffuse + ks * specular;
 	}
+	return color;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+	return vec4f(shade(in), 1.0);
+}
 
-	return vec4f(color, 1.0);
+struct OitOutput {
+	@location(0) accum: vec4f,
+	@location(1) revealage: f32,
+};
+
+// Weighted-blended OIT (McGuire and Bavoil 2013) for functions with opacity below 1: premultiplied
+// colour is summed with a weight that falls off with distance, and the revealage target keeps the
+// product of (1 - alpha). composite.wgsl resolves the two over the opaque scene.
+@fragment
+fn fs_oit(in: VertexOutput) -> OitOutput {
+	let alpha = uFunction.tint.a;
+	let d = length(in.viewDirection);
+	let weight = clamp(10.0 / (1e-5 + pow(d / 5.0, 2.0) + pow(d / 200.0, 6.0)), 1e-2, 3e3);
+	var out: OitOutput;
+	out.accum = vec4f(shade(in) * alpha, alpha) * weight;
+	out.revealage = alpha;
+	return out;
 }
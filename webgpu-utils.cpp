@@ -5,6 +5,10 @@
 #include <vector>
 #include <cassert>
 
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
 WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions const * options) {
 	// A simple structure holding the local information shared with the
 	// onAdapterRequestEnded callback.
@@ -43,7 +47,11 @@ WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions cons
 	// In theory we should wait until onAdapterReady has been called, which
 	// could take some time (what the 'await' keyword does in the JavaScript
 	// code). In practice, we know that when the wgpuInstanceRequestAdapter()
-	// function returns its callback has been called.
+	// function returns its callback has been called. The browser answers
+	// from its event loop instead, so yield to it until then (ASYNCIFY).
+#ifdef __EMSCRIPTEN__
+	while (!userData.requestEnded) emscripten_sleep(10);
+#endif
 	assert(userData.requestEnded);
 
 	return userData.adapter;
@@ -74,6 +82,9 @@ WGPUDevice requestDevice(WGPUAdapter adapter, WGPUDeviceDescriptor const * descr
 		(void*)&userData
 	);
 
+#ifdef __EMSCRIPTEN__
+	while (!userData.requestEnded) emscripten_sleep(10);
+#endif
 	assert(userData.requestEnded);
 
 	return userData.device;